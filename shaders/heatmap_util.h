@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Color scale of the cost heatmaps (DebugMethod::eHeat*), shared by the resolve shader and the
+// legend drawn by the UI, so both show the same colors.
+
+#ifndef HEATMAP_UTIL_H
+#define HEATMAP_UTIL_H
+
+#include "nvshaders/slang_types.h"
+
+#ifndef INLINE
+#ifdef __cplusplus
+#define INLINE inline
+#else
+#define INLINE
+#endif
+#endif
+
+// Turbo colormap, polynomial approximation: 0 is dark blue, 1 is dark red
+INLINE float3 heatmapColor(float t)
+{
+  t                = clamp(t, 0.0F, 1.0F);
+  const float4 v4  = float4(1.0F, t, t * t, t * t * t);
+  const float2 v2  = float2(v4.z * v4.z, v4.w * v4.z);
+  const float  red = dot(v4, float4(0.13572138F, 4.61539260F, -42.66032258F, 132.13108234F))
+                    + dot(v2, float2(-152.94239396F, 59.28637943F));
+  const float green = dot(v4, float4(0.09140261F, 2.19418839F, 4.84296658F, -14.18503333F))
+                      + dot(v2, float2(4.27729857F, 2.82956604F));
+  const float blue = dot(v4, float4(0.10667330F, 12.64194608F, -60.58204836F, 110.36276771F))
+                     + dot(v2, float2(-89.90310912F, 27.34824973F));
+  return clamp(float3(red, green, blue), float3(0.0F), float3(1.0F));
+}
+
+// Position of a cost on the color scale; the scale is logarithmic, as the costs often span
+// several orders of magnitude (a few any-hits on most pixels, hundreds in the foliage)
+INLINE float heatmapScale(float value, float rangeMax)
+{
+  return log2(1.0F + value) / log2(1.0F + max(rangeMax, 1.0F));
+}
+
+#endif  // HEATMAP_UTIL_H
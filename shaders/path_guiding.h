@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+// Path guiding: directional parameterization of the guiding distributions, shared by the shaders
+// and by the host, which builds the distributions from the training records.
+//
+// Directions are mapped to the unit square with the equal-area cylindrical projection
+// (u: cosine of the polar angle, v: azimuth), so all bins of a `resolution` x `resolution` grid
+// cover the same solid angle, 4*PI / resolution^2.
+
+#ifndef PATH_GUIDING_H
+#define PATH_GUIDING_H
+
+#include "nvshaders/slang_types.h"
+
+#ifndef INLINE
+#ifdef __cplusplus
+#define INLINE inline
+#else
+#define INLINE
+#endif
+#endif
+
+#ifdef __cplusplus
+#define GUIDING_ATAN2(y, x) std::atan2(y, x)
+#else
+#define GUIDING_ATAN2(y, x) atan2(y, x)
+#endif
+
+#define GUIDING_PI 3.14159265358979F
+
+// Unit direction to [0,1]^2
+INLINE float2 guidingDirToSquare(float3 dir)
+{
+  const float u   = clamp(dir.z * 0.5F + 0.5F, 0.0F, 1.0F);
+  float       phi = GUIDING_ATAN2(dir.y, dir.x);
+  if(phi < 0.0F)
+    phi += 2.0F * GUIDING_PI;
+  return float2(u, clamp(phi / (2.0F * GUIDING_PI), 0.0F, 1.0F));
+}
+
+// [0,1]^2 to unit direction
+INLINE float3 guidingSquareToDir(float2 p)
+{
+  const float z   = 2.0F * p.x - 1.0F;
+  const float r   = sqrt(max(0.0F, 1.0F - z * z));
+  const float phi = 2.0F * GUIDING_PI * p.y;
+  return float3(r * cos(phi), r * sin(phi), z);
+}
+
+// Index of the directional bin of a direction
+INLINE int guidingBin(float3 dir, int resolution)
+{
+  const float2 p = guidingDirToSquare(dir);
+  const int    x = min(int(p.x * float(resolution)), resolution - 1);
+  const int    y = min(int(p.y * float(resolution)), resolution - 1);
+  return y * resolution + x;
+}
+
+#endif  // PATH_GUIDING_H
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Sample generator of the path tracer, shared by the shaders and the CPU sampler benchmark.
+//
+// The random numbers of a path are requested by 4D blocks ("dimensions"), allocated explicitly
+// (SAMPLER_DIM_*), so a given decision of the path always uses the same coordinates of the sequence.
+// - White noise : hash of (pixel, sample, dimension). The GPU path tracer does not use it: its white
+//                 noise is the xxhash stream of the pixel, see getRandom() in gltf_pathtrace.slang
+// - Sobol       : Owen-scrambled Sobol, shuffled and scrambled per pixel and per dimension
+//                 (Burley 2020, "Practical Hash-based Owen Scrambling")
+// - Blue noise  : the same Sobol sequence for all pixels, digitally shifted per pixel by a dither
+//                 mask stratified over screen-space blocks: the error of neighbouring pixels is
+//                 anti-correlated, which looks smoother at low sample counts.
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "nvshaders/slang_types.h"
+
+#ifndef INLINE
+#ifdef __cplusplus
+#define INLINE inline
+#else
+#define INLINE
+#endif
+#endif
+
+#define SAMPLER_WHITE_NOISE 0
+#define SAMPLER_SOBOL 1
+#define SAMPLER_BLUE_NOISE 2
+
+// Dimension allocation: 4D blocks
+#define SAMPLER_DIM_CAMERA 0  // xy: sub-pixel position, zw: lens
+#define SAMPLER_DIMS_PER_BOUNCE 4
+#define SAMPLER_DIM_LIGHT(depth) (1 + (depth) * SAMPLER_DIMS_PER_BOUNCE + 0)  // x: lights or environment, yzw: sample
+#define SAMPLER_DIM_BSDF(depth) (1 + (depth) * SAMPLER_DIMS_PER_BOUNCE + 1)   // xyz: BSDF sample, w: Russian roulette
+#define SAMPLER_DIM_EVAL(depth) (1 + (depth) * SAMPLER_DIMS_PER_BOUNCE + 2)   // xyz: BSDF evaluation for the light
+#define SAMPLER_DIM_GUIDE(depth) (1 + (depth) * SAMPLER_DIMS_PER_BOUNCE + 3)  // x: BSDF or guide, yzw: guide sample
+
+// Direction numbers of the first 4 Sobol dimensions (Joe & Kuo)
+static const uint SOBOL_DIRECTIONS[4][32] = {
+    {0x80000000, 0x40000000, 0x20000000, 0x10000000, 0x08000000, 0x04000000, 0x02000000, 0x01000000,
+     0x00800000, 0x00400000, 0x00200000, 0x00100000, 0x00080000, 0x00040000, 0x00020000, 0x00010000,
+     0x00008000, 0x00004000, 0x00002000, 0x00001000, 0x00000800, 0x00000400, 0x00000200, 0x00000100,
+     0x00000080, 0x00000040, 0x00000020, 0x00000010, 0x00000008, 0x00000004, 0x00000002, 0x00000001},
+    {0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+     0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+     0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+     0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff},
+    {0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+     0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+     0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+     0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555},
+    {0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+     0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+     0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+     0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093}};
+
+INLINE uint samplerReverseBits(uint x)
+{
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+// Integer hash (lowbias32)
+INLINE uint samplerHash(uint x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+INLINE uint samplerHashCombine(uint seed, uint v)
+{
+  return seed ^ (samplerHash(v) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+// Each bit only depends on the lower bits: reversed, this is an Owen scrambling
+INLINE uint laineKarrasPermutation(uint x, uint seed)
+{
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+
+INLINE uint nestedUniformScramble(uint x, uint seed)
+{
+  return samplerReverseBits(laineKarrasPermutation(samplerReverseBits(x), seed));
+}
+
+INLINE uint sobolSample(uint index, int dim)
+{
+  uint x = 0;
+  for(int bit = 0; bit < 32; bit++)
+  {
+    if(((index >> bit) & 1u) != 0)
+      x ^= SOBOL_DIRECTIONS[dim][bit];
+  }
+  return x;
+}
+
+INLINE float samplerToFloat(uint x)
+{
+  return float(x >> 8) * (1.0F / 16777216.0F);  // [0, 1)
+}
+
+// Owen-scrambled Sobol coordinate, 32-bit fixed point
+INLINE uint scrambledSobol(uint shuffledIndex, int dim, uint seed)
+{
+  return nestedUniformScramble(sobolSample(shuffledIndex, dim), samplerHashCombine(seed, uint(dim)));
+}
+
+// Interleave the bits of the pixel coordinates (16 bits each)
+INLINE uint mortonCode2D(uint2 p)
+{
+  uint x = p.x & 0xffffu;
+  uint y = p.y & 0xffffu;
+  x      = (x | (x << 8)) & 0x00ff00ffu;
+  x      = (x | (x << 4)) & 0x0f0f0f0fu;
+  x      = (x | (x << 2)) & 0x33333333u;
+  x      = (x | (x << 1)) & 0x55555555u;
+  y      = (y | (y << 8)) & 0x00ff00ffu;
+  y      = (y | (y << 4)) & 0x0f0f0f0fu;
+  y      = (y | (y << 2)) & 0x33333333u;
+  y      = (y | (y << 1)) & 0x55555555u;
+  return x | (y << 1);
+}
+
+// Dither value of a pixel, 32-bit fixed point, stratified over the pixels: the 4 pixels of each
+// 2x2 block get the 4 quarters of [0,1), the 16 pixels of each 4x4 block the 16 sixteenths, etc.
+// The Z-order of the pixels is randomly permuted at each level of the quadtree, with `seed`
+// (Ahmed & Wonka 2020, "Screen-Space Blue-Noise Diffusion of Monte Carlo Sampling Error via
+// Hierarchical Ordering of Pixels").
+INLINE uint samplerDitherMask(uint2 pixel, uint seed)
+{
+  const uint morton = mortonCode2D(pixel);
+  uint       result = 0;
+  for(int level = 15; level >= 0; level--)
+  {
+    const uint prefix = (level == 15) ? 0u : (morton >> uint(2 * level + 2));
+    const uint digit  = (morton >> uint(2 * level)) & 3u;
+    const uint flip   = samplerHash(seed ^ samplerHash(prefix ^ (uint(level) << 27))) & 3u;
+    result |= (digit ^ flip) << uint(2 * level);
+  }
+  // The finest level of the quadtree gives the most significant bits
+  return samplerReverseBits(result) ^ (samplerHash(seed) & 0xffffu);
+}
+
+// State of the sampler for one sample of a pixel
+struct PathSampler
+{
+  int   mode;
+  uint2 pixel;
+  uint  index;  // Index of the sample in the sequence
+  uint  seed;   // Scrambling seed
+};
+
+INLINE PathSampler samplerInit(int mode, uint2 pixel, uint sampleIndex)
+{
+  PathSampler s;
+  s.mode  = mode;
+  s.pixel = pixel;
+  s.index = sampleIndex;
+  // Blue noise: the same sequence for all pixels, shifted by the dither mask
+  s.seed  = (mode == SAMPLER_BLUE_NOISE) ? 0u : samplerHashCombine(samplerHash(pixel.x), pixel.y);
+  return s;
+}
+
+// Sample of a 4D dimension block, in [0, 1)
+INLINE float4 samplerGet4D(PathSampler s, uint dimension)
+{
+  const uint seed = samplerHashCombine(s.seed, dimension);
+  uint4      u;
+  if(s.mode == SAMPLER_WHITE_NOISE)
+  {
+    const uint h = samplerHashCombine(seed, s.index);
+    u            = uint4(samplerHash(h), samplerHash(h + 1u), samplerHash(h + 2u), samplerHash(h + 3u));
+  }
+  else
+  {
+    // The index is shuffled per dimension block, to decorrelate the blocks (padding)
+    const uint index = nestedUniformScramble(s.index, seed);
+    u = uint4(scrambledSobol(index, 0, seed), scrambledSobol(index, 1, seed), scrambledSobol(index, 2, seed),
+              scrambledSobol(index, 3, seed));
+    if(s.mode == SAMPLER_BLUE_NOISE)
+    {
+      // Digital shift of the sequence by the dither mask, which keeps its stratification
+      u.x ^= samplerDitherMask(s.pixel, samplerHashCombine(seed, 4u));
+      u.y ^= samplerDitherMask(s.pixel, samplerHashCombine(seed, 5u));
+      u.z ^= samplerDitherMask(s.pixel, samplerHashCombine(seed, 6u));
+      u.w ^= samplerDitherMask(s.pixel, samplerHashCombine(seed, 7u));
+    }
+  }
+  return float4(samplerToFloat(u.x), samplerToFloat(u.y), samplerToFloat(u.z), samplerToFloat(u.w));
+}
+
+#endif  // SAMPLER_H
@@ -28,6 +28,16 @@
 
 #define WORKGROUP_SIZE 32
 #define SILHOUETTE_WORKGROUP_SIZE 16
+#define TAA_WORKGROUP_SIZE 16
+#define SVGF_WORKGROUP_SIZE 16
+#define LIGHT_CLUSTER_WORKGROUP_SIZE 64
+#define LIGHT_CLUSTER_HISTOGRAM_BINS 8
+#define RADIANCE_CACHE_WORKGROUP_SIZE 256
+#define HEATMAP_WORKGROUP_SIZE 16
+#define COMPOSITION_WORKGROUP_SIZE 64
+#define PATH_COUNTER_DEPTH_BINS 16
+#define PATH_COUNTER_NUM_LOBES 7
+#define PATH_COUNTER_NUM_FEATURES 12
 
 
 #define HDR_DIFFUSE_INDEX 0
@@ -50,6 +60,7 @@ enum OutputImage
   eDlssNormalRoughness,  // Normal and roughness (RGBA32)
   eDlssMotion,           // Motion (RGBA32)
   eDlssDepth,            // Depth (R32)
+  eObjectId,             // Render node of the first hit + 1, 0 for the background (R32_UINT, AOVs only)
 };
 
 // Binding points for descriptors
@@ -70,6 +81,34 @@ enum SilhouetteBindings
   eRGBAIImage,  // Out: the output image
 };
 
+// Binding points of the temporal anti-aliasing resolve
+enum TaaBindings
+{
+  eTaaColor,       // In: the jittered image, at render resolution
+  eTaaMotion,      // In: motion vectors (UV offset to the previous frame), at render resolution
+  eTaaHistory,     // In: the previous result, at output resolution
+  eTaaHistoryOut,  // Out: the new history
+  eTaaOutput,      // Out: the rendered image
+};
+
+// Binding points of the spatiotemporal denoiser (SVGF)
+enum SvgfBindings
+{
+  eSvgfColor,               // In: noisy image of the path tracer
+  eSvgfAlbedo,              // In: albedo guide
+  eSvgfNormalRoughness,     // In: normal/roughness guide
+  eSvgfMotion,              // In: motion vectors guide (pixels)
+  eSvgfDepth,               // In: view depth guide
+  eSvgfPrevIllumination,    // In: history of the previous frame, illumination and history length
+  eSvgfPrevMoments,         // In: history of the previous frame, luminance moments
+  eSvgfPrevNormalDepth,     // In: normal and depth of the previous frame
+  eSvgfIllumination,        // Out: new history
+  eSvgfMoments,             // Out: new history moments
+  eSvgfNormalDepth,         // Out: normal and depth of this frame
+  eSvgfFilterIn,            // In: illumination and variance, input of an a-trous iteration
+  eSvgfFilterOut,           // Out: result of an a-trous iteration, or the denoised image
+};
+
 enum DebugMethod
 {
   eNone,
@@ -83,6 +122,30 @@ enum DebugMethod
   eOpacity,
   eTexCoord0,
   eTexCoord1,
+  eRadianceCache,  // Path tracer: content of the radiance cache at the first hit
+  // Cost heatmaps, per pixel and per frame (see heatmap.cpp)
+  eHeatShaderTime,    // Path tracer: shader clock ticks of the pixel
+  eHeatTraversal,     // Path tracer: rays and candidate intersections returned to the shaders
+  eHeatAnyHit,        // Path tracer: any-hit invocations (alpha-tested and transmissive surfaces)
+  eHeatPathLength,    // Path tracer: path segments
+  eHeatLightSamples,  // Path tracer: light samples taken (next event estimation)
+  eHeatOverdraw,      // Rasterizer: fragments rasterized
+};
+
+// Cost heatmap of the frame: the renderers add the cost of each pixel to `values`,
+// the resolve pass shows them with a color scale over the tonemapped image
+struct HeatmapInfo
+{
+  uint*       values;    // Per-pixel cost, size.x * size.y
+  uint2       size;      // Resolution of the renderer writing the costs
+  DebugMethod mode;      // Cost written, DebugMethod::eHeat*
+  uint        maxValue;  // Largest cost, computed by the resolve pass
+};
+
+struct HeatmapPushConstant
+{
+  HeatmapInfo* heatmap;
+  float        rangeMax;  // Cost at the top of the color scale
 };
 
 
@@ -107,6 +170,126 @@ struct SceneFrameInfo
   float3      infinitePlaneBaseColor = float3(0.5, 0.5, 0.5);  // Default gray color
   float       infinitePlaneMetallic  = 0.0;                    // Default non-metallic
   float       infinitePlaneRoughness = 0.5;                    // Default medium roughness
+  float2      jitter                 = float2(0, 0);           // Rasterizer sub-pixel jitter (clip space), for TAA
+  HeatmapInfo* heatmap;  // Cost heatmap of the debug method, null otherwise
+};
+
+// Path guiding: path vertex written by the path tracer while training
+struct GuidingRecord
+{
+  float3 position;
+  float  weight;     // Luminance of the incident radiance, divided by the sampling pdf
+  float3 direction;  // Direction of the incident radiance (the sampled direction)
+  float  _pad0;
+};
+
+// Path guiding: node of the spatial binary tree
+struct GuidingNode
+{
+  int   child;  // First of the two children, -1 for a leaf
+  int   axis;   // Split axis
+  float split;  // Split position, the first child is below
+  int   leaf;   // Leaf: index of the directional distribution
+};
+
+// Path guiding: spatial binary tree of directional distributions of the incident radiance,
+// learned from the paths of the first frames (see path_guiding.h)
+struct PathGuidingField
+{
+  int            enabled      = 0;     // 1: directions are sampled from the guide, with MIS against the BSDF
+  int            training     = 0;     // 1: the path vertices are written to `records`
+  int            resolution   = 16;    // Directional bins per side (equal-area square)
+  int            maxRecords   = 0;     // Capacity of `records`
+  float          bsdfFraction = 0.5f;  // Probability of sampling the BSDF instead of the guide
+  float          minRoughness = 0.1f;  // Smoother materials are not guided
+  int            _pad0;
+  int            _pad1;
+  GuidingNode*   nodes;        // Spatial tree, the root is the first node
+  float*         cdfs;         // Per leaf, cumulative probabilities of the resolution^2 bins
+  GuidingRecord* records;      // Training path vertices
+  uint*          recordCount;  // Number of records written (may exceed maxRecords)
+};
+
+// Radiance cache: entry of the hash grid
+struct RadianceCacheEntry
+{
+  uint4  accum;        // Samples of the frame: radiance (fixed point, RADIANCE_CACHE_SCALE) and count
+  float3 radiance;     // Cached outgoing radiance, blended over the frames
+  float  sampleCount;  // Samples in `radiance`, up to RadianceCacheGrid::maxSamples
+  uint   age;          // Frames without samples, the entry is evicted after maxAge
+  uint   _pad0;
+  uint   _pad1;
+  uint   _pad2;
+};
+
+// Radiance cache of the path tracer: world-space hash grid of the outgoing radiance of the path
+// vertices, keyed by the cell of the position and the dominant axis of the normal
+// (see radiance_cache.h.slang). Cells grow with the distance to the camera.
+struct RadianceCacheGrid
+{
+  int                 enabled        = 0;      // 1: paths terminate in the cache
+  int                 terminateDepth = 1;      // First bounce at which paths may terminate
+  int                 trainingRatio  = 16;     // 1 pixel in trainingRatio traces full paths, updating the cache
+  uint                capacity       = 0;      // Number of entries, power of two
+  float3              cameraPosition;          // Origin of the level of detail
+  float               cellSize       = 0.01f;  // Size of the cells near the camera, world units
+  float               lodDistance    = 1.0f;   // Distance at which the cells start doubling in size
+  float               minRoughness   = 0.3f;   // Paths only terminate on rougher surfaces
+  float               maxSamples     = 64.0f;  // Temporal blending: minimum weight of a frame is 1/maxSamples
+  int                 maxAge         = 64;     // Frames after which an entry without samples is evicted
+  uint*               keys;                    // Checksum of the cell of each entry, 0 when empty
+  RadianceCacheEntry* entries;
+};
+
+struct RadianceCachePushConstant
+{
+  RadianceCacheGrid* grid;
+};
+
+// Path tracer counters: BSDF lobe sampled at a bounce
+enum PathCounterLobe
+{
+  eLobeAbsorb,
+  eLobeDiffuseReflection,
+  eLobeDiffuseTransmission,
+  eLobeGlossyReflection,
+  eLobeGlossyTransmission,
+  eLobeImpulseReflection,
+  eLobeImpulseTransmission,
+};
+
+// Path tracer counters: features of the materials hit by the paths
+enum PathCounterFeature
+{
+  eFeatureAlpha,                // Alpha mask or blend
+  eFeatureEmissive,             // Non-black emission
+  eFeatureUnlit,                // KHR_materials_unlit
+  eFeatureTransmission,         // KHR_materials_transmission
+  eFeatureVolume,               // KHR_materials_volume
+  eFeatureClearcoat,            // KHR_materials_clearcoat
+  eFeatureSheen,                // KHR_materials_sheen
+  eFeatureIridescence,          // KHR_materials_iridescence
+  eFeatureAnisotropy,           // KHR_materials_anisotropy
+  eFeatureDiffuseTransmission,  // KHR_materials_diffuse_transmission
+  eFeatureDispersion,           // KHR_materials_dispersion
+  eFeatureSpecularGlossiness,   // KHR_materials_pbrSpecularGlossiness
+};
+
+// Performance counters of the path tracer, accumulated over a frame with atomics
+// (see path_counters.h.slang). Only written when the shaders are specialized with USE_COUNTERS.
+struct PathCounters
+{
+  uint primaryRays;      // Camera rays, one per path
+  uint secondaryRays;    // Rays of the bounces
+  uint shadowRays;       // Visibility rays of the light sampling
+  uint anyHitMain;       // Any-hit invocations (alpha test) of the camera and bounce rays
+  uint anyHitShadow;     // Any-hit invocations (alpha test, transmission) of the shadow rays
+  uint russianRoulette;  // Paths terminated by Russian roulette
+  uint cacheTerminated;  // Paths terminated in the radiance cache
+  uint environment;      // Paths escaping to the environment
+  uint depth[PATH_COUNTER_DEPTH_BINS];       // Rays traced at each depth, the last bin counts the deeper ones
+  uint lobes[PATH_COUNTER_NUM_LOBES];        // Sampled lobes, see PathCounterLobe
+  uint features[PATH_COUNTER_NUM_FEATURES];  // Hits per material feature, see PathCounterFeature
 };
 
 // Push constant
@@ -120,12 +303,70 @@ struct PathtracePushConstant
   float aperture              = 0.0f;  // Aperture for depth of field
   int   useDlss               = 0;     // Use DLSS (0: no, 1: yes)
   int   renderSelection       = 1;     // Padding to align the structure
+  int   writeAovs             = 0;     // Write the first-hit AOVs without DLSS (0: no, 1: yes)
+  int   denoise               = 0;     // Write the noisy frame and its guides for the SVGF denoiser (0: no, 1: yes)
+  int   textureLod            = 0;     // Texture mip selection (0: finest level, 1: ray cones)
+  int   samplerMode           = 0;     // Random numbers of the paths (0: white noise, 1: Sobol, 2: blue noise), see sampler.h
+  int2  renderSize            = {0, 0};  // Dynamic resolution: rendered part of the output images, 0: all of it
   /// Infinite plane
   float2                 jitter;               // Jitter for the DLSS
   float2                 mouseCoord = {0, 0};  // Mouse coordinates (use for debug)
   SceneFrameInfo*        frameInfo;            // Camera info
   SkyPhysicalParameters* skyParams;            // Sky physical parameters
   GltfScene*             gltfScene;            // GLTF sceneF
+  PathGuidingField*      guiding;              // Path guiding
+  RadianceCacheGrid*     radianceCache;        // Radiance cache for path termination
+  PathCounters*          counters;             // Performance counters, with USE_COUNTERS
+};
+
+// Occupancy of the light clusters, for tuning the grid
+struct LightClusterStats
+{
+  uint numReferences;  // Sum of the light counts of all clusters
+  uint nonEmpty;       // Clusters with at least one light
+  uint maxCount;       // Highest light count, before clamping to maxLightsPerCluster
+  uint overflow;       // Clusters with more lights than maxLightsPerCluster (lights dropped)
+  uint histogram[LIGHT_CLUSTER_HISTOGRAM_BINS];  // Clusters by light count: 0, 1, 2-3, 4-7, .., 64+
+};
+
+// Clustered light culling of the rasterizers: the view frustum is divided in tiles on screen and
+// in exponential slices in depth, each cluster lists the lights reaching it.
+struct LightClusterGrid
+{
+  int                enabled             = 0;   // 0: the shaders loop over all lights
+  int                tilesX              = 16;  // Number of tiles on screen, horizontally
+  int                tilesY              = 9;   // Number of tiles on screen, vertically
+  int                numSlices           = 24;  // Number of depth slices
+  int                maxLightsPerCluster = 64;  // Capacity of the light list of a cluster
+  float              zNear               = 0.1f;
+  float              zFar                = 1000.f;
+  float              sliceScale          = 1.f;  // numSlices / log(zFar / zNear)
+  float2             screenSize;                 // Render size, in pixels
+  float              lightCutoff = 0.f;  // Lights without range are ignored below this irradiance (0: never)
+  int                _pad0;
+  uint*              lightCounts;   // Per cluster: number of lights
+  uint*              lightIndices;  // Per cluster: maxLightsPerCluster light indices
+  LightClusterStats* stats;         // Occupancy of this frame
+};
+
+// Light culling pass
+struct LightCullPushConstant
+{
+  LightClusterGrid* grid;
+  SceneFrameInfo*   frameInfo;  // Camera info
+  GltfScene*        gltfScene;  // Lights of the scene
+};
+
+// Scene composition: the arrays of the composed scene start with the ones of the loaded scene,
+// copied by scene_composition.comp.slang, and continue with the added assets
+struct CompositionPushConstant
+{
+  GltfScene* baseScene;      // Loaded scene
+  GltfScene* composedScene;  // Scene of the path tracer
+  int        numMaterials;   // Elements of the loaded scene
+  int        numRenderNodes;
+  int        numRenderPrimitives;
+  int        _pad0;
 };
 
 // Push constant
@@ -138,6 +379,33 @@ struct RasterPushConstant
   SceneFrameInfo*        frameInfo;              // Camera info
   SkyPhysicalParameters* skyParams;              // Sky physical parameters
   GltfScene*             gltfScene;              // GLTF sceneF
+  float4x4*              prevObjectToWorld;      // Node matrices of the previous frame (motion vectors)
+  LightClusterGrid*      lightClusters;          // Per-cluster light lists
+};
+
+// Spatiotemporal denoiser (SVGF)
+struct SvgfPushConstant
+{
+  int2  size;                 // Size of the images
+  int   reset        = 0;     // Discard the history (1)
+  int   stepSize     = 1;     // Distance between the taps of the a-trous iteration
+  int   finalPass    = 0;     // Last a-trous iteration: modulate the albedo and write the image (1)
+  float alphaColor   = 0.2f;  // Minimum blend weight of the current frame, color
+  float alphaMoments = 0.2f;  // Minimum blend weight of the current frame, moments
+  float maxHistory   = 32.f;  // Maximum history length
+  float phiColor     = 4.0f;  // Edge-stopping: luminance
+  float phiNormal    = 128.f; // Edge-stopping: normal
+  float phiDepth     = 1.0f;  // Edge-stopping: depth
+};
+
+// Temporal anti-aliasing resolve
+struct TaaPushConstant
+{
+  int2   renderSize;        // Size of the jittered image
+  int2   outputSize;        // Size of the output and history images
+  float2 jitter;            // Sub-pixel jitter of the current frame, in render pixels
+  float  feedback = 0.9f;   // Maximum weight of the history
+  int    reset    = 0;      // Discard the history (1)
 };
 
 
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Functions of the spatiotemporal (SVGF) denoiser, shared by the compute shader and the
+// CPU reference implementation, so both produce the same result.
+
+#ifndef SVGF_UTIL_H
+#define SVGF_UTIL_H
+
+#include "nvshaders/slang_types.h"
+
+#ifndef INLINE
+#ifdef __cplusplus
+#define INLINE inline
+#else
+#define INLINE
+#endif
+#endif
+
+#define SVGF_MIN_HISTORY_FOR_VARIANCE 4  // Below, the variance is estimated spatially
+
+INLINE float svgfLuminance(float3 c)
+{
+  return dot(c, float3(0.2126F, 0.7152F, 0.0722F));
+}
+
+// A surface was hit: the albedo guide is (baseColor, 1), and zero for the environment
+INLINE bool svgfIsSurface(float4 albedo)
+{
+  return albedo.w > 0.0F;
+}
+
+// The lighting is filtered without the texture detail, which is put back at the end
+INLINE float3 svgfAlbedo(float4 albedo)
+{
+  return svgfIsSurface(albedo) ? max(float3(albedo.x, albedo.y, albedo.z), float3(0.01F)) : float3(1.0F);
+}
+
+// B3-spline weights of the 5x5 a-trous kernel, for an offset of -2..2
+INLINE float svgfKernelWeight(int offset)
+{
+  return offset == 0 ? 0.375F : ((offset == 1 || offset == -1) ? 0.25F : 0.0625F);
+}
+
+// 3x3 Gaussian weights, used to smooth the variance before the edge-stopping function
+INLINE float svgfGaussianWeight(int x, int y)
+{
+  const float w1 = (x == 0) ? 0.5F : 0.25F;
+  const float w2 = (y == 0) ? 0.5F : 0.25F;
+  return w1 * w2;
+}
+
+// Edge-stopping weight between the center and a sample of the filter (SVGF, Schied et al. 2017)
+// - normals: cosine raised to phiNormal
+// - depth  : difference relative to the local depth gradient, scaled by the distance of the sample
+// - color  : luminance difference relative to the standard deviation of the center
+INLINE float svgfEdgeWeight(float3 centerNormal,
+                            float3 normal,
+                            float  centerDepth,
+                            float  depth,
+                            float  depthGradient,
+                            float  distance,
+                            float  centerLum,
+                            float  lum,
+                            float  stdDev,
+                            float  phiNormal,
+                            float  phiDepth,
+                            float  phiColor)
+{
+  const float wNormal = pow(max(0.0F, dot(centerNormal, normal)), phiNormal);
+  const float wDepth  = abs(centerDepth - depth) / (phiDepth * depthGradient * distance + 1e-3F * centerDepth + 1e-6F);
+  const float wColor  = abs(centerLum - lum) / (phiColor * stdDev + 1e-6F);
+  return wNormal * exp(-wDepth - wColor);
+}
+
+// Blend weight of the current frame: a running average, then an exponential moving average
+INLINE float svgfTemporalAlpha(float historyLength, float minAlpha)
+{
+  return max(minAlpha, 1.0F / historyLength);
+}
+
+#endif  // SVGF_UTIL_H
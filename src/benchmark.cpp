@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Benchmark
+
+    Script (--benchmark <file>), one statement per line, `#` starts a comment:
+    - frames <n>              : measured frames per renderer (default 128)
+    - warmup <n>              : frames rendered before measuring (default 16)
+    - renderers <r[:t]> ...   : renderSystem and optional ptTechnique (default 0:0 0:1 1 2)
+    - scene <file> [<path>]   : scene to render, with an optional camera path file
+    - hdr <file>              : HDR environment of the previous scene
+    Relative files are searched next to the script, then in the resource directories.
+
+    Camera path file, one key per line: `<time> {eye}, {center}, {up} [fov]`, the vectors are
+    written like the copy of the camera widget. The measured frames are spread evenly over the
+    time of the keys, and the poses are linearly interpolated.
+
+    Phases: load scene -> build scene -> for each renderer (start run -> warm-up -> measure)
+            -> next scene ... -> done
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+#include <fmt/format.h>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+
+// Searched next to the script first; otherwise left as is, for the search in the resource directories
+std::filesystem::path resolvePath(const std::filesystem::path& baseDir, const std::string& name)
+{
+  const std::filesystem::path path = nvutils::pathFromUtf8(name);
+  if(path.is_relative() && std::filesystem::exists(baseDir / path))
+    return baseDir / path;
+  return path;
+}
+
+std::string jsonEscape(const std::string& s)
+{
+  std::string result;
+  for(char c : s)
+  {
+    if(c == '"' || c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result;
+}
+
+const char* rendererName(const Benchmark::RendererEntry& r)
+{
+  switch(r.renderSystem)
+  {
+    case 0:
+      return r.ptTechnique == 0 ? "pathtracer-compute" : "pathtracer-rtx";
+    case 1:
+      return "raster";
+    case 2:
+      return "ddgi-raster";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Read the script and the camera paths
+//
+bool Benchmark::load(const std::filesystem::path& filename)
+{
+  std::ifstream file(filename);
+  if(!file)
+  {
+    LOGE("Benchmark: cannot open %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+  const std::filesystem::path baseDir = filename.parent_path();
+
+  m_scenes.clear();
+  m_renderers.clear();
+  std::string line;
+  int         lineNumber = 0;
+  while(std::getline(file, line))
+  {
+    lineNumber++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream stream(line);
+    std::string        keyword;
+    if(!(stream >> keyword))
+      continue;
+
+    bool valid = true;
+    if(keyword == "frames")
+      valid = bool(stream >> m_measureFrames) && m_measureFrames > 0;
+    else if(keyword == "warmup")
+      valid = bool(stream >> m_warmupFrames) && m_warmupFrames >= 0;
+    else if(keyword == "renderers")
+    {
+      std::string token;
+      while(valid && stream >> token)
+      {
+        RendererEntry entry;
+        char          separator = 0;
+        std::istringstream tokenStream(token);
+        valid = bool(tokenStream >> entry.renderSystem) && entry.renderSystem >= 0 && entry.renderSystem <= 2;
+        if(valid && tokenStream >> separator)
+          valid = separator == ':' && bool(tokenStream >> entry.ptTechnique) && entry.ptTechnique >= 0 && entry.ptTechnique <= 1;
+        m_renderers.push_back(entry);
+      }
+    }
+    else if(keyword == "scene")
+    {
+      std::string sceneName, pathName;
+      valid = bool(stream >> sceneName);
+      if(valid)
+      {
+        SceneEntry entry;
+        entry.filename = resolvePath(baseDir, sceneName);
+        if(stream >> pathName)
+          valid = parseCameraPath(resolvePath(baseDir, pathName), entry.cameraPath);
+        m_scenes.push_back(entry);
+      }
+    }
+    else if(keyword == "hdr")
+    {
+      std::string hdrName;
+      valid = !m_scenes.empty() && bool(stream >> hdrName);
+      if(valid)
+        m_scenes.back().hdrFilename = resolvePath(baseDir, hdrName);
+    }
+    else
+      valid = false;
+
+    if(!valid)
+    {
+      LOGE("Benchmark: %s(%d): invalid statement: %s\n", nvutils::utf8FromPath(filename).c_str(), lineNumber, line.c_str());
+      return false;
+    }
+  }
+
+  if(m_scenes.empty())
+  {
+    LOGE("Benchmark: no scene in %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+  if(m_renderers.empty())
+    m_renderers = {{0, 0}, {0, 1}, {1, 0}, {2, 0}};
+
+  LOGI("Benchmark: %zu scenes, %zu renderers, %d + %d frames\n", m_scenes.size(), m_renderers.size(), m_warmupFrames,
+       m_measureFrames);
+  m_results.clear();
+  m_sceneIndex = 0;
+  m_phase      = Phase::eLoadScene;
+  return true;
+}
+
+bool Benchmark::parseCameraPath(const std::filesystem::path& filename, std::vector<CameraKey>& path)
+{
+  std::ifstream file(filename);
+  if(!file)
+  {
+    LOGE("Benchmark: cannot open the camera path %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(file, line))
+  {
+    line = line.substr(0, line.find('#'));
+    std::replace_if(line.begin(), line.end(), [](char c) { return c == '{' || c == '}' || c == ','; }, ' ');
+    std::istringstream stream(line);
+    CameraKey          key;
+    if(!(stream >> key.time))
+      continue;
+    if(!(stream >> key.eye.x >> key.eye.y >> key.eye.z >> key.center.x >> key.center.y >> key.center.z >> key.up.x
+         >> key.up.y >> key.up.z))
+    {
+      LOGE("Benchmark: invalid camera key in %s: %s\n", nvutils::utf8FromPath(filename).c_str(), line.c_str());
+      return false;
+    }
+    stream >> key.fov;
+    path.push_back(key);
+  }
+  std::stable_sort(path.begin(), path.end(), [](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+  return !path.empty();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Camera of the frame being rendered: the warm-up stays on the first pose, the measured frames
+// are spread over the path
+//
+bool Benchmark::getCamera(CameraKey& camera) const
+{
+  const std::vector<CameraKey>& path = getScene().cameraPath;
+  if(path.empty())
+    return false;
+
+  float u = 0.0f;
+  if(m_phase == Phase::eMeasure && m_measureFrames > 1)
+    u = float(std::max(m_frame - 1, 0)) / float(m_measureFrames - 1);
+  const float time = glm::mix(path.front().time, path.back().time, u);
+
+  auto next = std::upper_bound(path.begin(), path.end(), time, [](float t, const CameraKey& k) { return t < k.time; });
+  if(next == path.begin() || next == path.end())
+  {
+    camera = next == path.end() ? path.back() : path.front();
+    return true;
+  }
+  const CameraKey& a = *(next - 1);
+  const CameraKey& b = *next;
+  const float      w = (b.time > a.time) ? (time - a.time) / (b.time - a.time) : 0.0f;
+  camera.time        = time;
+  camera.eye         = glm::mix(a.eye, b.eye, w);
+  camera.center      = glm::mix(a.center, b.center, w);
+  camera.up          = glm::normalize(glm::mix(a.up, b.up, w));
+  camera.fov         = (a.fov > 0.0f && b.fov > 0.0f) ? glm::mix(a.fov, b.fov, w) : 0.0f;
+  return true;
+}
+
+// Names of the GPU timer sections of the renderer (cmdFrameSection in renderer_*.cpp and renderer.cpp)
+std::vector<std::string> Benchmark::getSections() const
+{
+  switch(getRenderer().renderSystem)
+  {
+    case 0:
+      return {"Frame", "Pathtrace", "SVGF", "Tonemap", "Silhouette"};
+    case 1:
+      return {"Frame", "Raster", "Tonemap", "Silhouette"};
+    case 2:
+      return {"Frame", "Raster MRT", "Raster composition", "Tonemap", "Silhouette"};
+  }
+  return {"Frame", "Tonemap", "Silhouette"};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Steps
+//
+void Benchmark::endSceneLoad(double loadMs, bool loaded)
+{
+  SceneResult result;
+  result.name   = nvutils::utf8FromPath(getScene().filename.filename());  // Same key on all machines
+  result.loaded = loaded;
+  result.loadMs = loadMs;
+  m_results.push_back(result);
+  if(!loaded)
+  {
+    LOGW("Benchmark: skipping %s\n", result.name.c_str());
+    nextScene();
+    return;
+  }
+  m_phase = Phase::eBuildScene;
+}
+
+void Benchmark::addSceneBuildTime(bool isBlasBuild, double ms)
+{
+  if(m_phase != Phase::eBuildScene)
+    return;
+  (isBlasBuild ? m_results.back().blasBuildMs : m_results.back().uploadMs) += ms;
+}
+
+void Benchmark::endSceneBuild()
+{
+  const SceneResult& result = m_results.back();
+  LOGI("Benchmark: %s: load %.1f ms, upload %.1f ms, BLAS %.1f ms\n", result.name.c_str(), result.loadMs,
+       result.uploadMs, result.blasBuildMs);
+  m_rendererIndex = 0;
+  m_phase         = Phase::eStartRun;
+}
+
+void Benchmark::startRun()
+{
+  RunResult run;
+  run.renderer = getRenderer();
+  for(const std::string& name : getSections())
+    run.gpuMs.push_back({name, {}});
+  m_results.back().runs.push_back(run);
+  m_frame = 0;
+  m_phase = m_warmupFrames > 0 ? Phase::eWarmup : Phase::eMeasure;
+}
+
+// Called at the beginning of each frame of the run, with the measurements of the previous one
+void Benchmark::nextFrame(const FrameSample& previous)
+{
+  const auto now = std::chrono::steady_clock::now();
+  if(m_phase == Phase::eMeasure && m_frame > 0)
+  {
+    RunResult& run = m_results.back().runs.back();
+    run.cpuFrameMs.push_back(std::chrono::duration<double, std::milli>(now - m_lastFrameTime).count());
+    for(const auto& [name, ms] : previous.gpuMs)
+    {
+      for(auto& [sectionName, values] : run.gpuMs)
+      {
+        if(sectionName == name)
+          values.push_back(ms);
+      }
+    }
+    // The counters are the same each frame, in the same order
+    if(run.counters.empty())
+    {
+      for(const auto& [name, value] : previous.counters)
+        run.counters.push_back({name, {}});
+    }
+    for(size_t i = 0; i < previous.counters.size() && i < run.counters.size(); i++)
+      run.counters[i].second.push_back(previous.counters[i].second);
+    run.peakGpuMemory = std::max(run.peakGpuMemory, previous.gpuMemory);
+  }
+  m_lastFrameTime = now;
+
+  if(m_phase == Phase::eWarmup && m_frame == m_warmupFrames)
+  {
+    m_phase = Phase::eMeasure;
+    m_frame = 0;
+  }
+  if(m_phase == Phase::eMeasure && m_frame == m_measureFrames)
+  {
+    finishRun();
+    return;
+  }
+  m_frame++;
+}
+
+void Benchmark::addMemorySample(uint64_t gpuMemory)
+{
+  if(m_results.empty())
+    return;
+  m_results.back().peakGpuMemory = std::max(m_results.back().peakGpuMemory, gpuMemory);
+}
+
+void Benchmark::finishRun()
+{
+  const RunResult& run   = m_results.back().runs.back();
+  const Stats      stats = computeStats(run.cpuFrameMs);
+  LOGI("Benchmark: %s, %s: %.3f ms/frame (median %.3f, p95 %.3f)\n", m_results.back().name.c_str(),
+       rendererName(run.renderer), stats.mean, stats.median, stats.p95);
+
+  if(++m_rendererIndex < m_renderers.size())
+    m_phase = Phase::eStartRun;
+  else
+    nextScene();
+}
+
+void Benchmark::nextScene()
+{
+  m_phase = (++m_sceneIndex < m_scenes.size()) ? Phase::eLoadScene : Phase::eDone;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Report
+//
+Benchmark::Stats Benchmark::computeStats(std::vector<double> values)
+{
+  Stats stats;
+  if(values.empty())
+    return stats;
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  stats.mean     = std::accumulate(values.begin(), values.end(), 0.0) / double(n);
+  stats.median   = (n % 2) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+  stats.p95      = values[std::min(n - 1, size_t(std::ceil(0.95 * double(n))) - 1)];
+  stats.min      = values.front();
+  stats.max      = values.back();
+  return stats;
+}
+
+bool Benchmark::writeReport(const std::filesystem::path& filename, const std::string& deviceName, glm::uvec2 size) const
+{
+  auto statsJson = [](const std::vector<double>& values) {
+    const Stats s = computeStats(values);
+    return fmt::format(R"({{"samples": {}, "mean": {:.4f}, "median": {:.4f}, "p95": {:.4f}, "min": {:.4f}, "max": {:.4f}}})",
+                       values.size(), s.mean, s.median, s.p95, s.min, s.max);
+  };
+
+  std::string json = "{\n";
+  json += fmt::format("  \"version\": 1,\n  \"device\": \"{}\",\n  \"size\": [{}, {}],\n", jsonEscape(deviceName), size.x, size.y);
+  json += fmt::format("  \"warmupFrames\": {},\n  \"frames\": {},\n  \"scenes\": [", m_warmupFrames, m_measureFrames);
+  for(size_t i = 0; i < m_results.size(); i++)
+  {
+    const SceneResult& scene = m_results[i];
+    json += fmt::format("{}\n    {{\n      \"name\": \"{}\",\n      \"loaded\": {},\n", i ? "," : "", jsonEscape(scene.name),
+                        scene.loaded ? "true" : "false");
+    json += fmt::format("      \"loadMs\": {:.3f},\n      \"uploadMs\": {:.3f},\n      \"blasBuildMs\": {:.3f},\n",
+                        scene.loadMs, scene.uploadMs, scene.blasBuildMs);
+    json += fmt::format("      \"peakGpuMemoryMB\": {:.2f},\n      \"runs\": [", double(scene.peakGpuMemory) / (1024.0 * 1024.0));
+    for(size_t r = 0; r < scene.runs.size(); r++)
+    {
+      const RunResult& run = scene.runs[r];
+      json += fmt::format("{}\n        {{\n          \"renderer\": \"{}\",\n", r ? "," : "", rendererName(run.renderer));
+      json += fmt::format("          \"renderSystem\": {},\n          \"ptTechnique\": {},\n", run.renderer.renderSystem,
+                          run.renderer.ptTechnique);
+      json += fmt::format("          \"peakGpuMemoryMB\": {:.2f},\n", double(run.peakGpuMemory) / (1024.0 * 1024.0));
+      json += fmt::format("          \"cpuFrameMs\": {},\n          \"gpuMs\": {{", statsJson(run.cpuFrameMs));
+      bool first = true;
+      for(const auto& [name, values] : run.gpuMs)
+      {
+        if(values.empty())
+          continue;  // Section not executed with these settings
+        json += fmt::format("{}\n            \"{}\": {}", first ? "" : ",", name, statsJson(values));
+        first = false;
+      }
+      json += "\n          }";
+      if(!run.counters.empty())
+      {
+        json += ",\n          \"counters\": {";
+        for(size_t c = 0; c < run.counters.size(); c++)
+          json += fmt::format("{}\n            \"{}\": {}", c ? "," : "", run.counters[c].first, statsJson(run.counters[c].second));
+        json += "\n          }";
+      }
+      json += "\n        }";
+    }
+    json += "\n      ]\n    }";
+  }
+  json += "\n  ]\n}\n";
+
+  std::ofstream file(filename);
+  if(!file || !(file << json))
+  {
+    LOGE("Benchmark: cannot write %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+  LOGI("Benchmark report: %s\n", nvutils::utf8FromPath(filename).c_str());
+  return true;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Scripted performance benchmark (--benchmark <file>): each scene of the list is loaded, then
+// rendered by each renderer for a number of warm-up frames, followed by the measured frames,
+// with the camera following the keyframed path of the scene. The load, upload and BLAS build
+// times, the CPU frame times, the GPU time of the profiler sections and the peak GPU memory are
+// written to a JSON report, to be compared with a baseline by utils/benchmark_compare.py.
+//
+// The benchmark only holds the script and the measurements: GltfRenderer::updateBenchmark()
+// executes the steps, one per frame, following getPhase().
+class Benchmark
+{
+public:
+  // Pose of the camera at a time of the path, see the camera path file format in README.md
+  struct CameraKey
+  {
+    float     time{0.0f};
+    glm::vec3 eye{0.0f};
+    glm::vec3 center{0.0f};
+    glm::vec3 up{0.0f, 1.0f, 0.0f};
+    float     fov{0.0f};  // Degrees, 0: unchanged
+  };
+
+  struct SceneEntry
+  {
+    std::filesystem::path  filename;
+    std::filesystem::path  hdrFilename;  // Optional
+    std::vector<CameraKey> cameraPath;   // Empty: the camera of the scene
+  };
+
+  struct RendererEntry
+  {
+    int renderSystem{0};  // RenderingMode
+    int ptTechnique{0};   // PathTracer::RenderTechnique
+  };
+
+  // Measurements of the previous frame
+  struct FrameSample
+  {
+    std::vector<std::pair<std::string, double>> gpuMs;     // Profiler sections
+    std::vector<std::pair<std::string, double>> counters;  // Path tracer counters (--ptCounters)
+    uint64_t                                    gpuMemory{0};
+  };
+
+  enum class Phase
+  {
+    eIdle,        // No benchmark
+    eLoadScene,   // Load the scene of getScene()
+    eBuildScene,  // Wait for the upload and the acceleration structures of the scene
+    eStartRun,    // Switch to the renderer of getRenderer()
+    eWarmup,      // Render frames, not measured
+    eMeasure,     // Render measured frames
+    eDone,        // Write the report and exit
+  };
+
+  // Read the script. Returns false, with the error logged, if it is invalid.
+  bool load(const std::filesystem::path& filename);
+
+  Phase                getPhase() const { return m_phase; }
+  const SceneEntry&    getScene() const { return m_scenes[m_sceneIndex]; }
+  const RendererEntry& getRenderer() const { return m_renderers[m_rendererIndex]; }
+
+  // Camera of the frame being rendered, false if the scene has no camera path
+  bool getCamera(CameraKey& camera) const;
+
+  // Profiler sections measured with the current renderer
+  std::vector<std::string> getSections() const;
+
+  // Steps, called by the renderer
+  void endSceneLoad(double loadMs, bool loaded);
+  void addSceneBuildTime(bool isBlasBuild, double ms);
+  void endSceneBuild();
+  void startRun();
+  void nextFrame(const FrameSample& previous);
+  void addMemorySample(uint64_t gpuMemory);
+
+  bool writeReport(const std::filesystem::path& filename, const std::string& deviceName, glm::uvec2 size) const;
+
+private:
+  struct Stats
+  {
+    double mean{0.0}, median{0.0}, p95{0.0}, min{0.0}, max{0.0};
+  };
+  static Stats computeStats(std::vector<double> values);
+
+  struct RunResult
+  {
+    RendererEntry                                            renderer;
+    std::vector<double>                                      cpuFrameMs;
+    std::vector<std::pair<std::string, std::vector<double>>> gpuMs;
+    std::vector<std::pair<std::string, std::vector<double>>> counters;
+    uint64_t                                                 peakGpuMemory{0};
+  };
+
+  struct SceneResult
+  {
+    std::string            name;
+    bool                   loaded{false};
+    double                 loadMs{0.0};       // Parsing and creation of the buffers, CPU
+    double                 uploadMs{0.0};     // Submission of the uploads and TLAS build, until completion
+    double                 blasBuildMs{0.0};  // BLAS builds and compaction, until completion
+    uint64_t               peakGpuMemory{0};
+    std::vector<RunResult> runs;
+  };
+
+  static bool parseCameraPath(const std::filesystem::path& filename, std::vector<CameraKey>& path);
+  void        nextScene();
+  void        finishRun();
+
+  std::vector<SceneEntry>    m_scenes;
+  std::vector<RendererEntry> m_renderers;
+  int                        m_warmupFrames{16};
+  int                        m_measureFrames{128};
+
+  Phase    m_phase{Phase::eIdle};
+  size_t   m_sceneIndex{0};
+  size_t   m_rendererIndex{0};
+  int      m_frame{0};  // Number of frames started in the phase
+
+  std::chrono::steady_clock::time_point m_lastFrameTime;
+
+  std::vector<SceneResult> m_results;
+};
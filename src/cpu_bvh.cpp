@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    4-wide BVH of the CPU path tracer
+
+    Build
+    - Binary tree, top-down: the triangles of a node are split where the surface area heuristic
+      is the lowest, evaluated on 16 bins of the centroids along each axis. Nodes of up to 4
+      triangles become leaves: the 4 lanes of a leaf are tested at once, whatever their number.
+      Below a maximum depth, or when all centroids are equal, the triangles are split in two
+      halves instead.
+    - Collapse: each 4-wide node takes the children of a binary node, and repeatedly replaces
+      its largest inner child (by surface area) by the two children of that node, until it has
+      4 children.
+
+    Traversal
+    - The 4 boxes of a node are tested at once (slab test, one lane per child), the children
+      hit are pushed on the stack from far to near, so the nearest is visited first.
+    - The 4 triangles of a leaf are tested at once (Moller-Trumbore, one lane per triangle).
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+#include "cpu_bvh.hpp"
+
+namespace cpu {
+
+namespace {
+
+constexpr int      kNumBins       = 16;
+constexpr uint32_t kMaxBuildDepth = 60;  // Deeper, split in halves: bounds the depth of the tree
+
+struct Bounds
+{
+  glm::vec3 lo{std::numeric_limits<float>::infinity()};
+  glm::vec3 hi{-std::numeric_limits<float>::infinity()};
+
+  void grow(const glm::vec3& p)
+  {
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  void grow(const Bounds& b)
+  {
+    lo = glm::min(lo, b.lo);
+    hi = glm::max(hi, b.hi);
+  }
+  float area() const
+  {
+    if(lo.x > hi.x)
+      return 0.0f;
+    const glm::vec3 e = hi - lo;
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+  }
+};
+
+struct BinaryNode
+{
+  Bounds   bounds;
+  uint32_t left{0};  // Inner node: children
+  uint32_t right{0};
+  uint32_t first{0};  // Leaf: range in the triangle indices
+  uint32_t count{0};
+
+  bool isLeaf() const { return count > 0; }
+};
+
+class BinaryBuilder
+{
+public:
+  BinaryBuilder(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles)
+  {
+    const size_t numTriangles = triangles.size();
+    m_bounds.resize(numTriangles);
+    m_centroids.resize(numTriangles);
+    m_indices.resize(numTriangles);
+    std::iota(m_indices.begin(), m_indices.end(), 0u);
+    for(size_t i = 0; i < numTriangles; i++)
+    {
+      Bounds b;
+      b.grow(positions[triangles[i].x]);
+      b.grow(positions[triangles[i].y]);
+      b.grow(positions[triangles[i].z]);
+      m_bounds[i]    = b;
+      m_centroids[i] = 0.5f * (b.lo + b.hi);
+    }
+    m_nodes.reserve(2 * numTriangles);
+    buildRange(0, uint32_t(numTriangles), 0);
+  }
+
+  const std::vector<BinaryNode>& nodes() const { return m_nodes; }
+  const std::vector<uint32_t>&   indices() const { return m_indices; }
+
+private:
+  uint32_t buildRange(uint32_t first, uint32_t count, uint32_t depth)
+  {
+    const uint32_t nodeIndex = uint32_t(m_nodes.size());
+    m_nodes.emplace_back();
+
+    Bounds bounds, centroidBounds;
+    for(uint32_t i = first; i < first + count; i++)
+    {
+      bounds.grow(m_bounds[m_indices[i]]);
+      centroidBounds.grow(m_centroids[m_indices[i]]);
+    }
+    m_nodes[nodeIndex].bounds = bounds;
+
+    if(count <= Bvh4::kWidth)
+    {
+      m_nodes[nodeIndex].first = first;
+      m_nodes[nodeIndex].count = count;
+      return nodeIndex;
+    }
+
+    // Best split of the binned SAH
+    int   bestAxis = -1;
+    int   bestBin  = 0;
+    float bestCost = std::numeric_limits<float>::infinity();
+    if(depth < kMaxBuildDepth)
+    {
+      for(int axis = 0; axis < 3; axis++)
+      {
+        const float extent = centroidBounds.hi[axis] - centroidBounds.lo[axis];
+        if(extent <= 0.0f)
+          continue;
+        const float scale = float(kNumBins) / extent;
+
+        std::array<Bounds, kNumBins>   binBounds{};
+        std::array<uint32_t, kNumBins> binCounts{};
+        for(uint32_t i = first; i < first + count; i++)
+        {
+          const uint32_t t = m_indices[i];
+          const int      b = std::min(int((m_centroids[t][axis] - centroidBounds.lo[axis]) * scale), kNumBins - 1);
+          binBounds[b].grow(m_bounds[t]);
+          binCounts[b]++;
+        }
+
+        // Sweep from the right, then from the left: cost of splitting after bin i
+        std::array<float, kNumBins> rightCost{};
+        Bounds                      right;
+        uint32_t                    rightCount = 0;
+        for(int i = kNumBins - 1; i > 0; i--)
+        {
+          right.grow(binBounds[i]);
+          rightCount += binCounts[i];
+          rightCost[i - 1] = right.area() * float(rightCount);
+        }
+        Bounds   left;
+        uint32_t leftCount = 0;
+        for(int i = 0; i < kNumBins - 1; i++)
+        {
+          left.grow(binBounds[i]);
+          leftCount += binCounts[i];
+          const float cost = left.area() * float(leftCount) + rightCost[i];
+          if(leftCount > 0 && leftCount < count && cost < bestCost)
+          {
+            bestCost = cost;
+            bestAxis = axis;
+            bestBin  = i;
+          }
+        }
+      }
+    }
+
+    uint32_t leftCount = count / 2;
+    if(bestAxis >= 0)
+    {
+      const float extent = centroidBounds.hi[bestAxis] - centroidBounds.lo[bestAxis];
+      const float scale  = float(kNumBins) / extent;
+      const float lo     = centroidBounds.lo[bestAxis];
+      auto middle = std::partition(m_indices.begin() + first, m_indices.begin() + first + count, [&](uint32_t t) {
+        return std::min(int((m_centroids[t][bestAxis] - lo) * scale), kNumBins - 1) <= bestBin;
+      });
+      leftCount = uint32_t(middle - (m_indices.begin() + first));
+    }
+    else
+    {
+      // No useful split: halves along the largest extent of the centroids
+      const glm::vec3 e    = centroidBounds.hi - centroidBounds.lo;
+      const int       axis = (e.x >= e.y && e.x >= e.z) ? 0 : (e.y >= e.z ? 1 : 2);
+      std::nth_element(m_indices.begin() + first, m_indices.begin() + first + leftCount, m_indices.begin() + first + count,
+                       [&](uint32_t a, uint32_t b) { return m_centroids[a][axis] < m_centroids[b][axis]; });
+    }
+
+    const uint32_t leftIndex  = buildRange(first, leftCount, depth + 1);
+    const uint32_t rightIndex = buildRange(first + leftCount, count - leftCount, depth + 1);
+    m_nodes[nodeIndex].left   = leftIndex;
+    m_nodes[nodeIndex].right  = rightIndex;
+    return nodeIndex;
+  }
+
+  std::vector<Bounds>     m_bounds;
+  std::vector<glm::vec3>  m_centroids;
+  std::vector<uint32_t>   m_indices;
+  std::vector<BinaryNode> m_nodes;
+};
+
+// Reciprocal of the ray direction, without infinities (the slab test would produce NaN)
+inline float safeInverse(float x)
+{
+  constexpr float kTiny = 1e-20f;
+  return 1.0f / (std::abs(x) > kTiny ? x : std::copysign(kTiny, x));
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Build the binary tree and collapse it to 4-wide nodes
+//
+void Bvh4::build(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles)
+{
+  m_nodes.clear();
+  m_leaves.clear();
+  m_depth = 0;
+  if(triangles.empty())
+    return;
+
+  const BinaryBuilder              builder(positions, triangles);
+  const std::vector<BinaryNode>&   binary  = builder.nodes();
+  const std::vector<uint32_t>&     indices = builder.indices();
+  constexpr float                  kInf    = std::numeric_limits<float>::infinity();
+
+  auto makeLeaf = [&](const BinaryNode& node) {
+    Leaf leaf{};
+    for(uint32_t lane = 0; lane < kWidth; lane++)
+    {
+      leaf.id[lane] = kEmpty;
+      if(lane >= node.count)
+        continue;  // Degenerate triangle at the origin: never hit
+      const uint32_t    t  = indices[node.first + lane];
+      const glm::vec3&  p0 = positions[triangles[t].x];
+      const glm::vec3   e1 = positions[triangles[t].y] - p0;
+      const glm::vec3   e2 = positions[triangles[t].z] - p0;
+      for(int a = 0; a < 3; a++)
+      {
+        leaf.v0[a][lane] = p0[a];
+        leaf.e1[a][lane] = e1[a];
+        leaf.e2[a][lane] = e2[a];
+      }
+      leaf.id[lane] = t;
+    }
+    m_leaves.push_back(leaf);
+    return uint32_t(m_leaves.size() - 1) | kLeafBit;
+  };
+
+  // Collapse of the binary subtree under `binaryIndex` into a 4-wide node
+  auto collapse = [&](auto&& self, uint32_t binaryIndex, uint32_t depth) -> uint32_t {
+    m_depth = std::max(m_depth, depth + 1);
+
+    std::array<uint32_t, kWidth> children{};
+    uint32_t                     numChildren = 0;
+    const BinaryNode&            root        = binary[binaryIndex];
+    if(root.isLeaf())
+    {
+      children[numChildren++] = binaryIndex;
+    }
+    else
+    {
+      children[numChildren++] = root.left;
+      children[numChildren++] = root.right;
+    }
+    while(numChildren < kWidth)
+    {
+      int   largest     = -1;
+      float largestArea = -1.0f;
+      for(uint32_t i = 0; i < numChildren; i++)
+      {
+        const BinaryNode& c = binary[children[i]];
+        if(!c.isLeaf() && c.bounds.area() > largestArea)
+        {
+          largest     = int(i);
+          largestArea = c.bounds.area();
+        }
+      }
+      if(largest < 0)
+        break;
+      const BinaryNode& c     = binary[children[largest]];
+      children[largest]       = c.left;
+      children[numChildren++] = c.right;
+    }
+
+    const uint32_t nodeIndex = uint32_t(m_nodes.size());
+    m_nodes.emplace_back();
+
+    Node node{};
+    for(uint32_t i = 0; i < kWidth; i++)
+    {
+      if(i >= numChildren)
+      {
+        node.child[i] = kEmpty;
+        for(int a = 0; a < 3; a++)
+        {
+          node.bmin[a][i] = kInf;
+          node.bmax[a][i] = -kInf;
+        }
+        continue;
+      }
+      const BinaryNode& c = binary[children[i]];
+      for(int a = 0; a < 3; a++)
+      {
+        node.bmin[a][i] = c.bounds.lo[a];
+        node.bmax[a][i] = c.bounds.hi[a];
+      }
+      node.child[i] = c.isLeaf() ? makeLeaf(c) : self(self, children[i], depth + 1);
+    }
+    m_nodes[nodeIndex] = node;  // The vector may have grown in the recursion
+    return nodeIndex;
+  };
+
+  m_nodes.reserve(binary.size() / 2 + 1);
+  m_leaves.reserve(binary.size() / 2 + 1);
+  collapse(collapse, 0, 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Traversal, closest hit or any hit
+//
+template <bool anyHit>
+bool Bvh4::traverse(const Ray& ray, Hit& hit) const
+{
+  if(m_nodes.empty())
+    return false;
+
+  const glm::vec3 org = ray.origin;
+  const glm::vec3 dir = ray.direction;
+  const glm::vec3 inv(safeInverse(dir.x), safeInverse(dir.y), safeInverse(dir.z));
+
+  struct Entry
+  {
+    uint32_t node;
+    float    tNear;
+  };
+  Entry    stack[kStackSize];
+  uint32_t stackSize = 0;
+  stack[stackSize++] = {0, ray.tMin};
+
+  float tMax  = ray.tMax;
+  bool  found = false;
+
+  while(stackSize > 0)
+  {
+    const Entry entry = stack[--stackSize];
+    if(entry.tNear > tMax)
+      continue;
+
+    if((entry.node & kLeafBit) != 0)
+    {
+      const Leaf& leaf = m_leaves[entry.node & ~kLeafBit];
+      float       t[kWidth], u[kWidth], v[kWidth];
+      bool        valid[kWidth];
+      for(uint32_t i = 0; i < kWidth; i++)
+      {
+        // Moller-Trumbore, one triangle per lane
+        const float px  = dir.y * leaf.e2[2][i] - dir.z * leaf.e2[1][i];
+        const float py  = dir.z * leaf.e2[0][i] - dir.x * leaf.e2[2][i];
+        const float pz  = dir.x * leaf.e2[1][i] - dir.y * leaf.e2[0][i];
+        const float det = leaf.e1[0][i] * px + leaf.e1[1][i] * py + leaf.e1[2][i] * pz;
+        const float rcp = 1.0f / det;
+        const float tx  = org.x - leaf.v0[0][i];
+        const float ty  = org.y - leaf.v0[1][i];
+        const float tz  = org.z - leaf.v0[2][i];
+        const float qx  = ty * leaf.e1[2][i] - tz * leaf.e1[1][i];
+        const float qy  = tz * leaf.e1[0][i] - tx * leaf.e1[2][i];
+        const float qz  = tx * leaf.e1[1][i] - ty * leaf.e1[0][i];
+        u[i]            = (tx * px + ty * py + tz * pz) * rcp;
+        v[i]            = (dir.x * qx + dir.y * qy + dir.z * qz) * rcp;
+        t[i]            = (leaf.e2[0][i] * qx + leaf.e2[1][i] * qy + leaf.e2[2][i] * qz) * rcp;
+        valid[i] = (det != 0.0f) & (u[i] >= 0.0f) & (v[i] >= 0.0f) & (u[i] + v[i] <= 1.0f) & (t[i] >= ray.tMin) & (t[i] < tMax);
+      }
+      for(uint32_t i = 0; i < kWidth; i++)
+      {
+        if(!valid[i] || t[i] >= tMax)
+          continue;
+        found        = true;
+        tMax         = t[i];
+        hit.t        = t[i];
+        hit.u        = u[i];
+        hit.v        = v[i];
+        hit.triangle = leaf.id[i];
+        if constexpr(anyHit)
+          return true;
+      }
+      continue;
+    }
+
+    // Slab test of the 4 children
+    const Node& node = m_nodes[entry.node];
+    float       tNear[kWidth];
+    bool        hitBox[kWidth];
+    for(uint32_t i = 0; i < kWidth; i++)
+    {
+      const float t0x = (node.bmin[0][i] - org.x) * inv.x;
+      const float t1x = (node.bmax[0][i] - org.x) * inv.x;
+      const float t0y = (node.bmin[1][i] - org.y) * inv.y;
+      const float t1y = (node.bmax[1][i] - org.y) * inv.y;
+      const float t0z = (node.bmin[2][i] - org.z) * inv.z;
+      const float t1z = (node.bmax[2][i] - org.z) * inv.z;
+      const float tn  = std::max(std::max(std::min(t0x, t1x), std::min(t0y, t1y)), std::max(std::min(t0z, t1z), ray.tMin));
+      const float tf  = std::min(std::min(std::max(t0x, t1x), std::max(t0y, t1y)), std::min(std::max(t0z, t1z), tMax));
+      tNear[i]        = tn;
+      hitBox[i]       = (tn <= tf) & (node.child[i] != kEmpty);
+    }
+
+    // Push from far to near
+    uint32_t order[kWidth];
+    uint32_t numHits = 0;
+    for(uint32_t i = 0; i < kWidth; i++)
+    {
+      if(!hitBox[i])
+        continue;
+      uint32_t j = numHits++;
+      while(j > 0 && tNear[order[j - 1]] < tNear[i])
+      {
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = i;
+    }
+    assert(stackSize + numHits <= kStackSize);
+    for(uint32_t k = 0; k < numHits; k++)
+      stack[stackSize++] = {node.child[order[k]], tNear[order[k]]};
+  }
+  return found;
+}
+
+bool Bvh4::intersect(const Ray& ray, Hit& hit) const
+{
+  return traverse<false>(ray, hit);
+}
+
+bool Bvh4::occluded(const Ray& ray) const
+{
+  Hit hit;
+  return traverse<true>(ray, hit);
+}
+
+}  // namespace cpu
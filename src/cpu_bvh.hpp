@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace cpu {
+
+struct Ray
+{
+  glm::vec3 origin{};
+  float     tMin{0.0f};
+  glm::vec3 direction{0.0f, 0.0f, 1.0f};
+  float     tMax{std::numeric_limits<float>::infinity()};
+};
+
+struct Hit
+{
+  float    t{std::numeric_limits<float>::infinity()};
+  float    u{0.0f};  // Barycentric coordinates: position = (1-u-v)*p0 + u*p1 + v*p2
+  float    v{0.0f};
+  uint32_t triangle{~0u};  // Index of the triangle given to build(), ~0 on a miss
+};
+
+// Bounding volume hierarchy with 4 children per node, for the CPU path tracer.
+// Built with binned SAH as a binary tree, then collapsed to 4-wide nodes. The boxes of the
+// children and the triangles of the leaves are stored as structures of arrays, so that one
+// ray is tested against the 4 children (or the 4 triangles of a leaf) with loops the compiler
+// turns into SIMD instructions.
+class Bvh4
+{
+public:
+  // Triangles are given by the indices of their 3 vertices in `positions`
+  void build(const std::vector<glm::vec3>& positions, const std::vector<glm::uvec3>& triangles);
+
+  // Closest hit in [ray.tMin, ray.tMax]
+  bool intersect(const Ray& ray, Hit& hit) const;
+  // Any hit in [ray.tMin, ray.tMax], for shadow rays
+  bool occluded(const Ray& ray) const;
+
+  bool     empty() const { return m_nodes.empty(); }
+  size_t   getNodeCount() const { return m_nodes.size(); }
+  size_t   getLeafCount() const { return m_leaves.size(); }
+  uint32_t getDepth() const { return m_depth; }
+
+  static constexpr uint32_t kWidth     = 4;            // Children per node, triangles per leaf
+  static constexpr uint32_t kLeafBit   = 0x80000000u;  // Child is a leaf (index in m_leaves)
+  static constexpr uint32_t kEmpty     = 0xffffffffu;  // No child
+  static constexpr uint32_t kStackSize = 512;          // Traversal stack, enough for the depth of the build
+
+private:
+  struct alignas(64) Node
+  {
+    float    bmin[3][kWidth];  // Boxes of the children, per axis
+    float    bmax[3][kWidth];
+    uint32_t child[kWidth];  // Node index, leaf index | kLeafBit, or kEmpty
+  };
+
+  // Up to 4 triangles, precomputed for Moller-Trumbore; unused lanes are degenerate
+  struct alignas(64) Leaf
+  {
+    float    v0[3][kWidth];
+    float    e1[3][kWidth];
+    float    e2[3][kWidth];
+    uint32_t id[kWidth];
+  };
+
+  template <bool anyHit>
+  bool traverse(const Ray& ray, Hit& hit) const;
+
+  std::vector<Node> m_nodes;  // m_nodes[0] is the root
+  std::vector<Leaf> m_leaves;
+  uint32_t          m_depth{0};
+};
+
+}  // namespace cpu
@@ -0,0 +1,813 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    CPU path tracer
+
+    The integrator is a port of pathTrace() of shaders/gltf_pathtrace.slang, so both renderers
+    converge to the same image:
+    - the random numbers come from the same sampler (shaders/sampler.h), with the same dimensions
+    - one-sample MIS between the punctual lights and the environment (physical sky or HDR), and
+      MIS with the BSDF sampling when a ray escapes to the environment
+    - Russian roulette, the firefly clamp and the maximum roughness along the path
+    The BSDF is the simple metallic-roughness model of bsdf_functions.h.slang (glTF Appendix B),
+    not the layered one of the GPU: this renderer is a reference for base PBR materials only, and
+    the scene refuses the others (see cpu_scene.cpp). Textures are sampled at their finest level.
+
+    Scheduling: the image is divided in tiles, each thread starts with a contiguous range of tiles
+    in its own queue, and when it is empty, steals tiles from the end of the queues of the other
+    threads. Threads with cheap tiles (sky) help those with expensive ones (geometry).
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <fmt/format.h>
+#include <glm/gtc/constants.hpp>
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvkgltf/camera_utils.hpp>
+
+#include "cpu_pathtracer.hpp"
+#include "image_output.hpp"
+
+namespace shaderio {
+using namespace glm;
+#include <nvshaders/slang_types.h>
+// The sky blends colors with a scalar weight, which the template of slang_types.h cannot deduce
+inline vec3 lerp(vec3 a, vec3 b, float t)
+{
+  return glm::mix(a, b, t);
+}
+#include <nvshaders/sky_functions.h.slang>
+#include <nvshaders/tonemap_functions.h.slang>
+#include "shaders/sampler.h"
+}  // namespace shaderio
+
+namespace cpu {
+
+namespace {
+
+constexpr float kPi                           = glm::pi<float>();
+constexpr float kInfinite                     = 1e32f;  // INFINITE of the shaders
+constexpr float kDirac                        = -1.0f;  // DIRAC of the shaders
+constexpr float kMinRoughness                 = 0.0014142f;
+constexpr float kAntialiasingStandardDeviation = 0.4246609f;
+
+// Material at a hit, the subset of PbrMaterial used by the simple BSDF
+struct ShadeMaterial
+{
+  glm::vec3 baseColor{1.0f};
+  float     metallic{1.0f};
+  glm::vec2 roughness{1.0f};  // Squared
+  glm::vec3 emissive{0.0f};
+  glm::vec3 N{0.0f, 0.0f, 1.0f};
+  glm::vec3 T{1.0f, 0.0f, 0.0f};
+  glm::vec3 B{0.0f, 1.0f, 0.0f};
+  bool      unlit{false};
+};
+
+struct DirectLight
+{
+  glm::vec3 direction{0.0f};
+  float     pdf{0.0f};
+  float     distance{kInfinite};
+  glm::vec3 radianceOverPdf{0.0f};
+};
+
+float luminance(const glm::vec3& c)
+{
+  return glm::dot(c, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+void orthonormalBasis(const glm::vec3& n, glm::vec3& t, glm::vec3& b)
+{
+  // Duff et al. 2017, "Building an Orthonormal Basis, Revisited"
+  const float sign = std::copysign(1.0f, n.z);
+  const float a    = -1.0f / (sign + n.z);
+  const float c    = n.x * n.y * a;
+  t                = glm::vec3(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+  b                = glm::vec3(c, sign + n.y * n.y * a, -n.y);
+}
+
+glm::vec3 offsetRay(const glm::vec3& p, const glm::vec3& n)
+{
+  const float epsilon = 1.0f / 65536.0f;
+  return p + n * (epsilon * glm::length(p));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Simple BSDF, port of bsdfEvaluateSimple / bsdfSampleSimple (bsdf_functions.h.slang)
+//
+float schlickFresnel(float f0, float f90, float VdotH)
+{
+  return f0 + (f90 - f0) * std::pow(1.0f - VdotH, 5.0f);
+}
+
+glm::vec3 schlickFresnel(const glm::vec3& f0, const glm::vec3& f90, float VdotH)
+{
+  return f0 + (f90 - f0) * std::pow(1.0f - VdotH, 5.0f);
+}
+
+float ggxEval(const glm::vec2& invRoughness, const glm::vec3& h)
+{
+  const float x     = h.x * invRoughness.x;
+  const float y     = h.y * invRoughness.y;
+  const float aniso = x * x + y * y;
+  const float f     = aniso + h.z * h.z;
+  return (1.0f / kPi) * invRoughness.x * invRoughness.y * h.z / (f * f);
+}
+
+float smithShadowOrMask(const glm::vec3& k, const glm::vec2& roughness)
+{
+  const float kz2 = k.z * k.z;
+  if(kz2 == 0.0f)
+    return 0.0f;
+  const float ax     = k.x * roughness.x;
+  const float ay     = k.y * roughness.y;
+  const float inv_a2 = (ax * ax + ay * ay) / kz2;
+  return 2.0f / (1.0f + std::sqrt(1.0f + inv_a2));
+}
+
+glm::vec3 ggxSampleVndf(const glm::vec3& k, const glm::vec2& roughness, const glm::vec2& xi)
+{
+  const glm::vec3 v  = glm::normalize(glm::vec3(k.x * roughness.x, k.y * roughness.y, k.z));
+  const glm::vec3 t1 = (v.z < 0.99999f) ? glm::normalize(glm::cross(v, glm::vec3(0.0f, 0.0f, 1.0f))) : glm::vec3(1.0f, 0.0f, 0.0f);
+  const glm::vec3 t2 = glm::cross(t1, v);
+
+  const float a   = 1.0f / (1.0f + v.z);
+  const float r   = std::sqrt(xi.x);
+  const float phi = (xi.y < a) ? xi.y / a * kPi : kPi + (xi.y - a) / (1.0f - a) * kPi;
+  const float p1  = r * std::cos(phi);
+  const float p2  = r * std::sin(phi) * ((xi.y < a) ? 1.0f : v.z);
+
+  glm::vec3 h = p1 * t1 + p2 * t2 + std::sqrt(std::max(0.0f, 1.0f - p1 * p1 - p2 * p2)) * v;
+  h.x *= roughness.x;
+  h.y *= roughness.y;
+  h.z = std::max(0.0f, h.z);
+  return glm::normalize(h);
+}
+
+float glossyProbability(float NdotV, float metallic)
+{
+  return glm::mix(schlickFresnel(0.04f, 1.0f, NdotV), 1.0f, metallic);
+}
+
+struct BsdfEval
+{
+  glm::vec3 diffuse{0.0f};
+  glm::vec3 glossy{0.0f};
+  float     pdf{0.0f};
+};
+
+BsdfEval bsdfEvaluate(const ShadeMaterial& mat, const glm::vec3& k1, const glm::vec3& k2)
+{
+  BsdfEval        eval;
+  const glm::vec3 H     = glm::normalize(k1 + k2);
+  const float     NdotV = std::max(0.0f, glm::dot(mat.N, k1));
+  const float     NdotL = std::max(0.0f, glm::dot(mat.N, k2));
+  const float     VdotH = std::max(0.0f, glm::dot(k1, H));
+  const float     NdotH = std::max(0.0f, glm::dot(mat.N, H));
+  if(NdotV == 0.0f || NdotL == 0.0f || VdotH == 0.0f || NdotH == 0.0f)
+    return eval;
+
+  const float     cMinReflectance = 0.04f;
+  const glm::vec3 f0              = glm::mix(glm::vec3(cMinReflectance), mat.baseColor, mat.metallic);
+  const glm::vec3 fGlossy         = schlickFresnel(f0, glm::vec3(1.0f), VdotH);
+  const float     fDiffuse        = schlickFresnel(1.0f - cMinReflectance, 0.0f, VdotH) * (1.0f - mat.metallic);
+
+  const glm::vec3 localH(glm::dot(mat.T, H), glm::dot(mat.B, H), NdotH);
+  const float     d = ggxEval(1.0f / mat.roughness, localH);
+  const glm::vec3 localK1(glm::dot(mat.T, k1), glm::dot(mat.B, k1), NdotV);
+  const glm::vec3 localK2(glm::dot(mat.T, k2), glm::dot(mat.B, k2), NdotL);
+  const float     G1 = smithShadowOrMask(localK1, mat.roughness);
+  const float     G2 = G1 * smithShadowOrMask(localK2, mat.roughness);
+
+  const float diffusePdf  = NdotL / kPi;
+  const float specularPdf = G1 * d * 0.25f / (NdotV * NdotH);
+  eval.pdf                = glm::mix(diffusePdf, specularPdf, glossyProbability(NdotV, mat.metallic));
+  eval.diffuse            = mat.baseColor * fDiffuse * diffusePdf;
+  eval.glossy             = fGlossy * G2 * specularPdf;
+  return eval;
+}
+
+// Returns false when the path is absorbed
+bool bsdfSample(const ShadeMaterial& mat, const glm::vec3& k1, const glm::vec3& xi, glm::vec3& k2, glm::vec3& bsdfOverPdf, float& pdf)
+{
+  const float nk1 = std::max(0.0f, glm::dot(mat.N, k1));
+  if(xi.z <= glossyProbability(nk1, mat.metallic))
+  {
+    const glm::vec3 localK1(glm::dot(mat.T, k1), glm::dot(mat.B, k1), nk1);
+    glm::vec3       h = ggxSampleVndf(localK1, mat.roughness, glm::vec2(xi));
+    h                 = mat.T * h.x + mat.B * h.y + mat.N * h.z;
+    k2                = glm::reflect(-k1, h);
+  }
+  else
+  {
+    // Cosine-weighted hemisphere
+    const float r   = std::sqrt(xi.x);
+    const float phi = 2.0f * kPi * xi.y;
+    k2 = mat.T * (r * std::cos(phi)) + mat.B * (r * std::sin(phi)) + mat.N * std::sqrt(std::max(0.0f, 1.0f - xi.x));
+  }
+
+  const BsdfEval  eval  = bsdfEvaluate(mat, k1, k2);
+  const glm::vec3 total = eval.diffuse + eval.glossy;
+  pdf                   = eval.pdf;
+  if(pdf <= 0.00001f || glm::any(glm::isnan(total)))
+    return false;
+  bsdfOverPdf = total / pdf;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Punctual lights, port of singleLightContribution (light_contrib.h.slang) for lights without radius
+//
+// Returns the irradiance, `incident` is the direction of the light at the surface
+glm::vec3 lightContribution(const Light& light, const glm::vec3& pos, const glm::vec3& normal, glm::vec3& incident, float& distance)
+{
+  incident = glm::vec3(0.0f);
+  distance = kInfinite;
+  if(light.type == Light::eDirectional)
+  {
+    if(glm::dot(normal, -light.direction) <= 0.0f)
+      return glm::vec3(0.0f);
+    incident = light.direction;
+    return light.intensity * light.color;
+  }
+
+  const glm::vec3 lightToSurface = pos - light.position;
+  distance                       = glm::length(lightToSurface);
+  incident                       = lightToSurface / distance;
+
+  float attenuation = 1.0f;
+  if(light.invRange > 0.0f)
+  {
+    const float x = distance * light.invRange;
+    attenuation   = glm::clamp(1.0f - x * x * x * x, 0.0f, 1.0f);
+    attenuation *= attenuation;
+  }
+  float spot = 1.0f;
+  if(light.type == Light::eSpot)
+  {
+    const float angle = std::acos(glm::clamp(glm::dot(incident, light.direction), -1.0f, 1.0f));
+    spot              = 1.0f - glm::smoothstep(light.innerAngle, light.outerAngle, angle);
+  }
+  return light.intensity / (distance * distance) * spot * attenuation * light.color;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Work-stealing scheduler of the tiles
+//
+class TileScheduler
+{
+public:
+  TileScheduler(uint32_t numTiles, uint32_t numWorkers)
+      : m_queues(numWorkers)
+  {
+    // Contiguous ranges: neighbouring tiles of a thread share the same parts of the scene
+    for(uint32_t w = 0; w < numWorkers; w++)
+    {
+      const uint32_t begin = uint32_t(uint64_t(numTiles) * w / numWorkers);
+      const uint32_t end   = uint32_t(uint64_t(numTiles) * (w + 1) / numWorkers);
+      for(uint32_t t = begin; t < end; t++)
+        m_queues[w].tiles.push_back(t);
+    }
+  }
+
+  // Next tile of the worker: from the front of its queue, or stolen from the back of another one
+  bool next(uint32_t worker, uint32_t& tile)
+  {
+    {
+      Queue&                      own = m_queues[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if(!own.tiles.empty())
+      {
+        tile = own.tiles.front();
+        own.tiles.pop_front();
+        return true;
+      }
+    }
+    for(size_t i = 1; i < m_queues.size(); i++)
+    {
+      Queue&                      victim = m_queues[(worker + i) % m_queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if(!victim.tiles.empty())
+      {
+        tile = victim.tiles.back();
+        victim.tiles.pop_back();
+        m_numStolen++;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t getNumStolen() const { return m_numStolen; }
+
+private:
+  struct Queue
+  {
+    std::mutex           mutex;
+    std::deque<uint32_t> tiles;
+  };
+  std::vector<Queue>    m_queues;
+  std::atomic<uint32_t> m_numStolen{0};
+};
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// HDR environment: piecewise-constant distribution over the texels, proportional to their
+// luminance times the solid angle they cover (getSphericalUv mapping of the shaders)
+//
+bool PathTracer::loadEnvironment(const std::filesystem::path& filename)
+{
+  int    width = 0, height = 0, channels = 0;
+  float* pixels = stbi_loadf(nvutils::utf8FromPath(filename).c_str(), &width, &height, &channels, 3);
+  if(pixels == nullptr)
+  {
+    LOGE("CPU path tracer: cannot load %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+
+  Environment& env = m_env;
+  env.width        = width;
+  env.height       = height;
+  env.texels.resize(size_t(width) * height);
+  for(size_t i = 0; i < env.texels.size(); i++)
+    env.texels[i] = glm::vec3(pixels[i * 3 + 0], pixels[i * 3 + 1], pixels[i * 3 + 2]);
+  stbi_image_free(pixels);
+
+  env.conditionalCdf.assign(size_t(height) * (width + 1), 0.0f);
+  env.marginalCdf.assign(height + 1, 0.0f);
+  for(int j = 0; j < height; j++)
+  {
+    const float gamma  = ((float(j) + 0.5f) / float(height) - 0.5f) * kPi;
+    const float weight = std::cos(gamma);
+    float*      cdf    = &env.conditionalCdf[size_t(j) * (width + 1)];
+    for(int i = 0; i < width; i++)
+      cdf[i + 1] = cdf[i] + luminance(env.texels[size_t(j) * width + i]) * weight;
+    env.marginalCdf[j + 1] = env.marginalCdf[j] + cdf[width];
+  }
+  env.total = env.marginalCdf[height];
+  m_hasEnv  = env.total > 0.0f;
+  return m_hasEnv;
+}
+
+// Radiance of the environment in a direction, and the pdf of sampleEnvironment() for it
+glm::vec3 PathTracer::evalEnvironment(const glm::vec3& dir, float& pdf) const
+{
+  if(!m_hasEnv)
+  {
+    pdf = 0.0f;
+    return glm::vec3(0.0f);
+  }
+  const float u = std::atan2(dir.z, dir.x) / (2.0f * kPi) + 0.5f;
+  const float v = std::asin(glm::clamp(-dir.y, -1.0f, 1.0f)) / kPi + 0.5f;
+  const int   i = std::min(int(u * float(m_env.width)), m_env.width - 1);
+  const int   j = std::min(int(v * float(m_env.height)), m_env.height - 1);
+
+  const glm::vec3& radiance = m_env.texels[size_t(j) * m_env.width + i];
+  // pdf(texel) * texels per unit square / Jacobian of the mapping (2 pi^2 cos(gamma)); the cosines cancel
+  pdf = luminance(radiance) * float(m_env.width) * float(m_env.height) / (m_env.total * 2.0f * kPi * kPi);
+  return radiance * m_settings.envIntensity;
+}
+
+// Texel by importance, then a uniform point in its area, which the pdf of evalEnvironment() is for
+glm::vec3 PathTracer::sampleEnvironment(const glm::vec4& xi, glm::vec3& dir, float& pdf) const
+{
+  // Row, then texel in the row
+  const float rowTarget = xi.x * m_env.total;
+  const int   j = std::clamp(int(std::upper_bound(m_env.marginalCdf.begin(), m_env.marginalCdf.end(), rowTarget)
+                                 - m_env.marginalCdf.begin())
+                                 - 1,
+                             0, m_env.height - 1);
+  const float* cdf       = &m_env.conditionalCdf[size_t(j) * (m_env.width + 1)];
+  const float  colTarget = xi.y * cdf[m_env.width];
+  const int    i = std::clamp(int(std::upper_bound(cdf, cdf + m_env.width + 1, colTarget) - cdf) - 1, 0, m_env.width - 1);
+
+  const float u     = (float(i) + xi.z) / float(m_env.width);
+  const float v     = (float(j) + xi.w) / float(m_env.height);
+  const float theta = (u - 0.5f) * 2.0f * kPi;
+  const float gamma = (v - 0.5f) * kPi;
+  dir = glm::vec3(std::cos(gamma) * std::cos(theta), -std::sin(gamma), std::cos(gamma) * std::sin(theta));
+  return evalEnvironment(dir, pdf);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Render the image, all threads
+//
+void PathTracer::render(const Scene& scene, const Camera& camera, glm::uvec2 size, const Settings& settings)
+{
+  m_settings = settings;
+  m_camera   = camera;
+  m_size     = size;
+  m_numTiles = (size + glm::uvec2(settings.tileSize - 1)) / glm::uvec2(settings.tileSize);
+
+  const size_t numPixels = size_t(size.x) * size.y;
+  m_color.assign(numPixels, glm::vec4(0.0f));
+  m_albedo.assign(numPixels, glm::vec3(0.0f));
+  m_normal.assign(numPixels, glm::vec3(0.0f));
+  m_depth.assign(numPixels, 0.0f);
+
+  const uint32_t numThreads =
+      settings.numThreads > 0 ? uint32_t(settings.numThreads) : std::max(1u, std::thread::hardware_concurrency());
+  const uint32_t numTiles = m_numTiles.x * m_numTiles.y;
+  TileScheduler  scheduler(numTiles, numThreads);
+
+  const auto               start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for(uint32_t w = 0; w < numThreads; w++)
+  {
+    threads.emplace_back([&, w] {
+      uint32_t tile;
+      while(scheduler.next(w, tile))
+        renderTile(scene, tile);
+    });
+  }
+  for(std::thread& t : threads)
+    t.join();
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  LOGI("CPU path tracer: %ux%u, %d spp, %u threads, %u tiles (%u stolen): %.2f s, %.2f Msamples/s\n", size.x, size.y,
+       settings.samplesPerPixel, numThreads, numTiles, scheduler.getNumStolen(), seconds,
+       double(numPixels) * settings.samplesPerPixel / seconds * 1e-6);
+}
+
+void PathTracer::renderTile(const Scene& scene, uint32_t tile)
+{
+  const glm::uvec2 tileSize(m_settings.tileSize);
+  const glm::uvec2 origin = glm::uvec2(tile % m_numTiles.x, tile / m_numTiles.x) * tileSize;
+  const glm::uvec2 end    = glm::min(origin + tileSize, m_size);
+  const int        spp    = std::max(1, m_settings.samplesPerPixel);
+
+  for(uint32_t y = origin.y; y < end.y; y++)
+  {
+    for(uint32_t x = origin.x; x < end.x; x++)
+    {
+      PixelResult sum;
+      for(int s = 0; s < spp; s++)
+      {
+        const PixelResult r = samplePixel(scene, glm::uvec2(x, y), uint32_t(s));
+        sum.radiance += r.radiance;
+        sum.albedo += r.albedo;
+        sum.normal += r.normal;
+        sum.depth += r.depth;
+      }
+      const size_t index = size_t(y) * m_size.x + x;
+      const float  scale = 1.0f / float(spp);
+      m_color[index]     = sum.radiance * scale;
+      m_albedo[index]    = sum.albedo * scale;
+      m_normal[index]    = sum.normal * scale;
+      m_depth[index]     = sum.depth * scale;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// One path, see pathTrace() and processPixel() of gltf_pathtrace.slang
+//
+PathTracer::PixelResult PathTracer::samplePixel(const Scene& scene, glm::uvec2 pixel, uint32_t sampleIndex) const
+{
+  using namespace shaderio;
+  const PathSampler sampleGen = samplerInit(m_settings.samplerMode, pixel, sampleIndex);
+
+  // Sub-pixel position: the center for the first sample, then a Gaussian filter
+  glm::vec2 jitter(0.5f);
+  if(sampleIndex > 0)
+  {
+    const glm::vec4 u = samplerGet4D(sampleGen, SAMPLER_DIM_CAMERA);
+    const float     r = std::sqrt(-2.0f * std::log(std::max(1e-38f, u.x)));
+    jitter += kAntialiasingStandardDeviation * r * glm::vec2(std::cos(2.0f * kPi * u.y), std::sin(2.0f * kPi * u.y));
+  }
+
+  // Camera ray, row 0 at the top of the image
+  const glm::vec3 forward  = glm::normalize(m_camera.center - m_camera.eye);
+  const glm::vec3 right    = glm::normalize(glm::cross(forward, m_camera.up));
+  const glm::vec3 up       = glm::cross(right, forward);
+  const float     tanHalf  = std::tan(m_camera.fovY * 0.5f);
+  const float     aspect   = float(m_size.x) / float(m_size.y);
+  const glm::vec2 clip     = (glm::vec2(pixel) + jitter) / glm::vec2(m_size) * 2.0f - 1.0f;
+
+  Ray ray;
+  ray.origin    = m_camera.eye;
+  ray.direction = glm::normalize(forward + right * (clip.x * tanHalf * aspect) - up * (clip.y * tanHalf));
+
+  PixelResult result;
+  glm::vec3   radiance(0.0f);
+  glm::vec3   throughput(1.0f);
+  glm::vec2   maxRoughness(0.0f);
+  float       lastSamplePdf = kDirac;
+  result.radiance.w         = 1.0f;
+
+  const bool  useSky     = !m_hasEnv;
+  const float numLights  = float(scene.lights.size());
+  float       lightWeight = scene.lights.empty() ? 0.0f : 0.5f;
+  float       envWeight   = (useSky || m_settings.envIntensity > 0.0f) ? 0.5f : 0.0f;
+  const float totalWeight = lightWeight + envWeight;
+  if(totalWeight > 0.0f)
+  {
+    lightWeight /= totalWeight;
+    envWeight /= totalWeight;
+  }
+  SkyPhysicalParameters sky{};
+  sky.yIsUp = m_camera.up.y > 0.5f ? 1 : 0;
+
+  auto environment = [&](const glm::vec3& dir, float& pdf) {
+    if(useSky)
+    {
+      pdf = samplePhysicalSkyPDF(sky, dir);
+      return evalPhysicalSky(sky, dir);
+    }
+    return evalEnvironment(dir, pdf);
+  };
+
+  for(int depth = 0; depth < m_settings.maxDepth; depth++)
+  {
+    Hit hit;
+    ray.tMin = 0.0f;
+    ray.tMax = kInfinite;
+    if(!scene.bvh.intersect(ray, hit))
+    {
+      if(depth == 0)
+        result.radiance.w = 0.0f;  // Transparent background
+      float           envPdf;
+      const glm::vec3 envColor  = environment(ray.direction, envPdf);
+      const float     misWeight = (lastSamplePdf == kDirac) ? 1.0f : lastSamplePdf / (lastSamplePdf + envPdf);
+      radiance += throughput * misWeight * envColor;
+      break;
+    }
+
+    // Material at the hit
+    const Scene::SurfacePoint sp = scene.getSurfacePoint(hit);
+    const Material  defaultMaterial{};
+    const Material& material = sp.material >= 0 ? scene.materials[sp.material] : defaultMaterial;
+
+    ShadeMaterial mat;
+    glm::vec4     baseColor = material.baseColorFactor * sp.color;
+    float         metallic  = material.metallicFactor;
+    float         roughness = material.roughnessFactor;
+    glm::vec3     emissive  = material.emissiveFactor;
+    if(material.baseColorTexture >= 0)
+      baseColor *= scene.textures[material.baseColorTexture].sample(sp.uv, true);
+    if(material.metallicRoughnessTexture >= 0)
+    {
+      const glm::vec4 mr = scene.textures[material.metallicRoughnessTexture].sample(sp.uv, false);
+      roughness *= mr.y;
+      metallic *= mr.z;
+    }
+    if(material.emissiveTexture >= 0)
+      emissive *= glm::vec3(scene.textures[material.emissiveTexture].sample(sp.uv, true));
+    roughness     = std::max(roughness, kMinRoughness);
+    mat.baseColor = glm::vec3(baseColor);
+    mat.metallic  = glm::clamp(metallic, 0.0f, 1.0f);
+    mat.roughness = glm::vec2(roughness * roughness);
+    mat.emissive  = glm::max(emissive, glm::vec3(0.0f));
+
+    // Two-sided: the normals face the incoming ray
+    glm::vec3 geoNormal = sp.geoNormal;
+    mat.N               = sp.normal;
+    if(glm::dot(geoNormal, ray.direction) > 0.0f)
+      geoNormal = -geoNormal;
+    if(glm::dot(mat.N, geoNormal) < 0.0f)
+      mat.N = -mat.N;
+    orthonormalBasis(mat.N, mat.T, mat.B);
+
+    if(depth == 0)
+    {
+      result.albedo = mat.baseColor;
+      result.normal = mat.N;
+      result.depth  = hit.t;
+    }
+
+    // Roughness only increases along the path, against fireflies
+    maxRoughness  = glm::max(mat.roughness, maxRoughness);
+    mat.roughness = maxRoughness;
+
+    radiance += mat.emissive * throughput;
+    if(material.unlit)
+    {
+      radiance += mat.baseColor;
+      break;
+    }
+
+    // Lights: one-sample MIS between the punctual lights and the environment
+    DirectLight     directLight;
+    const glm::vec4 lightRnd     = samplerGet4D(sampleGen, SAMPLER_DIM_LIGHT(depth));
+    const bool      sampleLights = lightRnd.x <= lightWeight;
+    glm::vec3       lightRadiance(0.0f);
+    float           envPdf = 0.0f;
+    if(totalWeight > 0.0f)
+    {
+      if(lightWeight > 0.0f)
+      {
+        directLight.pdf = 1.0f / numLights;
+        if(sampleLights)
+        {
+          const int lightIndex = std::min(int(lightRnd.y * numLights), int(scene.lights.size()) - 1);
+          glm::vec3 incident;
+          lightRadiance = lightContribution(scene.lights[lightIndex], sp.position, mat.N, incident, directLight.distance)
+                          / (directLight.pdf * lightWeight);
+          directLight.direction = -incident;
+        }
+      }
+      if(envWeight > 0.0f)
+      {
+        if(!sampleLights)
+        {
+          if(useSky)
+          {
+            const SkySamplingResult skySample = samplePhysicalSky(sky, glm::vec2(lightRnd.y, lightRnd.z));
+            directLight.direction             = skySample.direction;
+            envPdf                            = skySample.pdf;
+            lightRadiance                     = skySample.radiance / (envPdf * envWeight);
+          }
+          else
+          {
+            // lightRnd.x chose the environment: rescaled, it is a fourth uniform number
+            const float     xiV         = glm::clamp((lightRnd.x - lightWeight) / std::max(1.0f - lightWeight, 1e-6f), 0.0f, 0.99999994f);
+            const glm::vec3 envRadiance = sampleEnvironment(glm::vec4(lightRnd.y, lightRnd.z, lightRnd.w, xiV),
+                                                            directLight.direction, envPdf);
+            lightRadiance = envPdf > 0.0f ? envRadiance / (envPdf * envWeight) : glm::vec3(0.0f);
+          }
+        }
+        else
+        {
+          environment(directLight.direction, envPdf);
+        }
+      }
+      const float misWeight = (sampleLights ? directLight.pdf : envPdf) / (directLight.pdf + envPdf);
+      directLight.radianceOverPdf = lightRadiance * misWeight;
+      directLight.pdf             = lightWeight * directLight.pdf + envWeight * envPdf;
+    }
+
+    const bool nextEventValid = glm::dot(directLight.direction, geoNormal) > 0.0f && directLight.pdf != 0.0f;
+    glm::vec3  contribution(0.0f);
+    if(nextEventValid)
+    {
+      const BsdfEval eval = bsdfEvaluate(mat, -ray.direction, directLight.direction);
+      if(eval.pdf > 0.0f)
+      {
+        const float     misWeight = directLight.pdf / (directLight.pdf + eval.pdf);
+        const glm::vec3 w         = throughput * directLight.radianceOverPdf * misWeight;
+        contribution              = w * (eval.diffuse + eval.glossy);
+      }
+    }
+
+    // Continue the path
+    const glm::vec4 bsdfRnd = samplerGet4D(sampleGen, SAMPLER_DIM_BSDF(depth));
+    glm::vec3       k2, bsdfOverPdf;
+    float           pdf      = 0.0f;
+    const bool      absorbed = !bsdfSample(mat, -ray.direction, glm::vec3(bsdfRnd), k2, bsdfOverPdf, pdf);
+    if(!absorbed)
+    {
+      throughput *= bsdfOverPdf;
+      lastSamplePdf = pdf;
+      ray.direction = k2;
+      ray.origin    = offsetRay(sp.position, glm::dot(k2, geoNormal) > 0.0f ? geoNormal : -geoNormal);
+    }
+
+    if(nextEventValid)
+    {
+      Ray shadowRay;
+      shadowRay.origin    = offsetRay(sp.position, geoNormal);
+      shadowRay.direction = directLight.direction;
+      shadowRay.tMax      = directLight.distance;
+      if(!scene.bvh.occluded(shadowRay))
+        radiance += contribution;
+    }
+
+    if(absorbed)
+      break;
+
+    // Russian roulette
+    const float rrPcont = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)) + 0.001f, 0.95f);
+    if(bsdfRnd.w >= rrPcont)
+      break;
+    throughput /= rrPcont;
+  }
+
+  // Firefly clamp
+  const float lum = glm::dot(radiance, glm::vec3(1.0f / 3.0f));
+  if(lum > m_settings.fireflyClampThreshold)
+    radiance *= m_settings.fireflyClampThreshold / lum;
+  result.radiance = glm::vec4(radiance, result.radiance.w);
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Outputs
+//
+bool PathTracer::saveImage(const std::filesystem::path& filename) const
+{
+  const shaderio::TonemapperData tonemapper{};
+  std::vector<uint8_t>           pixels(size_t(m_size.x) * m_size.y * 4);
+  for(uint32_t y = 0; y < m_size.y; y++)
+  {
+    for(uint32_t x = 0; x < m_size.x; x++)
+    {
+      const size_t    index = size_t(y) * m_size.x + x;
+      const glm::vec2 uv    = (glm::vec2(x, y) + 0.5f) / glm::vec2(m_size);
+      const glm::vec3 c     = glm::clamp(shaderio::applyTonemap(tonemapper, glm::vec3(m_color[index]), uv), 0.0f, 1.0f);
+      for(int k = 0; k < 3; k++)
+        pixels[index * 4 + k] = uint8_t(c[k] * 255.0f + 0.5f);
+      pixels[index * 4 + 3] = uint8_t(glm::clamp(m_color[index].w, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+  }
+
+  const std::string name = nvutils::utf8FromPath(filename);
+  const int         w    = int(m_size.x);
+  const int         h    = int(m_size.y);
+  const int result = nvutils::extensionMatches(filename, ".png") ? stbi_write_png(name.c_str(), w, h, 4, pixels.data(), w * 4) :
+                                                                   stbi_write_jpg(name.c_str(), w, h, 4, pixels.data(), 95);
+  if(result == 0)
+  {
+    LOGW("Cannot write %s\n", name.c_str());
+    return false;
+  }
+  LOGI("Image saved: %s\n", name.c_str());
+  return true;
+}
+
+bool PathTracer::saveExr(const std::filesystem::path& filename) const
+{
+  const float* color  = &m_color[0].x;
+  const float* albedo = &m_albedo[0].x;
+  const float* normal = &m_normal[0].x;
+  std::vector<ExrChannel> channels = {
+      {"R", color + 0, 4},         {"G", color + 1, 4},         {"B", color + 2, 4},         {"A", color + 3, 4},
+      {"albedo.R", albedo + 0, 3}, {"albedo.G", albedo + 1, 3}, {"albedo.B", albedo + 2, 3}, {"normal.X", normal + 0, 3},
+      {"normal.Y", normal + 1, 3}, {"normal.Z", normal + 2, 3}, {"depth.Z", m_depth.data(), 1},
+  };
+  if(!writeExr(filename, m_size.x, m_size.y, std::move(channels)))
+    return false;
+  LOGI("Image saved: %s\n", nvutils::utf8FromPath(filename).c_str());
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// --cpuRender
+//
+bool renderHeadless(const HeadlessInfo& info, std::shared_ptr<nvutils::CameraManipulator> cameraManip)
+{
+  nvvkgltf::Scene gltfScene;
+  LOGI("Loading scene: %s\n", nvutils::utf8FromPath(info.sceneFilename).c_str());
+  if(!gltfScene.load(info.sceneFilename))
+  {
+    LOGE("Error loading scene: %s\n", nvutils::utf8FromPath(info.sceneFilename).c_str());
+    return false;
+  }
+
+  Scene scene;
+  if(!scene.create(gltfScene, info.sceneFilename))
+    return false;
+
+  PathTracer pathTracer;
+  if(!info.hdrFilename.empty())
+    pathTracer.loadEnvironment(info.hdrFilename);
+
+  // Same camera as the GPU renderer: the first camera of the scene, or the scene fitted in the view
+  const glm::uvec2 size = (info.size.x > 0 && info.size.y > 0) ? info.size : glm::uvec2(1280, 720);
+  cameraManip->setWindowSize(size);
+  nvvkgltf::addSceneCamerasToWidget(cameraManip, info.sceneFilename, gltfScene.getRenderCameras(), gltfScene.getSceneBounds());
+  PathTracer::Camera camera;
+  cameraManip->getLookat(camera.eye, camera.center, camera.up);
+  camera.fovY = glm::radians(cameraManip->getFov());
+
+  PathTracer::Settings settings;
+  settings.samplesPerPixel = std::max(1, info.samplesPerPixel);
+  settings.numThreads      = info.numThreads;
+  pathTracer.render(scene, camera, size, settings);
+
+  const std::filesystem::path outName = nvutils::getExecutablePath();
+  const bool                  saved   = pathTracer.saveImage(std::filesystem::path(outName).replace_extension(".jpg"));
+  return pathTracer.saveExr(std::filesystem::path(outName).replace_extension(".exr")) && saved;
+}
+
+}  // namespace cpu
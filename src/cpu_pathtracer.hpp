@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <nvutils/camera_manipulator.hpp>
+
+#include "cpu_scene.hpp"
+
+// CPU path tracer: renders a glTF scene without a GPU, for render nodes without Vulkan and as
+// a reference for image regressions. It follows the path tracer of the GPU (shaders/gltf_pathtrace.slang):
+// same sampler, same light and environment sampling with MIS, Russian roulette and firefly
+// clamp, with the simple metallic-roughness BSDF (glTF Appendix B).
+namespace cpu {
+
+class PathTracer
+{
+public:
+  struct Settings
+  {
+    int   samplesPerPixel       = 16;
+    int   maxDepth              = 5;
+    float fireflyClampThreshold = 10.0f;
+    int   samplerMode           = 0;   // SAMPLER_WHITE_NOISE, like the GPU, see shaders/sampler.h
+    int   numThreads            = 0;   // 0: all cores
+    int   tileSize              = 16;  // Pixels of a side of a tile, the unit of work of the threads
+    float envIntensity          = 1.0f;
+  };
+
+  struct Camera
+  {
+    glm::vec3 eye{0.0f, 0.0f, 1.0f};
+    glm::vec3 center{0.0f};
+    glm::vec3 up{0.0f, 1.0f, 0.0f};
+    float     fovY{glm::radians(60.0f)};
+  };
+
+  // HDR environment, importance sampled. Without it, the physical sky of the GPU renderer is used.
+  bool loadEnvironment(const std::filesystem::path& filename);
+
+  void render(const Scene& scene, const Camera& camera, glm::uvec2 size, const Settings& settings);
+
+  // Tonemapped (default Filmic tonemapper) LDR image, PNG or JPG
+  bool saveImage(const std::filesystem::path& filename) const;
+  // Linear radiance and the first-hit AOVs (albedo, normal, depth)
+  bool saveExr(const std::filesystem::path& filename) const;
+
+  const std::vector<glm::vec4>& getColor() const { return m_color; }
+  glm::uvec2                    getSize() const { return m_size; }
+
+private:
+  struct Environment
+  {
+    int                    width{0};
+    int                    height{0};
+    std::vector<glm::vec3> texels;
+    std::vector<float>     marginalCdf;     // Rows, height + 1 values
+    std::vector<float>     conditionalCdf;  // Texels of each row, height * (width + 1) values
+    float                  total{0.0f};     // Sum of the weights
+  };
+
+  struct PixelResult
+  {
+    glm::vec4 radiance{0.0f};
+    glm::vec3 albedo{0.0f};
+    glm::vec3 normal{0.0f};
+    float     depth{0.0f};
+  };
+
+  void        renderTile(const Scene& scene, uint32_t tile);
+  PixelResult samplePixel(const Scene& scene, glm::uvec2 pixel, uint32_t sampleIndex) const;
+
+  glm::vec3 evalEnvironment(const glm::vec3& dir, float& pdf) const;
+  glm::vec3 sampleEnvironment(const glm::vec4& xi, glm::vec3& dir, float& pdf) const;
+
+  Environment m_env;
+  bool        m_hasEnv{false};
+
+  // Frame being rendered
+  Settings   m_settings;
+  Camera     m_camera;
+  glm::uvec2 m_size{0};
+  glm::uvec2 m_numTiles{0};
+
+  std::vector<glm::vec4> m_color;
+  std::vector<glm::vec3> m_albedo;
+  std::vector<glm::vec3> m_normal;
+  std::vector<float>     m_depth;
+};
+
+// --cpuRender: load the scene, render it on the CPU with `frames` samples per pixel, and write the
+// images next to the executable, like the headless mode of the GPU renderer
+struct HeadlessInfo
+{
+  std::filesystem::path sceneFilename;
+  std::filesystem::path hdrFilename;
+  glm::uvec2            size{0};
+  int                   samplesPerPixel{1};
+  int                   numThreads{0};
+};
+bool renderHeadless(const HeadlessInfo& info, std::shared_ptr<nvutils::CameraManipulator> cameraManip);
+
+}  // namespace cpu
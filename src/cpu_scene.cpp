@@ -0,0 +1,512 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Scene of the CPU path tracer
+
+    The render nodes of the nvvkgltf::Scene give the primitives to draw, with their world matrix
+    and material. The vertex attributes are read from the glTF accessors (any component type,
+    normalized or not, interleaved or not) and transformed to world space, so a single BVH holds
+    the whole scene. Lights are placed by walking the node hierarchy of the glTF scene.
+
+    The images of the textures are decoded here when the glTF loader did not keep them
+    (PNG/JPEG, from a file or a buffer view); other formats fall back to the material factors.
+
+    The CPU renderer is a reference for the base metallic-roughness material only: base color,
+    metallic-roughness and emissive (with KHR_materials_emissive_strength), or unlit. A scene
+    with another feature on a drawn material (material extensions, alpha blending or masking,
+    normal maps, texture transforms, second texture coordinates) is rejected, rather than
+    rendered with a different look than the GPU path tracer.
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <set>
+#include <string>
+
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <stb/stb_image.h>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/timers.hpp>
+
+#include "cpu_scene.hpp"
+
+namespace cpu {
+
+namespace {
+
+float readComponent(const uint8_t* p, int componentType, bool normalized)
+{
+  switch(componentType)
+  {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT: {
+      float v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      return normalized ? float(*p) / 255.0f : float(*p);
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+      return normalized ? std::max(float(int8_t(*p)) / 127.0f, -1.0f) : float(int8_t(*p));
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      uint16_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return normalized ? float(v) / 65535.0f : float(v);
+    }
+    case TINYGLTF_COMPONENT_TYPE_SHORT: {
+      int16_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return normalized ? std::max(float(v) / 32767.0f, -1.0f) : float(v);
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+      uint32_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return float(v);
+    }
+    default:
+      return 0.0f;
+  }
+}
+
+// Calls `visit(element, pointer to its first component)` for all elements of the accessor.
+// Returns false if the accessor has no data (sparse only) or points outside of its buffer.
+bool visitAccessor(const tinygltf::Model& model, int accessorIndex, const std::function<void(size_t, const uint8_t*)>& visit)
+{
+  if(accessorIndex < 0 || accessorIndex >= int(model.accessors.size()))
+    return false;
+  const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+  if(accessor.bufferView < 0)
+    return false;
+  const tinygltf::BufferView& view   = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer&     buffer = model.buffers[view.buffer];
+
+  const size_t elementSize = size_t(tinygltf::GetNumComponentsInType(accessor.type))
+                             * size_t(tinygltf::GetComponentSizeInBytes(accessor.componentType));
+  const size_t stride = view.byteStride > 0 ? view.byteStride : elementSize;
+  const size_t offset = view.byteOffset + accessor.byteOffset;
+  if(accessor.count > 0 && offset + (accessor.count - 1) * stride + elementSize > buffer.data.size())
+  {
+    LOGW("glTF accessor %d is out of its buffer\n", accessorIndex);
+    return false;
+  }
+  for(size_t i = 0; i < accessor.count; i++)
+    visit(i, buffer.data.data() + offset + i * stride);
+  return true;
+}
+
+}  // namespace
+
+template <int N>
+std::vector<glm::vec<N, float>> readAccessor(const tinygltf::Model& model, int accessorIndex, glm::vec<N, float> fill)
+{
+  std::vector<glm::vec<N, float>> result;
+  if(accessorIndex < 0 || accessorIndex >= int(model.accessors.size()))
+    return result;
+  const tinygltf::Accessor& accessor      = model.accessors[accessorIndex];
+  const int                 numComponents = std::min(N, tinygltf::GetNumComponentsInType(accessor.type));
+  const int                 componentSize = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  result.assign(accessor.count, fill);
+  if(!visitAccessor(model, accessorIndex, [&](size_t i, const uint8_t* p) {
+       for(int c = 0; c < numComponents; c++)
+         result[i][c] = readComponent(p + c * componentSize, accessor.componentType, accessor.normalized);
+     }))
+    result.clear();
+  return result;
+}
+
+std::vector<uint32_t> readIndices(const tinygltf::Model& model, int accessorIndex)
+{
+  std::vector<uint32_t> result;
+  if(accessorIndex < 0 || accessorIndex >= int(model.accessors.size()))
+    return result;
+  const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+  result.resize(accessor.count);
+  if(!visitAccessor(model, accessorIndex,
+                    [&](size_t i, const uint8_t* p) { result[i] = uint32_t(readComponent(p, accessor.componentType, false)); }))
+    result.clear();
+  return result;
+}
+
+template std::vector<glm::vec2> readAccessor<2>(const tinygltf::Model&, int, glm::vec2);
+template std::vector<glm::vec3> readAccessor<3>(const tinygltf::Model&, int, glm::vec3);
+template std::vector<glm::vec4> readAccessor<4>(const tinygltf::Model&, int, glm::vec4);
+
+namespace {
+
+glm::mat4 localMatrix(const tinygltf::Node& node)
+{
+  if(node.matrix.size() == 16)
+    return glm::mat4(glm::make_mat4(node.matrix.data()));
+  glm::mat4 m(1.0f);
+  if(node.translation.size() == 3)
+    m = glm::translate(m, glm::vec3(node.translation[0], node.translation[1], node.translation[2]));
+  if(node.rotation.size() == 4)
+    m *= glm::mat4_cast(glm::quat(float(node.rotation[3]), float(node.rotation[0]), float(node.rotation[1]), float(node.rotation[2])));
+  if(node.scale.size() == 3)
+    m = glm::scale(m, glm::vec3(node.scale[0], node.scale[1], node.scale[2]));
+  return m;
+}
+
+// %XX escapes of the URIs
+std::string decodeUri(const std::string& uri)
+{
+  std::string result;
+  for(size_t i = 0; i < uri.size(); i++)
+  {
+    if(uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(uri[i + 1]) && std::isxdigit(uri[i + 2]))
+    {
+      result += char(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    }
+    else
+      result += uri[i];
+  }
+  return result;
+}
+
+bool decodeImage(const tinygltf::Model& model, const tinygltf::Image& image, const std::filesystem::path& basePath, Texture& texture)
+{
+  // Already decoded by the loader
+  if(!image.image.empty() && image.bits == 8 && image.component >= 1 && image.component <= 4)
+  {
+    texture.width  = image.width;
+    texture.height = image.height;
+    texture.texels.resize(size_t(image.width) * image.height * 4);
+    for(size_t i = 0; i < size_t(image.width) * image.height; i++)
+    {
+      const uint8_t* src = &image.image[i * image.component];
+      uint8_t*       dst = &texture.texels[i * 4];
+      const bool     rgb = image.component >= 3;  // Otherwise grey, and alpha
+      dst[0]             = src[0];
+      dst[1]             = rgb ? src[1] : src[0];
+      dst[2]             = rgb ? src[2] : src[0];
+      dst[3]             = image.component == 4 ? src[3] : (image.component == 2 ? src[1] : 255);
+    }
+    return true;
+  }
+
+  std::vector<uint8_t> encoded;
+  if(image.bufferView >= 0)
+  {
+    const tinygltf::BufferView& view   = model.bufferViews[image.bufferView];
+    const tinygltf::Buffer&     buffer = model.buffers[view.buffer];
+    encoded.assign(buffer.data.begin() + view.byteOffset, buffer.data.begin() + view.byteOffset + view.byteLength);
+  }
+  else if(!image.uri.empty() && image.uri.rfind("data:", 0) != 0)
+  {
+    std::ifstream file(basePath / nvutils::pathFromUtf8(decodeUri(image.uri).c_str()), std::ios::binary);
+    encoded.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  if(encoded.empty())
+    return false;
+
+  int      channels = 0;
+  stbi_uc* pixels = stbi_load_from_memory(encoded.data(), int(encoded.size()), &texture.width, &texture.height, &channels, 4);
+  if(pixels == nullptr)
+    return false;
+  texture.texels.assign(pixels, pixels + size_t(texture.width) * texture.height * 4);
+  stbi_image_free(pixels);
+  return true;
+}
+
+float srgbToLinear(uint8_t v)
+{
+  static const std::array<float, 256> table = [] {
+    std::array<float, 256> t{};
+    for(int i = 0; i < 256; i++)
+    {
+      const float c = float(i) / 255.0f;
+      t[i]          = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    return t;
+  }();
+  return table[v];
+}
+
+// Features of the material the CPU renderer does not implement, empty for a base PBR material
+std::string getUnsupportedFeatures(const tinygltf::Material& material)
+{
+  std::string features;
+  auto        add = [&](const std::string& feature) { features += (features.empty() ? "" : ", ") + feature; };
+  for(const auto& [name, extension] : material.extensions)
+  {
+    if(name != "KHR_materials_emissive_strength" && name != "KHR_materials_unlit")
+      add(name);
+  }
+  if(!material.alphaMode.empty() && material.alphaMode != "OPAQUE")
+    add("alphaMode " + material.alphaMode);
+  if(material.normalTexture.index >= 0)
+    add("normalTexture");
+  const std::pair<const char*, const tinygltf::TextureInfo*> textures[] = {
+      {"baseColorTexture", &material.pbrMetallicRoughness.baseColorTexture},
+      {"metallicRoughnessTexture", &material.pbrMetallicRoughness.metallicRoughnessTexture},
+      {"emissiveTexture", &material.emissiveTexture},
+  };
+  for(const auto& [name, info] : textures)
+  {
+    if(info->index < 0)
+      continue;
+    if(info->texCoord != 0)
+      add(fmt::format("{}.texCoord {}", name, info->texCoord));
+    if(info->extensions.count("KHR_texture_transform") > 0)
+      add(fmt::format("{} KHR_texture_transform", name));
+  }
+  return features;
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Bilinear sample, with repeat wrapping
+//
+glm::vec4 Texture::sample(glm::vec2 uv, bool srgb) const
+{
+  const float x  = uv.x * float(width) - 0.5f;
+  const float y  = uv.y * float(height) - 0.5f;
+  const float fx = std::floor(x);
+  const float fy = std::floor(y);
+  const float tx = x - fx;
+  const float ty = y - fy;
+
+  auto texel = [&](int i, int j) {
+    i                 = ((i % width) + width) % width;
+    j                 = ((j % height) + height) % height;
+    const uint8_t* t  = &texels[(size_t(j) * width + i) * 4];
+    glm::vec4      c;
+    for(int k = 0; k < 3; k++)
+      c[k] = srgb ? srgbToLinear(t[k]) : float(t[k]) / 255.0f;
+    c.w = float(t[3]) / 255.0f;
+    return c;
+  };
+  const int i = int(fx);
+  const int j = int(fy);
+  return glm::mix(glm::mix(texel(i, j), texel(i + 1, j), tx), glm::mix(texel(i, j + 1), texel(i + 1, j + 1), tx), ty);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Flatten the visible render nodes, and build the BVH
+//
+bool Scene::create(const nvvkgltf::Scene& scene, const std::filesystem::path& filename)
+{
+  nvutils::ScopedTimer st(__FUNCTION__);
+
+  const tinygltf::Model& model = scene.getModel();
+  for(const nvvkgltf::RenderNode& renderNode : scene.getRenderNodes())
+  {
+    if(!renderNode.visible)
+      continue;
+    const nvvkgltf::RenderPrimitive& renderPrimitive = scene.getRenderPrimitive(renderNode.renderPrimID);
+    addPrimitive(model, *renderPrimitive.pPrimitive, renderNode.worldMatrix, renderNode.materialID);
+  }
+  if(m_triangles.empty())
+  {
+    LOGE("CPU scene: no triangles\n");
+    return false;
+  }
+
+  // Only the drawn materials must be supported
+  bool supported = true;
+  for(int materialIndex : std::set<int>(m_triangleMaterials.begin(), m_triangleMaterials.end()))
+  {
+    if(materialIndex < 0 || materialIndex >= int(model.materials.size()))
+      continue;
+    const std::string features = getUnsupportedFeatures(model.materials[materialIndex]);
+    if(!features.empty())
+    {
+      LOGE("CPU scene: material %d (%s) uses %s, the CPU renderer only supports the base metallic-roughness material\n",
+           materialIndex, model.materials[materialIndex].name.c_str(), features.c_str());
+      supported = false;
+    }
+  }
+  if(!supported)
+    return false;
+
+  loadMaterials(model, filename.parent_path());
+  loadLights(model);
+
+  bvh.build(m_positions, m_triangles);
+  LOGI("CPU scene: %zu triangles, %zu BVH nodes, %zu leaves, depth %u\n", m_triangles.size(), bvh.getNodeCount(),
+       bvh.getLeafCount(), bvh.getDepth());
+  return true;
+}
+
+void Scene::addPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const glm::mat4& worldMatrix, int materialID)
+{
+  if(primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != -1)
+    return;  // Points, lines and strips are not rendered
+  auto attribute = [&](const char* name) {
+    auto it = primitive.attributes.find(name);
+    return it == primitive.attributes.end() ? -1 : it->second;
+  };
+
+  const std::vector<glm::vec3> positions = readAccessor<3>(model, attribute("POSITION"), glm::vec3(0.0f));
+  if(positions.empty())
+    return;
+  std::vector<glm::vec3> normals = readAccessor<3>(model, attribute("NORMAL"), glm::vec3(0.0f));
+  std::vector<glm::vec2> uvs     = readAccessor<2>(model, attribute("TEXCOORD_0"), glm::vec2(0.0f));
+  std::vector<glm::vec4> colors  = readAccessor<4>(model, attribute("COLOR_0"), glm::vec4(1.0f));
+  normals.resize(positions.size(), glm::vec3(0.0f));  // Zero: the geometric normal is used
+  uvs.resize(positions.size(), glm::vec2(0.0f));
+  colors.resize(positions.size(), glm::vec4(1.0f));
+
+  std::vector<uint32_t> indices = readIndices(model, primitive.indices);
+  if(primitive.indices < 0)
+  {
+    indices.resize(positions.size());
+    std::iota(indices.begin(), indices.end(), 0u);
+  }
+
+  const uint32_t  base         = uint32_t(m_positions.size());
+  const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(worldMatrix)));
+  for(size_t i = 0; i < positions.size(); i++)
+  {
+    m_positions.push_back(glm::vec3(worldMatrix * glm::vec4(positions[i], 1.0f)));
+    const glm::vec3 n = normalMatrix * normals[i];
+    m_normals.push_back(glm::dot(n, n) > 0.0f ? glm::normalize(n) : n);
+    m_uvs.push_back(uvs[i]);
+    m_colors.push_back(colors[i]);
+  }
+  for(size_t i = 0; i + 2 < indices.size(); i += 3)
+  {
+    if(indices[i] >= positions.size() || indices[i + 1] >= positions.size() || indices[i + 2] >= positions.size())
+      continue;
+    m_triangles.emplace_back(base + indices[i], base + indices[i + 1], base + indices[i + 2]);
+    m_triangleMaterials.push_back(materialID);
+  }
+}
+
+void Scene::loadMaterials(const tinygltf::Model& model, const std::filesystem::path& basePath)
+{
+  // Texture index of the glTF -> decoded image, or -1
+  std::vector<int> imageTextures(model.images.size(), -2);  // -2: not decoded yet
+  auto             getTexture = [&](int textureIndex) {
+    if(textureIndex < 0 || textureIndex >= int(model.textures.size()))
+      return -1;
+    const int source = model.textures[textureIndex].source;
+    if(source < 0 || source >= int(model.images.size()))
+      return -1;
+    if(imageTextures[source] == -2)
+    {
+      Texture texture;
+      if(decodeImage(model, model.images[source], basePath, texture))
+      {
+        imageTextures[source] = int(textures.size());
+        textures.push_back(std::move(texture));
+      }
+      else
+      {
+        LOGW("CPU scene: image %d (%s) not supported, using the material factors\n", source, model.images[source].uri.c_str());
+        imageTextures[source] = -1;
+      }
+    }
+    return imageTextures[source];
+  };
+
+  for(const tinygltf::Material& gltfMaterial : model.materials)
+  {
+    const tinygltf::PbrMetallicRoughness& pbr = gltfMaterial.pbrMetallicRoughness;
+
+    Material material;
+    material.baseColorFactor = glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2],
+                                         pbr.baseColorFactor[3]);
+    material.metallicFactor  = float(pbr.metallicFactor);
+    material.roughnessFactor = float(pbr.roughnessFactor);
+    material.emissiveFactor =
+        glm::vec3(gltfMaterial.emissiveFactor[0], gltfMaterial.emissiveFactor[1], gltfMaterial.emissiveFactor[2]);
+    auto strength = gltfMaterial.extensions.find("KHR_materials_emissive_strength");
+    if(strength != gltfMaterial.extensions.end() && strength->second.Has("emissiveStrength"))
+      material.emissiveFactor *= float(strength->second.Get("emissiveStrength").GetNumberAsDouble());
+    material.unlit = gltfMaterial.extensions.count("KHR_materials_unlit") > 0;
+
+    material.baseColorTexture         = getTexture(pbr.baseColorTexture.index);
+    material.metallicRoughnessTexture = getTexture(pbr.metallicRoughnessTexture.index);
+    material.emissiveTexture          = getTexture(gltfMaterial.emissiveTexture.index);
+    materials.push_back(material);
+  }
+}
+
+void Scene::loadLights(const tinygltf::Model& model)
+{
+  if(model.lights.empty() || model.scenes.empty())
+    return;
+
+  const int sceneIndex = std::max(0, model.defaultScene);
+  auto      visit      = [&](auto&& self, int nodeIndex, const glm::mat4& parentMatrix) -> void {
+    const tinygltf::Node& node  = model.nodes[nodeIndex];
+    const glm::mat4       world = parentMatrix * localMatrix(node);
+    if(node.light >= 0 && node.light < int(model.lights.size()))
+    {
+      const tinygltf::Light& gltfLight = model.lights[node.light];
+      Light                  light;
+      light.type      = gltfLight.type == "directional" ? Light::eDirectional :
+                        gltfLight.type == "spot"        ? Light::eSpot :
+                                                          Light::ePoint;
+      light.position  = glm::vec3(world[3]);
+      light.direction = glm::normalize(glm::mat3(world) * glm::vec3(0.0f, 0.0f, -1.0f));
+      if(gltfLight.color.size() == 3)
+        light.color = glm::vec3(gltfLight.color[0], gltfLight.color[1], gltfLight.color[2]);
+      light.intensity  = float(gltfLight.intensity);
+      light.invRange   = gltfLight.range > 0.0 ? float(1.0 / gltfLight.range) : 0.0f;
+      light.innerAngle = float(gltfLight.spot.innerConeAngle);
+      light.outerAngle = float(gltfLight.spot.outerConeAngle);
+      lights.push_back(light);
+    }
+    for(int child : node.children)
+      self(self, child, world);
+  };
+  for(int nodeIndex : model.scenes[std::min(sceneIndex, int(model.scenes.size()) - 1)].nodes)
+    visit(visit, nodeIndex, glm::mat4(1.0f));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Interpolated attributes of a hit
+//
+Scene::SurfacePoint Scene::getSurfacePoint(const Hit& hit) const
+{
+  const glm::uvec3& tri = m_triangles[hit.triangle];
+  const float       w   = 1.0f - hit.u - hit.v;
+
+  SurfacePoint sp;
+  const glm::vec3& p0 = m_positions[tri.x];
+  const glm::vec3& p1 = m_positions[tri.y];
+  const glm::vec3& p2 = m_positions[tri.z];
+  sp.position         = w * p0 + hit.u * p1 + hit.v * p2;
+  sp.geoNormal        = glm::normalize(glm::cross(p1 - p0, p2 - p0));
+
+  const glm::vec3 n = w * m_normals[tri.x] + hit.u * m_normals[tri.y] + hit.v * m_normals[tri.z];
+  sp.normal         = glm::dot(n, n) > 1e-12f ? glm::normalize(n) : sp.geoNormal;
+  sp.uv             = w * m_uvs[tri.x] + hit.u * m_uvs[tri.y] + hit.v * m_uvs[tri.z];
+  sp.color          = w * m_colors[tri.x] + hit.u * m_colors[tri.y] + hit.v * m_colors[tri.z];
+
+  const int material = m_triangleMaterials[hit.triangle];
+  sp.material        = (material >= 0 && material < int(materials.size())) ? material : -1;
+  return sp;
+}
+
+}  // namespace cpu
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <nvvkgltf/scene.hpp>
+
+#include "cpu_bvh.hpp"
+
+namespace cpu {
+
+// Elements of an accessor as N floats; components missing in the accessor keep `fill`.
+// Empty if the accessor has no data (sparse only) or points outside of its buffer.
+template <int N>
+std::vector<glm::vec<N, float>> readAccessor(const tinygltf::Model& model, int accessorIndex, glm::vec<N, float> fill);
+std::vector<uint32_t> readIndices(const tinygltf::Model& model, int accessorIndex);
+
+// RGBA8 texture, sampled bilinearly with repeat
+struct Texture
+{
+  int                  width{0};
+  int                  height{0};
+  std::vector<uint8_t> texels;
+
+  glm::vec4 sample(glm::vec2 uv, bool srgb) const;
+};
+
+// glTF metallic-roughness material
+struct Material
+{
+  glm::vec4 baseColorFactor{1.0f};
+  float     metallicFactor{1.0f};
+  float     roughnessFactor{1.0f};
+  glm::vec3 emissiveFactor{0.0f};  // Emissive strength included
+  int       baseColorTexture{-1};  // Index in Scene::textures
+  int       metallicRoughnessTexture{-1};
+  int       emissiveTexture{-1};
+  bool      unlit{false};
+};
+
+// KHR_lights_punctual, in world space
+struct Light
+{
+  enum Type
+  {
+    eDirectional,
+    ePoint,
+    eSpot,
+  };
+  Type      type{ePoint};
+  glm::vec3 position{0.0f};
+  glm::vec3 direction{0.0f, 0.0f, -1.0f};  // Direction of the emitted light
+  glm::vec3 color{1.0f};
+  float     intensity{1.0f};
+  float     invRange{0.0f};  // 0: infinite
+  float     innerAngle{0.0f};
+  float     outerAngle{0.785398f};
+};
+
+// Flattened copy of a glTF scene for the CPU path tracer: the primitives of all visible render
+// nodes are transformed to world space and share one BVH.
+class Scene
+{
+public:
+  // `filename` locates the images referenced by URI
+  bool create(const nvvkgltf::Scene& scene, const std::filesystem::path& filename);
+
+  // Shading attributes at a hit
+  struct SurfacePoint
+  {
+    glm::vec3 position;
+    glm::vec3 normal;     // Interpolated, normalized
+    glm::vec3 geoNormal;  // Of the triangle, normalized
+    glm::vec2 uv;
+    glm::vec4 color;      // Vertex color
+    int       material;   // -1: default material
+  };
+  SurfacePoint getSurfacePoint(const Hit& hit) const;
+
+  Bvh4                 bvh;
+  std::vector<Material> materials;
+  std::vector<Texture>  textures;
+  std::vector<Light>    lights;
+
+  size_t getTriangleCount() const { return m_triangles.size(); }
+
+private:
+  void addPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive, const glm::mat4& worldMatrix, int materialID);
+  void loadMaterials(const tinygltf::Model& model, const std::filesystem::path& basePath);
+  void loadLights(const tinygltf::Model& model);
+
+  std::vector<glm::vec3>  m_positions;
+  std::vector<glm::vec3>  m_normals;
+  std::vector<glm::vec2>  m_uvs;
+  std::vector<glm::vec4>  m_colors;
+  std::vector<glm::uvec3> m_triangles;
+  std::vector<int>        m_triangleMaterials;
+};
+
+}  // namespace cpu
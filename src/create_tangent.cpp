@@ -52,6 +52,8 @@ using namespace glm;
 #include <nvutils/timers.hpp>
 #include <nvvkgltf/tinygltf_utils.hpp>
 
+#include "trace_export.hpp"
+
 // Structure to hold context data for MikkTSpace interface
 // Contains references to the glTF model and primitive being processed
 struct UserData
@@ -197,6 +199,7 @@ void simpleCreateTangents(SMikkTSpaceContext* mikkContext)
 void recomputeTangents(tinygltf::Model& model, bool forceCreation, bool mikktspace)
 {
   SCOPED_TIMER(__FUNCTION__);
+  TRACE_SCOPE("recomputeTangents");
 
   // Set up MikkTSpace interface
   SMikkTSpaceInterface mikkInterface   = {};
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Deletion Queue
+
+    - The render loop submits the command buffer of a frame after its
+      onRender. nextFrame() is called at the beginning of onRender: the
+      value it signals (vkQueueSubmit2 without command buffers) waits for
+      all the commands submitted before, including the previous frame
+    - A retired object is tagged with the value following the last one
+      submitted: retired during onRender, after nextFrame(), it may be used
+      by the frame being recorded, and the value is only signaled after it
+    - The semaphore is only signaled when something waits for it, so an
+      idle application does not submit anything
+    - The values are increasing: the entries are destroyed from the front
+      of the queue, until one is not reached yet
+    - The category of the MemoryReport scope open when retiring is kept
+      with the entry: nextFrame() runs outside any scope, the memory freed
+      is taken from that category instead of the memory not tracked
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "deletion_queue.hpp"
+
+void DeletionQueue::init(nvvk::ResourceAllocator* allocator, nvvk::SamplerPool* samplerPool, MemoryReport* memoryReport, VkQueue queue)
+{
+  m_allocator    = allocator;
+  m_samplerPool  = samplerPool;
+  m_memoryReport = memoryReport;
+  m_device       = allocator->getDevice();
+  m_queue        = queue;
+
+  const VkSemaphoreTypeCreateInfo typeInfo{
+      .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+      .initialValue  = 0,
+  };
+  const VkSemaphoreCreateInfo semaphoreInfo{.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, .pNext = &typeInfo};
+  NVVK_CHECK(vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore));
+  NVVK_DBG_NAME(m_semaphore);
+  m_value = 0;
+}
+
+void DeletionQueue::deinit()
+{
+  if(m_semaphore == VK_NULL_HANDLE)
+    return;
+  vkQueueWaitIdle(m_queue);
+  collect(UINT64_MAX);
+  vkDestroySemaphore(m_device, m_semaphore, nullptr);
+  m_semaphore = VK_NULL_HANDLE;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Signal the value of the objects retired since the last call, then destroy the completed ones
+void DeletionQueue::nextFrame()
+{
+  if(m_entries.empty())
+    return;
+
+  if(m_entries.back().value > m_value)
+    signal();
+
+  uint64_t completed = 0;
+  NVVK_CHECK(vkGetSemaphoreCounterValue(m_device, m_semaphore, &completed));
+  collect(completed);
+}
+
+void DeletionQueue::wait(uint64_t value)
+{
+  // Not signaled yet: the value follows the commands submitted so far
+  if(value > m_value)
+    signal();
+  value = std::min(value, m_value);
+
+  const VkSemaphoreWaitInfo waitInfo{
+      .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+      .semaphoreCount = 1,
+      .pSemaphores    = &m_semaphore,
+      .pValues        = &value,
+  };
+  NVVK_CHECK(vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX));
+  collect(value);
+}
+
+// An empty entry, so the next frame signals the value
+uint64_t DeletionQueue::frameValue()
+{
+  return retire([]() {});
+}
+
+bool DeletionQueue::isSignaled(uint64_t value) const
+{
+  if(value > m_value)
+    return false;
+  uint64_t completed = 0;
+  NVVK_CHECK(vkGetSemaphoreCounterValue(m_device, m_semaphore, &completed));
+  return completed >= value;
+}
+
+void DeletionQueue::signal()
+{
+  m_value++;
+  const VkSemaphoreSubmitInfo signalInfo{
+      .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+      .semaphore = m_semaphore,
+      .value     = m_value,
+      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+  };
+  const VkSubmitInfo2 submitInfo{
+      .sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+      .signalSemaphoreInfoCount = 1,
+      .pSignalSemaphoreInfos    = &signalInfo,
+  };
+  NVVK_CHECK(vkQueueSubmit2(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+}
+
+void DeletionQueue::collect(uint64_t completed)
+{
+  while(!m_entries.empty() && m_entries.front().value <= completed)
+  {
+    // Moved out first: the function may retire other objects
+    Entry entry = std::move(m_entries.front());
+    m_entries.pop_front();
+    if(entry.category && m_memoryReport)
+    {
+      MemoryReport::Scope memScope(*m_memoryReport, *entry.category);
+      entry.destroy();
+    }
+    else
+    {
+      entry.destroy();
+    }
+    m_destroyed++;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Retire the objects: the handles are copied in the function, the ones of the caller are reset
+uint64_t DeletionQueue::retire(std::function<void()> destroy)
+{
+  m_entries.push_back({m_value + 1, std::move(destroy), MemoryReport::currentCategory()});
+  return m_value + 1;
+}
+
+void DeletionQueue::retire(nvvk::Buffer& buffer)
+{
+  if(buffer.buffer == VK_NULL_HANDLE)
+    return;
+  retire([allocator = m_allocator, buffer]() mutable { allocator->destroyBuffer(buffer); });
+  buffer = {};
+}
+
+void DeletionQueue::retire(nvvk::Image& image)
+{
+  if(image.image == VK_NULL_HANDLE)
+    return;
+  retire([allocator = m_allocator, image]() mutable { allocator->destroyImage(image); });
+  image = {};
+}
+
+void DeletionQueue::retire(nvvk::AccelerationStructure& accel)
+{
+  if(accel.accel == VK_NULL_HANDLE)
+    return;
+  retire([allocator = m_allocator, accel]() mutable { allocator->destroyAcceleration(accel); });
+  accel = {};
+}
+
+void DeletionQueue::retire(VkImageView& view)
+{
+  if(view == VK_NULL_HANDLE)
+    return;
+  retire([device = m_device, view]() { vkDestroyImageView(device, view, nullptr); });
+  view = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::retire(VkSampler& sampler)
+{
+  if(sampler == VK_NULL_HANDLE)
+    return;
+  retire([samplerPool = m_samplerPool, sampler]() { samplerPool->releaseSampler(sampler); });
+  sampler = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::retire(VkPipeline& pipeline)
+{
+  if(pipeline == VK_NULL_HANDLE)
+    return;
+  retire([device = m_device, pipeline]() { vkDestroyPipeline(device, pipeline, nullptr); });
+  pipeline = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::retire(VkShaderEXT& shader)
+{
+  if(shader == VK_NULL_HANDLE)
+    return;
+  retire([device = m_device, shader]() { vkDestroyShaderEXT(device, shader, nullptr); });
+  shader = VK_NULL_HANDLE;
+}
+
+void DeletionQueue::retire(std::unique_ptr<nvvk::GBuffer>& gbuffer)
+{
+  if(!gbuffer)
+    return;
+  // std::function must be copyable
+  retire([old = std::shared_ptr<nvvk::GBuffer>(std::move(gbuffer))]() { old->deinit(); });
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include <vulkan/vulkan_core.h>
+#include <nvvk/gbuffers.hpp>
+#include <nvvk/resource_allocator.hpp>
+#include <nvvk/sampler_pool.hpp>
+
+#include "memory_report.hpp"
+
+
+// GPU objects destroyed once the frames using them are done, instead of waiting for the queue or
+// the device to be idle. A timeline semaphore is signaled on the queue after the command buffers
+// of each frame: an object retired now is tagged with the next value, which is signaled after the
+// command buffer being recorded, and destroyed when the semaphore reaches it. Objects are retired
+// on the main thread, once their last use is recorded. They are destroyed in a MemoryReport scope
+// of the category of the scope they were retired in, so their memory is freed from that category.
+class DeletionQueue
+{
+public:
+  void init(nvvk::ResourceAllocator* allocator, nvvk::SamplerPool* samplerPool, MemoryReport* memoryReport, VkQueue queue);
+  void deinit();  // Waits for the queue, destroys everything still retired
+
+  // Once per frame, before recording: signals the value of the objects retired by the previous
+  // frames, and destroys those the GPU is done with
+  void nextFrame();
+
+  // The handles are reset, the objects are destroyed later
+  void retire(nvvk::Buffer& buffer);
+  void retire(nvvk::Image& image);  // With its view
+  void retire(nvvk::AccelerationStructure& accel);
+  void retire(VkImageView& view);
+  void retire(VkSampler& sampler);  // Released to the sampler pool
+  void retire(VkPipeline& pipeline);
+  void retire(VkShaderEXT& shader);
+  void retire(std::unique_ptr<nvvk::GBuffer>& gbuffer);  // With all its images, e.g. when resizing
+  // Anything else, e.g. an object owning many resources. Returns the value it waits for.
+  uint64_t retire(std::function<void()> destroy);
+
+  // Waits for the value and destroys what was retired up to it, for an object to be reused. The
+  // commands submitted so far are waited for, not the frame being recorded: it must not use them.
+  void wait(uint64_t value);
+
+  // Value signaled once the commands of the frame being recorded are done, e.g. a copy for the
+  // host; isSignaled() tells when it can be read, without waiting
+  uint64_t frameValue();
+  bool     isSignaled(uint64_t value) const;
+
+  size_t   getPending() const { return m_entries.size(); }
+  uint64_t getDestroyed() const { return m_destroyed; }
+
+private:
+  struct Entry
+  {
+    uint64_t                      value{0};  // Signaled once the object is no longer used
+    std::function<void()>         destroy;
+    std::optional<MemoryCategory> category;  // Scope of the retire
+  };
+
+  void signal();  // Next value, after the commands submitted so far
+  void collect(uint64_t completed);
+
+  nvvk::ResourceAllocator* m_allocator{};
+  nvvk::SamplerPool*       m_samplerPool{};
+  MemoryReport*            m_memoryReport{};
+  VkDevice                 m_device{};
+  VkQueue                  m_queue{};
+  VkSemaphore              m_semaphore{};
+  uint64_t                 m_value{0};  // Last value submitted
+  std::deque<Entry>        m_entries;   // In the order of their values
+  uint64_t                 m_destroyed{0};
+};
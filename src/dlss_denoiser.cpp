@@ -44,15 +44,18 @@ void DlssDenoiser::init(Resources& resources)
   VkSampler linearSampler{};
   resources.samplerPool.acquireSampler(linearSampler);
   // G-Buffer
-  m_dlssGBuffers.init({.allocator      = &resources.allocator,
-                       .colorFormats   = m_bufferInfos,
-                       .imageSampler   = linearSampler,
-                       .descriptorPool = resources.descriptorPool});
+  m_gBuffersInfo = {.allocator      = &resources.allocator,
+                    .colorFormats   = m_bufferInfos,
+                    .imageSampler   = linearSampler,
+                    .descriptorPool = resources.descriptorPool};
+  m_dlssGBuffers.init(m_gBuffersInfo);
 }
 
 void DlssDenoiser::deinit()
 {
-  m_dlssGBuffers.deinit();
+  if(!m_released)
+    m_dlssGBuffers.deinit();
+  m_released = false;
   m_dlss.deinit();
   m_ngx.deinit();
   m_initialized = false;
@@ -117,11 +120,28 @@ VkExtent2D DlssDenoiser::updateSize(VkCommandBuffer cmd, VkExtent2D size)
   m_dlss.cmdInit(cmd, m_ngx, initInfo);
 
   // Recreate the G-Buffers
+  if(m_released)
+  {
+    m_dlssGBuffers.init(m_gBuffersInfo);
+    m_released = false;
+  }
   m_dlssGBuffers.update(cmd, m_renderingSize);
 
   return m_renderingSize;
 }
 
+void DlssDenoiser::releaseResources()
+{
+  if(m_released || m_dlssGBuffers.getSize().width == 0)
+    return;
+
+  // The previous frames may still be using the images
+  vkDeviceWaitIdle(m_device);
+  m_dlss.deinit();
+  m_dlssGBuffers.deinit();
+  m_released = true;
+}
+
 void DlssDenoiser::setResources()
 {
   if(!m_dlssSupported || !m_initialized)
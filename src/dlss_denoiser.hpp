@@ -67,6 +67,10 @@ public:
   // When the size of the rendering changes, we need to update the DLSS buffers
   VkExtent2D updateSize(VkCommandBuffer cmd, VkExtent2D size);
 
+  // Destroy the DLSS feature and its G-Buffers while DLSS is disabled, updateSize recreates them
+  void releaseResources();
+  bool isReleased() const { return m_released; }
+
   // This is setting the guide resources for the DLSS
   void setResources();
 
@@ -106,7 +110,9 @@ private:
       {VK_FORMAT_R16_SFLOAT},           // #DLSS - ViewZ                : eDlssDepth
   };
 
-  nvvk::GBuffer m_dlssGBuffers{};  // G-Buffers: for denoising
+  nvvk::GBuffer         m_dlssGBuffers{};  // G-Buffers: for denoising
+  nvvk::GBufferInitInfo m_gBuffersInfo{};
+  bool                  m_released = false;
   bool          m_dlssSupported = false;
   VkExtent2D    m_renderingSize{};
   VkDevice      m_device{};
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Dynamic Resolution
+
+    - Motion is detected from the frame counter: the renderer resets it each
+      frame the camera or the scene changes, so frameCount == 0 on every frame
+      of a navigation
+    - The targets have the size of the viewport and only their top-left part
+      is rendered, so changing the scale does not reallocate. On a resize of
+      the viewport, the previous targets go to the deletion queue
+    - The color is upscaled with a linear blit, or nearest when the device
+      cannot filter its format (32-bit float is optional)
+    - The cost of the path tracer is about proportional to the number of
+      pixels: the scale per axis follows sqrt(target / measured). The GPU time
+      is read back a few frames late, so the first reduced frames keep the
+      scale and the steps are bounded
+    - The first frame without motion sets frameCount back to 0: the image
+      accumulated from there is at full resolution, the upscaled frame is
+      not blended in
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+#include <nvgui/property_editor.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "dynamic_resolution.hpp"
+
+// Reduced frames before the measured GPU time is theirs
+constexpr int kSettleFrames = 4;
+
+void DynamicResolution::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"ptDynRes", "PathTracer: Lower the resolution while the camera or the scene change"}, &m_settings.enable, true);
+  paramReg->add({"ptDynResTarget", "PathTracer: Dynamic resolution, target GPU time in milliseconds"}, &m_settings.targetMs);
+  paramReg->add({"ptDynResMinScale", "PathTracer: Dynamic resolution, lowest fraction of the viewport"}, &m_settings.minScale);
+  paramReg->add({"ptDynResDepth", "PathTracer: Dynamic resolution, maximum depth while moving (0: unchanged)"},
+                &m_settings.motionDepth);
+}
+
+void DynamicResolution::deinit()
+{
+  if(m_targets)
+    m_targets->deinit();
+  m_targets.reset();
+  m_active       = false;
+  m_activeFrames = 0;
+}
+
+void DynamicResolution::onUi()
+{
+  namespace PE = nvgui::PropertyEditor;
+  if(PE::begin())
+  {
+    PE::Checkbox("Dynamic Resolution", &m_settings.enable,
+                 "Lower the resolution while the camera or the scene change, back to full resolution when it stops");
+    ImGui::BeginDisabled(!m_settings.enable);
+    PE::SliderFloat("Target Time (ms)", &m_settings.targetMs, 2.0f, 100.0f, "%.1f", ImGuiSliderFlags_Logarithmic,
+                    "GPU time of the path tracer while moving");
+    PE::SliderFloat("Min Scale", &m_settings.minScale, 0.1f, 1.0f, "%.2f", 0, "Lowest fraction of the viewport, per axis");
+    PE::SliderInt("Depth While Moving", &m_settings.motionDepth, 0, 20, "%d", 0, "Maximum number of bounces while moving, 0: unchanged");
+    PE::Text("Scale", m_active ? fmt::format("{:.2f}", m_scale) : fmt::format("{:.2f} (full resolution)", m_scale));
+    ImGui::EndDisabled();
+    PE::end();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Size of the frame to render: a fraction of the viewport while active
+VkExtent2D DynamicResolution::getRenderSize(const Resources& res) const
+{
+  const VkExtent2D size = res.gBuffers.getSize();
+  if(!m_active)
+    return size;
+  return {std::max(1U, uint32_t(std::lround(size.width * m_scale))), std::max(1U, uint32_t(std::lround(size.height * m_scale)))};
+}
+
+int DynamicResolution::getMaxDepth(int maxDepth) const
+{
+  return (m_active && m_settings.motionDepth > 0) ? std::min(maxDepth, m_settings.motionDepth) : maxDepth;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Resolution of the frame, and scale from the GPU time of the previous reduced frames
+void DynamicResolution::update(VkCommandBuffer cmd, Resources& res, bool available)
+{
+  const bool moving = res.frameCount == 0;
+  const bool active = m_settings.enable && available && moving && res.settings.maxFrames > 1;
+
+  // Motion stopped: restart the accumulation at full resolution
+  if(m_active && !active)
+  {
+    res.frameCount = 0;
+  }
+
+  m_activeFrames = active ? m_activeFrames + 1 : 0;
+  if(m_activeFrames > kSettleFrames && m_gpuMs > 0.0f)
+  {
+    const float ratio = std::sqrt(m_settings.targetMs / m_gpuMs);
+    if(ratio < 0.95f || ratio > 1.05f)
+      m_scale *= std::clamp(ratio, 0.8f, 1.25f);
+  }
+  m_scale  = std::clamp(m_scale, std::clamp(m_settings.minScale, 0.1f, 1.0f), 1.0f);
+  m_active = active;
+  if(!m_active)
+    return;
+
+  const VkExtent2D size = res.gBuffers.getSize();
+  if(m_targets && m_targets->getSize().width == size.width && m_targets->getSize().height == size.height)
+    return;
+
+  // The frames in flight may still use the previous targets
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  res.deletionQueue.retire(m_targets);
+  const VkFormat colorFormat = res.gBuffers.getColorFormat(Resources::eImgRendered);
+  VkFormatProperties formatProperties{};
+  vkGetPhysicalDeviceFormatProperties(res.allocator.getPhysicalDevice(), colorFormat, &formatProperties);
+  m_colorFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ?
+                      VK_FILTER_LINEAR :
+                      VK_FILTER_NEAREST;
+
+  m_targets = std::make_unique<nvvk::GBuffer>();
+  m_targets->init({.allocator    = &res.allocator,
+                   .colorFormats = {
+                       colorFormat,                                            // Color     : eTargetColor
+                       res.gBuffers.getColorFormat(Resources::eImgSelection),  // Selection : eTargetSelection
+                   },
+                   .imageSampler = res.gBuffers.getDescriptorImageInfo(Resources::eImgRendered).sampler});
+  m_targets->update(cmd, size);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bilinear upscale of the color when supported, nearest for the selection (object indices)
+void DynamicResolution::upscale(VkCommandBuffer cmd, Resources& res)
+{
+  const VkExtent2D srcSize = getRenderSize(res);
+  const VkExtent2D dstSize = res.gBuffers.getSize();
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  const VkImageBlit region{
+      .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+      .srcOffsets     = {{0, 0, 0}, {int(srcSize.width), int(srcSize.height), 1}},
+      .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+      .dstOffsets     = {{0, 0, 0}, {int(dstSize.width), int(dstSize.height), 1}},
+  };
+  vkCmdBlitImage(cmd, m_targets->getColorImage(eTargetColor), VK_IMAGE_LAYOUT_GENERAL,
+                 res.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL, 1, &region, m_colorFilter);
+  vkCmdBlitImage(cmd, m_targets->getColorImage(eTargetSelection), VK_IMAGE_LAYOUT_GENERAL,
+                 res.gBuffers.getColorImage(Resources::eImgSelection), VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_NEAREST);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <memory>
+
+#include <vulkan/vulkan_core.h>
+#include <nvutils/parameter_registry.hpp>
+#include <nvvk/gbuffers.hpp>
+
+#include "resources.hpp"
+
+
+// Dynamic resolution of the path tracer during navigation. While the image restarts every frame
+// (camera or scene changing), the path tracer renders into the targets of this class at a fraction
+// of the viewport, and the result is upscaled to the rendered and selection images. The fraction
+// is adjusted each frame from the measured GPU time of the path tracer, toward a target frame
+// time. When the motion stops, the accumulation restarts at full resolution.
+class DynamicResolution
+{
+public:
+  struct Settings
+  {
+    bool  enable      = false;
+    float targetMs    = 16.0f;  // GPU time of the path tracer while moving
+    float minScale    = 0.25f;  // Lowest fraction of the viewport, per axis
+    int   motionDepth = 0;      // Maximum depth while moving, 0: unchanged
+  };
+
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+  void deinit();
+  void onUi();  // The settings only apply to the next motion, no reset
+
+  // GPU time of a recent frame of the path tracer, in milliseconds
+  void setGpuTime(float ms) { m_gpuMs = ms; }
+
+  // Beginning of the frame of the path tracer: decides the resolution of the frame and adjusts the
+  // scale. `available` is false when the resolution is owned by another pass (DLSS, SVGF, AOVs,
+  // heatmaps). When the motion stopped, resets res.frameCount to restart at full resolution.
+  void update(VkCommandBuffer cmd, Resources& res, bool available);
+
+  // Upscale the targets to the rendered and selection images, after the path tracer
+  void upscale(VkCommandBuffer cmd, Resources& res);
+
+  bool                 isActive() const { return m_active; }  // The frame renders into the targets
+  float                getScale() const { return m_scale; }
+  VkExtent2D           getRenderSize(const Resources& res) const;
+  int                  getMaxDepth(int maxDepth) const;  // Depth of the frame
+  const nvvk::GBuffer& getTargets() const { return *m_targets; }  // Valid while active
+
+  // Images of the targets
+  enum Target
+  {
+    eTargetColor,      // RGBA32F, same as the rendered image
+    eTargetSelection,  // R8, same as the selection image
+  };
+
+private:
+  Settings                       m_settings{};
+  std::unique_ptr<nvvk::GBuffer> m_targets;  // Viewport size, only the top-left render size is used
+  VkFilter                       m_colorFilter{VK_FILTER_NEAREST};  // Linear when the color format supports it
+  bool                           m_active{false};
+  float                          m_scale{1.0f};
+  float                          m_gpuMs{0.0f};
+  int                            m_activeFrames{0};  // Consecutive reduced frames, the GPU time lags behind
+};
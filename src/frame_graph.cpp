@@ -0,0 +1,662 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Frame Graph
+
+    - The passes are executed in the order they were added. A pass is culled
+      when nothing it writes is read by a later pass, or marked as an output
+    - Barriers: each resource keeps its last write and the reads since then.
+      A read waits for the last write, unless it is already visible to its
+      stages; a write, or a layout transition, also waits for the reads
+      (execution dependency only). The barriers of a pass are one
+      vkCmdPipelineBarrier2
+    - Transient images: created when the declared images or their lifetimes
+      change, largest first, each at the lowest offset of one allocation
+      not used by an image alive at the same time. The first access of a
+      transient image discards its content (UNDEFINED) and waits for the
+      images sharing its memory
+    - Imported images are returned to their layout at the end of the graph.
+      Their first access waits for all previous commands: the frame capture,
+      the readbacks and the clears are recorded outside of the graph
+    - Released transient images go to the deletion queue: they are destroyed
+      when the frames in flight are done with them
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <numeric>
+
+#include <fmt/format.h>
+#include <nvutils/logger.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "frame_graph.hpp"
+
+namespace {
+
+constexpr VkAccessFlags2 kWriteAccess = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+                                        | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+                                        | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+VkAccessFlags2 getAccess(FrameGraph::Usage usage, bool write)
+{
+  using Usage = FrameGraph::Usage;
+  switch(usage)
+  {
+    case Usage::eColorAttachment:
+      return VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : 0);
+    case Usage::eDepthAttachment:
+      return VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+    case Usage::eSampled:
+      return VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+    case Usage::eStorage:
+      return VK_ACCESS_2_SHADER_STORAGE_READ_BIT | (write ? VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT : 0);
+    case Usage::eShaderRead:
+      return VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_UNIFORM_READ_BIT;
+    case Usage::eTransferSrc:
+      return VK_ACCESS_2_TRANSFER_READ_BIT;
+    case Usage::eTransferDst:
+      return VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    case Usage::eGeneral:
+      return VK_ACCESS_2_MEMORY_READ_BIT | (write ? VK_ACCESS_2_MEMORY_WRITE_BIT : 0);
+  }
+  return VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+}
+
+VkImageUsageFlags getImageUsage(FrameGraph::Usage usage)
+{
+  using Usage = FrameGraph::Usage;
+  switch(usage)
+  {
+    case Usage::eColorAttachment:
+      return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    case Usage::eDepthAttachment:
+      return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    case Usage::eSampled:
+      return VK_IMAGE_USAGE_SAMPLED_BIT;
+    case Usage::eStorage:
+    case Usage::eShaderRead:
+      return VK_IMAGE_USAGE_STORAGE_BIT;
+    case Usage::eTransferSrc:
+      return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    case Usage::eTransferDst:
+      return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    case Usage::eGeneral:
+      return VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  }
+  return 0;
+}
+
+VkImageAspectFlags getAspect(VkFormat format)
+{
+  switch(format)
+  {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+      return VK_IMAGE_ASPECT_COLOR_BIT;
+  }
+}
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+VkImageLayout FrameGraph::getLayout(Usage usage)
+{
+  switch(usage)
+  {
+    case Usage::eColorAttachment:
+      return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    case Usage::eDepthAttachment:
+      return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    case Usage::eSampled:
+      return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    case Usage::eTransferSrc:
+      return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    case Usage::eTransferDst:
+      return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    default:
+      return VK_IMAGE_LAYOUT_GENERAL;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Accesses of a pass
+void FrameGraph::PassBuilder::read(ResourceId id, Usage usage, VkPipelineStageFlags2 stages)
+{
+  m_graph.addAccess(m_pass, id, usage, stages, true, false);
+}
+
+void FrameGraph::PassBuilder::write(ResourceId id, Usage usage, VkPipelineStageFlags2 stages)
+{
+  m_graph.addAccess(m_pass, id, usage, stages, false, true);
+}
+
+void FrameGraph::PassBuilder::readWrite(ResourceId id, Usage usage, VkPipelineStageFlags2 stages)
+{
+  m_graph.addAccess(m_pass, id, usage, stages, true, true);
+}
+
+void FrameGraph::PassBuilder::sideEffect()
+{
+  m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+void FrameGraph::init(nvvk::ResourceAllocator* allocator, MemoryReport* memoryReport, DeletionQueue* deletionQueue)
+{
+  m_allocator     = allocator;
+  m_memoryReport  = memoryReport;
+  m_deletionQueue = deletionQueue;
+  m_device        = allocator->getDevice();
+}
+
+void FrameGraph::deinit()
+{
+  destroyTransients(m_transients);
+  m_transients = {};
+  m_passes.clear();
+  m_resources.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Declaration of the frame
+void FrameGraph::begin()
+{
+  m_passes.clear();
+  m_resources.clear();
+}
+
+FrameGraph::ResourceId FrameGraph::importImage(const char* name, VkImage image, VkImageLayout layout, VkImageAspectFlags aspect)
+{
+  // The same image can be imported by several passes
+  for(ResourceId id = 0; id < m_resources.size(); id++)
+  {
+    if(!m_resources[id].isBuffer && !m_resources[id].transient && m_resources[id].image == image)
+      return id;
+  }
+
+  Resource& res    = m_resources.emplace_back();
+  res.name         = name;
+  res.image        = image;
+  res.aspect       = aspect;
+  res.importLayout = layout;
+  res.state        = {.layout = layout, .writeStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .writeAccess = VK_ACCESS_2_MEMORY_WRITE_BIT};
+  return ResourceId(m_resources.size() - 1);
+}
+
+FrameGraph::ResourceId FrameGraph::importBuffer(const char* name, VkBuffer buffer)
+{
+  for(ResourceId id = 0; id < m_resources.size(); id++)
+  {
+    if(m_resources[id].isBuffer && m_resources[id].buffer == buffer)
+      return id;
+  }
+
+  Resource& res = m_resources.emplace_back();
+  res.name      = name;
+  res.isBuffer  = true;
+  res.buffer    = buffer;
+  res.state     = {.writeStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, .writeAccess = VK_ACCESS_2_MEMORY_WRITE_BIT};
+  return ResourceId(m_resources.size() - 1);
+}
+
+FrameGraph::ResourceId FrameGraph::createImage(const char* name, const ImageDesc& desc)
+{
+  Resource& res = m_resources.emplace_back();
+  res.name      = name;
+  res.transient = true;
+  res.desc      = desc;
+  res.aspect    = getAspect(desc.format);
+  return ResourceId(m_resources.size() - 1);
+}
+
+void FrameGraph::markOutput(ResourceId id)
+{
+  m_resources[id].output = true;
+}
+
+void FrameGraph::addPass(const char* name, const SetupFunc& setup, ExecuteFunc execute)
+{
+  const uint32_t index = uint32_t(m_passes.size());
+  m_passes.push_back({.name = name, .execute = std::move(execute)});
+  PassBuilder builder(*this, index);
+  setup(builder);
+}
+
+void FrameGraph::addAccess(uint32_t pass, ResourceId id, Usage usage, VkPipelineStageFlags2 stages, bool read, bool write)
+{
+  m_passes[pass].accesses.push_back({.resource = id, .usage = usage, .stages = stages, .read = read, .write = write});
+  if(m_resources[id].transient)
+    m_resources[id].usage |= getImageUsage(usage);
+}
+
+//--------------------------------------------------------------------------------------------------
+// From the last pass: a pass is needed when it writes a resource read later, or an output
+void FrameGraph::cull()
+{
+  std::vector<bool> live(m_resources.size());
+  for(size_t i = 0; i < m_resources.size(); i++)
+    live[i] = m_resources[i].output;
+
+  for(size_t p = m_passes.size(); p-- > 0;)
+  {
+    Pass& pass   = m_passes[p];
+    bool  needed = pass.sideEffect;
+    for(const Access& access : pass.accesses)
+      needed = needed || (access.write && live[access.resource]);
+    pass.culled = !needed;
+    if(!needed)
+      continue;
+
+    // Overwritten resources are not needed before this pass, unless the pass reads them
+    for(const Access& access : pass.accesses)
+    {
+      if(access.write && !access.read)
+        live[access.resource] = false;
+    }
+    for(const Access& access : pass.accesses)
+    {
+      if(access.read)
+        live[access.resource] = true;
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Allocate the transient images, unless the same images with the same lifetimes are already allocated
+void FrameGraph::updateTransients(const std::vector<ResourceId>& transients)
+{
+  std::string key;
+  for(ResourceId id : transients)
+  {
+    const Resource& res = m_resources[id];
+    key += fmt::format("{}:{}:{}x{}:{}:{}-{};", res.name, int(res.desc.format), res.desc.extent.width,
+                       res.desc.extent.height, res.usage, res.firstPass, res.lastPass);
+  }
+
+  if(key != m_transients.key)
+  {
+    // The frames in flight may still use the previous images
+    if(!m_transients.images.empty())
+    {
+      m_deletionQueue->retire([this, set = std::move(m_transients)]() mutable {
+        MemoryReport::Scope memScope(*m_memoryReport, MemoryCategory::eTransients);
+        destroyTransients(set);
+      });
+    }
+    m_transients     = {};
+    m_transients.key = key;
+    m_stats.transientBytes = 0;
+    m_stats.allocatedBytes = 0;
+
+    const size_t                      numImages = transients.size();
+    std::vector<VkMemoryRequirements> requirements(numImages);
+    uint32_t                          memoryTypeBits = ~0U;
+    for(size_t i = 0; i < numImages; i++)
+    {
+      const Resource&         res = m_resources[transients[i]];
+      const VkImageCreateInfo createInfo{
+          .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+          .imageType     = VK_IMAGE_TYPE_2D,
+          .format        = res.desc.format,
+          .extent        = {res.desc.extent.width, res.desc.extent.height, 1},
+          .mipLevels     = 1,
+          .arrayLayers   = 1,
+          .samples       = VK_SAMPLE_COUNT_1_BIT,
+          .tiling        = VK_IMAGE_TILING_OPTIMAL,
+          .usage         = res.usage,
+          .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+          .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      };
+      TransientImage& image = m_transients.images.emplace_back();
+      NVVK_CHECK(vkCreateImage(m_device, &createInfo, nullptr, &image.image));
+      nvvk::DebugUtil::getInstance().setObjectName(image.image, res.name);
+      vkGetImageMemoryRequirements(m_device, image.image, &requirements[i]);
+      image.size      = requirements[i].size;
+      image.firstPass = res.firstPass;
+      image.lastPass  = res.lastPass;
+      memoryTypeBits &= requirements[i].memoryTypeBits;
+      m_stats.transientBytes += image.size;
+    }
+
+    std::vector<TransientImage>& images = m_transients.images;
+    const VmaAllocationCreateInfo allocInfo{.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+    if(numImages > 0 && memoryTypeBits != 0)
+    {
+      // Largest first, at the lowest offset not used by an image alive at the same time
+      std::vector<size_t> order(numImages);
+      std::iota(order.begin(), order.end(), size_t(0));
+      std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return images[a].size > images[b].size; });
+
+      std::vector<bool> placed(numImages, false);
+      VkDeviceSize      totalSize = 0;
+      VkDeviceSize      alignment = 1;
+      for(size_t i : order)
+      {
+        VkDeviceSize offset = 0;
+        for(bool moved = true; moved;)
+        {
+          moved = false;
+          for(size_t j = 0; j < numImages; j++)
+          {
+            const bool alive = images[i].firstPass <= images[j].lastPass && images[j].firstPass <= images[i].lastPass;
+            if(placed[j] && alive && offset < images[j].offset + images[j].size && images[j].offset < offset + images[i].size)
+            {
+              offset = alignUp(images[j].offset + images[j].size, requirements[i].alignment);
+              moved  = true;
+            }
+          }
+        }
+        images[i].offset = offset;
+        placed[i]        = true;
+        totalSize        = std::max(totalSize, offset + images[i].size);
+        alignment        = std::max(alignment, requirements[i].alignment);
+      }
+
+      const VkMemoryRequirements memRequirements{.size = totalSize, .alignment = alignment, .memoryTypeBits = memoryTypeBits};
+      NVVK_CHECK(vmaAllocateMemory(*m_allocator, &memRequirements, &allocInfo, &m_transients.allocation, nullptr));
+      for(TransientImage& image : images)
+        NVVK_CHECK(vmaBindImageMemory2(*m_allocator, m_transients.allocation, image.offset, image.image, nullptr));
+      m_stats.allocatedBytes = totalSize;
+    }
+    else if(numImages > 0)
+    {
+      LOGW("Frame graph: the transient images have no common memory type, they are not aliased\n");
+      for(TransientImage& image : images)
+      {
+        NVVK_CHECK(vmaAllocateMemoryForImage(*m_allocator, image.image, &allocInfo, &image.allocation, nullptr));
+        NVVK_CHECK(vmaBindImageMemory(*m_allocator, image.allocation, image.image));
+        m_stats.allocatedBytes += image.size;
+      }
+    }
+
+    for(size_t i = 0; i < numImages; i++)
+    {
+      const Resource&             res = m_resources[transients[i]];
+      const VkImageViewCreateInfo viewInfo{
+          .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+          .image            = images[i].image,
+          .viewType         = VK_IMAGE_VIEW_TYPE_2D,
+          .format           = res.desc.format,
+          .subresourceRange = {.aspectMask = res.aspect & ~VkImageAspectFlags(VK_IMAGE_ASPECT_STENCIL_BIT), .levelCount = 1, .layerCount = 1},
+      };
+      NVVK_CHECK(vkCreateImageView(m_device, &viewInfo, nullptr, &images[i].view));
+      nvvk::DebugUtil::getInstance().setObjectName(images[i].view, res.name);
+    }
+
+    m_transientVersion++;
+    if(numImages > 0)
+      LOGI("Frame graph: %zu transient images, %.1f MB in %.1f MB\n", numImages,
+           double(m_stats.transientBytes) / (1024.0 * 1024.0), double(m_stats.allocatedBytes) / (1024.0 * 1024.0));
+  }
+
+  for(size_t i = 0; i < transients.size(); i++)
+  {
+    m_resources[transients[i]].image = m_transients.images[i].image;
+    m_resources[transients[i]].view  = m_transients.images[i].view;
+  }
+}
+
+void FrameGraph::destroyTransients(TransientSet& set)
+{
+  for(TransientImage& image : set.images)
+  {
+    vkDestroyImageView(m_device, image.view, nullptr);
+    vkDestroyImage(m_device, image.image, nullptr);
+    if(image.allocation)
+      vmaFreeMemory(*m_allocator, image.allocation);
+  }
+  if(set.allocation)
+    vmaFreeMemory(*m_allocator, set.allocation);
+  set.images.clear();
+  set.allocation = nullptr;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Barrier before an access, returns false when the access is already synchronized
+bool FrameGraph::addBarrier(Resource& res, const Access& access, std::vector<VkImageMemoryBarrier2>& imageBarriers,
+                            std::vector<VkBufferMemoryBarrier2>& bufferBarriers)
+{
+  State&               state        = res.state;
+  const VkImageLayout  layout       = res.isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : getLayout(access.usage);
+  const VkAccessFlags2 dstAccess    = getAccess(access.usage, access.write);
+  const bool           layoutChange = !res.isBuffer && layout != state.layout;
+
+  // Read of a resource already visible to the stages, or never written
+  if(!access.write && !layoutChange
+     && (state.writeStages == 0
+         || ((access.stages & ~state.visibleStages) == 0 && (dstAccess & ~state.visibleAccess) == 0)))
+  {
+    state.readStages |= access.stages;
+    return false;
+  }
+
+  // Writes and layout transitions also wait for the reads
+  VkPipelineStageFlags2 srcStages = state.writeStages;
+  if(access.write || layoutChange)
+    srcStages |= state.readStages;
+  if(srcStages == 0)
+    srcStages = VK_PIPELINE_STAGE_2_NONE;
+
+  if(res.isBuffer)
+  {
+    bufferBarriers.push_back({
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+        .srcStageMask        = srcStages,
+        .srcAccessMask       = state.writeAccess,
+        .dstStageMask        = access.stages,
+        .dstAccessMask       = dstAccess,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = res.buffer,
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE,
+    });
+  }
+  else
+  {
+    imageBarriers.push_back({
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask        = srcStages,
+        .srcAccessMask       = state.writeAccess,
+        .dstStageMask        = access.stages,
+        .dstAccessMask       = dstAccess,
+        .oldLayout           = state.layout,
+        .newLayout           = layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = res.image,
+        .subresourceRange    = {res.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS},
+    });
+  }
+
+  if(access.write || layoutChange)
+  {
+    // A layout transition is a write, made visible to the stages of the barrier
+    state.writeStages   = access.stages;
+    state.writeAccess   = access.write ? (dstAccess & kWriteAccess) : 0;
+    state.readStages    = access.write ? 0 : access.stages;
+    state.visibleStages = access.stages;
+    state.visibleAccess = dstAccess;
+  }
+  else
+  {
+    state.readStages |= access.stages;
+    state.visibleStages |= access.stages;
+    state.visibleAccess |= dstAccess;
+  }
+  state.layout = layout;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Execute the passes of the frame
+void FrameGraph::execute(VkCommandBuffer cmd)
+{
+  NVVK_DBG_SCOPE(cmd);
+  cull();
+
+  // Lifetimes, over the passes which are executed
+  m_stats.passes       = uint32_t(m_passes.size());
+  m_stats.culledPasses = 0;
+  for(uint32_t p = 0; p < m_passes.size(); p++)
+  {
+    if(m_passes[p].culled)
+    {
+      m_stats.culledPasses++;
+      continue;
+    }
+    for(const Access& access : m_passes[p].accesses)
+    {
+      Resource& res = m_resources[access.resource];
+      res.firstPass = std::min(res.firstPass, p);
+      res.lastPass  = std::max(res.lastPass, p);
+    }
+  }
+  std::vector<ResourceId> transients;
+  for(ResourceId id = 0; id < m_resources.size(); id++)
+  {
+    if(m_resources[id].transient && m_resources[id].firstPass != ~0U)
+      transients.push_back(id);
+  }
+
+  {
+    MemoryReport::Scope memScope(*m_memoryReport, MemoryCategory::eTransients);
+    updateTransients(transients);
+  }
+
+  // Last accesses of the transient images in this frame
+  std::vector<VkPipelineStageFlags2> lastStages(transients.size(), 0);
+  std::vector<VkAccessFlags2>        writeAccess(transients.size(), 0);
+  for(size_t i = 0; i < transients.size(); i++)
+  {
+    const Resource& res = m_resources[transients[i]];
+    for(const Access& access : m_passes[res.lastPass].accesses)
+    {
+      if(access.resource == transients[i])
+        lastStages[i] |= access.stages;
+    }
+    for(uint32_t p = res.firstPass; p <= res.lastPass; p++)
+    {
+      for(const Access& access : m_passes[p].accesses)
+      {
+        if(access.resource == transients[i] && access.write && !m_passes[p].culled)
+          writeAccess[i] |= getAccess(access.usage, true) & kWriteAccess;
+      }
+    }
+  }
+
+  // The first access of a transient image waits for the images sharing its memory: earlier in
+  // this frame, and in the previous frame
+  std::vector<TransientImage>& images = m_transients.images;
+  for(size_t i = 0; i < transients.size(); i++)
+  {
+    State state{};
+    for(size_t j = 0; j < transients.size(); j++)
+    {
+      const bool sharedMemory = i == j
+                                || (m_transients.allocation && images[i].offset < images[j].offset + images[j].size
+                                    && images[j].offset < images[i].offset + images[i].size);
+      if(!sharedMemory)
+        continue;
+      state.writeStages |= images[j].lastStages;
+      state.writeAccess |= images[j].lastWriteAccess;
+      if(images[j].lastPass < images[i].firstPass)
+      {
+        state.writeStages |= lastStages[j];
+        state.writeAccess |= writeAccess[j];
+      }
+    }
+    m_resources[transients[i]].state = state;
+  }
+
+  // Passes, with their barriers
+  m_stats.barriers = 0;
+  std::vector<VkImageMemoryBarrier2>  imageBarriers;
+  std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+  auto flushBarriers = [&]() {
+    if(imageBarriers.empty() && bufferBarriers.empty())
+      return;
+    const VkDependencyInfo depInfo{
+        .sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .bufferMemoryBarrierCount = uint32_t(bufferBarriers.size()),
+        .pBufferMemoryBarriers    = bufferBarriers.data(),
+        .imageMemoryBarrierCount  = uint32_t(imageBarriers.size()),
+        .pImageMemoryBarriers     = imageBarriers.data(),
+    };
+    vkCmdPipelineBarrier2(cmd, &depInfo);
+    m_stats.barriers += uint32_t(imageBarriers.size() + bufferBarriers.size());
+    imageBarriers.clear();
+    bufferBarriers.clear();
+  };
+
+  for(Pass& pass : m_passes)
+  {
+    if(pass.culled)
+      continue;
+    for(const Access& access : pass.accesses)
+      addBarrier(m_resources[access.resource], access, imageBarriers, bufferBarriers);
+    flushBarriers();
+    pass.execute(cmd);
+  }
+
+  // Imported images are returned to their layout, for the work after the graph
+  for(Resource& res : m_resources)
+  {
+    if(res.isBuffer || res.transient || res.state.layout == res.importLayout)
+      continue;
+    imageBarriers.push_back({
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask        = res.state.writeStages | res.state.readStages,
+        .srcAccessMask       = res.state.writeAccess,
+        .dstStageMask        = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        .dstAccessMask       = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+        .oldLayout           = res.state.layout,
+        .newLayout           = res.importLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = res.image,
+        .subresourceRange    = {res.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS},
+    });
+  }
+  flushBarriers();
+
+  // Last accesses of the transient images, for the images aliasing them in the next frame
+  for(size_t i = 0; i < transients.size(); i++)
+  {
+    images[i].lastStages      = lastStages[i];
+    images[i].lastWriteAccess = writeAccess[i];
+  }
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+#include <nvvk/resource_allocator.hpp>
+
+#include "deletion_queue.hpp"
+#include "memory_report.hpp"
+
+
+// Passes of a frame, with the resources they read and write. The graph is declared every frame,
+// then executed: the passes whose results are not used are culled, the barriers between the
+// passes are derived from the declared accesses (with the stages and accesses of the passes only),
+// and the transient images are allocated by the graph, sharing the same memory when their
+// lifetimes do not overlap. The images and buffers owned by the renderer are imported: they are
+// left in the layout they were imported with, and the graph does not know the work recorded
+// outside of it, so their first access waits for all previous commands.
+class FrameGraph
+{
+public:
+  using ResourceId = uint32_t;
+
+  // How a pass accesses a resource: gives the layout of the images and the access masks
+  enum class Usage
+  {
+    eColorAttachment,  // COLOR_ATTACHMENT_OPTIMAL
+    eDepthAttachment,  // DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    eSampled,          // SHADER_READ_ONLY_OPTIMAL, read only
+    eStorage,          // GENERAL, storage image or buffer
+    eShaderRead,       // Buffer read by the shaders (uniform or device address), read only
+    eTransferSrc,      // TRANSFER_SRC_OPTIMAL
+    eTransferDst,      // TRANSFER_DST_OPTIMAL
+    eGeneral,          // GENERAL, any access: for passes synchronizing their own work
+  };
+
+  // Transient 2D image, allocated by the graph
+  struct ImageDesc
+  {
+    VkFormat   format{VK_FORMAT_UNDEFINED};
+    VkExtent2D extent{};
+  };
+
+  struct Stats
+  {
+    uint32_t passes{0};
+    uint32_t culledPasses{0};
+    uint32_t barriers{0};        // Image and buffer barriers of the last frame
+    uint64_t transientBytes{0};  // Size of the transient images
+    uint64_t allocatedBytes{0};  // Memory allocated for them, with the aliasing
+  };
+
+  // Declares the accesses of a pass, in the setup function of addPass
+  class PassBuilder
+  {
+  public:
+    void read(ResourceId id, Usage usage, VkPipelineStageFlags2 stages);
+    // The previous content is not used by the pass
+    void write(ResourceId id, Usage usage, VkPipelineStageFlags2 stages);
+    void readWrite(ResourceId id, Usage usage, VkPipelineStageFlags2 stages);
+    // The pass is never culled
+    void sideEffect();
+
+  private:
+    friend class FrameGraph;
+    PassBuilder(FrameGraph& graph, uint32_t pass)
+        : m_graph(graph)
+        , m_pass(pass)
+    {
+    }
+    FrameGraph& m_graph;
+    uint32_t    m_pass;
+  };
+
+  using SetupFunc   = std::function<void(PassBuilder&)>;
+  using ExecuteFunc = std::function<void(VkCommandBuffer)>;
+
+  void init(nvvk::ResourceAllocator* allocator, MemoryReport* memoryReport, DeletionQueue* deletionQueue);
+  void deinit();  // The device must be idle
+
+  // Declaration of a frame: begin, then the resources and the passes in execution order
+  void       begin();
+  ResourceId importImage(const char* name, VkImage image, VkImageLayout layout, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+  ResourceId importBuffer(const char* name, VkBuffer buffer);
+  ResourceId createImage(const char* name, const ImageDesc& desc);
+  void       markOutput(ResourceId id);  // Used after the frame: its writers are not culled
+  void       addPass(const char* name, const SetupFunc& setup, ExecuteFunc execute);
+
+  // Culls, allocates the transient images, and records the passes with their barriers
+  void execute(VkCommandBuffer cmd);
+
+  // Valid in the execute functions of the passes
+  VkImage     getImage(ResourceId id) const { return m_resources[id].image; }
+  VkImageView getImageView(ResourceId id) const { return m_resources[id].view; }
+  // Changes when the transient images are reallocated: the descriptors using them must be updated
+  uint32_t getTransientVersion() const { return m_transientVersion; }
+
+  const Stats& getStats() const { return m_stats; }
+
+  static VkImageLayout getLayout(Usage usage);
+
+private:
+  // Synchronization state of a resource between two accesses
+  struct State
+  {
+    VkImageLayout         layout{VK_IMAGE_LAYOUT_UNDEFINED};
+    VkPipelineStageFlags2 writeStages{0};    // Last write or layout transition
+    VkAccessFlags2        writeAccess{0};
+    VkPipelineStageFlags2 readStages{0};     // Reads since the last write
+    VkPipelineStageFlags2 visibleStages{0};  // The last write is visible to these stages and accesses
+    VkAccessFlags2        visibleAccess{0};
+  };
+
+  struct Access
+  {
+    ResourceId            resource;
+    Usage                 usage;
+    VkPipelineStageFlags2 stages;
+    bool                  read;
+    bool                  write;
+  };
+
+  struct Pass
+  {
+    std::string         name;
+    ExecuteFunc         execute;
+    std::vector<Access> accesses;
+    bool                sideEffect{false};
+    bool                culled{false};
+  };
+
+  struct Resource
+  {
+    std::string        name;
+    bool               isBuffer{false};
+    bool               transient{false};
+    bool               output{false};
+    VkImage            image{};
+    VkImageView        view{};
+    VkBuffer           buffer{};
+    VkImageAspectFlags aspect{};
+    VkImageLayout      importLayout{};  // Imported: layout before and after the graph
+    ImageDesc          desc{};
+    VkImageUsageFlags  usage{0};  // Transient: from the declared usages
+    uint32_t           firstPass{~0U};
+    uint32_t           lastPass{0};
+    State              state;
+  };
+
+  // Transient images sharing one allocation
+  struct TransientImage
+  {
+    VkImage               image{};
+    VkImageView           view{};
+    VkDeviceSize          offset{0};
+    VkDeviceSize          size{0};
+    uint32_t              firstPass{0};
+    uint32_t              lastPass{0};
+    VkPipelineStageFlags2 lastStages{0};  // Of the previous frame
+    VkAccessFlags2        lastWriteAccess{0};
+    VmaAllocation         allocation{};  // Own memory, when the images cannot share a memory type
+  };
+  struct TransientSet
+  {
+    std::string                 key;  // Declared images and lifetimes
+    std::vector<TransientImage> images;
+    VmaAllocation               allocation{};  // Shared memory
+  };
+
+  void addAccess(uint32_t pass, ResourceId id, Usage usage, VkPipelineStageFlags2 stages, bool read, bool write);
+  void cull();
+  void updateTransients(const std::vector<ResourceId>& transients);
+  void destroyTransients(TransientSet& set);
+  bool addBarrier(Resource& res, const Access& access, std::vector<VkImageMemoryBarrier2>& imageBarriers,
+                  std::vector<VkBufferMemoryBarrier2>& bufferBarriers);
+
+  nvvk::ResourceAllocator* m_allocator{};
+  MemoryReport*            m_memoryReport{};
+  DeletionQueue*           m_deletionQueue{};
+  VkDevice                 m_device{};
+
+  std::vector<Pass>         m_passes;
+  std::vector<Resource>     m_resources;
+  TransientSet              m_transients;
+  uint32_t                  m_transientVersion{0};
+  Stats                     m_stats;
+};
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Cost Heatmaps
+
+    - Debug methods eHeat*: instead of a material channel, each pixel shows what
+      it cost, to find the assets (foliage, glass, decals) that blow the frame
+      budget without an external profiler
+    - The renderers add the cost of the pixels to a buffer of uints, cleared
+      before they render:
+        - Shader time: clock ticks between the start and the end of the pixel
+          (VK_KHR_shader_clock), in the compute shader or the ray generation.
+          The extension is optional: without the device clock, the shaders
+          are specialized without it and the debug method is not available
+        - Traversal: rays and candidate intersections returned to the shaders.
+          The steps of the hardware traversal are not exposed by Vulkan, the
+          candidates are the part the shaders add to it
+        - Any-hit: invocations of the any-hit shaders, or of their ray query
+          equivalent
+        - Path length, light samples: segments and next event estimations
+        - Overdraw: fragments rasterized, counted by the fragment shader of
+          the rasterizer
+    - The resolve pass replaces the tonemapped image with the color scale of
+      heatmap_util.h (logarithmic), and computes the largest cost; it is read
+      back a few frames later, without waiting, for the range and the legend
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <cstring>
+
+#include <fmt/format.h>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/compute_pipeline.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "heatmap.hpp"
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/heatmap_util.h"
+}  // namespace shaderio
+
+// Pre-compiled shader
+#include "_autogen/heatmap.comp.slang.h"
+
+namespace {
+
+// Name and unit of the costs, from DebugMethod::eHeatShaderTime
+const char* s_costNames[] = {"Shader time (clock ticks)", "Traversal (rays + candidates)", "Any-hit invocations",
+                             "Path length (segments)",    "Light samples",                 "Overdraw (fragments)"};
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Create the resolve shader and the buffers; the costs are allocated with the renderer size
+void Heatmap::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  VkDevice device = res.allocator.getDevice();
+
+  VkPushConstantRange pushConstant = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::HeatmapPushConstant)};
+
+  m_bindings.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  NVVK_CHECK(m_bindings.createDescriptorSetLayout(device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR, &m_descriptorSetLayout));
+  NVVK_DBG_NAME(m_descriptorSetLayout);
+
+  VkPipelineLayoutCreateInfo plCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_descriptorSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreatePipelineLayout(device, &plCreateInfo, nullptr, &m_pipelineLayout));
+  NVVK_DBG_NAME(m_pipelineLayout);
+
+  VkShaderCreateInfoEXT shaderCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+      .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
+      .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+      .codeSize               = heatmap_comp_slang_sizeInBytes,
+      .pCode                  = heatmap_comp_slang,
+      .pName                  = "main",
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_descriptorSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_shader));
+  NVVK_DBG_NAME(m_shader);
+
+  NVVK_CHECK(res.allocator.createBuffer(m_bInfo, sizeof(shaderio::HeatmapInfo),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT
+                                            | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bInfo.buffer);
+  NVVK_CHECK(res.allocator.createBuffer(m_bInfoReadback, sizeof(shaderio::HeatmapInfo), VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                        VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+  NVVK_DBG_NAME(m_bInfoReadback.buffer);
+  memset(m_bInfoReadback.mapping, 0, sizeof(shaderio::HeatmapInfo));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the buffers and the shader
+void Heatmap::deinit(Resources& res)
+{
+  VkDevice device = res.allocator.getDevice();
+  res.allocator.destroyBuffer(m_bInfo);
+  res.allocator.destroyBuffer(m_bValues);
+  res.allocator.destroyBuffer(m_bInfoReadback);
+  vkDestroyShaderEXT(device, m_shader, nullptr);
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+  m_bindings.clear();
+  m_shader              = {};
+  m_pipelineLayout      = {};
+  m_descriptorSetLayout = {};
+  m_size                = {};
+  m_resolved            = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void Heatmap::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"heatmapRange", "Cost heatmaps: cost at the top of the color scale (0: largest cost of the frame)"}, &m_range);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Range of the color scale, under the debug method when it is a heatmap
+bool Heatmap::onUi(Resources& res)
+{
+  if(!isHeatmap(res.settings.debugMethod))
+    return false;
+
+  namespace PE = nvgui::PropertyEditor;
+  bool autoRange = m_range <= 0.0f;
+  if(PE::Checkbox("Heatmap Auto Range", &autoRange, "Top of the color scale at the largest cost of the frame"))
+    m_range = autoRange ? 0.0f : getRange();
+  if(!autoRange)
+    PE::DragFloat("Heatmap Range", &m_range, 1.0f, 1.0f, 1e9f, "%.0f", ImGuiSliderFlags_Logarithmic,
+                  "Cost at the top of the color scale, to compare views or scenes");
+  if(res.settings.debugMethod == shaderio::DebugMethod::eHeatOverdraw && res.settings.renderSystem != RenderingMode::eRasterizer)
+    ImGui::TextDisabled("Overdraw is counted by the Rasterizer");
+  else if(res.settings.debugMethod != shaderio::DebugMethod::eHeatOverdraw && res.settings.renderSystem != RenderingMode::ePathtracer)
+    ImGui::TextDisabled("This cost is counted by the Path Tracer");
+  return false;  // The scale is applied on the next resolve, the costs stay valid
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+void Heatmap::checkSupport(Resources& res)
+{
+  if(res.settings.debugMethod == shaderio::DebugMethod::eHeatShaderTime && !res.hasShaderClock)
+  {
+    LOGW("Heat: Shader Time needs VK_KHR_shader_clock with shaderDeviceClock, not supported by this device\n");
+    res.settings.debugMethod = shaderio::DebugMethod::eNone;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Address of the heatmap for the shaders, null when the debug method is not a heatmap
+VkDeviceAddress Heatmap::getInfoAddress(const Resources& res) const
+{
+  return isHeatmap(res.settings.debugMethod) ? m_bInfo.address : 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Clear the costs of the frame, the renderer adds them at `size`
+void Heatmap::begin(VkCommandBuffer cmd, Resources& res, VkExtent2D size)
+{
+  NVVK_DBG_SCOPE(cmd);
+  if(size.width != m_size.width || size.height != m_size.height)
+  {
+    // The previous frames may still be using the buffer
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+    res.deletionQueue.retire(m_bValues);
+    NVVK_CHECK(res.allocator.createBuffer(m_bValues, VkDeviceSize(size.width) * size.height * sizeof(uint32_t),
+                                          VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+    NVVK_DBG_NAME(m_bValues.buffer);
+    m_size = size;
+  }
+
+  const shaderio::HeatmapInfo info{
+      .values   = (uint32_t*)m_bValues.address,
+      .size     = {size.width, size.height},
+      .mode     = res.settings.debugMethod,
+      .maxValue = 0,
+  };
+
+  // The previous resolve is done with the costs
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdUpdateBuffer(cmd, m_bInfo.buffer, 0, sizeof(info), &info);
+  vkCmdFillBuffer(cmd, m_bValues.buffer, 0, VK_WHOLE_SIZE, 0);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+                             | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Replace the tonemapped image with the costs, and copy the largest cost for the host
+void Heatmap::resolve(VkCommandBuffer cmd, Resources& res)
+{
+  if(!isHeatmap(res.settings.debugMethod) || m_size.width == 0)
+    return;
+  NVVK_DBG_SCOPE(cmd);
+
+  // Largest cost of a recent resolve
+  if(m_resolved)
+  {
+    shaderio::HeatmapInfo info;
+    memcpy(&info, m_bInfoReadback.mapping, sizeof(info));
+    m_maxValue = info.maxValue;
+  }
+
+  // The renderers and the tonemapper are done
+  nvvk::cmdMemoryBarrier(cmd,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+                             | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+  nvvk::WriteSetContainer writeContainer;
+  writeContainer.append(m_bindings.getWriteSet(0), res.gBuffers.getDescriptorImageInfo(Resources::eImgTonemapped));
+  vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0,
+                            static_cast<uint32_t>(writeContainer.size()), writeContainer.data());
+
+  const shaderio::HeatmapPushConstant pushConstant{.heatmap = (shaderio::HeatmapInfo*)m_bInfo.address, .rangeMax = getRange()};
+  const VkShaderStageFlagBits         stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  vkCmdBindShadersEXT(cmd, 1, &stage, &m_shader);
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+  const VkExtent2D groups = nvvk::getGroupCounts(res.gBuffers.getSize(), HEATMAP_WORKGROUP_SIZE);
+  vkCmdDispatch(cmd, groups.width, groups.height, 1);
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  const VkBufferCopy region{.size = sizeof(shaderio::HeatmapInfo)};
+  vkCmdCopyBuffer(cmd, m_bInfo.buffer, m_bInfoReadback.buffer, 1, &region);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_HOST_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+  m_resolved = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Color scale at the bottom right of the viewport, with the costs at a few positions
+void Heatmap::onUiLegend(const Resources& res, const ImVec2& viewportMin, const ImVec2& viewportMax) const
+{
+  if(!isHeatmap(res.settings.debugMethod))
+    return;
+
+  const int   costIndex = int(res.settings.debugMethod) - int(shaderio::DebugMethod::eHeatShaderTime);
+  const float range     = getRange();
+  const float width     = 240.0f;
+  const float height    = 12.0f;
+  const float margin    = 10.0f;
+  const float lineH     = ImGui::GetTextLineHeight();
+
+  ImDrawList*  drawList = ImGui::GetWindowDrawList();
+  const ImVec2 barMin(viewportMax.x - width - margin, viewportMax.y - height - lineH - 2.0f * margin);
+  const ImVec2 barMax(barMin.x + width, barMin.y + height);
+  drawList->AddRectFilled(ImVec2(barMin.x - 6.0f, barMin.y - lineH - 8.0f), ImVec2(barMax.x + 6.0f, barMax.y + lineH + 6.0f),
+                          IM_COL32(0, 0, 0, 160), 4.0f);
+
+  // The scale, in a few flat steps
+  const int numSteps = 48;
+  for(int i = 0; i < numSteps; i++)
+  {
+    const glm::vec3 color = shaderio::heatmapColor((float(i) + 0.5f) / float(numSteps));
+    const float     x0    = barMin.x + width * float(i) / float(numSteps);
+    const float     x1    = barMin.x + width * float(i + 1) / float(numSteps);
+    drawList->AddRectFilled(ImVec2(x0, barMin.y), ImVec2(x1 + 0.5f, barMax.y), ImGui::ColorConvertFloat4ToU32(ImVec4(color.x, color.y, color.z, 1.0f)));
+  }
+
+  // Costs at 0, 1/2 and 1 of the logarithmic scale
+  const float mid = std::exp2(0.5f * std::log2(1.0f + range)) - 1.0f;
+  drawList->AddText(ImVec2(barMin.x, barMin.y - lineH - 2.0f), IM_COL32_WHITE, s_costNames[costIndex]);
+  drawList->AddText(ImVec2(barMin.x, barMax.y + 2.0f), IM_COL32_WHITE, "0");
+  const std::string midText = fmt::format("{:.0f}", mid);
+  const std::string maxText = fmt::format("{:.0f}", range);
+  drawList->AddText(ImVec2(barMin.x + 0.5f * (width - ImGui::CalcTextSize(midText.c_str()).x), barMax.y + 2.0f),
+                    IM_COL32_WHITE, midText.c_str());
+  drawList->AddText(ImVec2(barMax.x - ImGui::CalcTextSize(maxText.c_str()).x, barMax.y + 2.0f), IM_COL32_WHITE, maxText.c_str());
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <imgui/imgui.h>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include <nvutils/parameter_registry.hpp>
+
+#include "resources.hpp"
+
+
+// Cost heatmaps of the debug methods DebugMethod::eHeat*: shader time, traversal, any-hit
+// invocations, path length and light samples of the path tracer, overdraw of the rasterizer.
+// The renderers add the cost of each pixel to a buffer (SceneFrameInfo::heatmap), which replaces
+// the tonemapped image with a color scale. The largest cost of a recent frame sets the range of
+// the scale, unless a fixed range is given, and is shown in the legend of the viewport.
+class Heatmap
+{
+public:
+  Heatmap() = default;
+  ~Heatmap() { assert(!m_shader && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUi(Resources& res);
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  static bool isHeatmap(shaderio::DebugMethod method) { return method >= shaderio::DebugMethod::eHeatShaderTime; }
+  // Falls back to no debug method when the device cannot count the selected cost (shader clock)
+  static void checkSupport(Resources& res);
+
+  // Address for SceneFrameInfo::heatmap, 0 when the debug method is not a heatmap
+  VkDeviceAddress getInfoAddress(const Resources& res) const;
+
+  // Clear the costs, before a renderer writing them at `size`
+  void begin(VkCommandBuffer cmd, Resources& res, VkExtent2D size);
+  // Replace the tonemapped image with the costs of the last rendered frame
+  void resolve(VkCommandBuffer cmd, Resources& res);
+
+  // Color scale and range, over the viewport
+  void onUiLegend(const Resources& res, const ImVec2& viewportMin, const ImVec2& viewportMax) const;
+
+private:
+  float getRange() const { return m_range > 0.0f ? m_range : float(std::max(m_maxValue, 1U)); }
+
+  float    m_range{0.0f};      // Cost at the top of the scale, 0: largest cost of a recent frame
+  uint32_t m_maxValue{0};      // Largest cost of a recent frame, read back
+  bool     m_resolved{false};  // A resolve copied the largest cost to the readback buffer
+
+  nvvk::Buffer m_bInfo;          // shaderio::HeatmapInfo
+  nvvk::Buffer m_bValues;        // Costs of the pixels
+  nvvk::Buffer m_bInfoReadback;  // Host copy of the info, for the largest cost
+  VkExtent2D   m_size{};         // Resolution of the costs
+
+  nvvk::DescriptorBindings m_bindings;
+  VkShaderEXT              m_shader{};
+  VkPipelineLayout         m_pipelineLayout{};
+  VkDescriptorSetLayout    m_descriptorSetLayout{};
+};
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Idle Scheduler
+
+    - The path tracer stops accumulating at maxFrames; the post-processing
+      is only recorded when its inputs change. Without the idle mode the
+      application would still acquire, record the UI and present at full
+      rate, for an image that does not change
+    - The activity of a frame is known at the end of onRender; the wait is
+      at the beginning of the next onUIRender, once that frame was
+      presented, so the last image is always on screen
+    - The input of a frame is checked before deciding to wait: the events
+      that ended a wait are processed by ImGui in the following frame
+    - The timeout keeps the UI alive (progress, logs, GPU monitor) without
+      any event, at a low rate
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+
+#include "idle_scheduler.hpp"
+
+void IdleScheduler::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"idle", "Idle: stop rendering and wait for input when the image is final"}, &m_enable);
+  paramReg->add({"idleTimeout", "Idle: seconds between two frames while idle"}, &m_timeout);
+}
+
+void IdleScheduler::init(GLFWwindow* window)
+{
+  m_window = window;
+  m_start  = std::chrono::steady_clock::now();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Any mouse, keyboard or text input of the current frame
+bool IdleScheduler::hasInput() const
+{
+  const ImGuiIO& io = ImGui::GetIO();
+  if(io.MouseDelta.x != 0.0f || io.MouseDelta.y != 0.0f || io.MouseWheel != 0.0f || io.MouseWheelH != 0.0f)
+    return true;
+  if(!io.InputQueueCharacters.empty() || ImGui::IsAnyItemActive())
+    return true;
+  for(int i = 0; i < IM_ARRAYSIZE(io.MouseDown); i++)
+  {
+    if(io.MouseDown[i])
+      return true;
+  }
+  for(int key = ImGuiKey_NamedKey_BEGIN; key < ImGuiKey_NamedKey_END; key++)
+  {
+    if(ImGui::IsKeyDown(ImGuiKey(key)))
+      return true;
+  }
+  return false;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+void IdleScheduler::beginFrame()
+{
+  if(m_window == nullptr)
+    return;
+
+  if(m_active || hasInput() || !m_enable)
+    m_quietFrames = 0;
+  else if(m_quietFrames < kQuietFrames)
+    m_quietFrames++;
+  m_active = false;
+
+  if(isIdle())
+  {
+    const auto start = std::chrono::steady_clock::now();
+    glfwWaitEventsTimeout(m_timeout);
+    m_idleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_waits++;
+  }
+}
+
+double IdleScheduler::getIdleRatio() const
+{
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  return seconds > 0.0 ? m_idleSeconds / seconds : 0.0;
+}
+
+void IdleScheduler::wakeUp()
+{
+  glfwPostEmptyEvent();
+}
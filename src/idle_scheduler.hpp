@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include <nvutils/parameter_registry.hpp>
+
+struct GLFWwindow;
+
+// Idle mode of the interactive renderer. A frame is active when it records rendering work, has
+// pending work (loading, captures, benchmark), or receives input. After a few quiet frames the
+// image shown is final: the main loop blocks on the window events, with a timeout, instead of
+// acquiring and presenting continuously. Input and glfwPostEmptyEvent (wakeUp) end the wait.
+class IdleScheduler
+{
+public:
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  // The window of the application, no idle mode without one (headless)
+  void init(GLFWwindow* window);
+
+  // Beginning of the UI of a frame: closes the previous frame, and waits when idle
+  void beginFrame();
+  // Work recorded or pending in the current frame
+  void markActive() { m_active = true; }
+
+  bool isIdle() const { return m_window != nullptr && m_enable && m_quietFrames >= kQuietFrames; }
+  // Fraction of the time spent waiting, since the start
+  double getIdleRatio() const;
+  uint64_t getWaits() const { return m_waits; }
+
+  // Ends a wait from any thread, e.g. when a scene finished loading
+  static void wakeUp();
+
+private:
+  // Quiet frames before waiting, so the UI settles (hover, popups) after the last input
+  static constexpr int kQuietFrames = 3;
+
+  bool hasInput() const;
+
+  bool  m_enable{true};    // --idle
+  float m_timeout{0.25f};  // --idleTimeout, seconds
+
+  GLFWwindow*                           m_window{};
+  bool                                  m_active{true};
+  int                                   m_quietFrames{0};
+  uint64_t                              m_waits{0};
+  double                                m_idleSeconds{0.0};
+  std::chrono::steady_clock::time_point m_start{std::chrono::steady_clock::now()};
+};
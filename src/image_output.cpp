@@ -0,0 +1,559 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Image Output
+
+    Readback of the rendered images for offline use:
+    - The linear HDR result (RGBA32F) and optional AOVs are copied to
+      host-visible staging buffers, organized as a ring of slots
+    - Each slot has its own command buffer and fence, the copy is submitted
+      right away and the file is written once the fence is signaled
+    - Layers are written in a single multi-layer half-float OpenEXR file;
+      layers with a different resolution (ex. DLSS guides) go to a second file.
+      PNG and JPG files only get the first layer.
+    - Encoding and writing the files is done by worker threads, the render
+      loop only waits when all slots of the ring are in use
+    .
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+
+#include <fmt/format.h>
+#include <glm/gtc/packing.hpp>
+#include <stb/stb_image_write.h>
+
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/commands.hpp>
+#include <nvvk/debug_util.hpp>
+#include <nvvk/helpers.hpp>
+
+#include "image_output.hpp"
+
+namespace {
+
+struct FormatInfo
+{
+  uint32_t components        = 0;
+  uint32_t bytesPerComponent = 0;
+  bool     isUint            = false;  // Integer IDs, kept as integers in EXR
+};
+
+FormatInfo getFormatInfo(VkFormat format)
+{
+  switch(format)
+  {
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+      return {4, 4};
+    case VK_FORMAT_R32G32_SFLOAT:
+      return {2, 4};
+    case VK_FORMAT_R32_SFLOAT:
+      return {1, 4};
+    case VK_FORMAT_R32_UINT:
+      return {1, 4, true};
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+      return {4, 2};
+    case VK_FORMAT_R16G16_SFLOAT:
+      return {2, 2};
+    case VK_FORMAT_R16_SFLOAT:
+      return {1, 2};
+    case VK_FORMAT_R8G8B8A8_UNORM:
+      return {4, 1};
+    case VK_FORMAT_R8_UNORM:
+      return {1, 1};
+    default:
+      return {};
+  }
+}
+
+// Convert the content of the staging buffer to floats, keeping the components interleaved
+std::vector<float> toFloat(const uint8_t* data, const FormatInfo& info, size_t numPixels)
+{
+  const size_t       numValues = numPixels * info.components;
+  std::vector<float> result(numValues);
+  switch(info.bytesPerComponent)
+  {
+    case 4:
+      if(info.isUint)
+      {
+        // Exact up to 2^24, converted back to integers when written to EXR
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(data);
+        for(size_t i = 0; i < numValues; i++)
+          result[i] = float(src[i]);
+      }
+      else
+      {
+        memcpy(result.data(), data, numValues * sizeof(float));
+      }
+      break;
+    case 2: {
+      const uint16_t* src = reinterpret_cast<const uint16_t*>(data);
+      for(size_t i = 0; i < numValues; i++)
+        result[i] = glm::unpackHalf1x16(src[i]);
+      break;
+    }
+    case 1:
+      for(size_t i = 0; i < numValues; i++)
+        result[i] = float(data[i]) / 255.0f;
+      break;
+  }
+  return result;
+}
+
+// Little helpers to serialize the EXR header
+template <typename T>
+void put(std::vector<uint8_t>& out, const T& value)
+{
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& str)
+{
+  out.insert(out.end(), str.begin(), str.end());
+  out.push_back(0);
+}
+
+void putAttribute(std::vector<uint8_t>& out, const std::string& name, const std::string& type, const std::vector<uint8_t>& value)
+{
+  putString(out, name);
+  putString(out, type);
+  put(out, int32_t(value.size()));
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+}  // namespace
+
+
+//--------------------------------------------------------------------------------------------------
+// Write an uncompressed OpenEXR file, all channels stored as half floats.
+// Channels must be sorted by name, which is done here.
+bool writeExr(const std::filesystem::path& filename, uint32_t width, uint32_t height, std::vector<ExrChannel> channels)
+{
+  std::sort(channels.begin(), channels.end(), [](const ExrChannel& a, const ExrChannel& b) { return a.name < b.name; });
+
+  std::vector<uint8_t> header;
+  put(header, uint32_t(20000630));  // Magic number
+  put(header, uint32_t(2));         // Version 2, single part scanline
+
+  {
+    std::vector<uint8_t> chlist;
+    for(const ExrChannel& channel : channels)
+    {
+      putString(chlist, channel.name);
+      put(chlist, int32_t(channel.isUint ? 0 : 1));  // UINT or HALF
+      put(chlist, uint32_t(0));  // pLinear + reserved
+      put(chlist, int32_t(1));  // xSampling
+      put(chlist, int32_t(1));  // ySampling
+    }
+    chlist.push_back(0);
+    putAttribute(header, "channels", "chlist", chlist);
+  }
+
+  std::vector<uint8_t> box;
+  put(box, int32_t(0));
+  put(box, int32_t(0));
+  put(box, int32_t(width - 1));
+  put(box, int32_t(height - 1));
+  std::vector<uint8_t> one, center;
+  put(one, 1.0f);
+  put(center, 0.0f);
+  put(center, 0.0f);
+
+  putAttribute(header, "compression", "compression", {0});  // NO_COMPRESSION
+  putAttribute(header, "dataWindow", "box2i", box);
+  putAttribute(header, "displayWindow", "box2i", box);
+  putAttribute(header, "lineOrder", "lineOrder", {0});  // INCREASING_Y
+  putAttribute(header, "pixelAspectRatio", "float", one);
+  putAttribute(header, "screenWindowCenter", "v2f", center);
+  putAttribute(header, "screenWindowWidth", "float", one);
+  header.push_back(0);  // End of header
+
+  // One scanline per chunk: y, size, then each channel for the whole line
+  uint32_t lineSize = 0;
+  for(const ExrChannel& channel : channels)
+    lineSize += width * uint32_t(channel.isUint ? sizeof(uint32_t) : sizeof(uint16_t));
+  const uint64_t firstLine = header.size() + height * sizeof(uint64_t);
+  for(uint32_t y = 0; y < height; y++)
+  {
+    put(header, uint64_t(firstLine + uint64_t(y) * (lineSize + 2 * sizeof(int32_t))));
+  }
+
+  std::ofstream file(filename, std::ios::binary);
+  if(!file)
+  {
+    LOGW("Cannot write %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+  std::vector<uint8_t> line;
+  line.reserve(lineSize + 2 * sizeof(int32_t));
+  for(uint32_t y = 0; y < height; y++)
+  {
+    line.clear();
+    put(line, int32_t(y));
+    put(line, int32_t(lineSize));
+    for(const ExrChannel& channel : channels)
+    {
+      const float* src = channel.data + size_t(y) * width * channel.stride;
+      for(uint32_t x = 0; x < width; x++)
+      {
+        if(channel.isUint)
+          put(line, uint32_t(src[x * channel.stride]));
+        else
+          put(line, uint16_t(glm::packHalf1x16(src[x * channel.stride])));
+      }
+    }
+    file.write(reinterpret_cast<const char*>(line.data()), line.size());
+  }
+
+  return file.good();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the ring of slots, the staging buffers are created on demand
+void ImageOutput::init(Resources& res, const nvvk::QueueInfo& queue, uint32_t numSlots, uint32_t numThreads)
+{
+  m_alloc   = &res.allocator;
+  m_device  = res.allocator.getDevice();
+  m_queue   = queue.queue;
+
+  // Command buffers of the slots are re-recorded for each capture
+  VkCommandPoolCreateInfo poolInfo{.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                                   .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+                                   .queueFamilyIndex = queue.familyIndex};
+  NVVK_CHECK(vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_cmdPool));
+  NVVK_DBG_NAME(m_cmdPool);
+
+  m_slots.resize(std::max(numSlots, 1U));
+  for(Slot& slot : m_slots)
+  {
+    VkCommandBufferAllocateInfo allocInfo{.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                                          .commandPool        = m_cmdPool,
+                                          .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                          .commandBufferCount = 1};
+    NVVK_CHECK(vkAllocateCommandBuffers(m_device, &allocInfo, &slot.cmd));
+    VkFenceCreateInfo fenceInfo{.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+    NVVK_CHECK(vkCreateFence(m_device, &fenceInfo, nullptr, &slot.fence));
+  }
+
+  m_stop = false;
+  for(uint32_t i = 0; i < std::max(numThreads, 1U); i++)
+  {
+    m_workers.emplace_back(&ImageOutput::workerLoop, this);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the pending captures and destroy the ring
+void ImageOutput::deinit(Resources& res)
+{
+  flush(true);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_jobCond.notify_all();
+  for(std::thread& worker : m_workers)
+  {
+    worker.join();
+  }
+  m_workers.clear();
+
+  for(Slot& slot : m_slots)
+  {
+    res.allocator.destroyBuffer(slot.buffer);
+    vkDestroyFence(m_device, slot.fence, nullptr);
+  }
+  m_slots.clear();
+  vkDestroyCommandPool(m_device, m_cmdPool, nullptr);
+  m_cmdPool = {};
+}
+
+bool ImageOutput::isSupported(VkFormat format)
+{
+  return getFormatInfo(format).components > 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Record the copy of all layers in the next slot of the ring and submit it
+void ImageOutput::capture(const std::vector<Layer>& layers, const std::filesystem::path& filename)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  Slot& slot = m_slots[m_nextSlot];
+  m_nextSlot = (m_nextSlot + 1) % uint32_t(m_slots.size());
+
+  // All slots in use: wait for the oldest one to be copied and written
+  if(getState(slot) == SlotState::eInFlight)
+  {
+    NVVK_CHECK(vkWaitForFences(m_device, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+    encodeSlot(slot);
+  }
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [&] { return slot.state == SlotState::eFree; });
+  }
+
+  slot.layers.clear();
+  slot.offsets.clear();
+  slot.filename = filename;
+
+  size_t totalSize = 0;
+  for(const Layer& layer : layers)
+  {
+    const FormatInfo info = getFormatInfo(layer.format);
+    if(info.components == 0 || layer.image == VK_NULL_HANDLE)
+    {
+      LOGW("Image output: skipping layer '%s' (unsupported format)\n", layer.name.c_str());
+      continue;
+    }
+    slot.layers.push_back(layer);
+    slot.offsets.push_back(totalSize);
+    totalSize += size_t(layer.size.width) * layer.size.height * info.components * info.bytesPerComponent;
+  }
+  if(slot.layers.empty())
+    return;
+
+  // Grow the staging buffer if needed
+  if(slot.buffer.bufferSize < totalSize)
+  {
+    m_alloc->destroyBuffer(slot.buffer);
+    NVVK_CHECK(m_alloc->createBuffer(slot.buffer, totalSize, VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                     VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+    NVVK_DBG_NAME(slot.buffer.buffer);
+  }
+
+  VkCommandBufferBeginInfo beginInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                                     .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+  NVVK_CHECK(vkResetCommandBuffer(slot.cmd, 0));
+  NVVK_CHECK(vkBeginCommandBuffer(slot.cmd, &beginInfo));
+
+  // Wait for all previously submitted work writing the images
+  nvvk::cmdMemoryBarrier(slot.cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  for(size_t i = 0; i < slot.layers.size(); i++)
+  {
+    const Layer&      layer = slot.layers[i];
+    VkBufferImageCopy region{
+        .bufferOffset     = slot.offsets[i],
+        .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseArrayLayer = layer.arrayLayer, .layerCount = 1},
+        .imageExtent      = {layer.size.width, layer.size.height, 1},
+    };
+    vkCmdCopyImageToBuffer(slot.cmd, layer.image, VK_IMAGE_LAYOUT_GENERAL, slot.buffer.buffer, 1, &region);
+  }
+  nvvk::cmdMemoryBarrier(slot.cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_HOST_BIT);
+  NVVK_CHECK(vkEndCommandBuffer(slot.cmd));
+
+  NVVK_CHECK(vkResetFences(m_device, 1, &slot.fence));
+  VkCommandBufferSubmitInfo cmdInfo{.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO, .commandBuffer = slot.cmd};
+  VkSubmitInfo2 submitInfo{.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2, .commandBufferInfoCount = 1, .pCommandBufferInfos = &cmdInfo};
+  NVVK_CHECK(vkQueueSubmit2(m_queue, 1, &submitInfo, slot.fence));
+  slot.state = SlotState::eInFlight;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Copy the layers through the ring like a capture, but wait for the copy and convert the
+// content on the calling thread instead of writing a file
+std::vector<std::vector<float>> ImageOutput::read(const std::vector<Layer>& layers)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  std::vector<std::vector<float>> result(layers.size());
+
+  Slot& slot = m_slots[m_nextSlot];
+  capture(layers, {});
+  if(getState(slot) != SlotState::eInFlight)
+    return result;
+  NVVK_CHECK(vkWaitForFences(m_device, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+
+  const uint8_t* data = slot.buffer.mapping;
+  for(size_t i = 0; i < layers.size(); i++)
+  {
+    // Skipped layers are not in the slot
+    auto it = std::find_if(slot.layers.begin(), slot.layers.end(), [&](const Layer& l) { return l.image == layers[i].image; });
+    if(it == slot.layers.end())
+      continue;
+    const size_t index = size_t(it - slot.layers.begin());
+    result[i] = toFloat(data + slot.offsets[index], getFormatInfo(it->format), size_t(it->size.width) * it->size.height);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    slot.state = SlotState::eFree;
+  }
+  m_doneCond.notify_all();
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Hand all the slots whose copy is done to the workers
+void ImageOutput::flush(bool wait)
+{
+  // Oldest first, to keep the files in the order they were captured
+  for(size_t i = 0; i < m_slots.size(); i++)
+  {
+    Slot& slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+    if(getState(slot) != SlotState::eInFlight)
+      continue;
+    if(wait)
+      NVVK_CHECK(vkWaitForFences(m_device, 1, &slot.fence, VK_TRUE, UINT64_MAX));
+    else if(vkGetFenceStatus(m_device, slot.fence) != VK_SUCCESS)
+      continue;
+    encodeSlot(slot);
+  }
+
+  if(wait)
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [&] {
+      return std::all_of(m_slots.begin(), m_slots.end(), [](const Slot& s) { return s.state != SlotState::eEncoding; });
+    });
+  }
+}
+
+bool ImageOutput::hasInFlight()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return std::any_of(m_slots.begin(), m_slots.end(), [](const Slot& s) { return s.state == SlotState::eInFlight; });
+}
+
+ImageOutput::SlotState ImageOutput::getState(const Slot& slot)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return slot.state;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Queue a slot, whose copy is done, to be written by a worker
+void ImageOutput::encodeSlot(Slot& slot)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    slot.state = SlotState::eEncoding;
+    m_jobs.push(&slot);
+  }
+  m_jobCond.notify_one();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Worker thread: write the queued slots, then give them back to the ring
+void ImageOutput::workerLoop()
+{
+  while(true)
+  {
+    Slot* slot = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobCond.wait(lock, [&] { return m_stop || !m_jobs.empty(); });
+      if(m_jobs.empty())
+        return;  // Stopping and nothing left to do
+      slot = m_jobs.front();
+      m_jobs.pop();
+    }
+
+    writeSlot(*slot);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      slot->state = SlotState::eFree;
+    }
+    m_doneCond.notify_all();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Convert the layers of a completed slot and write them to disk (called from a worker).
+// PNG and JPG only get the first layer. For EXR, layers are grouped by resolution:
+// the first group goes to the requested file, the others to `<name>_<width>x<height>.exr`
+void ImageOutput::writeSlot(Slot& slot)
+{
+  vmaInvalidateAllocation(*m_alloc, slot.buffer.allocation, 0, VK_WHOLE_SIZE);
+
+  if(!nvutils::extensionMatches(slot.filename, ".exr"))
+  {
+    const Layer&      layer = slot.layers[0];
+    const FormatInfo  info  = getFormatInfo(layer.format);
+    const int         w     = int(layer.size.width);
+    const int         h     = int(layer.size.height);
+    const std::string name  = nvutils::utf8FromPath(slot.filename);
+
+    // 8-bit data is written as is, float data is clamped to [0,1]
+    std::vector<uint8_t> converted;
+    const uint8_t*       pixels = slot.buffer.mapping + slot.offsets[0];
+    if(info.bytesPerComponent != 1)
+    {
+      std::vector<float> values = toFloat(pixels, info, size_t(w) * h);
+      converted.resize(values.size());
+      for(size_t i = 0; i < values.size(); i++)
+        converted[i] = uint8_t(std::clamp(values[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+      pixels = converted.data();
+    }
+
+    int result = 0;
+    if(nvutils::extensionMatches(slot.filename, ".png"))
+      result = stbi_write_png(name.c_str(), w, h, int(info.components), pixels, w * int(info.components));
+    else
+      result = stbi_write_jpg(name.c_str(), w, h, int(info.components), pixels, 95);
+    if(result == 0)
+      LOGW("Cannot write %s\n", name.c_str());
+    return;
+  }
+
+  struct Group
+  {
+    std::vector<std::vector<float>> pixels;
+    std::vector<ExrChannel>         channels;
+  };
+  std::map<std::pair<uint32_t, uint32_t>, Group> groups;
+  const VkExtent2D mainSize = slot.layers[0].size;
+
+  for(size_t i = 0; i < slot.layers.size(); i++)
+  {
+    const Layer&      layer = slot.layers[i];
+    const FormatInfo  info  = getFormatInfo(layer.format);
+    Group&            group = groups[{layer.size.width, layer.size.height}];
+    const size_t      numPixels = size_t(layer.size.width) * layer.size.height;
+    group.pixels.push_back(toFloat(slot.buffer.mapping + slot.offsets[i], info, numPixels));
+    const float* data = group.pixels.back().data();
+    for(uint32_t c = 0; c < info.components && c < layer.channels.size(); c++)
+    {
+      std::string name = layer.name.empty() ? layer.channels[c] : layer.name + "." + layer.channels[c];
+      group.channels.push_back({name, data + c, info.components, info.isUint});
+    }
+  }
+
+  for(auto& [size, group] : groups)
+  {
+    std::filesystem::path filename = slot.filename;
+    if(size.first != mainSize.width || size.second != mainSize.height)
+    {
+      filename.replace_filename(fmt::format("{}_{}x{}.exr", nvutils::utf8FromPath(slot.filename.stem()), size.first, size.second));
+    }
+    if(writeExr(filename, size.first, size.second, group.channels))
+    {
+      LOGI("Image saved: %s\n", nvutils::utf8FromPath(filename).c_str());
+    }
+  }
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+#include <nvvk/resource_allocator.hpp>
+
+#include "resources.hpp"
+
+
+// Reads back rendered images from the GPU and writes them to disk: the linear HDR result
+// and AOVs as a multi-layer half-float OpenEXR file, or the first layer as PNG/JPG.
+// The copies are recorded in a ring of host-visible staging buffers, each with its own
+// fence, so a capture does not stall the queue. Once the readback completed, the file is
+// encoded and written by a pool of worker threads while the next frames are being rendered.
+// Rendering only blocks when all slots of the ring are still in use.
+class ImageOutput
+{
+public:
+  // One image to read back, written as a layer of the EXR
+  struct Layer
+  {
+    std::string              name;           // Layer name, empty for the main image (R,G,B,A)
+    std::vector<std::string> channels;       // Channel names, one per component of the format
+    VkImage                  image{};        // Image in VK_IMAGE_LAYOUT_GENERAL
+    VkFormat                 format{};       // Format of the image
+    VkExtent2D               size{};         // Size of the image
+    uint32_t                 arrayLayer{0};  // Layer of an image array
+  };
+
+  ImageOutput() = default;
+  ~ImageOutput() { assert(m_slots.empty() && "deinit must be called"); }
+
+  void init(Resources& res, const nvvk::QueueInfo& queue, uint32_t numSlots = 4, uint32_t numThreads = 2);
+  void deinit(Resources& res);
+
+  // Copy all layers into a free staging slot and submit the copy.
+  // Must be called once the commands producing the images have been submitted to the queue.
+  // Only blocks when all slots are still in flight.
+  void capture(const std::vector<Layer>& layers, const std::filesystem::path& filename);
+
+  // Synchronous readback, for checks on the host: returns the content of each layer as
+  // interleaved floats, in the order of `layers` (empty for an unsupported layer)
+  std::vector<std::vector<float>> read(const std::vector<Layer>& layers);
+
+  // Hand the completed readbacks to the workers; with `wait`, block until all files are written
+  void flush(bool wait);
+  // Copies submitted and not handed to the workers yet: a later flush is needed
+  bool hasInFlight();
+
+  // Return true if the format can be read back and written
+  static bool isSupported(VkFormat format);
+
+private:
+  enum class SlotState
+  {
+    eFree,      // Can be used for a new capture
+    eInFlight,  // Copy submitted, waiting on the fence
+    eEncoding,  // Copy done, the file is being written by a worker
+  };
+
+  struct Slot
+  {
+    nvvk::Buffer          buffer{};  // Host-visible staging buffer
+    VkCommandBuffer       cmd{};     // Copy commands
+    VkFence               fence{};   // Signaled when the copy is done
+    SlotState             state{SlotState::eFree};
+    std::vector<Layer>    layers;    // Layers stored in the buffer
+    std::vector<size_t>   offsets;   // Offset of each layer in the buffer
+    std::filesystem::path filename;  // Destination file
+  };
+
+  void writeSlot(Slot& slot);
+  void encodeSlot(Slot& slot);  // Hand a completed slot to the workers
+  void workerLoop();
+  SlotState getState(const Slot& slot);  // The state is shared with the workers
+
+  nvvk::ResourceAllocator* m_alloc{};
+  VkDevice                 m_device{};
+  VkQueue                  m_queue{};
+  VkCommandPool            m_cmdPool{};
+  std::vector<Slot>        m_slots;
+  uint32_t                 m_nextSlot{0};
+
+  // Worker threads writing the files
+  std::vector<std::thread> m_workers;
+  std::queue<Slot*>        m_jobs;
+  std::mutex               m_mutex;
+  std::condition_variable  m_jobCond;   // A job was added, or stopping
+  std::condition_variable  m_doneCond;  // A slot went back to free
+  bool                     m_stop{false};
+};
+
+// A channel of the EXR file: `data` points to the first element, `stride` is in floats
+struct ExrChannel
+{
+  std::string  name;
+  const float* data{};
+  size_t       stride{1};
+  bool         isUint{false};  // Written as 32-bit unsigned integers instead of half floats
+};
+
+// Write an uncompressed, half-float (or uint for IDs), multi-channel OpenEXR scanline file
+bool writeExr(const std::filesystem::path& filename, uint32_t width, uint32_t height, std::vector<ExrChannel> channels);
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Clustered Light Culling
+
+    - The frustum is split in tilesX x tilesY tiles and numSlices depth slices,
+      exponentially distributed between the near and far planes
+    - The culling pass (light_clusters.comp.slang) runs one thread per cluster,
+      testing the sphere of influence of each light against the view space box of
+      the cluster, and writes a fixed-size list of light indices per cluster
+    - Directional lights and lights without a range reach all clusters, unless a
+      cutoff irradiance gives them a range
+    - The occupancy statistics are copied to a host-visible buffer and shown in the
+      UI, to tune the size of the grid and the capacity of the lists. There is one
+      buffer per frame in flight: a copy is read once the deletion queue value of
+      its frame is signaled, never while the GPU writes it. When all of them are
+      in flight, the statistics of the frame are not copied
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <fmt/format.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/camera_manipulator.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/compute_pipeline.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "light_clusters.hpp"
+
+// Pre-compiled shader
+#include "_autogen/light_clusters.comp.slang.h"
+
+//--------------------------------------------------------------------------------------------------
+// Create the culling shader, the grid and the statistics buffers. The light lists are created on first use.
+void LightClusters::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  VkDevice device = res.allocator.getDevice();
+
+  VkPushConstantRange pushConstant = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::LightCullPushConstant)};
+
+  VkPipelineLayoutCreateInfo plCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreatePipelineLayout(device, &plCreateInfo, nullptr, &m_pipelineLayout));
+  NVVK_DBG_NAME(m_pipelineLayout);
+
+  VkShaderCreateInfoEXT shaderCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+      .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
+      .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+      .codeSize               = light_clusters_comp_slang_sizeInBytes,
+      .pCode                  = light_clusters_comp_slang,
+      .pName                  = "main",
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_shader));
+  NVVK_DBG_NAME(m_shader);
+
+  NVVK_CHECK(res.allocator.createBuffer(m_bGrid, sizeof(shaderio::LightClusterGrid),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bGrid.buffer);
+  NVVK_CHECK(res.allocator.createBuffer(m_bStats, sizeof(shaderio::LightClusterStats),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT
+                                            | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bStats.buffer);
+  for(Readback& readback : m_readbacks)
+  {
+    NVVK_CHECK(res.allocator.createBuffer(readback.buffer, sizeof(shaderio::LightClusterStats), VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                          VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+    NVVK_DBG_NAME(readback.buffer.buffer);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the buffers and the shader
+void LightClusters::deinit(Resources& res)
+{
+  VkDevice device = res.allocator.getDevice();
+  res.allocator.destroyBuffer(m_bGrid);
+  res.allocator.destroyBuffer(m_bLightCounts);
+  res.allocator.destroyBuffer(m_bLightIndices);
+  res.allocator.destroyBuffer(m_bStats);
+  for(Readback& readback : m_readbacks)
+  {
+    res.allocator.destroyBuffer(readback.buffer);
+    readback.value = 0;
+  }
+  vkDestroyShaderEXT(device, m_shader, nullptr);
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  m_shader         = {};
+  m_pipelineLayout = {};
+  m_hasStats       = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Settings shared by the rasterizers, and the occupancy of the clusters
+bool LightClusters::onUIRender(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  Settings& settings = res.settings;
+  bool      changed  = false;
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("Clustered Lights", &settings.clusterEnable, "Shade each fragment with the lights of its cluster only");
+    ImGui::BeginDisabled(!settings.clusterEnable);
+    changed |= PE::SliderInt2("Cluster Tiles", glm::value_ptr(settings.clusterTiles), 1, 64, "%d", 0, "Number of tiles on screen (X, Y)");
+    changed |= PE::SliderInt("Cluster Slices", &settings.clusterSlices, 1, 64, "%d", 0, "Number of depth slices, exponentially distributed");
+    changed |= PE::SliderInt("Max Lights / Cluster", &settings.clusterMaxLights, 1, 256, "%d", 0,
+                             "Capacity of the light list of a cluster, lights beyond are dropped");
+    changed |= PE::DragFloat("Light Cutoff", &settings.clusterLightCutoff, 0.0001f, 0.0f, 10.0f, "%.4f", 0,
+                             "Irradiance below which lights without range are ignored (0: lights without range reach all clusters)");
+
+    if(settings.clusterEnable && m_hasStats)
+    {
+      const uint32_t numClusters = uint32_t(m_grid.tilesX * m_grid.tilesY * m_grid.numSlices);
+      const float    nonEmpty    = 100.0f * float(m_stats.nonEmpty) / float(std::max(1U, numClusters));
+      const float    average     = float(m_stats.numReferences) / float(std::max(1U, m_stats.nonEmpty));
+      PE::Text("Clusters", fmt::format("{} ({:.1f}% with lights)", numClusters, nonEmpty));
+      PE::Text("Lights / Cluster", fmt::format("avg {:.1f}, max {}", average, m_stats.maxCount));
+      PE::Text("Overflowing", fmt::format("{} clusters", m_stats.overflow));
+
+      // Number of clusters by light count: 0, 1, 2-3, 4-7, ...
+      float histogram[LIGHT_CLUSTER_HISTOGRAM_BINS];
+      for(int i = 0; i < LIGHT_CLUSTER_HISTOGRAM_BINS; i++)
+        histogram[i] = float(m_stats.histogram[i]);
+      PE::entry(
+          "Occupancy",
+          [&] {
+            ImGui::PlotHistogram("##occupancy", histogram, LIGHT_CLUSTER_HISTOGRAM_BINS, 0, "0, 1, 2-3, 4-7, .., 64+", 0.0f,
+                                 FLT_MAX, ImVec2(0, 60));
+            return false;
+          },
+          "Number of clusters by light count");
+    }
+    ImGui::EndDisabled();
+    PE::end();
+  }
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// (Re)create the light lists for the size of the grid
+void LightClusters::allocateLists(Resources& res, uint32_t numClusters, uint32_t maxLightsPerCluster)
+{
+  const VkDeviceSize countsSize  = VkDeviceSize(numClusters) * sizeof(uint32_t);
+  const VkDeviceSize indicesSize = countsSize * maxLightsPerCluster;
+  if(m_bLightCounts.bufferSize >= countsSize && m_bLightIndices.bufferSize >= indicesSize)
+    return;
+
+  // The previous frames may still be using the lists
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  res.deletionQueue.retire(m_bLightCounts);
+  res.deletionQueue.retire(m_bLightIndices);
+  NVVK_CHECK(res.allocator.createBuffer(m_bLightCounts, countsSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT));
+  NVVK_DBG_NAME(m_bLightCounts.buffer);
+  NVVK_CHECK(res.allocator.createBuffer(m_bLightIndices, indicesSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT));
+  NVVK_DBG_NAME(m_bLightIndices.buffer);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Statistics of the most recent frame whose copy is done; the completed copies are freed
+void LightClusters::readStats(Resources& res)
+{
+  const Readback* newest = nullptr;
+  for(Readback& readback : m_readbacks)
+  {
+    if(readback.value == 0 || !res.deletionQueue.isSignaled(readback.value))
+      continue;
+    if(newest == nullptr || readback.value > newest->value)
+      newest = &readback;
+  }
+  if(newest != nullptr)
+  {
+    vmaInvalidateAllocation(res.allocator, newest->buffer.allocation, 0, VK_WHOLE_SIZE);
+    memcpy(&m_stats, newest->buffer.mapping, sizeof(m_stats));
+    m_hasStats = true;
+  }
+  for(Readback& readback : m_readbacks)
+  {
+    if(readback.value != 0 && res.deletionQueue.isSignaled(readback.value))
+      readback.value = 0;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the grid for the camera of the frame, then build the light lists
+void LightClusters::update(VkCommandBuffer cmd, Resources& res, const VkExtent2D& renderSize)
+{
+  NVVK_DBG_SCOPE(cmd);
+  const Settings& settings = res.settings;
+
+  readStats(res);
+
+  const glm::vec2 clipPlanes = res.cameraManip->getClipPlanes();
+  m_grid.enabled             = settings.clusterEnable ? 1 : 0;
+  m_grid.tilesX              = std::clamp(settings.clusterTiles.x, 1, 64);
+  m_grid.tilesY              = std::clamp(settings.clusterTiles.y, 1, 64);
+  m_grid.numSlices           = std::clamp(settings.clusterSlices, 1, 64);
+  m_grid.maxLightsPerCluster = std::clamp(settings.clusterMaxLights, 1, 256);
+  m_grid.zNear               = std::max(clipPlanes.x, 1e-6f);
+  m_grid.zFar                = std::max(clipPlanes.y, m_grid.zNear * 1.001f);
+  m_grid.sliceScale          = float(m_grid.numSlices) / std::log(m_grid.zFar / m_grid.zNear);
+  m_grid.screenSize          = {float(renderSize.width), float(renderSize.height)};
+  m_grid.lightCutoff         = std::max(settings.clusterLightCutoff, 0.0f);
+
+  const uint32_t numClusters = uint32_t(m_grid.tilesX * m_grid.tilesY * m_grid.numSlices);
+  if(m_grid.enabled == 1)
+    allocateLists(res, numClusters, uint32_t(m_grid.maxLightsPerCluster));
+  m_grid.lightCounts  = (uint32_t*)m_bLightCounts.address;
+  m_grid.lightIndices = (uint32_t*)m_bLightIndices.address;
+  m_grid.stats        = (shaderio::LightClusterStats*)m_bStats.address;
+
+  // The previous frame is done reading the grid, when its fragments shaders completed
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdUpdateBuffer(cmd, m_bGrid.buffer, 0, sizeof(m_grid), &m_grid);
+  if(m_grid.enabled == 0)
+  {
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+    return;
+  }
+  vkCmdFillBuffer(cmd, m_bStats.buffer, 0, VK_WHOLE_SIZE, 0);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+  // Culling, one thread per cluster
+  const shaderio::LightCullPushConstant pushConstant{
+      .grid      = (shaderio::LightClusterGrid*)m_bGrid.address,
+      .frameInfo = (shaderio::SceneFrameInfo*)res.bFrameInfo.address,
+      .gltfScene = (shaderio::GltfScene*)res.sceneVk->sceneDesc().address,
+  };
+  const VkShaderStageFlagBits stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  vkCmdBindShadersEXT(cmd, 1, &stage, &m_shader);
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+  vkCmdDispatch(cmd, (numClusters + LIGHT_CLUSTER_WORKGROUP_SIZE - 1) / LIGHT_CLUSTER_WORKGROUP_SIZE, 1, 1);
+
+  // The lists are read by the fragment shaders, the statistics by the host
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  Readback& readback = m_readbacks[m_nextReadback];
+  if(readback.value != 0)
+    return;  // All copies in flight
+  const VkBufferCopy region{.size = sizeof(shaderio::LightClusterStats)};
+  vkCmdCopyBuffer(cmd, m_bStats.buffer, readback.buffer.buffer, 1, &region);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_HOST_BIT);
+  readback.value = res.deletionQueue.frameValue();
+  m_nextReadback = (m_nextReadback + 1) % kNumReadbacks;
+}
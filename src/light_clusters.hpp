@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include "resources.hpp"
+
+
+// Clustered (froxel) light culling for the rasterizers.
+// The view frustum is divided in tiles on screen and exponential slices in depth. Each frame, a
+// compute pass lists the lights reaching each cluster, and the fragment shaders only loop over the
+// lights of their cluster (see shaders/light_clusters.h.slang). The grid is described by a small
+// buffer whose address is fixed, so recorded draws stay valid when the grid is resized.
+class LightClusters
+{
+public:
+  LightClusters() = default;
+  ~LightClusters() { assert(!m_shader && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUIRender(Resources& res);
+
+  // Build the light lists of the clusters, for the camera of the frame and the render size
+  void update(VkCommandBuffer cmd, Resources& res, const VkExtent2D& renderSize);
+
+  // Address of the shaderio::LightClusterGrid, for RasterPushConstant::lightClusters
+  VkDeviceAddress getGridAddress() const { return m_bGrid.address; }
+
+private:
+  void allocateLists(Resources& res, uint32_t numClusters, uint32_t maxLightsPerCluster);
+  void readStats(Resources& res);
+
+  static constexpr uint32_t kNumReadbacks = 4;  // More than the frames in flight
+
+  // Host copy of the statistics of a frame
+  struct Readback
+  {
+    nvvk::Buffer buffer;
+    uint64_t     value{0};  // Deletion queue value signaled once the copy is done, 0: free
+  };
+
+  nvvk::Buffer m_bGrid;          // shaderio::LightClusterGrid
+  nvvk::Buffer m_bLightCounts;   // Number of lights per cluster
+  nvvk::Buffer m_bLightIndices;  // Light indices, maxLightsPerCluster per cluster
+  nvvk::Buffer m_bStats;         // shaderio::LightClusterStats, written by the culling pass
+
+  std::array<Readback, kNumReadbacks> m_readbacks;  // Ring of the copies of m_bStats
+  uint32_t                            m_nextReadback{0};
+
+  shaderio::LightClusterGrid  m_grid{};
+  shaderio::LightClusterStats m_stats{};  // Last statistics read back
+  bool                        m_hasStats{false};
+
+  VkShaderEXT      m_shader{};
+  VkPipelineLayout m_pipelineLayout{};
+};
@@ -37,7 +37,10 @@
 #include <nvvk/context.hpp>
 #include <nvvk/validation_settings.hpp>
 
+#include "cpu_pathtracer.hpp"
 #include "renderer.hpp"
+#include "sampler_benchmark.hpp"
+#include "utils.hpp"
 #include "doc/app_icon_png.h"
 
 nvutils::ProfilerManager g_profilerManager;  // #PROFILER
@@ -79,6 +82,9 @@ auto main(int argc, char** argv) -> int
   // Global variables
   std::filesystem::path sceneFilename{};  // "shader_ball.gltf"};  // Default scene
   std::filesystem::path hdrFilename{};    // "env3.hdr"};         // Default HDR
+  bool                  samplerBenchmark = false;
+  bool                  cpuRender        = false;
+  int                   cpuThreads       = 0;
 
   // Command line parameters registration
   nvutils::ParameterRegistry parameterRegistry;
@@ -92,6 +98,11 @@ auto main(int argc, char** argv) -> int
   parameterRegistry.add({"logLevel", "Log level: [Info:0, Warning:1, Error:2]"}, (int*)&logLevel);
   parameterRegistry.add({"logShow", "Show extra log info (bitset): [None:0, Time:1, Level:2]"}, (int*)&logShow);
   parameterRegistry.add({"device", "force a vulkan device via index into the device list"}, &vkSetup.forceGPU);
+  parameterRegistry.add({"samplerBenchmark", "Print the error of the path tracer samplers on test integrals, and exit"},
+                        &samplerBenchmark, true);
+  parameterRegistry.add({"cpuRender", "Render the scene on the CPU with `frames` samples per pixel, save the image and exit"},
+                        &cpuRender, true);
+  parameterRegistry.add({"cpuThreads", "Number of threads of the CPU renderer, 0: all cores"}, &cpuThreads);
 
   // Don't show the profiler by default
   auto profilerSettings  = std::make_shared<nvapp::ElementProfiler::ViewSettings>();
@@ -112,6 +123,7 @@ auto main(int argc, char** argv) -> int
   // The logger will redirect the log to the Element Logger, to be displayed in the UI
   nvutils::Logger::getInstance().setLogCallback([](nvutils::Logger::LogLevel logLevel, const std::string& str) {
     elemLogger->addLog(logLevel, "%s", str.c_str());
+    elemGltfRenderer->getMetrics().addLog(logLevel);
   });
 
   // Adding the parameter registry to the command line parser
@@ -123,6 +135,28 @@ auto main(int argc, char** argv) -> int
   logger.setMinimumLogLevel(logLevel);
   logger.setShowFlags(logShow);
 
+  // CPU only, no Vulkan device needed
+  if(samplerBenchmark)
+  {
+    sampler::logBenchmark(sampler::runBenchmark());
+    return 0;
+  }
+  if(cpuRender)
+  {
+    cpu::HeadlessInfo info;
+    info.sceneFilename   = nvutils::findFile(sceneFilename.empty() ? "shader_ball.gltf" : sceneFilename, nvsamples::getResourcesDirs());
+    info.hdrFilename     = hdrFilename.empty() ? hdrFilename : nvutils::findFile(hdrFilename, nvsamples::getResourcesDirs());
+    info.size            = appInfo.windowSize;
+    info.samplesPerPixel = appInfo.headlessFrameCount;
+    info.numThreads      = cpuThreads;
+    if(info.sceneFilename.empty())
+    {
+      LOGE("Cannot find file: %s\n", nvutils::utf8FromPath(sceneFilename).c_str());
+      return 1;
+    }
+    return cpu::renderHeadless(info, cameraManip) ? 0 : 1;
+  }
+
 
   // Extension feature needed.
   // clang-format off
@@ -134,6 +168,7 @@ auto main(int argc, char** argv) -> int
   VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtPipelineFeature{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR};
   VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT};
   VkPhysicalDeviceRayTracingInvocationReorderFeaturesNV reorderFeature{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_INVOCATION_REORDER_FEATURES_NV};
+  VkPhysicalDeviceShaderClockFeaturesKHR shaderClockFeature{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_CLOCK_FEATURES_KHR};  // Shader time heatmap, optional
 
   // clang-format on
 
@@ -149,6 +184,9 @@ auto main(int argc, char** argv) -> int
                                 {VK_EXT_SHADER_OBJECT_EXTENSION_NAME, &shaderObjectFeatures},
                                 {VK_KHR_FRAGMENT_SHADER_BARYCENTRIC_EXTENSION_NAME, &baryFeatures},
                                 {VK_EXT_NESTED_COMMAND_BUFFER_EXTENSION_NAME, &nestedCmdFeature},
+                                {VK_KHR_SHADER_CLOCK_EXTENSION_NAME, &shaderClockFeature, false},
+                                {VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME, nullptr, false},
+                                {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, nullptr, false},
                                 {VK_NV_RAY_TRACING_INVOCATION_REORDER_EXTENSION_NAME, &reorderFeature, false}};
   if(!appInfo.headless)
   {
@@ -258,6 +296,8 @@ auto main(int argc, char** argv) -> int
     ImGui::DockBuilderDockWindow("NVML Monitor", monitorID);
     ImGuiID profilerID = ImGui::DockBuilderSplitNode(logID, ImGuiDir_Right, 0.33F, nullptr, &logID);
     ImGui::DockBuilderDockWindow("Profiler", profilerID);
+    ImGui::DockBuilderDockWindow("Path Counters", profilerID);
+    ImGui::DockBuilderDockWindow("Memory", profilerID);
   };
 
   // Create the application
@@ -295,6 +335,8 @@ auto main(int argc, char** argv) -> int
     elemGltfRenderer->createHDR(hdrFilename);
 
   app.run();
+  const int exitCode = elemGltfRenderer->getExitCode();
   app.deinit();
   vkContext.deinit();
+  return exitCode;
 }
\ No newline at end of file
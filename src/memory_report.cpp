@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Memory Report
+
+    - The resources are allocated inside nvvk and nvvkgltf, which do not
+      know about the subsystems of the renderer. Instead of tagging each
+      allocation, the renderer wraps the code creating and destroying the
+      resources of a subsystem in a Scope: the change of the VMA allocated
+      bytes of each heap during the scope belongs to its category
+    - The VMA statistics are per allocator, not per thread. A scene loaded
+      in the background (SceneSwap) uses the allocator of its slot, bound to
+      the loading thread with ThreadAllocator: its scopes only measure that
+      allocator, and the scopes of the render loop measure the others. The
+      allocators measured are chosen when the scope starts
+    - Resources retired to the deletion queue are freed later, outside the
+      scope retiring them: the queue keeps the category of that scope and
+      frees them in a scope of the same category
+    - The upload staging is counted with the subsystem uploading, until
+      processQueuedCommandBuffers releases it
+    - The heaps come from the VMA budgets (VK_EXT_memory_budget when the
+      device has it, otherwise an estimate), the fragmentation from the
+      VMA statistics: free bytes in the blocks, and the largest free range
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <imgui/imgui.h>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+
+#include "memory_report.hpp"
+
+namespace {
+
+const char* s_categoryNames[size_t(MemoryCategory::eCount)] = {
+    "Geometry", "Textures", "AccelerationStructures", "GBuffers", "Transients", "Environment", "Renderers", "DLSS",
+};
+
+thread_local MemoryReport::Scope* s_currentScope        = nullptr;
+thread_local uint32_t             s_threadAllocatorMask = 0;  // Bound with ThreadAllocator
+
+double toMB(double bytes)
+{
+  return bytes / (1024.0 * 1024.0);
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void MemoryReport::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"memReport", "Write the GPU memory per category and heap to this JSON file at exit"}, &m_filename);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called after the creation of the allocator, before any scope
+void MemoryReport::init(VmaAllocator allocator, bool hasMemoryBudget)
+{
+  m_allocator       = allocator;
+  m_allocators      = {allocator};
+  m_hasMemoryBudget = hasMemoryBudget;
+
+  const VkPhysicalDeviceMemoryProperties* memProps{};
+  vmaGetMemoryProperties(m_allocator, &memProps);
+  m_numHeaps = memProps->memoryHeapCount;
+  m_heaps.resize(m_numHeaps);
+  for(uint32_t i = 0; i < m_numHeaps; i++)
+  {
+    m_heaps[i].deviceLocal = (memProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    m_heaps[i].size        = memProps->memoryHeaps[i].size;
+  }
+  if(!m_hasMemoryBudget)
+  {
+    LOGW("VK_EXT_memory_budget is not available, the memory budgets are estimated\n");
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the report, before the resources are destroyed
+void MemoryReport::deinit()
+{
+  if(m_allocator && !m_filename.empty())
+  {
+    writeJson(nvutils::pathFromUtf8(m_filename));
+  }
+  m_allocator = nullptr;
+  m_allocators.clear();
+}
+
+void MemoryReport::addAllocator(VmaAllocator allocator)
+{
+  if(!m_allocator)
+    return;
+  if(m_allocators.size() == 32)
+  {
+    LOGW("MemoryReport: too many allocators, this one is not measured\n");
+    return;
+  }
+  m_allocators.push_back(allocator);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bytes allocated in each heap by the allocators of the mask, from the VMA statistics kept up to
+// date by each allocator
+MemoryReport::HeapBytes MemoryReport::allocatedBytes(uint32_t allocatorMask) const
+{
+  HeapBytes bytes{};
+  for(size_t a = 0; a < m_allocators.size(); a++)
+  {
+    if((allocatorMask & (1U << a)) == 0)
+      continue;
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+    vmaGetHeapBudgets(m_allocators[a], budgets);
+    for(uint32_t i = 0; i < m_numHeaps; i++)
+      bytes[i] += int64_t(budgets[i].statistics.allocationBytes);
+  }
+  return bytes;
+}
+
+// The allocator bound to the thread, otherwise all those not bound to another thread
+uint32_t MemoryReport::threadAllocatorMask() const
+{
+  if(s_threadAllocatorMask != 0)
+    return s_threadAllocatorMask;
+  const uint32_t all = m_allocators.size() == 32 ? ~0U : (1U << m_allocators.size()) - 1;
+  return all & ~m_boundMask.load();
+}
+
+// Budgets of the heaps with the statistics of all the allocators. With VK_EXT_memory_budget the
+// usage is the one of the process, otherwise VMA estimates it from the blocks of each allocator.
+void MemoryReport::getHeapBudgets(VmaBudget* budgets) const
+{
+  vmaGetHeapBudgets(m_allocators[0], budgets);
+  for(size_t a = 1; a < m_allocators.size(); a++)
+  {
+    VmaBudget other[VK_MAX_MEMORY_HEAPS]{};
+    vmaGetHeapBudgets(m_allocators[a], other);
+    for(uint32_t i = 0; i < m_numHeaps; i++)
+    {
+      budgets[i].statistics.blockCount += other[i].statistics.blockCount;
+      budgets[i].statistics.allocationCount += other[i].statistics.allocationCount;
+      budgets[i].statistics.blockBytes += other[i].statistics.blockBytes;
+      budgets[i].statistics.allocationBytes += other[i].statistics.allocationBytes;
+      if(!m_hasMemoryBudget)
+        budgets[i].usage += other[i].usage;
+    }
+  }
+}
+
+void MemoryReport::attribute(MemoryCategory category, const HeapBytes& bytes)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  Category& c     = m_categories[size_t(category)];
+  int64_t   total = 0;
+  for(uint32_t i = 0; i < m_numHeaps; i++)
+  {
+    c.bytes[i] += bytes[i];
+    total += c.bytes[i];
+  }
+  c.peak = std::max(c.peak, total);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Scopes
+MemoryReport::Scope::Scope(MemoryReport& report, MemoryCategory category)
+{
+  if(!report.m_allocator)
+    return;
+  m_report        = &report;
+  m_category      = category;
+  m_parent        = s_currentScope;
+  m_allocatorMask = report.threadAllocatorMask();
+  m_start         = report.allocatedBytes(m_allocatorMask);
+  s_currentScope  = this;
+}
+
+MemoryReport::Scope::~Scope()
+{
+  if(!m_report)
+    return;
+  s_currentScope        = m_parent;
+  const HeapBytes end   = m_report->allocatedBytes(m_allocatorMask);
+  HeapBytes       delta{};
+  HeapBytes       own{};
+  for(uint32_t i = 0; i < m_report->m_numHeaps; i++)
+  {
+    delta[i] = end[i] - m_start[i];
+    own[i]   = delta[i] - m_childBytes[i];
+    if(m_parent)
+      m_parent->m_childBytes[i] += delta[i];
+  }
+  m_report->attribute(m_category, own);
+}
+
+std::optional<MemoryCategory> MemoryReport::currentCategory()
+{
+  if(!s_currentScope)
+    return std::nullopt;
+  return s_currentScope->m_category;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Allocator of a thread
+MemoryReport::ThreadAllocator::ThreadAllocator(MemoryReport& report, VmaAllocator allocator)
+{
+  const auto it = std::find(report.m_allocators.begin(), report.m_allocators.end(), allocator);
+  if(!report.m_allocator || it == report.m_allocators.end())
+    return;
+  m_report = &report;
+  m_mask   = 1U << uint32_t(it - report.m_allocators.begin());
+
+  report.m_boundMask |= m_mask;
+  s_threadAllocatorMask = m_mask;
+}
+
+MemoryReport::ThreadAllocator::~ThreadAllocator()
+{
+  if(!m_report)
+    return;
+  s_threadAllocatorMask = 0;
+  m_report->m_boundMask &= ~m_mask;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Move the exact size of the scene textures from the geometry to the textures
+void MemoryReport::setSceneTextures(VmaAllocator allocator, std::span<const nvvk::Image> textures)
+{
+  if(!m_allocator)
+    return;
+
+  const VkPhysicalDeviceMemoryProperties* memProps{};
+  vmaGetMemoryProperties(allocator, &memProps);
+  HeapBytes bytes{};
+  for(const nvvk::Image& texture : textures)
+  {
+    if(!texture.allocation)
+      continue;
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(allocator, texture.allocation, &info);
+    bytes[memProps->memoryTypes[info.memoryType].heapIndex] += int64_t(info.size);
+  }
+
+  HeapBytes change{};
+  HeapBytes opposite{};
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(uint32_t i = 0; i < m_numHeaps; i++)
+    {
+      change[i]   = bytes[i] - m_textureBytes[i];
+      opposite[i] = -change[i];
+    }
+    m_textureBytes = bytes;
+  }
+  attribute(MemoryCategory::eTextures, change);
+  attribute(MemoryCategory::eGeometry, opposite);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Peak usage of the heaps
+void MemoryReport::update()
+{
+  if(!m_allocator)
+    return;
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+  getHeapBudgets(budgets);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(uint32_t i = 0; i < m_numHeaps; i++)
+    m_peakUsage[i] = std::max(m_peakUsage[i], budgets[i].usage);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Budgets and fragmentation of the heaps, over all the allocators. vmaCalculateStatistics walks
+// all the blocks.
+void MemoryReport::refreshHeaps()
+{
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+  getHeapBudgets(budgets);
+  std::vector<VmaTotalStatistics> stats(m_allocators.size());
+  for(size_t a = 0; a < m_allocators.size(); a++)
+    vmaCalculateStatistics(m_allocators[a], &stats[a]);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(uint32_t i = 0; i < m_numHeaps; i++)
+  {
+    Heap& heap            = m_heaps[i];
+    m_peakUsage[i]        = std::max(m_peakUsage[i], budgets[i].usage);
+    heap.budget           = budgets[i].budget;
+    heap.usage            = budgets[i].usage;
+    heap.peakUsage        = m_peakUsage[i];
+    heap.blockBytes       = 0;
+    heap.allocationBytes  = 0;
+    heap.freeRanges       = 0;
+    heap.largestFreeRange = 0;
+    for(size_t a = 0; a < m_allocators.size(); a++)
+    {
+      const VmaDetailedStatistics& detailed = stats[a].memoryHeap[i];
+      heap.blockBytes += detailed.statistics.blockBytes;
+      heap.allocationBytes += detailed.statistics.allocationBytes;
+      heap.freeRanges += detailed.unusedRangeCount;
+      if(detailed.unusedRangeCount > 0)
+        heap.largestFreeRange = std::max(heap.largestFreeRange, detailed.unusedRangeSizeMax);
+    }
+  }
+  m_lastRefresh = std::chrono::steady_clock::now();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Memory per category and per heap, refreshed twice per second
+void MemoryReport::onUiWindow()
+{
+  if(!m_allocator)
+    return;
+
+  if(ImGui::Begin("Memory"))
+  {
+    if(std::chrono::steady_clock::now() - m_lastRefresh > std::chrono::milliseconds(500))
+      refreshHeaps();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Device-local budget, for the share of each category
+    uint64_t deviceBudget = 0;
+    for(const Heap& heap : m_heaps)
+      deviceBudget += heap.deviceLocal ? heap.budget : 0;
+
+    const ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp;
+    if(ImGui::BeginTable("MemoryCategories", 5, tableFlags))
+    {
+      ImGui::TableSetupColumn("Category");
+      ImGui::TableSetupColumn("Device MB");
+      ImGui::TableSetupColumn("Host MB");
+      ImGui::TableSetupColumn("Peak MB");
+      ImGui::TableSetupColumn("Budget");
+      ImGui::TableHeadersRow();
+
+      auto row = [&](const char* name, int64_t device, int64_t host, int64_t peak) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", toMB(double(device)));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", toMB(double(host)));
+        ImGui::TableNextColumn();
+        if(peak >= 0)
+          ImGui::Text("%.1f", toMB(double(peak)));
+        ImGui::TableNextColumn();
+        ImGui::ProgressBar(deviceBudget > 0 ? float(double(device) / double(deviceBudget)) : 0.0f, ImVec2(-1, 0));
+      };
+
+      int64_t trackedDevice = 0;
+      int64_t trackedHost   = 0;
+      for(size_t c = 0; c < m_categories.size(); c++)
+      {
+        int64_t device = 0;
+        int64_t host   = 0;
+        for(uint32_t i = 0; i < m_numHeaps; i++)
+          (m_heaps[i].deviceLocal ? device : host) += m_categories[c].bytes[i];
+        trackedDevice += device;
+        trackedHost += host;
+        row(s_categoryNames[c], device, host, m_categories[c].peak);
+      }
+      int64_t allocatedDevice = 0;
+      int64_t allocatedHost   = 0;
+      for(const Heap& heap : m_heaps)
+        (heap.deviceLocal ? allocatedDevice : allocatedHost) += int64_t(heap.allocationBytes);
+      row("Other", allocatedDevice - trackedDevice, allocatedHost - trackedHost, -1);
+      ImGui::EndTable();
+    }
+
+    ImGui::Separator();
+    if(ImGui::BeginTable("MemoryHeaps", 5, tableFlags))
+    {
+      ImGui::TableSetupColumn("Heap");
+      ImGui::TableSetupColumn("Usage / Budget");
+      ImGui::TableSetupColumn("Peak MB");
+      ImGui::TableSetupColumn("Unused in blocks MB");
+      ImGui::TableSetupColumn("Fragmentation");
+      ImGui::TableHeadersRow();
+      for(uint32_t i = 0; i < m_numHeaps; i++)
+      {
+        const Heap& heap = m_heaps[i];
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%u (%s)", i, heap.deviceLocal ? "device" : "host");
+        ImGui::TableNextColumn();
+        const std::string usage = fmt::format("{:.0f} / {:.0f} MB", toMB(double(heap.usage)), toMB(double(heap.budget)));
+        ImGui::ProgressBar(heap.budget > 0 ? float(double(heap.usage) / double(heap.budget)) : 0.0f, ImVec2(-1, 0), usage.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", toMB(double(heap.peakUsage)));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.1f", toMB(double(heap.blockBytes - heap.allocationBytes)));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.0f%% (%u ranges)", 100.0 * heap.fragmentation(), heap.freeRanges);
+      }
+      ImGui::EndTable();
+    }
+    if(!m_hasMemoryBudget)
+      ImGui::TextDisabled("VK_EXT_memory_budget is not available: the budgets are estimated");
+  }
+  ImGui::End();
+}
+
+//--------------------------------------------------------------------------------------------------
+// JSON report: the categories with their peak, and the heaps
+std::string MemoryReport::toJson()
+{
+  refreshHeaps();
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::string json = fmt::format("{{\n  \"version\": 1,\n  \"memoryBudget\": {},\n  \"categories\": [", m_hasMemoryBudget);
+  HeapBytes tracked{};
+  for(size_t c = 0; c <= m_categories.size(); c++)
+  {
+    // The last entry is the memory outside any scope
+    HeapBytes bytes{};
+    for(uint32_t i = 0; i < m_numHeaps; i++)
+    {
+      bytes[i] = c < m_categories.size() ? m_categories[c].bytes[i] : int64_t(m_heaps[i].allocationBytes) - tracked[i];
+      tracked[i] += bytes[i];
+    }
+    int64_t device = 0;
+    int64_t host   = 0;
+    for(uint32_t i = 0; i < m_numHeaps; i++)
+      (m_heaps[i].deviceLocal ? device : host) += bytes[i];
+    json += fmt::format("{}\n    {{\"name\": \"{}\", \"deviceBytes\": {}, \"hostBytes\": {}", c ? "," : "",
+                        c < m_categories.size() ? s_categoryNames[c] : "Other", device, host);
+    json += c < m_categories.size() ? fmt::format(", \"peakBytes\": {}}}", m_categories[c].peak) : "}";
+  }
+  json += "\n  ],\n  \"heaps\": [";
+  for(uint32_t i = 0; i < m_numHeaps; i++)
+  {
+    const Heap& heap = m_heaps[i];
+    json += fmt::format("{}\n    {{\"index\": {}, \"deviceLocal\": {}, \"size\": {}, \"budget\": {}, \"usage\": {}, \"peakUsage\": {},",
+                        i ? "," : "", i, heap.deviceLocal, heap.size, heap.budget, heap.usage, heap.peakUsage);
+    json += fmt::format(" \"blockBytes\": {}, \"allocationBytes\": {}, \"freeRanges\": {}, \"largestFreeRange\": {}, \"fragmentation\": {:.4f}}}",
+                        heap.blockBytes, heap.allocationBytes, heap.freeRanges, heap.largestFreeRange, heap.fragmentation());
+  }
+  json += "\n  ]\n}\n";
+  return json;
+}
+
+bool MemoryReport::writeJson(const std::filesystem::path& filename)
+{
+  const std::string json = toJson();
+  std::ofstream     file(filename);
+  if(!file || !(file << json))
+  {
+    LOGE("Cannot write the memory report %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+  LOGI("Memory report written to %s\n", nvutils::utf8FromPath(filename).c_str());
+  return true;
+}
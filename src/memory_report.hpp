@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+#include <nvutils/parameter_registry.hpp>
+#include <nvvk/resource_allocator.hpp>
+
+
+// Subsystems owning GPU memory
+enum class MemoryCategory
+{
+  eGeometry,                // Scene buffers: vertices, indices, materials, nodes, lights, and their upload staging
+  eTextures,                // Scene textures
+  eAccelerationStructures,  // BLAS, TLAS and their build scratch
+  eGBuffers,                // Output G-Buffers (tonemapped, rendered, selection, depth)
+  eTransients,              // Transient images of the frame graph (deferred G-Buffers)
+  eEnvironment,             // HDR image, importance sampling and prefiltered cubes
+  eRenderers,               // Buffers of the renderers: AOVs, SVGF, caches, TAA, light clusters, ...
+  eDlss,                    // DLSS Ray Reconstruction
+  eCount
+};
+
+// GPU memory per category, against the budget of the heaps (VK_EXT_memory_budget), with the peak
+// usage and the fragmentation of the VMA blocks. The allocations are done by nvvk and nvvkgltf, so
+// they are tagged by scope: a MemoryReport::Scope attributes the memory allocated and freed by its
+// thread to a category, from the change of the VMA statistics. A thread creating resources next to
+// the render loop uses an allocator of its own, bound to it with ThreadAllocator, so the scopes of
+// each thread only see their own allocations. What no scope covers is reported as "Other". The
+// report is a window next to the profiler, and a JSON file with --memReport.
+class MemoryReport
+{
+public:
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  void init(VmaAllocator allocator, bool hasMemoryBudget);
+  void deinit();  // Writes the --memReport file
+
+  // Other allocators of the same device, e.g. the one of each scene slot, before any scope using them
+  void addAllocator(VmaAllocator allocator);
+
+  // Attributes the memory allocated and freed by the calling thread during its lifetime. Scopes
+  // nest: the memory of an inner scope is not counted in the outer one.
+  class Scope
+  {
+  public:
+    Scope(MemoryReport& report, MemoryCategory category);
+    ~Scope();
+
+  private:
+    friend class MemoryReport;
+    MemoryReport*                            m_report{};
+    MemoryCategory                           m_category{};
+    Scope*                                   m_parent{};
+    uint32_t                                 m_allocatorMask{0};  // Allocators measured, chosen at the start
+    std::array<int64_t, VK_MAX_MEMORY_HEAPS> m_start{};
+    std::array<int64_t, VK_MAX_MEMORY_HEAPS> m_childBytes{};  // Attributed by inner scopes
+  };
+
+  // Binds an allocator to the calling thread during its lifetime: the scopes of this thread only
+  // measure this allocator, and the scopes of the other threads no longer measure it
+  class ThreadAllocator
+  {
+  public:
+    ThreadAllocator(MemoryReport& report, VmaAllocator allocator);
+    ~ThreadAllocator();
+
+  private:
+    MemoryReport* m_report{};
+    uint32_t      m_mask{0};
+  };
+
+  // Category of the innermost scope of the calling thread, e.g. to free a retired resource in it
+  static std::optional<MemoryCategory> currentCategory();
+
+  // The textures are created with the geometry (SceneVk::create): their exact size is moved from
+  // the geometry to the textures, call after each scope creating or destroying the scene. The
+  // allocator is the one the textures were created with.
+  void setSceneTextures(VmaAllocator allocator, std::span<const nvvk::Image> textures);
+
+  // Peak usage of the heaps, once per frame
+  void update();
+
+  // Window next to the profiler
+  void onUiWindow();
+
+  bool writeJson(const std::filesystem::path& filename);
+
+private:
+  using HeapBytes = std::array<int64_t, VK_MAX_MEMORY_HEAPS>;
+
+  struct Heap
+  {
+    bool     deviceLocal{false};
+    uint64_t size{};
+    uint64_t budget{};
+    uint64_t usage{};
+    uint64_t peakUsage{};
+    uint64_t blockBytes{};       // Device memory allocated by VMA
+    uint64_t allocationBytes{};  // Used by the resources
+    uint64_t largestFreeRange{};
+    uint32_t freeRanges{};
+    // 1 - largest free range / free bytes: 0 when the free memory is in one range
+    double fragmentation() const
+    {
+      const uint64_t freeBytes = blockBytes - allocationBytes;
+      return freeBytes > 0 ? 1.0 - double(largestFreeRange) / double(freeBytes) : 0.0;
+    }
+  };
+
+  struct Category
+  {
+    HeapBytes bytes{};
+    int64_t   peak{};
+  };
+
+  HeapBytes   allocatedBytes(uint32_t allocatorMask) const;
+  uint32_t    threadAllocatorMask() const;  // Allocators measured by the scopes of the calling thread
+  void        getHeapBudgets(VmaBudget* budgets) const;  // Sum of the allocators
+  void        attribute(MemoryCategory category, const HeapBytes& bytes);
+  void        refreshHeaps();  // Budgets and VMA statistics, slow
+  std::string toJson();
+
+  std::string m_filename;  // --memReport
+
+  VmaAllocator              m_allocator{};   // Main allocator, first of m_allocators
+  std::vector<VmaAllocator> m_allocators;    // At most 32, one bit each in the masks
+  std::atomic<uint32_t>     m_boundMask{0};  // Allocators bound to a thread
+  uint32_t                  m_numHeaps{0};
+  bool                      m_hasMemoryBudget{false};
+  std::vector<Heap>         m_heaps;
+
+  mutable std::mutex                                   m_mutex;
+  std::array<Category, size_t(MemoryCategory::eCount)> m_categories{};
+  std::array<uint64_t, VK_MAX_MEMORY_HEAPS>            m_peakUsage{};
+  HeapBytes                                            m_textureBytes{};  // Moved from the geometry
+  std::chrono::steady_clock::time_point                m_lastRefresh{};
+};
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Metrics
+
+    - A headless worker has no UI; the metrics tell a monitoring system if it
+      is alive, how fast it renders, and if it is stuck loading or logging
+      errors
+    - The render thread updates the metrics once per frame, under a mutex;
+      the exposition text is built on request, by the HTTP thread or when
+      writing the file
+    - The percentiles and rates cover the last frames (kWindowSize); the
+      totals (_count, _sum, _total) cover the whole run, for rate() in
+      Prometheus
+    - The endpoint is a minimal HTTP/1.0 server on the loopback interface:
+      one request per connection, answered with the metrics, which is all a
+      scraper needs. It polls the socket to stop quickly at exit. A client
+      cannot block it for more than kClientTimeoutSeconds, and a client that
+      disconnects does not raise SIGPIPE
+    - The file is written to a temporary file then renamed, so a reader never
+      sees a partial file
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <fmt/format.h>
+#include <nvutils/file_operations.hpp>
+
+#include "metrics.hpp"
+
+namespace {
+
+constexpr size_t kWindowSize           = 1024;  // Frames of the percentiles and rates
+constexpr int    kClientTimeoutSeconds = 2;     // Receive and send timeout of a connection
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+void closeSocket(SocketHandle s)
+{
+  closesocket(s);
+}
+#else
+using SocketHandle = int;
+void closeSocket(SocketHandle s)
+{
+  close(s);
+}
+#endif
+
+// Timeouts, so a slow or silent client does not block the endpoint, and no SIGPIPE on macOS
+void setClientOptions(SocketHandle s)
+{
+#ifdef _WIN32
+  const DWORD timeout = kClientTimeoutSeconds * 1000;
+#else
+  const timeval timeout{.tv_sec = kClientTimeoutSeconds, .tv_usec = 0};
+#endif
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+  setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+  const int noSigPipe = 1;
+  setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+}
+
+// send() may write only part of the data; stops on error or timeout
+bool sendAll(SocketHandle s, const std::string& data)
+{
+#ifdef MSG_NOSIGNAL
+  const int flags = MSG_NOSIGNAL;  // A closed connection returns an error instead of raising SIGPIPE
+#else
+  const int flags = 0;
+#endif
+  size_t sent = 0;
+  while(sent < data.size())
+  {
+    const int n = int(send(s, data.data() + sent, int(data.size() - sent), flags));
+    if(n <= 0)
+      return false;
+    sent += size_t(n);
+  }
+  return true;
+}
+
+// Value at quantile `q` of sorted values, with linear interpolation
+double quantile(const std::vector<double>& sorted, double q)
+{
+  if(sorted.empty())
+    return 0.0;
+  const double pos = q * double(sorted.size() - 1);
+  const size_t i   = size_t(pos);
+  const size_t j   = std::min(i + 1, sorted.size() - 1);
+  return sorted[i] + (sorted[j] - sorted[i]) * (pos - double(i));
+}
+
+void addMetric(std::string& text, const char* name, const char* type, const char* help)
+{
+  text += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void Metrics::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"metricsPort", "Metrics: serve the Prometheus metrics on http://127.0.0.1:<port>/metrics (0: off)"}, &m_port);
+  paramReg->add({"metricsFile", "Metrics: write the Prometheus metrics to this file, every metricsInterval seconds"},
+                &m_filename);
+  paramReg->add({"metricsInterval", "Metrics: seconds between two writes of the metrics file"}, &m_interval);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Open the socket of the endpoint, and start the thread answering the requests
+void Metrics::init()
+{
+  m_window.reserve(kWindowSize);
+  m_lastWrite = Clock::now();
+  if(m_port <= 0)
+    return;
+
+#ifdef _WIN32
+  WSADATA wsaData{};
+  if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+  {
+    LOGE("Metrics: cannot initialize the sockets\n");
+    return;
+  }
+#endif
+
+  SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if(s == SocketHandle(-1))
+  {
+    LOGE("Metrics: cannot create the socket\n");
+    return;
+  }
+  int reuse = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+  sockaddr_in address{};
+  address.sin_family      = AF_INET;
+  address.sin_port        = htons(uint16_t(m_port));
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(s, 4) != 0)
+  {
+    LOGE("Metrics: cannot listen on port %d\n", m_port);
+    closeSocket(s);
+    return;
+  }
+
+  m_socket = intptr_t(s);
+  m_stop   = false;
+  m_server = std::thread(&Metrics::serve, this);
+  LOGI("Metrics: serving http://127.0.0.1:%d/metrics\n", m_port);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Stop the endpoint and write the final metrics
+void Metrics::deinit()
+{
+  if(m_server.joinable())
+  {
+    m_stop = true;
+    m_server.join();
+    closeSocket(SocketHandle(m_socket));
+    m_socket = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+  }
+  if(!m_filename.empty())
+  {
+    writeFile();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Answer the requests until deinit, checking the stop flag every 100 ms
+void Metrics::serve()
+{
+  const SocketHandle listener = SocketHandle(m_socket);
+  while(!m_stop)
+  {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(listener, &readSet);
+    timeval timeout{.tv_sec = 0, .tv_usec = 100'000};
+    if(select(int(listener + 1), &readSet, nullptr, nullptr, &timeout) <= 0)
+      continue;
+
+    const SocketHandle client = accept(listener, nullptr, nullptr);
+    if(client == SocketHandle(-1))
+      continue;
+    setClientOptions(client);
+
+    // The request line is enough: GET /metrics (or /)
+    char      request[1024]{};
+    const int received = int(recv(client, request, sizeof(request) - 1, 0));
+    std::string response;
+    if(received > 0 && (strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0))
+    {
+      const std::string body = getText();
+      response = fmt::format("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\n\r\n{}",
+                             body.size(), body);
+    }
+    else
+    {
+      response = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+    }
+    sendAll(client, response);
+    closeSocket(client);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame time since the previous frame, state of the renderer, and periodic write of the file
+void Metrics::frameBegin(const FrameState& state)
+{
+  if(!isEnabled())
+    return;
+
+  const Clock::time_point now = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_lastFrame != Clock::time_point{} && state.idle)
+    {
+      // Waiting for input: not a frame time, kept out of the window and the quantiles
+      m_idleSecondsSum += std::chrono::duration<double>(now - m_lastFrame).count();
+    }
+    else if(m_lastFrame != Clock::time_point{})
+    {
+      const FrameSample sample{.seconds = std::chrono::duration<double>(now - m_lastFrame).count(),
+                               .samples = m_pendingSamples};
+      if(m_window.size() < kWindowSize)
+        m_window.push_back(sample);
+      else
+        m_window[m_windowNext] = sample;
+      m_windowNext = (m_windowNext + 1) % kWindowSize;
+      m_numFrames++;
+      m_frameSecondsSum += sample.seconds;
+      m_samplesTotal += m_pendingSamples;
+    }
+    m_lastFrame      = now;
+    m_pendingSamples = 0;
+    m_state          = state;
+  }
+
+  if(!m_filename.empty() && std::chrono::duration<float>(now - m_lastWrite).count() >= m_interval)
+  {
+    m_lastWrite = now;
+    writeFile();
+  }
+}
+
+void Metrics::addSamples(uint64_t samples)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pendingSamples += samples;
+}
+
+void Metrics::addSceneLoad(bool success, double seconds)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_sceneLoads++;
+  m_sceneLoadFailures += success ? 0 : 1;
+  m_sceneLoadSecondsSum += seconds;
+  m_sceneLoadLastSeconds = seconds;
+}
+
+void Metrics::addLog(nvutils::Logger::LogLevel level)
+{
+  if(level == nvutils::Logger::LogLevel::eERROR)
+    m_errors++;
+  else if(level == nvutils::Logger::LogLevel::eWARNING)
+    m_warnings++;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Prometheus text exposition format (version 0.0.4)
+std::string Metrics::getText() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  // Percentiles and rates over the window, whose frames are contiguous
+  std::vector<double> frameSeconds;
+  frameSeconds.reserve(m_window.size());
+  double   span          = 0.0;
+  uint64_t windowSamples = 0;
+  for(const FrameSample& sample : m_window)
+  {
+    frameSeconds.push_back(sample.seconds);
+    span += sample.seconds;
+    windowSamples += sample.samples;
+  }
+  std::sort(frameSeconds.begin(), frameSeconds.end());
+
+  std::string text;
+  addMetric(text, "gltf_renderer_uptime_seconds", "gauge", "Time since the start of the renderer");
+  text += fmt::format("gltf_renderer_uptime_seconds {:.3f}\n", std::chrono::duration<double>(Clock::now() - m_start).count());
+
+  addMetric(text, "gltf_renderer_frame_time_seconds", "summary", "CPU time between two frames, quantiles of the last frames");
+  for(double q : {0.5, 0.9, 0.95, 0.99})
+    text += fmt::format("gltf_renderer_frame_time_seconds{{quantile=\"{}\"}} {:.6f}\n", q, quantile(frameSeconds, q));
+  text += fmt::format("gltf_renderer_frame_time_seconds_sum {:.6f}\n", m_frameSecondsSum);
+  text += fmt::format("gltf_renderer_frame_time_seconds_count {}\n", m_numFrames);
+
+  addMetric(text, "gltf_renderer_frames_per_second", "gauge", "Frames per second over the last frames");
+  text += fmt::format("gltf_renderer_frames_per_second {:.3f}\n", span > 0.0 ? double(m_window.size()) / span : 0.0);
+
+  addMetric(text, "gltf_renderer_samples_total", "counter", "Rendered samples (pixels times samples per pixel)");
+  text += fmt::format("gltf_renderer_samples_total {}\n", m_samplesTotal);
+  addMetric(text, "gltf_renderer_samples_per_second", "gauge", "Rendered samples per second over the last frames");
+  text += fmt::format("gltf_renderer_samples_per_second {:.1f}\n", span > 0.0 ? double(windowSamples) / span : 0.0);
+
+  addMetric(text, "gltf_renderer_frame_count", "gauge", "Accumulated frames of the current image");
+  text += fmt::format("gltf_renderer_frame_count {}\n", m_state.frameCount);
+  addMetric(text, "gltf_renderer_max_frames", "gauge", "Frames at which the accumulation stops");
+  text += fmt::format("gltf_renderer_max_frames {}\n", m_state.maxFrames);
+
+  addMetric(text, "gltf_renderer_idle", "gauge", "1 when the image is final and the renderer waits for input");
+  text += fmt::format("gltf_renderer_idle {}\n", m_state.idle ? 1 : 0);
+  addMetric(text, "gltf_renderer_idle_seconds_total", "counter", "Time spent waiting for input, without GPU work");
+  text += fmt::format("gltf_renderer_idle_seconds_total {:.3f}\n", m_idleSecondsSum);
+
+  addMetric(text, "gltf_renderer_queued_command_buffers", "gauge", "Scene uploads and BLAS builds waiting for submission");
+  text += fmt::format("gltf_renderer_queued_command_buffers {}\n", m_state.queuedCommandBuffers);
+
+  const struct
+  {
+    const char* name;
+    const char* help;
+    uint64_t MemoryHeap::*value;
+  } memoryMetrics[] = {
+      {"gltf_renderer_memory_usage_bytes", "Memory of the heap used by the process", &MemoryHeap::usage},
+      {"gltf_renderer_memory_budget_bytes", "Memory of the heap available to the process", &MemoryHeap::budget},
+      {"gltf_renderer_memory_block_bytes", "Device memory blocks allocated by VMA", &MemoryHeap::blockBytes},
+      {"gltf_renderer_memory_allocation_bytes", "Resources placed in the VMA blocks", &MemoryHeap::allocationBytes},
+  };
+  for(const auto& metric : memoryMetrics)
+  {
+    addMetric(text, metric.name, "gauge", metric.help);
+    for(size_t i = 0; i < m_state.memory.size(); i++)
+    {
+      const MemoryHeap& heap = m_state.memory[i];
+      text += fmt::format("{}{{heap=\"{}\",location=\"{}\"}} {}\n", metric.name, i, heap.deviceLocal ? "device" : "host",
+                          heap.*metric.value);
+    }
+  }
+
+  addMetric(text, "gltf_renderer_scene_load_seconds", "summary", "Duration of the scene loads");
+  text += fmt::format("gltf_renderer_scene_load_seconds_sum {:.6f}\n", m_sceneLoadSecondsSum);
+  text += fmt::format("gltf_renderer_scene_load_seconds_count {}\n", m_sceneLoads);
+  addMetric(text, "gltf_renderer_scene_load_last_seconds", "gauge", "Duration of the last scene load");
+  text += fmt::format("gltf_renderer_scene_load_last_seconds {:.6f}\n", m_sceneLoadLastSeconds);
+  addMetric(text, "gltf_renderer_scene_load_failures_total", "counter", "Scenes that could not be loaded");
+  text += fmt::format("gltf_renderer_scene_load_failures_total {}\n", m_sceneLoadFailures);
+
+  addMetric(text, "gltf_renderer_log_messages_total", "counter", "Logged warnings and errors");
+  text += fmt::format("gltf_renderer_log_messages_total{{level=\"warning\"}} {}\n", m_warnings.load());
+  text += fmt::format("gltf_renderer_log_messages_total{{level=\"error\"}} {}\n", m_errors.load());
+  return text;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the metrics next to the file, then replace it
+bool Metrics::writeFile() const
+{
+  const std::filesystem::path path = nvutils::pathFromUtf8(m_filename);
+  std::filesystem::path       temp = path;
+  temp += ".tmp";
+  {
+    std::ofstream file(temp, std::ios::binary);
+    if(!file || !(file << getText()))
+    {
+      LOGE("Metrics: cannot write %s\n", nvutils::utf8FromPath(temp).c_str());
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temp, path, error);
+  if(error)
+  {
+    LOGE("Metrics: cannot write %s: %s\n", m_filename.c_str(), error.message().c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <nvutils/logger.hpp>
+#include <nvutils/parameter_registry.hpp>
+
+
+// Health and throughput metrics of a long-running renderer, in the Prometheus text format:
+// frame time percentiles, frames and samples per second, progress of the accumulation, queued
+// command buffers, memory of the Vulkan heaps, scene loads and logged errors.
+// They are served on http://127.0.0.1:<port>/metrics (--metricsPort) and/or written to a file
+// at a fixed interval (--metricsFile), e.g. for the textfile collector of the node exporter.
+class Metrics
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Memory of a Vulkan heap, from the VMA budgets
+  struct MemoryHeap
+  {
+    bool     deviceLocal{false};
+    uint64_t usage{};            // Used by the process, as reported by the driver
+    uint64_t budget{};           // Available to the process
+    uint64_t blockBytes{};       // Device memory blocks allocated by VMA
+    uint64_t allocationBytes{};  // Resources placed in the blocks
+  };
+
+  // State of the renderer, sampled at the beginning of each frame
+  struct FrameState
+  {
+    int                     frameCount{0};  // Accumulated frames of the current image
+    int                     maxFrames{0};
+    uint32_t                queuedCommandBuffers{0};
+    bool                    idle{false};  // The frame waited for input (--idle)
+    std::vector<MemoryHeap> memory;
+  };
+
+  Metrics() = default;
+  ~Metrics() { assert(!m_server.joinable() && "deinit must be called"); }
+
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+  void init();    // Starts the HTTP endpoint
+  void deinit();  // Stops it, and writes the file a last time
+
+  bool isEnabled() const { return m_port > 0 || !m_filename.empty(); }
+
+  // Beginning of a frame: the time since the previous call is the frame time
+  void frameBegin(const FrameState& state);
+  // Samples rendered by the frame (pixels times samples per pixel)
+  void addSamples(uint64_t samples);
+  // Duration of GltfRenderer::createScene, failed when the scene could not be loaded
+  void addSceneLoad(bool success, double seconds);
+  // Called by the log callback, from any thread
+  void addLog(nvutils::Logger::LogLevel level);
+
+  // All metrics, in the Prometheus text exposition format
+  std::string getText() const;
+
+private:
+  struct FrameSample
+  {
+    double   seconds{};
+    uint64_t samples{};
+  };
+
+  void serve();
+  bool writeFile() const;
+
+  // Settings
+  int         m_port{0};          // --metricsPort, 0: no endpoint
+  std::string m_filename;         // --metricsFile, empty: no file
+  float       m_interval{10.0f};  // --metricsInterval, seconds between two writes of the file
+
+  mutable std::mutex       m_mutex;
+  Clock::time_point        m_start{Clock::now()};
+  Clock::time_point        m_lastFrame{};
+  Clock::time_point        m_lastWrite{};
+  std::vector<FrameSample> m_window;  // Last frames, ring buffer for the percentiles and the rates
+  size_t                   m_windowNext{0};
+  uint64_t                 m_numFrames{0};
+  double                   m_frameSecondsSum{0.0};
+  double                   m_idleSecondsSum{0.0};  // Idle frames, not in the frame times
+  uint64_t                 m_samplesTotal{0};
+  uint64_t                 m_pendingSamples{0};  // Samples of the frame being recorded
+  FrameState               m_state;
+
+  uint64_t m_sceneLoads{0};
+  uint64_t m_sceneLoadFailures{0};
+  double   m_sceneLoadSecondsSum{0.0};
+  double   m_sceneLoadLastSeconds{0.0};
+
+  std::atomic<uint64_t> m_warnings{0};
+  std::atomic<uint64_t> m_errors{0};
+
+  // HTTP endpoint
+  std::thread       m_server;
+  std::atomic<bool> m_stop{false};
+  intptr_t          m_socket{-1};
+};
@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Multi-View
+
+    - The result and selection of the views are the layers of two image
+      arrays; the path tracer binds them through an alias of its output
+      images binding (RWTexture2DArray), and the shaders are specialized
+      with USE_MULTI_VIEW, so the single view is unchanged
+    - The frame info of the frame is copied to each view on the GPU, then the
+      camera matrices (the first members of SceneFrameInfo) are replaced: the
+      environment, debug and plane settings follow the UI as usual
+    - The projection of each view is the one of the camera manipulator, for
+      the size of the views, with the FOV of the view when it has one
+    - All views share the frame counter: they restart and converge together
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+
+#include <fmt/format.h>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/camera_manipulator.hpp>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "multi_view.hpp"
+
+// The camera matrices are replaced per view, the rest of the frame info is shared
+struct ViewMatrices
+{
+  glm::mat4 viewMatrix;
+  glm::mat4 projInv;
+  glm::mat4 viewInv;
+  glm::mat4 viewProjMatrix;
+  glm::mat4 prevMVP;
+};
+static_assert(offsetof(shaderio::SceneFrameInfo, envRotation) == sizeof(ViewMatrices),
+              "The camera matrices must be the first members of SceneFrameInfo");
+
+void MultiView::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"multiView", "Path tracer: render all the views of this file at once, one `{eye}, {center}, {up} [fov]` per line"},
+                &m_filename);
+  paramReg->addVector({"multiViewSize", "Path tracer: size of each view of --multiView"}, &m_sizeParam);
+}
+
+bool MultiView::init()
+{
+  m_views.clear();
+  if(m_filename.empty())
+    return true;
+  if(!parseViews(nvutils::pathFromUtf8(m_filename), m_views))
+  {
+    m_views.clear();
+    return false;
+  }
+  m_size = {std::max(1U, m_sizeParam.x), std::max(1U, m_sizeParam.y)};
+  LOGI("Multi-view: %zu views of %ux%u\n", m_views.size(), m_size.width, m_size.height);
+  return true;
+}
+
+void MultiView::deinit(Resources& res)
+{
+  for(nvvk::Image& image : m_images)
+    res.allocator.destroyImage(image);
+  res.allocator.destroyBuffer(m_bFrameInfos);
+}
+
+bool MultiView::parseViews(const std::filesystem::path& filename, std::vector<View>& views)
+{
+  std::ifstream file(filename);
+  if(!file)
+  {
+    LOGE("Multi-view: cannot open %s\n", nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+
+  std::string line;
+  while(std::getline(file, line))
+  {
+    line = line.substr(0, line.find('#'));
+    std::replace_if(line.begin(), line.end(), [](char c) { return c == '{' || c == '}' || c == ','; }, ' ');
+    std::istringstream stream(line);
+    View               view;
+    if(!(stream >> view.eye.x))
+      continue;
+    if(!(stream >> view.eye.y >> view.eye.z >> view.center.x >> view.center.y >> view.center.z >> view.up.x >> view.up.y >> view.up.z))
+    {
+      LOGE("Multi-view: invalid view in %s: %s\n", nvutils::utf8FromPath(filename).c_str(), line.c_str());
+      return false;
+    }
+    stream >> view.fov;
+    views.push_back(view);
+  }
+  if(views.empty())
+    LOGE("Multi-view: no view in %s\n", nvutils::utf8FromPath(filename).c_str());
+  return !views.empty();
+}
+
+bool MultiView::onUi()
+{
+  if(m_views.empty())
+    return false;
+
+  namespace PE = nvgui::PropertyEditor;
+  bool changed = false;
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("Multi-View", &m_enable, "Render all the views of --multiView at once");
+    ImGui::BeginDisabled(!m_enable);
+    PE::Text("Views", fmt::format("{} x {}x{}", m_views.size(), m_size.width, m_size.height));
+    PE::SliderInt("Displayed View", &m_displayView, 0, int(m_views.size()) - 1, "%d", 0, "View shown in the viewport");
+    ImGui::EndDisabled();
+    PE::end();
+  }
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Image arrays of the views, in the general layout
+void MultiView::createImages(VkCommandBuffer cmd, Resources& res)
+{
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  const VkFormat formats[] = {res.gBuffers.getColorFormat(Resources::eImgRendered), res.gBuffers.getColorFormat(Resources::eImgSelection)};
+  std::vector<VkImageMemoryBarrier2> barriers;
+  for(int i = 0; i < 2; i++)
+  {
+    const VkImageCreateInfo imageInfo{
+        .sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType   = VK_IMAGE_TYPE_2D,
+        .format      = formats[i],
+        .extent      = {m_size.width, m_size.height, 1},
+        .mipLevels   = 1,
+        .arrayLayers = getNumViews(),
+        .samples     = VK_SAMPLE_COUNT_1_BIT,
+        .usage       = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+    };
+    const VkImageViewCreateInfo viewInfo{
+        .sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .viewType         = VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+        .format           = formats[i],
+        .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = VK_REMAINING_ARRAY_LAYERS},
+    };
+    NVVK_CHECK(res.allocator.createImage(m_images[i], imageInfo, viewInfo));
+    NVVK_DBG_NAME(m_images[i].image);
+    m_images[i].descriptor.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers.push_back({.sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                        .dstStageMask     = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                        .dstAccessMask    = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                        .oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED,
+                        .newLayout        = VK_IMAGE_LAYOUT_GENERAL,
+                        .image            = m_images[i].image,
+                        .subresourceRange = viewInfo.subresourceRange});
+  }
+  const VkDependencyInfo depInfo{.sType                   = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+                                 .imageMemoryBarrierCount = uint32_t(barriers.size()),
+                                 .pImageMemoryBarriers    = barriers.data()};
+  vkCmdPipelineBarrier2(cmd, &depInfo);
+
+  NVVK_CHECK(res.allocator.createBuffer(m_bFrameInfos, sizeof(shaderio::SceneFrameInfo) * getNumViews(),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bFrameInfos.buffer);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame info of each view: the one of the frame, with the camera of the view
+void MultiView::update(VkCommandBuffer cmd, Resources& res)
+{
+  if(m_images[eTargetResult].image == VK_NULL_HANDLE)
+    createImages(cmd, res);
+
+  // Same projection as the main camera, for the size of the views
+  nvutils::CameraManipulator camera(*res.cameraManip);
+  camera.setWindowSize({m_size.width, m_size.height});
+
+  std::vector<VkBufferCopy> copies(getNumViews());
+  std::vector<ViewMatrices> matrices(getNumViews());
+  for(uint32_t i = 0; i < getNumViews(); i++)
+  {
+    const View& view = m_views[i];
+    camera.setLookat(view.eye, view.center, view.up, true);
+    if(view.fov > 0.0f)
+      camera.setFov(view.fov);
+    else
+      camera.setFov(res.cameraManip->getFov());
+    const glm::mat4 viewMatrix = camera.getViewMatrix();
+    const glm::mat4 proj       = camera.getPerspectiveMatrix();
+    matrices[i]                = {.viewMatrix     = viewMatrix,
+                                  .projInv        = glm::inverse(proj),
+                                  .viewInv        = glm::inverse(viewMatrix),
+                                  .viewProjMatrix = proj * viewMatrix,
+                                  .prevMVP        = proj * viewMatrix};
+    copies[i] = {.srcOffset = 0, .dstOffset = i * sizeof(shaderio::SceneFrameInfo), .size = sizeof(shaderio::SceneFrameInfo)};
+  }
+
+  // The frame info was written by the frame info pass
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdCopyBuffer(cmd, res.bFrameInfo.buffer, m_bFrameInfos.buffer, uint32_t(copies.size()), copies.data());
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  for(uint32_t i = 0; i < getNumViews(); i++)
+    vkCmdUpdateBuffer(cmd, m_bFrameInfos.buffer, copies[i].dstOffset, sizeof(ViewMatrices), &matrices[i]);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR);
+}
+
+std::vector<VkDescriptorImageInfo> MultiView::getOutputImages() const
+{
+  return {m_images[eTargetResult].descriptor, m_images[eTargetSelection].descriptor};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Blit the displayed view to the rendered image, keeping its aspect ratio: the view is centered
+void MultiView::display(VkCommandBuffer cmd, Resources& res)
+{
+  const VkExtent2D dstSize = res.gBuffers.getSize();
+  const float      scale   = std::min(float(dstSize.width) / float(m_size.width), float(dstSize.height) / float(m_size.height));
+  const int        width   = std::max(1, int(float(m_size.width) * scale));
+  const int        height  = std::max(1, int(float(m_size.height) * scale));
+  const int        x       = (int(dstSize.width) - width) / 2;
+  const int        y       = (int(dstSize.height) - height) / 2;
+  const uint32_t   layer   = uint32_t(std::clamp(m_displayView, 0, int(getNumViews()) - 1));
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  const VkClearColorValue       black{};
+  const VkImageSubresourceRange range{.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = 1, .layerCount = 1};
+  vkCmdClearColorImage(cmd, res.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL, &black, 1, &range);
+  vkCmdClearColorImage(cmd, res.gBuffers.getColorImage(Resources::eImgSelection), VK_IMAGE_LAYOUT_GENERAL, &black, 1, &range);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+  const VkImageBlit region{
+      .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseArrayLayer = layer, .layerCount = 1},
+      .srcOffsets     = {{0, 0, 0}, {int(m_size.width), int(m_size.height), 1}},
+      .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+      .dstOffsets     = {{x, y, 0}, {x + width, y + height, 1}},
+  };
+  vkCmdBlitImage(cmd, m_images[eTargetResult].image, VK_IMAGE_LAYOUT_GENERAL, res.gBuffers.getColorImage(Resources::eImgRendered),
+                 VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_LINEAR);
+  vkCmdBlitImage(cmd, m_images[eTargetSelection].image, VK_IMAGE_LAYOUT_GENERAL,
+                 res.gBuffers.getColorImage(Resources::eImgSelection), VK_IMAGE_LAYOUT_GENERAL, 1, &region, VK_FILTER_NEAREST);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
+
+ImageOutput::Layer MultiView::getLayer(uint32_t view) const
+{
+  return {.name       = "",
+          .channels   = {"R", "G", "B", "A"},
+          .image      = m_images[eTargetResult].image,
+          .format     = m_images[eTargetResult].format,
+          .size       = m_size,
+          .arrayLayer = view};
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan_core.h>
+#include <nvutils/parameter_registry.hpp>
+#include <nvvk/resource_allocator.hpp>
+
+#include "image_output.hpp"
+#include "resources.hpp"
+
+
+// Several views of the scene path traced together, for product shots rendered from many cameras.
+// The cameras come from a file (--multiView), and each frame the path tracer dispatches all views
+// at once, with the view index in z, into the layers of two image arrays (result and selection).
+// The views share the TLAS, the textures and the pipeline, and accumulate concurrently, so small
+// views still fill the GPU. Each view has its SceneFrameInfo: the frame info of the frame, with
+// the camera of the view. One of the views is shown in the viewport.
+class MultiView
+{
+public:
+  struct View
+  {
+    glm::vec3 eye{0.0f};
+    glm::vec3 center{0.0f};
+    glm::vec3 up{0.0f, 1.0f, 0.0f};
+    float     fov{0.0f};  // Degrees, 0: the FOV of the camera
+  };
+
+  // Images of the views
+  enum Target
+  {
+    eTargetResult,     // RGBA32F, same as the rendered image
+    eTargetSelection,  // R8, same as the selection image
+  };
+
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+  bool init();  // Reads the views of --multiView, returns false if the file is invalid
+  void deinit(Resources& res);
+  bool onUi();  // Returns true when the views must be rendered again
+
+  bool       isActive() const { return m_enable && !m_views.empty(); }
+  uint32_t   getNumViews() const { return uint32_t(m_views.size()); }
+  VkExtent2D getSize() const { return m_size; }
+
+  // Before the path tracer: allocates the images and writes the frame info of each view, from the
+  // frame info of the frame (Resources::bFrameInfo)
+  void update(VkCommandBuffer cmd, Resources& res);
+
+  // Address of the SceneFrameInfo array, one per view
+  VkDeviceAddress getFrameInfoAddress() const { return m_bFrameInfos.address; }
+  // Output images of the path tracer: the result and selection arrays
+  std::vector<VkDescriptorImageInfo> getOutputImages() const;
+
+  // After the path tracer: shows the selected view in the rendered and selection images
+  void display(VkCommandBuffer cmd, Resources& res);
+
+  // Result of a view, to be written with ImageOutput
+  ImageOutput::Layer getLayer(uint32_t view) const;
+
+  // One view per line, `{eye}, {center}, {up} [fov]` as copied from the camera widget, # comments
+  static bool parseViews(const std::filesystem::path& filename, std::vector<View>& views);
+
+private:
+  void createImages(VkCommandBuffer cmd, Resources& res);
+
+  std::string       m_filename;             // --multiView
+  glm::uvec2        m_sizeParam{512, 512};  // --multiViewSize
+  bool              m_enable{true};
+  int               m_displayView{0};  // View shown in the viewport
+  std::vector<View> m_views;
+  VkExtent2D        m_size{};
+
+  nvvk::Image  m_images[2];    // See Target, one layer per view
+  nvvk::Buffer m_bFrameInfos;  // shaderio::SceneFrameInfo per view
+};
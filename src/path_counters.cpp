@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Path Tracer Counters
+
+    - The profiler only times the passes; the counters tell why a frame is slow:
+      long paths, alpha-tested geometry calling the any-hit shaders, or costly
+      materials
+    - USE_COUNTERS is a specialization constant of the path tracer: toggling the
+      counters recreates the compute shader and the ray tracing pipeline, the
+      default pipelines do not contain the atomics
+    - Each frame, the buffer is cleared before the path tracer, then copied to
+      one of a ring of host-visible buffers. The host reads the newest copy whose
+      frame is done (deletion queue value signaled), without waiting for the GPU;
+      with all the copies in flight, the counters of a frame are not copied
+    - The counters of the frames are added to the benchmark report
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+
+#include <fmt/format.h>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "path_counters.hpp"
+
+namespace {
+
+// Names of the counters, in the order of shaderio::PathCounterLobe and shaderio::PathCounterFeature
+const char* s_lobeNames[PATH_COUNTER_NUM_LOBES] = {"absorb",          "diffuseReflection", "diffuseTransmission",
+                                                   "glossyReflection", "glossyTransmission", "impulseReflection",
+                                                   "impulseTransmission"};
+const char* s_featureNames[PATH_COUNTER_NUM_FEATURES] = {
+    "alpha",      "emissive",    "unlit",      "transmission",        "volume",     "clearcoat",
+    "sheen",      "iridescence", "anisotropy", "diffuseTransmission", "dispersion", "specularGlossiness"};
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Create the counter buffer and its host-visible copy
+void PathTracerCounters::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  NVVK_CHECK(res.allocator.createBuffer(m_bCounters, sizeof(shaderio::PathCounters),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT
+                                            | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bCounters.buffer);
+  for(Readback& readback : m_readbacks)
+  {
+    NVVK_CHECK(res.allocator.createBuffer(readback.buffer, sizeof(shaderio::PathCounters), VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                          VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+    NVVK_DBG_NAME(readback.buffer.buffer);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the buffers
+void PathTracerCounters::deinit(Resources& res)
+{
+  res.allocator.destroyBuffer(m_bCounters);
+  for(Readback& readback : m_readbacks)
+  {
+    res.allocator.destroyBuffer(readback.buffer);
+    readback.value = 0;
+  }
+  m_hasCounters = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void PathTracerCounters::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"ptCounters", "PathTracer: Count rays, any-hits, terminations, lobes and material features (slower)"},
+                &m_enable, true);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Toggle of the counters, in the path tracer settings
+bool PathTracerCounters::onUi(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  bool changed = false;
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("Performance Counters", &m_enable,
+                            "Count the rays, any-hit invocations, terminations, BSDF lobes and material features "
+                            "(shown in the Path Counters window, slows down the rendering)");
+    PE::end();
+  }
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Counters of a recent frame, per path when it makes sense
+void PathTracerCounters::onUiWindow() const
+{
+  if(!m_enable)
+    return;
+
+  namespace PE = nvgui::PropertyEditor;
+  if(ImGui::Begin("Path Counters"))
+  {
+    if(!m_hasCounters)
+    {
+      ImGui::TextDisabled("Waiting for the first frame");
+    }
+    else
+    {
+      const shaderio::PathCounters& c        = m_counters;
+      const uint32_t                numRays  = c.primaryRays + c.secondaryRays;
+      const double                  paths    = double(std::max(1U, c.primaryRays));
+      const double                  rays     = double(std::max(1U, numRays));
+      const double                  hits     = double(std::max(1U, numRays - std::min(c.environment, numRays)));
+      uint32_t                      bounces  = 0;
+      for(uint32_t lobe : c.lobes)
+        bounces += lobe;
+
+      if(PE::begin("PathCounters"))
+      {
+        PE::Text("Paths", fmt::format("{}", c.primaryRays));
+        PE::Text("Bounce Rays", fmt::format("{} ({:.2f} / path)", c.secondaryRays, c.secondaryRays / paths));
+        PE::Text("Shadow Rays", fmt::format("{} ({:.2f} / path)", c.shadowRays, c.shadowRays / paths));
+        PE::Text("Any-Hit", fmt::format("{:.2f} / ray", c.anyHitMain / rays));
+        PE::Text("Any-Hit Shadow", fmt::format("{:.2f} / ray", c.anyHitShadow / double(std::max(1U, c.shadowRays))));
+        PE::Text("Russian Roulette", fmt::format("{:.1f}% of the paths", 100.0 * c.russianRoulette / paths));
+        PE::Text("Radiance Cache", fmt::format("{:.1f}% of the paths", 100.0 * c.cacheTerminated / paths));
+        PE::Text("Environment", fmt::format("{:.1f}% of the paths", 100.0 * c.environment / paths));
+
+        // Fraction of the paths reaching each depth
+        float depth[PATH_COUNTER_DEPTH_BINS];
+        for(int i = 0; i < PATH_COUNTER_DEPTH_BINS; i++)
+          depth[i] = float(c.depth[i] / paths);
+        PE::entry(
+            "Depth",
+            [&] {
+              ImGui::PlotHistogram("##depth", depth, PATH_COUNTER_DEPTH_BINS, 0, nullptr, 0.0f, 1.0f, ImVec2(0, 60));
+              return false;
+            },
+            "Fraction of the paths reaching each depth, the last bin adds the deeper rays");
+
+        if(PE::treeNode("Sampled Lobes"))
+        {
+          for(int i = 0; i < PATH_COUNTER_NUM_LOBES; i++)
+            PE::Text(s_lobeNames[i], fmt::format("{:.1f}%", 100.0 * c.lobes[i] / double(std::max(1U, bounces))));
+          PE::treePop();
+        }
+        if(PE::treeNode("Material Features"))
+        {
+          for(int i = 0; i < PATH_COUNTER_NUM_FEATURES; i++)
+            PE::Text(s_featureNames[i], fmt::format("{:.1f}% of the hits", 100.0 * c.features[i] / hits));
+          PE::treePop();
+        }
+        PE::end();
+      }
+    }
+  }
+  ImGui::End();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Counters of the most recent frame whose copy is done; the completed copies are freed
+void PathTracerCounters::readCounters(Resources& res)
+{
+  const Readback* newest = nullptr;
+  for(Readback& readback : m_readbacks)
+  {
+    if(readback.value == 0 || !res.deletionQueue.isSignaled(readback.value))
+      continue;
+    if(newest == nullptr || readback.value > newest->value)
+      newest = &readback;
+  }
+  if(newest != nullptr)
+  {
+    vmaInvalidateAllocation(res.allocator, newest->buffer.allocation, 0, VK_WHOLE_SIZE);
+    memcpy(&m_counters, newest->buffer.mapping, sizeof(m_counters));
+    m_hasCounters = true;
+  }
+  for(Readback& readback : m_readbacks)
+  {
+    if(readback.value != 0 && res.deletionQueue.isSignaled(readback.value))
+      readback.value = 0;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Read the counters of a recent frame, then clear them for this frame
+void PathTracerCounters::begin(VkCommandBuffer cmd, Resources& res)
+{
+  if(!m_enable)
+  {
+    // The copies still in flight are not read, they would be stale once enabled again
+    for(Readback& readback : m_readbacks)
+      readback.value = 0;
+    m_hasCounters = false;
+    return;
+  }
+  readCounters(res);
+
+  NVVK_DBG_SCOPE(cmd);
+  // The previous frame is done counting and copying
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdFillBuffer(cmd, m_bCounters.buffer, 0, VK_WHOLE_SIZE, 0);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Copy the counters of the frame to the next buffer of the ring, unless all are in flight
+void PathTracerCounters::end(VkCommandBuffer cmd, Resources& res)
+{
+  Readback& readback = m_readbacks[m_nextReadback];
+  if(!m_enable || readback.value != 0)
+    return;
+  NVVK_DBG_SCOPE(cmd);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  const VkBufferCopy region{.size = sizeof(shaderio::PathCounters)};
+  vkCmdCopyBuffer(cmd, m_bCounters.buffer, readback.buffer.buffer, 1, &region);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_HOST_BIT);
+  readback.value = res.deletionQueue.frameValue();
+  m_nextReadback = (m_nextReadback + 1) % kNumReadbacks;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Counters of a recent frame, for the benchmark report
+std::vector<std::pair<std::string, double>> PathTracerCounters::getNamedCounters() const
+{
+  const shaderio::PathCounters&               c = m_counters;
+  std::vector<std::pair<std::string, double>> values = {
+      {"primaryRays", c.primaryRays},         {"secondaryRays", c.secondaryRays},
+      {"shadowRays", c.shadowRays},           {"anyHitMain", c.anyHitMain},
+      {"anyHitShadow", c.anyHitShadow},       {"russianRoulette", c.russianRoulette},
+      {"cacheTerminated", c.cacheTerminated}, {"environment", c.environment},
+  };
+  for(int i = 0; i < PATH_COUNTER_DEPTH_BINS; i++)
+    values.push_back({fmt::format("depth.{}", i), c.depth[i]});
+  for(int i = 0; i < PATH_COUNTER_NUM_LOBES; i++)
+    values.push_back({fmt::format("lobe.{}", s_lobeNames[i]), c.lobes[i]});
+  for(int i = 0; i < PATH_COUNTER_NUM_FEATURES; i++)
+    values.push_back({fmt::format("feature.{}", s_featureNames[i]), c.features[i]});
+  return values;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include <nvutils/parameter_registry.hpp>
+
+#include "resources.hpp"
+
+
+// Performance counters of the path tracer: rays per kind and depth, any-hit invocations, Russian
+// roulette and cache terminations, sampled BSDF lobes and material features of the hits.
+// The shaders count with atomics into a small buffer (PathtracePushConstant::counters); the counting
+// code is only compiled in when the pipelines are specialized with USE_COUNTERS (see PathTracer).
+// The counters of each frame are copied to one of a ring of host-visible buffers, read once the
+// frame is done.
+class PathTracerCounters
+{
+public:
+  PathTracerCounters() = default;
+  ~PathTracerCounters() { assert(!m_bCounters.buffer && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUi(Resources& res);
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  // Window next to the profiler, with the counters of a recent frame
+  void onUiWindow() const;
+
+  bool isEnabled() const { return m_enable; }
+
+  // Clear the counters, before the path tracer
+  void begin(VkCommandBuffer cmd, Resources& res);
+  // Copy the counters of the frame for the host, after the path tracer
+  void end(VkCommandBuffer cmd, Resources& res);
+
+  // Address of the shaderio::PathCounters, for PathtracePushConstant::counters
+  VkDeviceAddress getAddress() const { return m_bCounters.address; }
+
+  // Counters of a recent frame, named as in the benchmark report
+  bool                                        hasCounters() const { return m_hasCounters; }
+  std::vector<std::pair<std::string, double>> getNamedCounters() const;
+
+private:
+  void readCounters(Resources& res);
+
+  static constexpr uint32_t kNumReadbacks = 4;  // More than the frames in flight
+
+  // Host copy of the counters of a frame
+  struct Readback
+  {
+    nvvk::Buffer buffer;
+    uint64_t     value{0};  // Deletion queue value signaled once the copy is done, 0: free
+  };
+
+  bool m_enable{false};
+
+  nvvk::Buffer                        m_bCounters;  // shaderio::PathCounters, written by the path tracer
+  std::array<Readback, kNumReadbacks> m_readbacks;  // Ring of the copies of m_bCounters
+  uint32_t                            m_nextReadback{0};
+
+  shaderio::PathCounters m_counters{};  // Last counters read back
+  bool                   m_hasCounters{false};
+};
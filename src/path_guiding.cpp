@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Path Guiding
+
+    - Training: for the first frames, the path tracer keeps the vertices of its paths
+      and, when the path ends, writes for each of them the position, the sampled
+      direction and the luminance of the radiance that came back through it, divided
+      by the density of the direction (path_guiding.h.slang)
+    - After 1, 2, 4, .. training frames, the records are read back and the structure
+      is rebuilt: the scene bounds are split at the middle of their longest axis while
+      a node holds more than `spatialThreshold` records, and each leaf gets a histogram
+      of the record weights over equal-area directional bins, mixed with a uniform
+      distribution so that no direction has a null density
+    - Rendering: the directions are sampled from the BSDF or from the leaf of the hit
+      point, and weighted by the one-sample MIS combination of both densities; the
+      estimator stays unbiased, only its variance depends on the training
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <numeric>
+
+#include <fmt/format.h>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "path_guiding.hpp"
+
+namespace shaderio {
+#include "shaders/path_guiding.h"
+}  // namespace shaderio
+
+namespace {
+constexpr float kUniformFraction = 0.1f;  // Share of the uniform distribution in each leaf
+constexpr int   kMaxTreeDepth    = 24;
+
+// Records of a node of the tree under construction
+struct BuildRange
+{
+  uint32_t  begin;
+  uint32_t  end;
+  glm::vec3 boundsMin;
+  glm::vec3 boundsMax;
+  int       depth;
+};
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Create the field buffer, the rest is created when training starts
+void PathGuiding::init(Resources& res)
+{
+  NVVK_CHECK(res.allocator.createBuffer(m_bField, sizeof(shaderio::PathGuidingField),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bField.buffer);
+  m_reset = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the buffers
+void PathGuiding::deinit(Resources& res)
+{
+  res.allocator.destroyBuffer(m_bField);
+  res.allocator.destroyBuffer(m_bNodes);
+  res.allocator.destroyBuffer(m_bCdfs);
+  res.allocator.destroyBuffer(m_bRecords);
+  res.allocator.destroyBuffer(m_bRecordCount);
+  m_bField = {};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void PathGuiding::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"ptGuiding", "PathTracer: Enable path guiding"}, &m_settings.enable, true);
+  paramReg->add({"ptGuidingTraining", "PathTracer: Path guiding, number of training frames"}, &m_settings.trainingFrames);
+  paramReg->add({"ptGuidingThreshold", "PathTracer: Path guiding, records per spatial leaf before splitting"},
+                &m_settings.spatialThreshold);
+  paramReg->add({"ptGuidingResolution", "PathTracer: Path guiding, directional bins per side [4..32]"}, &m_settings.resolution);
+  paramReg->add({"ptGuidingBsdfFraction", "PathTracer: Path guiding, probability of sampling the BSDF"}, &m_settings.bsdfFraction);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Settings of the guiding, returns true if the image must be rendered again
+bool PathGuiding::onUi(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  bool changed = false;
+  bool retrain = false;
+  if(PE::begin())
+  {
+    retrain |= PE::Checkbox("Path Guiding", &m_settings.enable,
+                            "Sample directions from a distribution of the incident radiance learned during the first frames");
+    ImGui::BeginDisabled(!m_settings.enable);
+    retrain |= PE::SliderInt("Training Frames", &m_settings.trainingFrames, 1, 256, "%d", 0,
+                             "Frames recording paths; the structure is rebuilt after 1, 2, 4, .. of them");
+    retrain |= PE::DragInt("Spatial Threshold", &m_settings.spatialThreshold, 100.0f, 100, 1000000, "%d", 0,
+                           "Records per leaf of the spatial tree, before it is split");
+    retrain |= PE::SliderInt("Directional Bins", &m_settings.resolution, 4, 32, "%d", 0,
+                             "Resolution of the directional histograms (per side)");
+    changed |= PE::SliderFloat("BSDF Fraction", &m_settings.bsdfFraction, 0.05f, 0.95f, "%.2f", 0,
+                               "Probability of sampling the BSDF instead of the learned distribution");
+    changed |= PE::SliderFloat("Min Roughness", &m_settings.minRoughness, 0.0f, 1.0f, "%.2f", 0,
+                               "Smoother materials are sampled from their BSDF only");
+    if(m_settings.enable)
+    {
+      const std::string status = (m_frame < m_settings.trainingFrames) ?
+                                     fmt::format("Training {}/{}", m_frame, m_settings.trainingFrames) :
+                                     std::string("Trained");
+      PE::Text("Status", status);
+      PE::Text("Leaves", fmt::format("{} ({} records)", m_numLeaves, m_numRecords));
+    }
+    ImGui::EndDisabled();
+    PE::end();
+  }
+  if(retrain)
+    m_reset = true;
+  return changed || retrain;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Discard the structure: a single leaf with a uniform distribution, and no record
+void PathGuiding::restart(Resources& res)
+{
+  // Training frames in flight may still write the records and their count
+  res.deletionQueue.wait(m_recordsValue);
+
+  m_settings.resolution       = std::clamp(m_settings.resolution, 4, 32);
+  m_settings.trainingFrames   = std::max(m_settings.trainingFrames, 1);
+  m_settings.spatialThreshold = std::max(m_settings.spatialThreshold, 1);
+  m_settings.maxRecords       = std::max(m_settings.maxRecords, 1024);
+
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  const VkDeviceSize  recordsSize = VkDeviceSize(m_settings.maxRecords) * sizeof(shaderio::GuidingRecord);
+  if(m_bRecords.bufferSize != recordsSize)
+  {
+    res.deletionQueue.retire(m_bRecords);
+    NVVK_CHECK(res.allocator.createBuffer(m_bRecords, recordsSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+    NVVK_DBG_NAME(m_bRecords.buffer);
+  }
+  if(!m_bRecordCount.buffer)
+  {
+    NVVK_CHECK(res.allocator.createBuffer(m_bRecordCount, sizeof(uint32_t), VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                          VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+    NVVK_DBG_NAME(m_bRecordCount.buffer);
+  }
+  memset(m_bRecordCount.mapping, 0, sizeof(uint32_t));
+
+  const int numBins = m_settings.resolution * m_settings.resolution;
+  std::vector<float> cdf(numBins);
+  for(int i = 0; i < numBins; i++)
+    cdf[i] = float(i + 1) / float(numBins);
+  upload(res, {{.child = -1, .axis = 0, .split = 0.0f, .leaf = 0}}, cdf);
+
+  m_frame       = 0;
+  m_nextRebuild = 1;
+  m_numLeaves   = 1;
+  m_numRecords  = 0;
+  m_reset       = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the tree and distribution buffers and write them. The frames in flight keep reading the
+// previous ones, whose address is in their field: they go to the deletion queue.
+void PathGuiding::upload(Resources& res, const std::vector<shaderio::GuidingNode>& nodes, const std::vector<float>& cdfs)
+{
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  const VkDeviceSize  nodesSize = nodes.size() * sizeof(shaderio::GuidingNode);
+  const VkDeviceSize  cdfsSize  = cdfs.size() * sizeof(float);
+  res.deletionQueue.retire(m_bNodes);
+  NVVK_CHECK(res.allocator.createBuffer(m_bNodes, nodesSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO,
+                                        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+  NVVK_DBG_NAME(m_bNodes.buffer);
+  res.deletionQueue.retire(m_bCdfs);
+  NVVK_CHECK(res.allocator.createBuffer(m_bCdfs, cdfsSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_AUTO,
+                                        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+  NVVK_DBG_NAME(m_bCdfs.buffer);
+  memcpy(m_bNodes.mapping, nodes.data(), nodesSize);
+  memcpy(m_bCdfs.mapping, cdfs.data(), cdfsSize);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Build the tree and the directional distributions from the records of the training frames
+void PathGuiding::rebuild(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  // The frames writing the records are done (see update), and no frame in flight writes more
+
+  const uint32_t written = *static_cast<const uint32_t*>(m_bRecordCount.mapping);
+  m_numRecords           = std::min(written, uint32_t(m_settings.maxRecords));
+  const auto* records    = static_cast<const shaderio::GuidingRecord*>(m_bRecords.mapping);
+
+  // Spatial tree: the children of a node are consecutive, the leaves are numbered in creation order
+  std::vector<uint32_t> order(m_numRecords);
+  std::iota(order.begin(), order.end(), 0U);
+  std::vector<shaderio::GuidingNode> nodes(1);
+  std::vector<BuildRange>            ranges{{0, m_numRecords, m_boundsMin, m_boundsMax, 0}};
+  std::vector<BuildRange>            leafRanges;
+  for(size_t n = 0; n < nodes.size(); n++)
+  {
+    const BuildRange range  = ranges[n];
+    const glm::vec3  extent = range.boundsMax - range.boundsMin;
+    if(range.end - range.begin > uint32_t(m_settings.spatialThreshold) && range.depth < kMaxTreeDepth)
+    {
+      const int   axis  = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+      const float split = range.boundsMin[axis] + 0.5f * extent[axis];
+      auto middle = std::partition(order.begin() + range.begin, order.begin() + range.end,
+                                   [&](uint32_t r) { return records[r].position[axis] < split; });
+      const uint32_t mid = uint32_t(middle - order.begin());
+
+      BuildRange lower = range;
+      BuildRange upper = range;
+      lower.depth           = range.depth + 1;
+      upper.depth           = range.depth + 1;
+      lower.end             = mid;
+      lower.boundsMax[axis] = split;
+      upper.begin           = mid;
+      upper.boundsMin[axis] = split;
+
+      nodes[n] = {.child = int(nodes.size()), .axis = axis, .split = split, .leaf = -1};
+      nodes.push_back({});
+      nodes.push_back({});
+      ranges.push_back(lower);
+      ranges.push_back(upper);
+    }
+    else
+    {
+      nodes[n] = {.child = -1, .axis = 0, .split = 0.0f, .leaf = int(leafRanges.size())};
+      leafRanges.push_back(range);
+    }
+  }
+
+  // Directional distributions: histogram of the record weights, mixed with the uniform distribution
+  const int          resolution = m_settings.resolution;
+  const int          numBins    = resolution * resolution;
+  std::vector<float> cdfs(leafRanges.size() * numBins);
+  std::vector<double> histogram(numBins);
+  for(size_t leaf = 0; leaf < leafRanges.size(); leaf++)
+  {
+    std::fill(histogram.begin(), histogram.end(), 0.0);
+    double total = 0.0;
+    for(uint32_t i = leafRanges[leaf].begin; i < leafRanges[leaf].end; i++)
+    {
+      const shaderio::GuidingRecord& record = records[order[i]];
+      histogram[shaderio::guidingBin(record.direction, resolution)] += record.weight;
+      total += record.weight;
+    }
+    const double learned = (total > 0.0) ? (1.0 - kUniformFraction) / total : 0.0;
+    const double uniform = (total > 0.0) ? kUniformFraction / numBins : 1.0 / numBins;
+    double       sum     = 0.0;
+    float*       cdf     = &cdfs[leaf * numBins];
+    for(int b = 0; b < numBins; b++)
+    {
+      sum += histogram[b] * learned + uniform;
+      cdf[b] = float(sum);
+    }
+    cdf[numBins - 1] = 1.0f;
+  }
+
+  upload(res, nodes, cdfs);
+  memset(m_bRecordCount.mapping, 0, sizeof(uint32_t));
+  m_numLeaves = int(leafRanges.size());
+  LOGI("Path guiding: %u records (%u written), %d leaves\n", m_numRecords, written, m_numLeaves);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Advance the training, rebuilding the structure when due, and write the field for the frame
+void PathGuiding::update(VkCommandBuffer cmd, Resources& res)
+{
+  NVVK_DBG_SCOPE(cmd);
+
+  if(m_settings.enable)
+  {
+    // The structure covers the scene bounds, slightly enlarged
+    const nvutils::Bbox bounds    = res.scene->getSceneBounds();
+    const glm::vec3     margin    = 0.01f * (bounds.max() - bounds.min()) + 1e-4f;
+    const glm::vec3     boundsMin = bounds.min() - margin;
+    const glm::vec3     boundsMax = bounds.max() + margin;
+    if(boundsMin != m_boundsMin || boundsMax != m_boundsMax)
+    {
+      m_boundsMin = boundsMin;
+      m_boundsMax = boundsMax;
+      m_reset     = true;
+    }
+    if(m_reset)
+      restart(res);
+
+    // Rebuild after 1, 2, 4, .. training frames, and at the end of the training. The records are
+    // read once the frames writing them are done; until then the frames render without recording.
+    if(m_frame > 0 && m_frame == m_nextRebuild && res.deletionQueue.isSignaled(m_recordsValue))
+    {
+      rebuild(res);
+      m_nextRebuild = (m_frame >= m_settings.trainingFrames) ? INT_MAX : std::min(2 * m_frame, m_settings.trainingFrames);
+    }
+  }
+  else
+  {
+    m_reset = true;  // Train again when enabled
+  }
+
+  const bool training   = m_settings.enable && m_frame < m_settings.trainingFrames && m_frame != m_nextRebuild;
+  m_field.enabled       = (m_settings.enable && m_frame > 0) ? 1 : 0;  // Nothing learned before the first rebuild
+  m_field.training      = training ? 1 : 0;
+  m_field.resolution    = m_settings.resolution;
+  m_field.maxRecords    = m_settings.maxRecords;
+  m_field.bsdfFraction  = std::clamp(m_settings.bsdfFraction, 0.05f, 1.0f);
+  m_field.minRoughness  = m_settings.minRoughness;
+  m_field.nodes         = (shaderio::GuidingNode*)m_bNodes.address;
+  m_field.cdfs          = (float*)m_bCdfs.address;
+  m_field.records       = (shaderio::GuidingRecord*)m_bRecords.address;
+  m_field.recordCount   = (uint32_t*)m_bRecordCount.address;
+  if(training)
+  {
+    m_frame++;
+    m_recordsValue = res.deletionQueue.frameValue();
+  }
+
+  // The previous frame is done reading the field, when its path tracing completed
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdUpdateBuffer(cmd, m_bField.buffer, 0, sizeof(m_field), &m_field);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include <nvutils/parameter_registry.hpp>
+
+#include "resources.hpp"
+
+
+// Path guiding for the path tracer: a spatial binary tree over the scene, with in each leaf a
+// directional histogram of the incident radiance (equal-area bins, see shaders/path_guiding.h).
+// During the first frames the path tracer writes its path vertices to a buffer; the structure is
+// rebuilt on the host from them after 1, 2, 4, ... training frames, and the path tracer samples
+// its directions from the BSDF and the structure with multiple importance sampling.
+// The field is described by a small buffer whose address is fixed (PathtracePushConstant::guiding).
+class PathGuiding
+{
+public:
+  struct Settings
+  {
+    bool  enable           = false;
+    int   trainingFrames   = 32;       // Frames writing path vertices, the structure is rebuilt after 1, 2, 4, .. of them
+    int   maxRecords       = 1 << 20;  // Capacity of the record buffer, vertices beyond are dropped
+    int   spatialThreshold = 4000;     // Leaves with more records are split
+    int   resolution       = 16;       // Directional bins per side
+    float bsdfFraction     = 0.5f;     // Probability of sampling the BSDF instead of the guide
+    float minRoughness     = 0.1f;     // Smoother materials are not guided
+  };
+
+  PathGuiding() = default;
+  ~PathGuiding() { assert(!m_bField.buffer && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUi(Resources& res);
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  // Advance the training and write the field for the frame, before the path tracer runs
+  void update(VkCommandBuffer cmd, Resources& res);
+
+  // Address of the shaderio::PathGuidingField, for PathtracePushConstant::guiding
+  VkDeviceAddress getFieldAddress() const { return m_bField.address; }
+
+  void reset() { m_reset = true; }  // Discard the learned structure and train again
+
+private:
+  void restart(Resources& res);
+  void rebuild(Resources& res);
+  void upload(Resources& res, const std::vector<shaderio::GuidingNode>& nodes, const std::vector<float>& cdfs);
+
+  Settings m_settings{};
+
+  nvvk::Buffer m_bField;        // shaderio::PathGuidingField
+  nvvk::Buffer m_bNodes;        // Spatial tree
+  nvvk::Buffer m_bCdfs;         // Directional distributions of the leaves
+  nvvk::Buffer m_bRecords;      // Training path vertices, read by the host
+  nvvk::Buffer m_bRecordCount;  // Number of records written, read by the host
+
+  shaderio::PathGuidingField m_field{};
+  bool                       m_reset{true};
+  int                        m_frame{0};        // Training frame
+  int                        m_nextRebuild{1};  // Training frame after which the structure is rebuilt
+  uint64_t                   m_recordsValue{0}; // Deletion queue value: the last frame writing records is done
+  int                        m_numLeaves{0};
+  uint32_t                   m_numRecords{0};   // Records used by the last rebuild
+  glm::vec3                  m_boundsMin{0.0f};
+  glm::vec3                  m_boundsMax{0.0f};
+};
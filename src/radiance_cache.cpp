@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Radiance Cache
+
+    - The cache is an open-addressing hash table: the hash of a cell (integer
+      position at its level of detail, dominant axis of the normal) gives the first
+      slot, a second hash identifies the cell in the slot
+    - Training: 1 pixel in `trainingRatio` traces full paths; when the path ends,
+      the radiance leaving each rough vertex toward the previous one is added to its
+      cell, in fixed point with atomics
+    - Termination: the other paths stop on the first rough surface reached after
+      `terminateDepth` bounces whose cell has enough samples, adding the cached
+      radiance; this biases the result a little, for much shorter paths
+    - Resolve (radiance_cache.comp.slang): the samples of the frame are blended in
+      the cached radiance, entries without samples for `maxAge` frames are freed
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include <nvgui/property_editor.hpp>
+#include <nvutils/camera_manipulator.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "radiance_cache.hpp"
+
+// Pre-compiled shader
+#include "_autogen/radiance_cache.comp.slang.h"
+
+//--------------------------------------------------------------------------------------------------
+// Create the resolve shader and the grid buffer. The entries are created on first use.
+void RadianceCache::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  VkDevice device = res.allocator.getDevice();
+
+  VkPushConstantRange pushConstant = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::RadianceCachePushConstant)};
+
+  VkPipelineLayoutCreateInfo plCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreatePipelineLayout(device, &plCreateInfo, nullptr, &m_pipelineLayout));
+  NVVK_DBG_NAME(m_pipelineLayout);
+
+  VkShaderCreateInfoEXT shaderCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+      .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
+      .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+      .codeSize               = radiance_cache_comp_slang_sizeInBytes,
+      .pCode                  = radiance_cache_comp_slang,
+      .pName                  = "main",
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_shader));
+  NVVK_DBG_NAME(m_shader);
+
+  NVVK_CHECK(res.allocator.createBuffer(m_bGrid, sizeof(shaderio::RadianceCacheGrid),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bGrid.buffer);
+  m_reset = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the buffers and the shader
+void RadianceCache::deinit(Resources& res)
+{
+  VkDevice device = res.allocator.getDevice();
+  res.allocator.destroyBuffer(m_bGrid);
+  res.allocator.destroyBuffer(m_bKeys);
+  res.allocator.destroyBuffer(m_bEntries);
+  vkDestroyShaderEXT(device, m_shader, nullptr);
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  m_shader         = {};
+  m_pipelineLayout = {};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void RadianceCache::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"ptRadianceCache", "PathTracer: Terminate the paths in the radiance cache"}, &m_settings.enable, true);
+  paramReg->add({"ptCacheQuality", "PathTracer: Radiance cache quality [Performance:0, Quality:1]"}, &m_settings.quality);
+  paramReg->add({"ptCacheCellSize", "PathTracer: Radiance cache cell size, relative to the scene radius"}, &m_settings.cellScale);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Settings of the cache, returns true if the image must be rendered again
+bool RadianceCache::onUi(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  bool changed = false;
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("Radiance Cache", &m_settings.enable,
+                            "Terminate the paths in a world-space cache of the radiance leaving the surfaces (biased, faster)");
+    ImGui::BeginDisabled(!m_settings.enable);
+    changed |= PE::Combo("Cache Quality", &m_settings.quality, "Performance\0Quality\0\0", -1,
+                         "Performance: terminate after the first bounce. Quality: after the second, with finer cells");
+    changed |= PE::SliderFloat("Cell Size", &m_settings.cellScale, 0.0005f, 0.05f, "%.4f", ImGuiSliderFlags_Logarithmic,
+                               "Size of the cells near the camera, relative to the scene radius; cells grow with the distance");
+    changed |= PE::SliderInt("Capacity (log2)", &m_settings.capacityLog2, 16, 23, "%d", 0, "Number of entries of the hash table");
+    changed |= PE::SliderFloat("Temporal Samples", &m_settings.maxSamples, 4.0f, 1024.0f, "%.0f", ImGuiSliderFlags_Logarithmic,
+                               "Number of samples averaged per cell: lower adapts faster to changes, higher is less noisy");
+    changed |= PE::SliderFloat("Min Roughness", &m_settings.minRoughness, 0.0f, 1.0f, "%.2f", 0,
+                               "Paths only terminate on rougher surfaces, where the radiance barely depends on the view");
+    ImGui::EndDisabled();
+    PE::end();
+  }
+  if(changed)
+    m_reset = true;
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// (Re)create the hash table for its capacity
+void RadianceCache::allocateEntries(Resources& res, uint32_t capacity)
+{
+  if(m_bKeys.bufferSize == VkDeviceSize(capacity) * sizeof(uint32_t))
+    return;
+
+  // The previous frames may still be using the cache
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  res.deletionQueue.retire(m_bKeys);
+  res.deletionQueue.retire(m_bEntries);
+  NVVK_CHECK(res.allocator.createBuffer(m_bKeys, VkDeviceSize(capacity) * sizeof(uint32_t),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bKeys.buffer);
+  NVVK_CHECK(res.allocator.createBuffer(m_bEntries, VkDeviceSize(capacity) * sizeof(shaderio::RadianceCacheEntry),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bEntries.buffer);
+  m_reset = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the grid for the camera of the frame, emptying the cache when needed
+void RadianceCache::update(VkCommandBuffer cmd, Resources& res)
+{
+  NVVK_DBG_SCOPE(cmd);
+
+  // The cell size follows the scene, a new scene starts from an empty cache
+  const float sceneRadius = res.scene->valid() ? res.scene->getSceneBounds().radius() : 1.0f;
+  if(sceneRadius != m_sceneRadius)
+  {
+    m_sceneRadius = sceneRadius;
+    m_reset       = true;
+  }
+
+  const bool quality    = m_settings.quality == eQuality;
+  m_grid.enabled        = m_settings.enable ? 1 : 0;
+  m_grid.terminateDepth = quality ? 2 : 1;
+  m_grid.trainingRatio  = quality ? 8 : 16;
+  m_grid.cameraPosition = res.cameraManip->getEye();
+  m_grid.cellSize       = std::max(m_settings.cellScale * sceneRadius * (quality ? 0.5f : 1.0f), 1e-6f);
+  m_grid.lodDistance    = m_grid.cellSize * 128.0f;  // Further, the cells cover about the same angle
+  m_grid.minRoughness   = m_settings.minRoughness;
+  m_grid.maxSamples     = std::max(m_settings.maxSamples, 1.0f);
+  m_grid.maxAge         = 64;
+
+  if(m_settings.enable)
+  {
+    m_settings.capacityLog2 = std::clamp(m_settings.capacityLog2, 16, 23);  // Dispatch limit of the resolve
+    m_grid.capacity         = 1U << m_settings.capacityLog2;
+    allocateEntries(res, m_grid.capacity);
+  }
+  m_grid.keys    = (uint32_t*)m_bKeys.address;
+  m_grid.entries = (shaderio::RadianceCacheEntry*)m_bEntries.address;
+
+  // The previous frame is done reading the grid and the cache, when its path tracing and resolve completed
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  vkCmdUpdateBuffer(cmd, m_bGrid.buffer, 0, sizeof(m_grid), &m_grid);
+  if(m_settings.enable && m_reset)
+  {
+    vkCmdFillBuffer(cmd, m_bKeys.buffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(cmd, m_bEntries.buffer, 0, VK_WHOLE_SIZE, 0);
+    m_reset = false;
+  }
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Blend the samples of the frame into the cache, one thread per entry
+void RadianceCache::resolve(VkCommandBuffer cmd)
+{
+  if(!m_settings.enable)
+    return;
+  NVVK_DBG_SCOPE(cmd);
+
+  // The path tracer is done adding samples
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+  const shaderio::RadianceCachePushConstant pushConstant{.grid = (shaderio::RadianceCacheGrid*)m_bGrid.address};
+  const VkShaderStageFlagBits               stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  vkCmdBindShadersEXT(cmd, 1, &stage, &m_shader);
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+  vkCmdDispatch(cmd, (m_grid.capacity + RADIANCE_CACHE_WORKGROUP_SIZE - 1) / RADIANCE_CACHE_WORKGROUP_SIZE, 1, 1);
+
+  // The next frame reads the cache
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include <nvutils/parameter_registry.hpp>
+
+#include "resources.hpp"
+
+
+// World-space radiance cache of the path tracer: a hash grid of the radiance leaving the surfaces,
+// keyed by the quantized position and normal (see shaders/radiance_cache.h.slang).
+// A few pixels per frame trace full paths and add the radiance leaving their vertices to the cache;
+// the other paths terminate in the cache on the first rough surface after `terminateDepth` bounces.
+// After the path tracer, a compute pass blends the samples of the frame into the cache.
+// The grid is described by a small buffer whose address is fixed (PathtracePushConstant::radianceCache).
+class RadianceCache
+{
+public:
+  enum Quality
+  {
+    ePerformance,  // Terminate after the first bounce
+    eQuality,      // Terminate after the second bounce, finer cells, more training paths
+  };
+
+  struct Settings
+  {
+    bool  enable       = false;
+    int   quality      = ePerformance;  // See Quality
+    float cellScale    = 0.005f;        // Size of the cells near the camera, relative to the scene radius
+    int   capacityLog2 = 20;            // log2 of the number of entries [16..23]
+    float maxSamples   = 64.0f;         // Temporal blending: number of samples averaged
+    float minRoughness = 0.3f;          // Paths only terminate on rougher surfaces
+  };
+
+  RadianceCache() = default;
+  ~RadianceCache() { assert(!m_shader && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUi(Resources& res);
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  bool isEnabled() const { return m_settings.enable; }
+
+  // Write the grid for the frame, before the path tracer runs
+  void update(VkCommandBuffer cmd, Resources& res);
+
+  // Blend the samples written by the path tracer into the cache
+  void resolve(VkCommandBuffer cmd);
+
+  // Address of the shaderio::RadianceCacheGrid, for PathtracePushConstant::radianceCache
+  VkDeviceAddress getGridAddress() const { return m_bGrid.address; }
+
+  void reset() { m_reset = true; }  // Empty the cache
+
+private:
+  void allocateEntries(Resources& res, uint32_t capacity);
+
+  Settings m_settings{};
+
+  nvvk::Buffer m_bGrid;     // shaderio::RadianceCacheGrid
+  nvvk::Buffer m_bKeys;     // Checksum of the cell of each entry
+  nvvk::Buffer m_bEntries;  // shaderio::RadianceCacheEntry
+
+  shaderio::RadianceCacheGrid m_grid{};
+  bool                        m_reset{true};
+  float                       m_sceneRadius{0.0f};
+
+  VkShaderEXT      m_shader{};
+  VkPipelineLayout m_pipelineLayout{};
+};
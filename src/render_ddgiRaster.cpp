@@ -6,6 +6,7 @@
 #include <nvvk/helpers.hpp>
 #include <nvvk/commands.hpp>
 #include "render_ddgiRaster.hpp"
+#include "trace_export.hpp"
 
 // Pre-compiled shaders
 #include "_autogen/gltf_raster.slang.h"
@@ -32,6 +33,20 @@ void DDGIRasterizer::onAttach(Resources& resources, nvvk::ProfilerGpuTimer* prof
 	m_device = resources.allocator.getDevice();
 	m_commandPool = resources.commandPool;
 	m_skyPhysical.init(&resources.allocator, std::span(sky_physical_slang));
+	m_taa.init(resources);
+	m_lightClusters.init(resources);
+
+	const VkSamplerCreateInfo samplerInfo{
+		.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter    = VK_FILTER_NEAREST,
+		.minFilter    = VK_FILTER_NEAREST,
+		.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+	};
+	NVVK_CHECK(resources.samplerPool.acquireSampler(m_gbufferSampler, samplerInfo));
+	NVVK_DBG_NAME(m_gbufferSampler);
 	compileShader(resources, false);  // Compile the shader
 	createRecordCommandBuffer();
 	
@@ -57,6 +72,9 @@ void DDGIRasterizer::onDetach(Resources& resources)
 	vkDestroyShaderEXT(m_device, m_wireframeShader, nullptr);
 
 	m_skyPhysical.deinit();
+	m_taa.deinit(resources);
+	m_lightClusters.deinit(resources);
+	resources.samplerPool.releaseSampler(m_gbufferSampler);
 }
 
 void DDGIRasterizer::onResize(VkCommandBuffer cmd, const VkExtent2D& size, Resources& resources)
@@ -74,8 +92,10 @@ bool DDGIRasterizer::onUIRender(Resources& resources)
 		PE::Checkbox("Use Recorded Cmd", &m_useRecordedCmd, "Use recorded command buffers for better performance");
 		PE::end();
 	}
+	changed |= m_taa.onUIRender(resources);
+	changed |= m_lightClusters.onUIRender(resources);
 
-	return false;
+	return changed;
 }
 
 
@@ -83,162 +103,234 @@ void DDGIRasterizer::onRender(VkCommandBuffer cmd, Resources& resources)
 {
 	NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
 
-	// ӡColorAttachementĵַ
-	//LOGI("gBuffer:%p\n", (void*)resources.gBuffers.getColorImage(0));
-	//LOGI("gBufferDefer0:%p\n", (void*)resources.gBuffersDefer.getColorImage(0));
-	//LOGI("gBufferDefer1:%p\n", (void*)resources.gBuffersDefer.getColorImage(1));
-	//LOGI("gBufferDefer2:%p\n", (void*)resources.gBuffersDefer.getColorImage(2));
-
-	// Rendering the environment, gbuffer
-	if (!resources.settings.useSolidBackground)
+	// The recorded scene depends on the TAA targets and on the address of the previous matrices
+	bool recordChanged = m_taa.update(cmd, resources);
+	recordChanged |= m_taa.updateTransforms(cmd, resources);
+	if (recordChanged)
 	{
-		glm::mat4 viewMatrix = resources.cameraManip->getViewMatrix();
-		glm::mat4 projMatrix = resources.cameraManip->getPerspectiveMatrix();
-
-		// Rendering dome or sky in the background, it is covering the entire screen
-		if (resources.settings.envSystem == shaderio::EnvSystem::eSky)
-		{
-			m_skyPhysical.runCompute(cmd, resources.gBuffers.getSize(), viewMatrix, projMatrix, resources.skyParams,
-				resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
-		}
-		else if (resources.settings.envSystem == shaderio::EnvSystem::eHdr)
-		{
-			resources.hdrDome.draw(cmd, viewMatrix, projMatrix, resources.gBuffers.getSize(), glm::vec4(resources.settings.hdrEnvIntensity),
-				resources.settings.hdrEnvRotation, resources.settings.hdrBlur);
-		}
+		freeRecordCommandBuffer();
 	}
-	// mrtgbufferDefer
-	nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-	{
-		VkRenderingAttachmentInfo renderingInfo_gbuffer = DEFAULT_VkRenderingAttachmentInfo;
-
-		renderingInfo_gbuffer.clearValue = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-		renderingInfo_gbuffer.loadOp = resources.settings.useSolidBackground ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-		// 1 - Selection attachment
-
-		// Two attachments, one for color and one for selection
-		std::array<VkRenderingAttachmentInfo, 3> attachments = { {renderingInfo_gbuffer, renderingInfo_gbuffer, renderingInfo_gbuffer} };
-		// 0 - Color attachment
-		attachments[0].imageView = resources.gBuffersDefer.getColorImageView((uint32_t)Resources::EGbuffer::epos); //resources.gBuffers.getColorImageView(Resources::eImgRendered);
-		attachments[1].imageView = resources.gBuffersDefer.getColorImageView((uint32_t)Resources::EGbuffer::enorm);
-		attachments[2].imageView = resources.gBuffersDefer.getColorImageView((uint32_t)Resources::EGbuffer::euv);
-		// 1 - Selection attachment
-		// attachments[1].imageView = resources.gBuffers.getColorImageView(Resources::eImgSelection);
-		// X - Depth
-		VkRenderingAttachmentInfo depthAttachment = DEFAULT_VkRenderingAttachmentInfo;
-		depthAttachment.imageView = resources.gBuffersDefer.getDepthImageView();
-		depthAttachment.clearValue = { .depthStencil = DEFAULT_VkClearDepthStencilValue };
-
-
-		// Setting up the push constant
-		m_pushConst.frameInfo = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
-		m_pushConst.skyParams = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
-		m_pushConst.gltfScene = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
-		m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
-		vkCmdPushConstants(cmd, m_MRTPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
-
-
-		// Create the rendering info
-		VkRenderingInfo renderingInfo = DEFAULT_VkRenderingInfo;
-		renderingInfo.flags = m_useRecordedCmd ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0,
-			renderingInfo.renderArea = DEFAULT_VkRect2D(resources.gBuffersDefer.getSize());
-		renderingInfo.colorAttachmentCount = uint32_t(attachments.size());
-		renderingInfo.pColorAttachments = attachments.data();
-		renderingInfo.pDepthAttachment = &depthAttachment;
-
-		// Scene is recorded to avoid CPU overhead
-		if (m_recordedSceneCmd == VK_NULL_HANDLE && m_useRecordedCmd)
-		{
-			recordRasterScene(resources);
-		}
-
 
-		// ** BEGIN RENDERING **
-		vkCmdBeginRendering(cmd, &renderingInfo);
-
-		if (m_useRecordedCmd && m_recordedSceneCmd != VK_NULL_HANDLE)
-		{
-			vkCmdExecuteCommands(cmd, 1, &m_recordedSceneCmd);  // Execute the recorded command buffer
-		}
-		else
-		{
-			renderRasterScene(cmd, resources);  // Render the scene
-		}
-		
-
-		vkCmdEndRendering(cmd);
-
-		// copy from defer to gbuffer:
-		//{
-		//	// Blit the selection image from the DLSS GBuffer (different resolution) to the Renderer GBuffer Selection
-		//	VkOffset3D  minCorner = { 0, 0, 0 };
-		//	VkImageBlit blitRegions{
-		//		.srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
-		//		.srcOffsets = {minCorner, {int(resources.gBuffersDefer.getSize().width), int(resources.gBuffersDefer.getSize().height), 1}},
-		//		.dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
-		//		.dstOffsets = {minCorner, {int(resources.gBuffers.getSize().width), int(resources.gBuffers.getSize().height), 1}},
-		//	};
-		//	vkCmdBlitImage(cmd, resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::epos),
-		//		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, resources.gBuffers.getColorImage(Resources::eImgRendered),
-		//		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1, &blitRegions, VK_FILTER_LINEAR);
-		//}
-
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::epos), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::enorm), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::euv), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
-	
+	// The passes are added to the frame graph: the MRT pass renders in transient images at the render
+	// resolution, the composition in the G-Buffer, or in the TAA color target
+	FrameGraph&          graph      = resources.frameGraph;
+	const bool           useTaa     = m_taa.isActive();
+	const nvvk::GBuffer& targets    = useTaa ? m_taa.getTargets() : resources.gBuffers;
+	const uint32_t       colorIndex = useTaa ? uint32_t(TemporalAA::eTargetColor) : uint32_t(Resources::eImgRendered);
+	const VkExtent2D     renderSize = m_taa.getRenderSize(resources);
+
+	using Usage = FrameGraph::Usage;
+	const FrameGraph::ResourceId frameInfo = graph.importBuffer("FrameInfo", resources.bFrameInfo.buffer);
+	const FrameGraph::ResourceId skyParams = graph.importBuffer("SkyParams", resources.bSkyParams.buffer);
+	const FrameGraph::ResourceId rendered =
+		graph.importImage("Rendered", resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL);
+	const FrameGraph::ResourceId color = graph.importImage("Color", targets.getColorImage(colorIndex), VK_IMAGE_LAYOUT_GENERAL);
+	const FrameGraph::ResourceId motion =
+		useTaa ? graph.importImage("Motion", targets.getColorImage(TemporalAA::eTargetMotion), VK_IMAGE_LAYOUT_GENERAL) : 0;
+	const FrameGraph::ResourceId position = graph.createImage("GBufferPosition", {VK_FORMAT_R32G32B32A32_SFLOAT, renderSize});
+	const FrameGraph::ResourceId normal   = graph.createImage("GBufferNormal", {VK_FORMAT_R32G32B32A32_SFLOAT, renderSize});
+	const FrameGraph::ResourceId texCoord = graph.createImage("GBufferTexCoord", {VK_FORMAT_R32G32B32A32_SFLOAT, renderSize});
+	const FrameGraph::ResourceId depth    = graph.createImage("GBufferDepth", {resources.gBuffers.getDepthFormat(), renderSize});
+
+	// Light lists of the clusters, used by the composition
+	graph.addPass(
+		"Light clusters", [&](FrameGraph::PassBuilder& pass) { pass.sideEffect(); },
+		[this, &resources, renderSize](VkCommandBuffer cmd) { m_lightClusters.update(cmd, resources, renderSize); });
+
+	// Rendering the environment, in the color target
+	if (!resources.settings.useSolidBackground)
+	{
+		graph.addPass(
+			"Environment",
+			[&](FrameGraph::PassBuilder& pass) {
+				pass.read(skyParams, Usage::eShaderRead, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+				pass.write(color, Usage::eStorage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+			},
+			[this, &resources, &targets, useTaa, colorIndex, renderSize](VkCommandBuffer cmd) {
+				glm::mat4 viewMatrix = resources.cameraManip->getViewMatrix();
+				glm::mat4 projMatrix = resources.cameraManip->getPerspectiveMatrix();
+
+				// Rendering dome or sky in the background, it is covering the entire screen
+				if (resources.settings.envSystem == shaderio::EnvSystem::eSky)
+				{
+					m_skyPhysical.runCompute(cmd, renderSize, viewMatrix, projMatrix, resources.skyParams,
+						targets.getDescriptorImageInfo(colorIndex));
+				}
+				else if (resources.settings.envSystem == shaderio::EnvSystem::eHdr)
+				{
+					resources.hdrDome->draw(cmd, viewMatrix, projMatrix, renderSize, glm::vec4(resources.settings.hdrEnvIntensity),
+						resources.settings.hdrEnvRotation, resources.settings.hdrBlur);
+					if (useTaa)
+						m_taa.copyEnvironment(cmd, resources);
+				}
+			});
 	}
 
+	// MRT: position, normal and texture coordinates of the visible surfaces
+	graph.addPass(
+		"Raster MRT",
+		[&](FrameGraph::PassBuilder& pass) {
+			pass.read(frameInfo, Usage::eShaderRead, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+			pass.read(skyParams, Usage::eShaderRead, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+			pass.write(position, Usage::eColorAttachment, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+			pass.write(normal, Usage::eColorAttachment, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+			pass.write(texCoord, Usage::eColorAttachment, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+			pass.write(depth, Usage::eDepthAttachment,
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT);
+			if (useTaa)
+				pass.write(motion, Usage::eColorAttachment, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+		},
+		[this, &resources, &graph, &targets, useTaa, renderSize, position, normal, texCoord, depth](VkCommandBuffer cmd) {
+			auto timerSection = m_profiler->cmdFrameSection(cmd, "Raster MRT");
+			auto traceSection = g_traceExport.cmdSection(cmd, "Raster MRT");
+
+			VkRenderingAttachmentInfo renderingInfo_gbuffer = DEFAULT_VkRenderingAttachmentInfo;
+
+			// Cleared to zero: the composition keeps the background where nothing was rendered (w == 0)
+			renderingInfo_gbuffer.clearValue  = { {{0.0f, 0.0f, 0.0f, 0.0f}} };
+			renderingInfo_gbuffer.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			renderingInfo_gbuffer.imageLayout = FrameGraph::getLayout(Usage::eColorAttachment);
+
+			std::array<VkRenderingAttachmentInfo, 4> attachments = { {renderingInfo_gbuffer, renderingInfo_gbuffer, renderingInfo_gbuffer, renderingInfo_gbuffer} };
+			attachments[0].imageView = graph.getImageView(position);
+			attachments[1].imageView = graph.getImageView(normal);
+			attachments[2].imageView = graph.getImageView(texCoord);
+			// 3 - Motion vectors, only written with TAA
+			attachments[3].imageView = useTaa ? targets.getColorImageView(TemporalAA::eTargetMotion) : VK_NULL_HANDLE;
+			// X - Depth
+			VkRenderingAttachmentInfo depthAttachment = DEFAULT_VkRenderingAttachmentInfo;
+			depthAttachment.imageView   = graph.getImageView(depth);
+			depthAttachment.imageLayout = FrameGraph::getLayout(Usage::eDepthAttachment);
+			depthAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			depthAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			depthAttachment.clearValue  = { .depthStencil = DEFAULT_VkClearDepthStencilValue };
+
+
+			// Setting up the push constant
+			m_pushConst.frameInfo = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
+			m_pushConst.skyParams = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
+			m_pushConst.gltfScene = (shaderio::GltfScene*)resources.sceneVk->sceneDesc().address;
+			m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+			m_pushConst.prevObjectToWorld = (glm::mat4*)m_taa.getPrevTransformsAddress();
+			m_pushConst.lightClusters = (shaderio::LightClusterGrid*)m_lightClusters.getGridAddress();
+			vkCmdPushConstants(cmd, m_MRTPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
+
+
+			// Create the rendering info
+			VkRenderingInfo renderingInfo = DEFAULT_VkRenderingInfo;
+			renderingInfo.flags = m_useRecordedCmd ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0,
+				renderingInfo.renderArea = DEFAULT_VkRect2D(renderSize);
+			renderingInfo.colorAttachmentCount = uint32_t(attachments.size());
+			renderingInfo.pColorAttachments = attachments.data();
+			renderingInfo.pDepthAttachment = &depthAttachment;
+
+			// Scene is recorded to avoid CPU overhead
+			if (m_recordedSceneCmd == VK_NULL_HANDLE && m_useRecordedCmd)
+			{
+				recordRasterScene(resources);
+			}
+
+
+			// ** BEGIN RENDERING **
+			vkCmdBeginRendering(cmd, &renderingInfo);
+
+			if (m_useRecordedCmd && m_recordedSceneCmd != VK_NULL_HANDLE)
+			{
+				vkCmdExecuteCommands(cmd, 1, &m_recordedSceneCmd);  // Execute the recorded command buffer
+			}
+			else
+			{
+				renderRasterScene(cmd, resources);  // Render the scene
+			}
+
+			vkCmdEndRendering(cmd);
+		});
+
+	// Composition: shading of the MRT images, over the environment
+	graph.addPass(
+		"Raster composition",
+		[&](FrameGraph::PassBuilder& pass) {
+			pass.read(frameInfo, Usage::eShaderRead, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+			pass.read(position, Usage::eSampled, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+			pass.read(normal, Usage::eSampled, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+			pass.read(texCoord, Usage::eSampled, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+			if (resources.settings.useSolidBackground)
+				pass.write(color, Usage::eColorAttachment, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+			else
+				pass.readWrite(color, Usage::eColorAttachment, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+		},
+		[this, &resources, &graph, &targets, colorIndex, renderSize, position, normal, texCoord](VkCommandBuffer cmd) {
+			auto timerSection = m_profiler->cmdFrameSection(cmd, "Raster composition");
+			auto traceSection = g_traceExport.cmdSection(cmd, "Raster composition");
+
+			// The transient images were reallocated: the frames in flight may still use the descriptor set,
+			// the other one is written. It was last used before the previous reallocation, normally done.
+			if (m_gbufferVersion != graph.getTransientVersion())
+			{
+				const uint32_t next = 1 - m_gbufferSetIndex;
+				m_gbufferSetValues[m_gbufferSetIndex] = resources.deletionQueue.frameValue();
+				if (!resources.deletionQueue.isSignaled(m_gbufferSetValues[next]))
+					resources.deletionQueue.wait(m_gbufferSetValues[next]);
+				const std::array<FrameGraph::ResourceId, 3> images = { position, normal, texCoord };
+				std::array<VkDescriptorImageInfo, 3>        imageInfos{};
+				std::array<VkWriteDescriptorSet, 3>         writes{};
+				for (uint32_t i = 0; i < 3; i++)
+				{
+					imageInfos[i] = { .sampler     = m_gbufferSampler,
+									  .imageView   = graph.getImageView(images[i]),
+									  .imageLayout = FrameGraph::getLayout(Usage::eSampled) };
+					writes[i]     = { .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+									  .dstSet          = resources.gbufferDescSets[next],
+									  .dstBinding      = i,
+									  .descriptorCount = 1,
+									  .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+									  .pImageInfo      = &imageInfos[i] };
+				}
+				vkUpdateDescriptorSets(m_device, uint32_t(writes.size()), writes.data(), 0, nullptr);
+				m_gbufferVersion         = graph.getTransientVersion();
+				m_gbufferSetIndex        = next;
+				resources.gbufferDescSet = resources.gbufferDescSets[next];
+			}
+
+			VkRenderingAttachmentInfo renderingInfo_gbuffer = DEFAULT_VkRenderingAttachmentInfo;
+
+			renderingInfo_gbuffer.clearValue  = { {{0.0f, 0.0f, 0.0f, 0.0f}} };
+			renderingInfo_gbuffer.loadOp      = resources.settings.useSolidBackground ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+			renderingInfo_gbuffer.imageLayout = FrameGraph::getLayout(Usage::eColorAttachment);
+
+			std::array<VkRenderingAttachmentInfo, 1> attachments = { {renderingInfo_gbuffer} };
+			// 0 - Color attachment
+			attachments[0].imageView = targets.getColorImageView(colorIndex);
+			// X - Depth
+			VkRenderingAttachmentInfo depthAttachment = DEFAULT_VkRenderingAttachmentInfo;
+			depthAttachment.imageView = targets.getDepthImageView();
+			depthAttachment.clearValue = { .depthStencil = DEFAULT_VkClearDepthStencilValue };
+
+			// Setting up the push constant
+			m_pushConst.frameInfo = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
+			m_pushConst.skyParams = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
+			m_pushConst.gltfScene = (shaderio::GltfScene*)resources.sceneVk->sceneDesc().address;
+			m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+			m_pushConst.lightClusters = (shaderio::LightClusterGrid*)m_lightClusters.getGridAddress();
+			vkCmdPushConstants(cmd, m_COMPPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
+
+			// Create the rendering info
+			VkRenderingInfo renderingInfo = DEFAULT_VkRenderingInfo;
+			renderingInfo.flags = m_useRecordedCmd ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0,
+				renderingInfo.renderArea = DEFAULT_VkRect2D(renderSize);
+			renderingInfo.colorAttachmentCount = uint32_t(attachments.size());
+			renderingInfo.pColorAttachments = attachments.data();
+			renderingInfo.pDepthAttachment = &depthAttachment;
+
+			// ** BEGIN RENDERING **
+			vkCmdBeginRendering(cmd, &renderingInfo);
 
-
-
-	nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  VK_IMAGE_LAYOUT_GENERAL });
-	// Composition - gbuffer
-	{
-		VkRenderingAttachmentInfo renderingInfo_gbuffer = DEFAULT_VkRenderingAttachmentInfo;
-	
-		renderingInfo_gbuffer.clearValue = { {{0.0f, 0.0f, 0.0f, 0.0f}} };
-		renderingInfo_gbuffer.loadOp = resources.settings.useSolidBackground ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-		// 1 - Selection attachment
-	
-		// Two attachments, one for color and one for selection
-		std::array<VkRenderingAttachmentInfo, 1> attachments = { {renderingInfo_gbuffer} };
-		// 0 - Color attachment
-		attachments[0].imageView = resources.gBuffers.getColorImageView(Resources::eImgRendered);
-		// 1 - Selection attachment
-		// attachments[1].imageView = resources.gBuffers.getColorImageView(Resources::eImgSelection);
-		// X - Depth
-		VkRenderingAttachmentInfo depthAttachment = DEFAULT_VkRenderingAttachmentInfo;
-		depthAttachment.imageView = resources.gBuffers.getDepthImageView();
-		depthAttachment.clearValue = { .depthStencil = DEFAULT_VkClearDepthStencilValue };
-	
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		// Setting up the push constant
-		m_pushConst.frameInfo = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
-		m_pushConst.skyParams = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
-		m_pushConst.gltfScene = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
-		m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
-		vkCmdPushConstants(cmd, m_COMPPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
-	
-		// Create the rendering info
-		VkRenderingInfo renderingInfo = DEFAULT_VkRenderingInfo;
-		renderingInfo.flags = m_useRecordedCmd ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0,
-			renderingInfo.renderArea = DEFAULT_VkRect2D(resources.gBuffers.getSize());
-		renderingInfo.colorAttachmentCount = uint32_t(attachments.size());
-		renderingInfo.pColorAttachments = attachments.data();
-		renderingInfo.pDepthAttachment = &depthAttachment;
-	
-		// ** BEGIN RENDERING **
-		vkCmdBeginRendering(cmd, &renderingInfo);
-	
-		{
-			
 			// All dynamic states are set here
 			m_COMPPipeline.cmdApplyAllStates(cmd);
-			m_COMPPipeline.cmdSetViewportAndScissor(cmd, resources.gBuffers.getSize());
+			m_COMPPipeline.cmdSetViewportAndScissor(cmd, renderSize);
 			m_COMPPipeline.cmdBindShaders(cmd, { .vertex = m_COMPvertexShader, .fragment = m_COMPfragmentShader });
 			vkCmdSetDepthTestEnable(cmd, VK_TRUE);
-	
+
 			// Bind the descriptor set: textures (Set: 0)
 			std::array<VkDescriptorSet, 2> descriptorSets{ resources.gbufferDescSet,  resources.descriptorSet };
 			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_COMPPipelineLayout, 0, descriptorSets.size(), descriptorSets.data(), 0, nullptr);
@@ -248,20 +340,22 @@ void DDGIRasterizer::onRender(VkCommandBuffer cmd, Resources& resources)
 			// finally composition
 			vkCmdSetVertexInputEXT(cmd, 0, nullptr, 0, nullptr);
 			vkCmdDraw(cmd, 3, 1, 0, 0);
-			
-		}
-		
-	
-		vkCmdEndRendering(cmd);
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::epos), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::enorm), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::euv), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-	
-		nvvk::cmdImageMemoryBarrier(cmd, { resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,  VK_IMAGE_LAYOUT_GENERAL });
-	
-	
-	}
 
+			vkCmdEndRendering(cmd);
+		});
+
+	// Accumulate the jittered frame and upscale it to the G-Buffer (the selection is not rendered by the MRT pass)
+	if (useTaa)
+	{
+		graph.addPass(
+			"TAA resolve",
+			[&](FrameGraph::PassBuilder& pass) {
+				pass.read(color, Usage::eGeneral, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+				pass.read(motion, Usage::eGeneral, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+				pass.write(rendered, Usage::eGeneral, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+			},
+			[this, &resources](VkCommandBuffer cmd) { m_taa.resolve(cmd, resources, false); });
+	}
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -274,8 +368,8 @@ void DDGIRasterizer::renderNodes(VkCommandBuffer cmd, Resources& resources, cons
 {
 	NVVK_DBG_SCOPE(cmd);
 
-	nvvkgltf::Scene& scene = resources.scene;
-	nvvkgltf::SceneVk& sceneVk = resources.sceneVk;
+	nvvkgltf::Scene& scene = *resources.scene;
+	nvvkgltf::SceneVk& sceneVk = *resources.sceneVk;
 
 	const std::array<VkDeviceSize, 3>                            offsets{ {0} };
 	const std::vector<nvvkgltf::RenderNode>& renderNodes = scene.getRenderNodes();
@@ -330,7 +424,7 @@ void DDGIRasterizer::pushDescriptorSet(VkCommandBuffer cmd, Resources& resources
 {
 	//// Use a compute shader that outputs to the render target for now
 	//nvvk::WriteSetContainer write{};
-	//write.append(resources.descriptorBinding[1].getWriteSet(0), resources.sceneRtx.tlas());
+	//write.append(resources.descriptorBinding[1].getWriteSet(0), resources.sceneRtx->tlas());
 	//write.append(resources.descriptorBinding[1].getWriteSet(1),
 	//             resources.gBuffers.getColorImageView(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL);
 	//vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 1, write.size(), write.data());
@@ -389,6 +483,11 @@ void DDGIRasterizer::createPipeline(Resources& resources)
 			{ VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT });
 		m_MRTPipeline.colorBlendEquations.push_back(VkColorBlendEquationEXT{});
 		m_MRTPipeline.colorBlendEquations.push_back(VkColorBlendEquationEXT{});
+
+		// Attachment #3 - Motion vectors (TAA)
+		m_MRTPipeline.colorBlendEnables.push_back(false);
+		m_MRTPipeline.colorWriteMasks.push_back({ VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT });
+		m_MRTPipeline.colorBlendEquations.push_back(VkColorBlendEquationEXT{});
 	}
 	{
 		// for COMP
@@ -549,15 +648,15 @@ void DDGIRasterizer::recordRasterScene(Resources& resources)
 
 	createRecordCommandBuffer();
 
-	std::vector<VkFormat> colorFormat = { resources.gBuffersDefer.getColorFormat((uint32_t)Resources::EGbuffer::epos),
-										 resources.gBuffersDefer.getColorFormat((uint32_t)Resources::EGbuffer::enorm),
-										resources.gBuffersDefer.getColorFormat((uint32_t)Resources::EGbuffer::euv), };
+	// Formats of the transient images of the MRT pass
+	std::vector<VkFormat> colorFormat = { VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT,
+										m_taa.isActive() ? m_taa.getTargets().getColorFormat(TemporalAA::eTargetMotion) : VK_FORMAT_UNDEFINED };
 
 	VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
 		.colorAttachmentCount = uint32_t(colorFormat.size()),
 		.pColorAttachmentFormats = colorFormat.data(),
-		.depthAttachmentFormat = resources.gBuffersDefer.getDepthFormat(),
+		.depthAttachmentFormat = resources.gBuffers.getDepthFormat(),
 		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
 	};
 
@@ -587,13 +686,15 @@ void DDGIRasterizer::renderRasterScene(VkCommandBuffer cmd, Resources& resources
 	// Setting up the push constant
 	m_pushConst.frameInfo = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
 	m_pushConst.skyParams = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
-	m_pushConst.gltfScene = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
+	m_pushConst.gltfScene = (shaderio::GltfScene*)resources.sceneVk->sceneDesc().address;
 	m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+	m_pushConst.prevObjectToWorld = (glm::mat4*)m_taa.getPrevTransformsAddress();
+	m_pushConst.lightClusters = (shaderio::LightClusterGrid*)m_lightClusters.getGridAddress();
 	vkCmdPushConstants(cmd, m_MRTPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
 
 	// All dynamic states are set here
 	m_MRTPipeline.cmdApplyAllStates(cmd);
-	m_MRTPipeline.cmdSetViewportAndScissor(cmd, resources.gBuffersDefer.getSize());
+	m_MRTPipeline.cmdSetViewportAndScissor(cmd, m_taa.getRenderSize(resources));
 	m_MRTPipeline.cmdBindShaders(cmd, { .vertex = m_MRTvertexShader, .fragment = m_MRTfragmentShader });
 	vkCmdSetDepthTestEnable(cmd, VK_TRUE);
 
@@ -631,27 +732,27 @@ void DDGIRasterizer::renderRasterScene(VkCommandBuffer cmd, Resources& resources
 	// Bind the descriptor set: textures (Set: 0)
 	std::array<VkDescriptorSet, 1> descriptorSets{ resources.descriptorSet};
 	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_MRTPipelineLayout, 0, descriptorSets.size(), descriptorSets.data(), 0, nullptr);
-	VkBool32 blendEnable[] = { VK_TRUE,VK_TRUE,VK_TRUE };
-	VkBool32 blendDisable[] = {VK_FALSE, VK_FALSE, VK_FALSE};
+	VkBool32 blendEnable[] = { VK_TRUE,VK_TRUE,VK_TRUE,VK_FALSE };
+	VkBool32 blendDisable[] = {VK_FALSE, VK_FALSE, VK_FALSE, VK_FALSE};
 
 	// Draw the scene
 	// Back-face culling with depth bias
 	vkCmdSetCullMode(cmd, VK_CULL_MODE_BACK_BIT);
 	vkCmdSetDepthBias(cmd, -1.0f, 0.0f, 1.0f);  // Apply depth bias for solid objects
-	vkCmdSetColorBlendEnableEXT(cmd, 0, 3, blendDisable);
+	vkCmdSetColorBlendEnableEXT(cmd, 0, 4, blendDisable);
 
-	renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterSolid));
+	renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterSolid));
 
 	// Double sided without depth bias
 	vkCmdSetCullMode(cmd, VK_CULL_MODE_NONE);
 	vkCmdSetDepthBias(cmd, 0.0f, 0.0f, 0.0f);  // Disable depth bias for double-sided objects
-	vkCmdSetColorBlendEnableEXT(cmd, 0, 3, blendDisable);
-	renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterSolidDoubleSided));
+	vkCmdSetColorBlendEnableEXT(cmd, 0, 4, blendDisable);
+	renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterSolidDoubleSided));
 
 	// Blendable objects without depth bias
 	
 	// vkCmdSetColorBlendEnableEXT(cmd, 0, 3, blendEnable);
-	// renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterBlend));
+	// renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterBlend));
 
 	//if (m_enableWireframe)
 	//{
@@ -659,7 +760,7 @@ void DDGIRasterizer::renderRasterScene(VkCommandBuffer cmd, Resources& resources
 	//	vkCmdSetColorBlendEnableEXT(cmd, 0, 1, &blendDisable);
 	//	vkCmdSetDepthBias(cmd, 0.0f, 0.0f, 0.0f);  // Disable depth bias for wireframe
 	//	vkCmdSetPolygonModeEXT(cmd, VK_POLYGON_MODE_LINE);
-	//	renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterAll));
+	//	renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterAll));
 	//}
 }
 
@@ -12,6 +12,8 @@ namespace shaderio {
 
 #include "resources.hpp"
 #include "renderer_base.hpp"
+#include "temporal_aa.hpp"
+#include "light_clusters.hpp"
 
 
 class DDGIRasterizer : public BaseRenderer
@@ -31,6 +33,9 @@ public:
 	void createPipeline(Resources& resources) override;
 	void freeRecordCommandBuffer();
 
+	// Clip space jitter of the next frame (TAA)
+	glm::vec2 getJitter(const Resources& resources) const { return m_taa.getJitter(resources); }
+
 	// Register command line parameters
 	void registerParameters(nvutils::ParameterRegistry* paramReg);
 
@@ -62,6 +67,13 @@ private:
 	//VkShaderEXT m_vertexShader{};     // Vertex shader
 	//VkShaderEXT m_fragmentShader{};   // Fragment shader
 	nvshaders::SkyPhysical m_skyPhysical;  // Sky physical
+	TemporalAA             m_taa;          // Temporal anti-aliasing and upscaling
+	LightClusters          m_lightClusters;  // Clustered light culling
+
+	VkSampler m_gbufferSampler{};    // Nearest, for the MRT images in the composition
+	uint32_t  m_gbufferVersion{0};   // Transient images of the frame graph written in gbufferDescSet
+	uint32_t  m_gbufferSetIndex{0};  // Index of gbufferDescSet in gbufferDescSets
+	std::array<uint64_t, 2> m_gbufferSetValues{};  // Deletion queue values: the frames using each set are done
 
 
 	// UI
@@ -49,9 +49,13 @@
   }
 #define IMGUI_DEFINE_MATH_OPERATORS
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <thread>
 #include <vulkan/vulkan_core.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <fmt/format.h>
 
 #include "GLFW/glfw3.h"
@@ -88,6 +92,8 @@ using namespace glm;
 
 #include "create_tangent.hpp"
 #include "renderer.hpp"
+#include "svgf_reference.hpp"
+#include "trace_export.hpp"
 #include "ui_collapsing_header_manager.h"
 #include "ui_mouse_state.hpp"
 #include "ui_renderer.hpp"
@@ -112,6 +118,37 @@ GltfRenderer::GltfRenderer(nvutils::ParameterRegistry* paramReg)
   paramReg->add({"useSolidBackground", "Use solid color background"}, &m_resources.settings.useSolidBackground, true);
   paramReg->addVector({"solidBackgroundColor", "Solid Background Color"}, &m_resources.settings.solidBackgroundColor);
   paramReg->add({"maxFrames", "Maximum number of iterations"}, &m_resources.settings.maxFrames);
+  paramReg->add({"output", "Headless: filename of the final image, .jpg, .png or .exr (default: <executable>.jpg)"},
+                &m_resources.settings.outputImage);
+  paramReg->add({"saveExr", "Headless: also save the linear HDR image as .exr"}, &m_resources.settings.saveExr, true);
+  paramReg->add({"saveAovs", "Add the AOVs (albedo, normal, depth, selection, ...) to the .exr"}, &m_resources.settings.saveAovs, true);
+  paramReg->add({"captureEvery", "Frame capture: save every Nth rendered frame (0: off, 1: every frame)"},
+                &m_resources.settings.captureEvery);
+  paramReg->add({"captureStart", "Frame capture: start once the frame count reaches this value"},
+                &m_resources.settings.captureStart);
+  paramReg->add({"captureExr", "Frame capture: save the linear image (and AOVs) as .exr instead of .png"},
+                &m_resources.settings.captureExr, true);
+  paramReg->add({"captureDir", "Frame capture: output directory"}, &m_resources.settings.captureDir);
+  paramReg->add({"sequenceFps", "Animation sequence: render the animation with fixed 1/fps steps (0: off)"},
+                &m_resources.settings.sequenceFps);
+  paramReg->add({"sequenceSamples", "Animation sequence: iterations accumulated before writing each frame"},
+                &m_resources.settings.sequenceSamples);
+  paramReg->add({"sequenceFrames", "Animation sequence: number of frames to render (0: whole animation)"},
+                &m_resources.settings.sequenceFrames);
+  paramReg->add({"taa", "Rasterizer: temporal anti-aliasing"}, &m_resources.settings.taaEnable);
+  paramReg->add({"taaScale", "Rasterizer: render resolution relative to the output, upscaled by TAA [0.5..1]"},
+                &m_resources.settings.taaRenderScale);
+  paramReg->add({"taaFeedback", "Rasterizer: maximum weight of the TAA history"}, &m_resources.settings.taaFeedback);
+  paramReg->add({"clusterLights", "Rasterizer: clustered light culling"}, &m_resources.settings.clusterEnable);
+  paramReg->addVector({"clusterTiles", "Rasterizer: number of light cluster tiles on screen (X, Y)"}, &m_resources.settings.clusterTiles);
+  paramReg->add({"clusterSlices", "Rasterizer: number of light cluster depth slices"}, &m_resources.settings.clusterSlices);
+  paramReg->add({"clusterMaxLights", "Rasterizer: maximum number of lights per cluster"}, &m_resources.settings.clusterMaxLights);
+  paramReg->add({"clusterLightCutoff", "Rasterizer: irradiance below which lights without range are culled (0: off)"},
+                &m_resources.settings.clusterLightCutoff);
+  paramReg->add({"benchmark", "Benchmark: script of the scenes, renderers and camera paths to measure (see README)"},
+                &m_resources.settings.benchmarkFile);
+  paramReg->add({"benchmarkReport", "Benchmark: JSON report filename (default: <executable>_benchmark.json)"},
+                &m_resources.settings.benchmarkReport);
 
   paramReg->add({"tmMethod", "Tonemapper method: [Filmic:0, Uncharted:1, Clip:2, ACES:3, Agx:4, KhronosPBR:5]"},
                 &m_resources.tonemapperData.method);
@@ -124,7 +161,12 @@ GltfRenderer::GltfRenderer(nvutils::ParameterRegistry* paramReg)
   // Register PathTracer-specific command line parameters
   m_pathTracer.registerParameters(paramReg);
   m_rasterizer.registerParameters(paramReg);
+  m_heatmap.registerParameters(paramReg);
   m_ddgirasterizer.registerParameters(paramReg);
+  g_traceExport.registerParameters(paramReg);
+  m_metrics.registerParameters(paramReg);
+  m_idle.registerParameters(paramReg);
+  m_resources.memoryReport.registerParameters(paramReg);
 }
 
 //void GltfRenderer::changeGbufferLayout() {}
@@ -136,19 +178,53 @@ GltfRenderer::GltfRenderer(nvutils::ParameterRegistry* paramReg)
 void GltfRenderer::onAttach(nvapp::Application* app)
 {
   SCOPED_TIMER("GltfRenderer::onAttach");
+  TRACE_SCOPE("GltfRenderer::onAttach");
 
   m_app                = app;
   m_device             = app->getDevice();
   m_resources.instance = app->getInstance();
+  m_idle.init(app->getWindowHandle());  // No window in headless mode: never idle
 
   // ===== Memory Allocation & Buffer Management =====
-  m_resources.allocator.init({
-      .flags            = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+  // VK_EXT_memory_budget is requested when available (see main.cpp), VMA then reports the real budgets
+  uint32_t numExtensions = 0;
+  vkEnumerateDeviceExtensionProperties(app->getPhysicalDevice(), nullptr, &numExtensions, nullptr);
+  std::vector<VkExtensionProperties> extensions(numExtensions);
+  vkEnumerateDeviceExtensionProperties(app->getPhysicalDevice(), nullptr, &numExtensions, extensions.data());
+  const bool hasMemoryBudget = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& e) {
+    return strcmp(e.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+  });
+  // VK_KHR_shader_clock is optional too: without the device clock, the shaders are specialized
+  // without the shader time heatmap
+  const bool hasShaderClockExt = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& e) {
+    return strcmp(e.extensionName, VK_KHR_SHADER_CLOCK_EXTENSION_NAME) == 0;
+  });
+  if(hasShaderClockExt)
+  {
+    VkPhysicalDeviceShaderClockFeaturesKHR clockFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_CLOCK_FEATURES_KHR};
+    VkPhysicalDeviceFeatures2 features2{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &clockFeatures};
+    vkGetPhysicalDeviceFeatures2(app->getPhysicalDevice(), &features2);
+    m_resources.hasShaderClock = clockFeatures.shaderDeviceClock == VK_TRUE;
+  }
+
+  const VmaAllocatorCreateInfo allocatorInfo{
+      .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT | (hasMemoryBudget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0),
       .physicalDevice   = app->getPhysicalDevice(),
       .device           = app->getDevice(),
       .instance         = app->getInstance(),
       .vulkanApiVersion = VK_API_VERSION_1_4,
-  });  // Allocator
+  };
+  m_resources.allocator.init(allocatorInfo);  // Allocator
+  m_resources.memoryReport.init(m_resources.allocator, hasMemoryBudget);
+  // Each scene slot has its allocator: the scene loaded on a thread is measured apart (MemoryReport)
+  for(SceneSlot& slot : m_resources.sceneSlots)
+  {
+    slot.allocator.init(allocatorInfo);
+    m_resources.memoryReport.addAllocator(slot.allocator);
+  }
+  m_resources.deletionQueue.init(&m_resources.allocator, &m_resources.samplerPool, &m_resources.memoryReport,
+                                 app->getQueue(0).queue);
+  m_resources.frameGraph.init(&m_resources.allocator, &m_resources.memoryReport, &m_resources.deletionQueue);
 
   m_transientCmdPool = nvvk::createTransientCommandPool(m_device, app->getQueue(0).familyIndex);
   NVVK_DBG_NAME(m_transientCmdPool);
@@ -165,10 +241,6 @@ void GltfRenderer::onAttach(nvapp::Application* app)
   NVVK_CHECK(m_resources.samplerPool.acquireSampler(linearSampler));
   NVVK_DBG_NAME(linearSampler);
 
-  // IBL environment map
-  m_resources.hdrIbl.init(&m_resources.allocator, &m_resources.samplerPool);
-  m_resources.hdrDome.init(&m_resources.allocator, &m_resources.samplerPool, m_app->getQueue(0));
-
   // G-Buffer
   m_resources.gBuffers.init({.allocator = &m_resources.allocator,
                              .colorFormats =
@@ -183,33 +255,11 @@ void GltfRenderer::onAttach(nvapp::Application* app)
   {
     VkCommandBuffer cmd{};
     nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
+    MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eGBuffers);
     m_resources.gBuffers.update(cmd, {100, 100});
     nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
   }
 
-  m_resources.gBuffersDefer.init({ .allocator = &m_resources.allocator,
-                            .colorFormats =
-                                {
-                                    VK_FORMAT_R32G32B32A32_SFLOAT,       // POSITION
-                                    VK_FORMAT_R32G32B32A32_SFLOAT,  // NORMAL + intAsFloat(materialid)
-                                    VK_FORMAT_R32G32B32A32_SFLOAT,             // texCoord.xy, 0, 0
-                                },
-                            .depthFormat = nvvk::findDepthFormat(app->getPhysicalDevice()),
-                            .imageSampler = linearSampler,
-                            .descriptorPool = m_app->getTextureDescriptorPool() });
-  {
-      VkCommandBuffer cmd{};
-      nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
-      m_resources.gBuffersDefer.update(cmd, { 100, 100 });
-      nvvk::cmdImageMemoryBarrier(cmd, { m_resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::epos), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-      nvvk::cmdImageMemoryBarrier(cmd, { m_resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::enorm), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-      nvvk::cmdImageMemoryBarrier(cmd, { m_resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::euv), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-
-      nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
-  }
-  
-  
-
   // ===== Rendering Utilities =====
 
   // Ray picker
@@ -221,21 +271,40 @@ void GltfRenderer::onAttach(nvapp::Application* app)
   // Silhouette renderer
   m_silhouette.init(m_resources);
 
+  // Cost heatmaps
+  m_heatmap.init(m_resources);
+  Heatmap::checkSupport(m_resources);  // --debugMethod
+
+  // Assets added to the scene
+  m_composition.init(m_resources);
+
+  // Readback of the rendered images (EXR)
+  m_imageOutput.init(m_resources, m_app->getQueue(0));
+
+  // Metrics endpoint and file
+  m_metrics.init();
+
   // ===== Scene & Acceleration Structure =====
-  m_resources.sceneVk.init(&m_resources.allocator);
-  m_resources.sceneRtx.init(&m_resources.allocator);
+  for(SceneSlot& slot : m_resources.sceneSlots)
+  {
+    slot.sceneVk.init(&slot.allocator);
+    slot.sceneRtx.init(&slot.allocator);
+  }
+  m_sceneSwap.init(m_resources, m_app->getQueue(0));
 
   // ===== Profiling & Performance =====
   {
     SCOPED_TIMER("Profiler");
     m_profilerTimeline = g_profilerManager.createTimeline({.name = "Primary Timeline"});
     m_profilerGpuTimer.init(m_profilerTimeline, m_app->getDevice(), m_app->getPhysicalDevice(), m_app->getQueue(0).familyIndex, false);
+    g_traceExport.init(m_app->getDevice(), m_app->getPhysicalDevice());
   }
 
 
   // ===== Shader Compilation =====
   {
     SCOPED_TIMER("Shader Slang");
+    TRACE_SCOPE("Shader Slang");
     using namespace slang;
     m_resources.slangCompiler.addSearchPaths(nvsamples::getShaderDirs());
     m_resources.slangCompiler.defaultTarget();
@@ -282,14 +351,23 @@ void GltfRenderer::onAttach(nvapp::Application* app)
   createResourceBuffers();
 
   // Initialize the renderers
-  m_pathTracer.onAttach(m_resources, &m_profilerGpuTimer);
-  m_rasterizer.onAttach(m_resources, &m_profilerGpuTimer);
-  m_ddgirasterizer.onAttach(m_resources, &m_profilerGpuTimer);
-  
+  {
+    MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eRenderers);
+    m_pathTracer.onAttach(m_resources, &m_profilerGpuTimer);
+    m_rasterizer.onAttach(m_resources, &m_profilerGpuTimer);
+    m_ddgirasterizer.onAttach(m_resources, &m_profilerGpuTimer);
+
+    m_pathTracer.createPipeline(m_resources);
+    m_rasterizer.createPipeline(m_resources);
+    m_ddgirasterizer.createPipeline(m_resources);
+  }
 
-  m_pathTracer.createPipeline(m_resources);
-  m_rasterizer.createPipeline(m_resources);
-  m_ddgirasterizer.createPipeline(m_resources);
+  if(!m_resources.settings.benchmarkFile.empty())
+  {
+    const std::filesystem::path script = nvutils::pathFromUtf8(m_resources.settings.benchmarkFile);
+    const std::filesystem::path found  = nvutils::findFile(script, nvsamples::getResourcesDirs());
+    m_benchmark.load(found.empty() ? script : found);
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -307,16 +385,21 @@ void GltfRenderer::onDetach()
 // Resize the G-Buffer and the renderers
 void GltfRenderer::onResize(VkCommandBuffer cmd, const VkExtent2D& size)
 {
-  m_resources.gBuffers.update(cmd, size);
-  m_resources.gBuffersDefer.update(cmd, size);
-  nvvk::cmdImageMemoryBarrier(cmd, { m_resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::epos), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-  nvvk::cmdImageMemoryBarrier(cmd, { m_resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::enorm), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
-  nvvk::cmdImageMemoryBarrier(cmd, { m_resources.gBuffersDefer.getColorImage((uint32_t)Resources::EGbuffer::euv), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+  {
+    MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eGBuffers);
+    m_resources.gBuffers.update(cmd, size);
+  }
+  {
+    MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eRenderers);
+    m_pathTracer.onResize(cmd, size, m_resources);
+    m_rasterizer.onResize(cmd, size, m_resources);
+    m_ddgirasterizer.onResize(cmd, size, m_resources);
+  }
+  m_resources.hdrDome->setOutImage(m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
 
-  m_pathTracer.onResize(cmd, size, m_resources);
-  m_rasterizer.onResize(cmd, size, m_resources);
-  m_ddgirasterizer.onResize(cmd, size, m_resources);
-  m_resources.hdrDome.setOutImage(m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
+  // New images: the post-processing and the clear of the empty scene are done again
+  m_postProcess.valid = false;
+  m_gbufferCleared    = false;
 
   resetFrame();  // Reset frame to restart the rendering
 }
@@ -334,6 +417,7 @@ void GltfRenderer::onResize(VkCommandBuffer cmd, const VkExtent2D& size)
 // The UI layout is organized hierarchically with collapsible sections for better usability
 void GltfRenderer::onUIRender()
 {
+  m_idle.beginFrame();  // Waits for input when the previous frames had nothing to render
   GltfRendererUI::renderUI(*this);
 }
 
@@ -344,43 +428,112 @@ void GltfRenderer::onRender(VkCommandBuffer cmd)
 {
   NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
   m_profilerTimeline->frameAdvance();
-  // Don't do anything if the busy window is open
-  if(m_busy.isBusy())
+  g_traceExport.frameBegin(cmd);
+  TRACE_SCOPE("GltfRenderer::onRender");
+  updateMetrics();
+  m_resources.memoryReport.update();
+  m_resources.deletionQueue.nextFrame();  // Before anything is retired by this frame
+
+  // The frame to capture was submitted with the previous command buffer, read it back now
+  if(m_capturePending)
   {
-    return;
+    updateFrameCapture(false);
+  }
+
+  // Hand the images whose readback has completed to the writer threads
+  m_imageOutput.flush(false);
+
+  // Work still pending outside of the rendering: keep the frames coming
+  if(m_capturePending || m_imageOutput.hasInFlight() || m_benchmark.getPhase() != Benchmark::Phase::eIdle)
+  {
+    m_idle.markActive();
   }
 
-  // Consume the done signal from the busy state, this will remove the Progress Bar from the UI
-  if(m_busy.isDone())
+  // Benchmark: load the next scene, switch the renderer or move the camera along the path
+  if(m_benchmark.getPhase() != Benchmark::Phase::eIdle)
   {
-    m_busy.consumeDone();
+    updateBenchmark();
   }
 
   // Process queued command buffers in FIFO order
   if(processQueuedCommandBuffers())
   {
+    m_idle.markActive();
     return;  // Give back control to the UI
   }
 
-  // Empty scene, clear the G-Buffer
-  if(!m_resources.scene.valid())
+  // Scene loaded in the background: built between the frames of the current one, then swapped in
+  updateSceneSwap();
+
+  // Empty scene, clear the G-Buffer once
+  if(!m_resources.scene->valid())
   {
-    clearGbuffer(cmd);
+    if(!m_gbufferCleared)
+    {
+      clearGbuffer(cmd);
+      m_gbufferCleared = true;
+      m_idle.markActive();
+    }
+    m_postProcess.valid = false;
     return;
   }
+  m_gbufferCleared = false;
 
   // Start the profiler section for the GPU timer
-  auto timerSection = m_profilerGpuTimer.cmdFrameSection(cmd, __FUNCTION__);
+  auto timerSection = m_profilerGpuTimer.cmdFrameSection(cmd, "Frame");
+  auto traceSection = g_traceExport.cmdSection(cmd, "Frame");
 
-  // Update the animation
-  bool didAnimate = updateAnimation(cmd);
+  // Update the animation: wall-clock time, or fixed steps when rendering a sequence
+  const bool isSequence = m_resources.settings.sequenceFps > 0.0f && m_resources.scene->hasAnimation();
+  bool       didAnimate = isSequence ? updateSequence() : updateAnimation(cmd);
 
   // Check for changes
   bool changed      = updateSceneChanges(cmd, didAnimate);
+  if(m_composition.update(cmd, m_resources))
+  {
+    resetFrame();
+    changed = true;
+  }
+
+  // Sequence: the step was uploaded, sample the animation of the next one on a thread
+  // while the GPU accumulates the iterations of the current step. The scene stays at the
+  // current step until the boundary.
+  if(isSequence && didAnimate && m_sequence.step + 1 < m_sequence.numSteps)
+  {
+    prepareSequenceStep(m_sequence.step + 1);
+  }
   bool frameChanged = updateFrameCounter();  // Check if the frame counter has changed
 
+  // Converged and nothing changed: the tonemapped image is final, no GPU work for this frame
+  if(!changed && !frameChanged && isPostProcessValid())
+  {
+    updateFrameCapture(false);
+    return;
+  }
+  m_idle.markActive();
+
+  // The passes of the frame, with the images and buffers they access: the frame graph derives the
+  // barriers between them, and culls the passes whose result is not used
+  using Usage       = FrameGraph::Usage;
+  FrameGraph& graph = m_resources.frameGraph;
+  graph.begin();
+  const FrameGraph::ResourceId frameInfo = graph.importBuffer("FrameInfo", m_resources.bFrameInfo.buffer);
+  const FrameGraph::ResourceId skyParams = graph.importBuffer("SkyParams", m_resources.bSkyParams.buffer);
+  const FrameGraph::ResourceId rendered =
+      graph.importImage("Rendered", m_resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL);
+  const FrameGraph::ResourceId selection =
+      graph.importImage("Selection", m_resources.gBuffers.getColorImage(Resources::eImgSelection), VK_IMAGE_LAYOUT_GENERAL);
+  const FrameGraph::ResourceId tonemapped =
+      graph.importImage("Tonemapped", m_resources.gBuffers.getColorImage(Resources::eImgTonemapped), VK_IMAGE_LAYOUT_GENERAL);
+
   if(changed || frameChanged)
   {
+    // Sub-pixel jitter of the rasterizers (TAA)
+    glm::vec2 jitter{0.0f};
+    if(m_resources.settings.renderSystem == RenderingMode::eRasterizer)
+      jitter = m_rasterizer.getJitter(m_resources);
+    else if(m_resources.settings.renderSystem == RenderingMode::eDDGIRasterizer)
+      jitter = m_ddgirasterizer.getJitter(m_resources);
 
     // Update the scene frame information uniform buffer
     shaderio::SceneFrameInfo finfo{
@@ -402,35 +555,190 @@ void GltfRenderer::onRender(VkCommandBuffer cmd)
         .infinitePlaneBaseColor = m_resources.settings.infinitePlaneBaseColor,
         .infinitePlaneMetallic  = m_resources.settings.infinitePlaneMetallic,
         .infinitePlaneRoughness = m_resources.settings.infinitePlaneRoughness,
+        .jitter                 = jitter,
+        .heatmap                = (shaderio::HeatmapInfo*)m_heatmap.getInfoAddress(m_resources),
     };
     // Update the camera information
     m_prevMVP = finfo.viewProjMatrix;
 
-    vkCmdUpdateBuffer(cmd, m_resources.bFrameInfo.buffer, 0, sizeof(shaderio::SceneFrameInfo), &finfo);
     // Update the sky
     m_resources.skyParams.yIsUp = m_resources.cameraManip->getUp().y > 0.5f;
-    vkCmdUpdateBuffer(cmd, m_resources.bSkyParams.buffer, 0, sizeof(shaderio::SkyPhysicalParameters), &m_resources.skyParams);
-    // Make sure buffer is ready to be used
-    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    graph.addPass(
+        "Frame info",
+        [&](FrameGraph::PassBuilder& pass) {
+          pass.write(frameInfo, Usage::eTransferDst, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+          pass.write(skyParams, Usage::eTransferDst, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+        },
+        [this, finfo](VkCommandBuffer cmd) {
+          vkCmdUpdateBuffer(cmd, m_resources.bFrameInfo.buffer, 0, sizeof(shaderio::SceneFrameInfo), &finfo);
+          vkCmdUpdateBuffer(cmd, m_resources.bSkyParams.buffer, 0, sizeof(shaderio::SkyPhysicalParameters), &m_resources.skyParams);
+        });
+
+    // Cost heatmaps: the renderer adds the costs of the frame, at its render resolution
+    if(Heatmap::isHeatmap(m_resources.settings.debugMethod))
+    {
+      const VkExtent2D heatmapSize = m_resources.settings.renderSystem == RenderingMode::eRasterizer ?
+                                         m_rasterizer.getRenderSize(m_resources) :
+                                         m_resources.gBuffers.getSize();
+      graph.addPass(
+          "Heatmap begin", [](FrameGraph::PassBuilder& pass) { pass.sideEffect(); },
+          [this, heatmapSize](VkCommandBuffer cmd) { m_heatmap.begin(cmd, m_resources, heatmapSize); });
+    }
 
-    // Switch between renderers based on the current mode
+    // Switch between renderers based on the current mode. The path tracer and the rasterizer are
+    // one pass, synchronizing their own work; the DDGI rasterizer adds its passes to the graph.
+    auto addRendererPass = [&](const char* name, BaseRenderer& renderer, VkPipelineStageFlags2 stages) {
+      graph.addPass(
+          name,
+          [&](FrameGraph::PassBuilder& pass) {
+            pass.read(frameInfo, Usage::eShaderRead, stages);
+            pass.read(skyParams, Usage::eShaderRead, stages);
+            pass.readWrite(rendered, Usage::eGeneral, stages);
+            pass.readWrite(selection, Usage::eGeneral, stages);
+          },
+          [this, &renderer](VkCommandBuffer cmd) { renderer.onRender(cmd, m_resources); });
+    };
     switch(m_resources.settings.renderSystem)
     {
       case RenderingMode::ePathtracer:
-        m_pathTracer.onRender(cmd, m_resources);
+      {
+        // GPU time of a recent frame of the path tracer, for its dynamic resolution
+        nvutils::ProfilerTimeline::TimerInfo info{};
+        if(m_profilerTimeline->getFrameTimerInfo("Pathtrace", info))
+          m_pathTracer.setGpuTime(float(info.gpu.last / 1000.0));  // Microseconds
+        addRendererPass("Path tracer", m_pathTracer,
+                        VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+                            | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
         break;
+      }
       case RenderingMode::eRasterizer:
-        m_rasterizer.onRender(cmd, m_resources);
+        addRendererPass("Rasterizer", m_rasterizer,
+                        VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
         break;
       case RenderingMode::eDDGIRasterizer:
-          m_ddgirasterizer.onRender(cmd, m_resources);
-          break;
+        m_ddgirasterizer.onRender(cmd, m_resources);
+        break;
     }
+
+    // Samples of the frame, for the metrics
+    const VkExtent2D size = m_resources.gBuffers.getSize();
+    const int samplesPerPixel = m_resources.settings.renderSystem == RenderingMode::ePathtracer ? m_pathTracer.getSamplesPerFrame() : 1;
+    m_metrics.addSamples(uint64_t(size.width) * size.height * samplesPerPixel);
   }
 
   // Apply the post-processing effects
-  tonemap(cmd);
-  silhouette(cmd);
+  graph.addPass(
+      "Tonemap",
+      [&](FrameGraph::PassBuilder& pass) {
+        pass.read(rendered, Usage::eStorage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        pass.write(tonemapped, Usage::eStorage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+      },
+      [this](VkCommandBuffer cmd) { tonemap(cmd); });
+  if(Heatmap::isHeatmap(m_resources.settings.debugMethod))
+  {
+    graph.addPass(
+        "Heatmap resolve",
+        [&](FrameGraph::PassBuilder& pass) {
+          pass.readWrite(tonemapped, Usage::eGeneral, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+        },
+        [this](VkCommandBuffer cmd) { m_heatmap.resolve(cmd, m_resources); });
+  }
+  if(m_resources.selectedObject > -1)
+  {
+    graph.addPass(
+        "Silhouette",
+        [&](FrameGraph::PassBuilder& pass) {
+          pass.read(selection, Usage::eStorage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+          pass.readWrite(tonemapped, Usage::eStorage, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        },
+        [this](VkCommandBuffer cmd) { silhouette(cmd); });
+  }
+  graph.markOutput(tonemapped);
+  graph.execute(cmd);
+
+  m_postProcess = {.valid           = true,
+                   .tonemapper      = m_resources.tonemapperData,
+                   .selectedObject  = m_resources.selectedObject,
+                   .silhouetteColor = m_resources.settings.silhouetteColor,
+                   .debugMethod     = m_resources.settings.debugMethod};
+
+  updateFrameCapture(changed || frameChanged);
+}
+
+//--------------------------------------------------------------------------------------------------
+// The post-processing of the last frame is still valid: same inputs, and no heatmap (its range
+// and its readback of the largest cost are updated by the UI every frame)
+bool GltfRenderer::isPostProcessValid() const
+{
+  return m_postProcess.valid && !Heatmap::isHeatmap(m_resources.settings.debugMethod)
+         && m_postProcess.debugMethod == m_resources.settings.debugMethod
+         && m_postProcess.selectedObject == m_resources.selectedObject
+         && m_postProcess.silhouetteColor == m_resources.settings.silhouetteColor
+         && std::memcmp(&m_postProcess.tonemapper, &m_resources.tonemapperData, sizeof(shaderio::TonemapperData)) == 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Frame capture: save every Nth rendered frame once the frame count reached `captureStart`.
+// The frame is marked when rendered, and read back at the beginning of the next frame, once
+// its command buffer has been submitted. The readback and the writing are asynchronous.
+void GltfRenderer::updateFrameCapture(bool rendered)
+{
+  const Settings& settings = m_resources.settings;
+  const bool      isSequence = settings.sequenceFps > 0.0f && m_resources.scene->hasAnimation();
+  if(m_capturePending)
+  {
+    m_capturePending = false;
+    std::filesystem::path filename =
+        m_captureDir / fmt::format("{}_{:05d}{}", nvutils::utf8FromPath(nvutils::getExecutablePath().stem()), m_captureIndex++,
+                          settings.captureExr ? ".exr" : ".png");
+    saveImage(filename);
+    return;
+  }
+
+  // Sequence: write the step once it has accumulated all its iterations
+  if(isSequence)
+  {
+    const int target = std::min(settings.sequenceSamples, settings.maxFrames + 1);
+    if(rendered && m_sequence.step >= 0 && !m_sequence.converged && m_resources.frameCount + 1 >= target)
+    {
+      m_sequence.converged = true;
+      m_capturePending     = createCaptureDir();
+    }
+    return;
+  }
+
+  if(!rendered || settings.captureEvery <= 0 || m_resources.frameCount < settings.captureStart)
+    return;
+
+  m_capturePending = (m_captureCounter++ % settings.captureEvery) == 0 && createCaptureDir();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Output directory of the frame capture (default: executable directory), created when a capture
+// starts or the setting changed. A failure is reported once per value and fails the process.
+bool GltfRenderer::createCaptureDir()
+{
+  const std::string& captureDir = m_resources.settings.captureDir;
+  if(captureDir.empty())
+  {
+    m_captureDir = nvutils::getExecutablePath().parent_path();
+    return true;
+  }
+  if(captureDir == m_captureDirChecked)
+    return !m_captureDir.empty();
+
+  m_captureDirChecked = captureDir;
+  m_captureDir        = nvutils::pathFromUtf8(captureDir);
+  std::error_code error;
+  std::filesystem::create_directories(m_captureDir, error);
+  if(error)
+  {
+    LOGE("Frame capture: cannot create the directory %s: %s\n", captureDir.c_str(), error.message().c_str());
+    m_captureDir.clear();
+    m_exitCode = 1;
+    return false;
+  }
+  return true;
 }
 
 
@@ -445,51 +753,246 @@ void GltfRenderer::onUIMenu()
 // Called with headless rendering, to save the final image
 void GltfRenderer::onLastHeadlessFrame()
 {
-  m_app->saveImageToFile(m_resources.gBuffers.getColorImage(Resources::eImgTonemapped), m_resources.gBuffers.getSize(),
-                         nvutils::getExecutablePath().replace_extension(".jpg").string());
+  if(m_capturePending)
+  {
+    updateFrameCapture(false);
+  }
+  std::filesystem::path outputImage = m_resources.settings.outputImage.empty() ?
+                                          nvutils::getExecutablePath().replace_extension(".jpg") :
+                                          nvutils::pathFromUtf8(m_resources.settings.outputImage);
+  saveImage(outputImage);
+  if(m_resources.settings.saveExr && !nvutils::extensionMatches(outputImage, ".exr"))
+  {
+    saveExr(std::filesystem::path(outputImage).replace_extension(".exr"));
+  }
+  if(m_resources.settings.renderSystem == RenderingMode::ePathtracer && m_pathTracer.isMultiView())
+  {
+    // Each view in a linear EXR next to the output image: <name>_view_00.exr, ...
+    const MultiView& multiView = m_pathTracer.getMultiView();
+    for(uint32_t i = 0; i < multiView.getNumViews(); i++)
+    {
+      const std::filesystem::path filename =
+          outputImage.parent_path()
+          / nvutils::pathFromUtf8(fmt::format("{}_view_{:02d}.exr", nvutils::utf8FromPath(outputImage.stem()), i));
+      m_imageOutput.capture({multiView.getLayer(i)}, filename);
+    }
+  }
+  if(m_resources.settings.renderSystem == RenderingMode::ePathtracer && m_pathTracer.isDenoising()
+     && m_pathTracer.getSvgf().getSettings().validate)
+  {
+    validateSvgf();
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Compare the last frame of the SVGF denoiser with the CPU reference implementation, fed with the
+// same inputs and the history that frame has read. A failure sets the exit code of the process.
+void GltfRenderer::validateSvgf()
+{
+  const SvgfDenoiser& svgf = m_pathTracer.getSvgf();
+  const VkExtent2D&   size = m_resources.gBuffers.getSize();
+  m_exitCode               = 1;
+
+  std::vector<ImageOutput::Layer> layers(6);
+  layers[0] = {.image = svgf.getNoisyImage(), .format = svgf.getNoisyFormat(), .size = size};
+  layers[1] = {.image  = m_resources.gBuffers.getColorImage(Resources::eImgRendered),
+               .format = m_resources.gBuffers.getColorFormat(Resources::eImgRendered),
+               .size   = size};
+  const shaderio::OutputImage guides[] = {shaderio::eDlssAlbedo, shaderio::eDlssNormalRoughness, shaderio::eDlssDepth,
+                                          shaderio::eDlssMotion};
+  for(int i = 0; i < 4; i++)
+  {
+    if(!m_pathTracer.getGuideImage(guides[i], layers[2 + i].image, layers[2 + i].format, layers[2 + i].size))
+    {
+      LOGE("SVGF validation: FAILED, the guides are not available\n");
+      return;
+    }
+  }
+  const SvgfDenoiser::Image history[] = {SvgfDenoiser::eIllumination0, SvgfDenoiser::eMoments0, SvgfDenoiser::eNormalDepth0};
+  for(SvgfDenoiser::Image image : history)
+  {
+    ImageOutput::Layer layer{.size = size};
+    if(svgf.getLastHistory(image, layer.image, layer.format))
+      layers.push_back(layer);
+  }
+  const bool hasHistory = layers.size() == 9;
+
+  std::vector<std::vector<float>> data = m_imageOutput.read(layers);
+  if(data.size() != layers.size()
+     || std::any_of(data.begin(), data.end(), [](const std::vector<float>& d) { return d.empty(); }))
+  {
+    LOGE("SVGF validation: FAILED, cannot read back the images\n");
+    return;
+  }
+
+  const SvgfDenoiser::Settings& settings = svgf.getSettings();
+  svgf::ReferenceInput          input{.width           = size.width,
+                                      .height          = size.height,
+                                      .color           = std::move(data[0]),
+                                      .albedo          = std::move(data[2]),
+                                      .normalRoughness = std::move(data[3]),
+                                      .depth           = std::move(data[4]),
+                                      .motion          = std::move(data[5]),
+                                      .iterations      = settings.iterations,
+                                      .alphaColor      = settings.alphaColor,
+                                      .alphaMoments    = settings.alphaMoments,
+                                      .maxHistory      = float(std::max(1, settings.maxHistory)),
+                                      .phiColor        = settings.phiColor,
+                                      .phiNormal       = settings.phiNormal,
+                                      .phiDepth        = settings.phiDepth};
+  if(hasHistory)
+  {
+    input.prevIllumination = std::move(data[6]);
+    input.prevMoments      = std::move(data[7]);
+    input.prevNormalDepth  = std::move(data[8]);
+  }
+  const std::vector<float> reference = svgf::denoiseReference(input);
+
+  const float error     = svgf::relativeRmse(data[1], reference);
+  const float tolerance = 1e-2f;
+  if(error <= tolerance)
+  {
+    LOGI("SVGF validation: passed, relative RMSE %g (%s history)\n", error, hasHistory ? "with" : "without");
+    m_exitCode = 0;
+  }
+  else
+  {
+    LOGE("SVGF validation: FAILED, relative RMSE %g (tolerance %g)\n", error, tolerance);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Save the tonemapped image (.png, .jpg), or the linear image and AOVs (.exr), without stalling
+void GltfRenderer::saveImage(const std::filesystem::path& filename)
+{
+  if(nvutils::extensionMatches(filename, ".exr"))
+  {
+    saveExr(filename);
+    return;
+  }
+  m_imageOutput.capture({{.channels = {"R", "G", "B", "A"},
+                          .image    = m_resources.gBuffers.getColorImage(Resources::eImgTonemapped),
+                          .format   = m_resources.gBuffers.getColorFormat(Resources::eImgTonemapped),
+                          .size     = m_resources.gBuffers.getSize()}},
+                        filename);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Save the linear rendered image, and the AOVs if requested, to a multi-layer EXR.
+// The readback is asynchronous, the file is written when the copy is done (see ImageOutput).
+void GltfRenderer::saveExr(const std::filesystem::path& filename)
+{
+  const VkExtent2D&               size = m_resources.gBuffers.getSize();
+  std::vector<ImageOutput::Layer> layers;
+  layers.push_back({.name     = "",
+                    .channels = {"R", "G", "B", "A"},
+                    .image    = m_resources.gBuffers.getColorImage(Resources::eImgRendered),
+                    .format   = m_resources.gBuffers.getColorFormat(Resources::eImgRendered),
+                    .size     = size});
+
+  if(m_resources.settings.saveAovs)
+  {
+    layers.push_back({.name     = "selection",
+                      .channels = {"Y"},
+                      .image    = m_resources.gBuffers.getColorImage(Resources::eImgSelection),
+                      .format   = m_resources.gBuffers.getColorFormat(Resources::eImgSelection),
+                      .size     = size});
+
+    // Guides written by the path tracer (DLSS buffers or AOV buffers)
+    struct Guide
+    {
+      shaderio::OutputImage    name;
+      const char*              layerName;
+      std::vector<std::string> channels;
+    };
+    const Guide guides[] = {
+        {shaderio::eDlssAlbedo, "albedo", {"R", "G", "B", "A"}},
+        {shaderio::eDlssSpecAlbedo, "specularAlbedo", {"R", "G", "B"}},
+        {shaderio::eDlssNormalRoughness, "normal", {"X", "Y", "Z", "roughness"}},
+        {shaderio::eDlssMotion, "motion", {"X", "Y"}},
+        {shaderio::eDlssDepth, "depth", {"Z"}},
+        {shaderio::eObjectId, "objectId", {"id"}},
+    };
+    for(const Guide& guide : guides)
+    {
+      ImageOutput::Layer layer{.name = guide.layerName, .channels = guide.channels};
+      if(m_resources.settings.renderSystem == RenderingMode::ePathtracer
+         && m_pathTracer.getGuideImage(guide.name, layer.image, layer.format, layer.size))
+      {
+        layers.push_back(layer);
+      }
+    }
+  }
+
+  m_imageOutput.capture(layers, filename);
 }
 
 //--------------------------------------------------------------------------------------------------
 // Load a glTF scene or an HDR file
 void GltfRenderer::onFileDrop(const std::filesystem::path& filename)
 {
-  vkQueueWaitIdle(m_app->getQueue(0).queue);
-
   if(nvutils::extensionMatches(filename, ".gltf") || nvutils::extensionMatches(filename, ".glb")
      || nvutils::extensionMatches(filename, ".obj"))
   {
-    if(m_busy.isBusy())
+    const std::filesystem::path found = nvutils::findFile(filename, nvsamples::getResourcesDirs());
+    if(!found.has_filename())
+    {
+      LOGE("Cannot find file: %s\n", nvutils::utf8FromPath(filename).c_str());
       return;
+    }
 
-    m_cmdBufferQueue = {};             // Clear the command buffer queue
-    m_resources.scene.destroy();       // Destroy the current scene
-    m_resources.selectedObject = -1;   // Reset the selected object
-    m_uiSceneGraph.setModel(nullptr);  // Reset the UI model
-    m_rasterizer.freeRecordCommandBuffer();
-    m_ddgirasterizer.freeRecordCommandBuffer();
-
-    std::filesystem::path loadFile = filename;
-    std::thread([=, this]() {
-      m_busy.start("Loading");
-      createScene(loadFile);
-      m_busy.stop();
-    }).detach();  // Load the scene in a separate thread
+    // The current scene is rendered until the new one is complete (updateSceneSwap)
+    const SceneCommands commands{.staging = &m_sceneSwap.getStaging(),
+                                 .cmdPool = m_sceneSwap.getCommandPool(),
+                                 .queue   = [this](VkCommandBuffer cmd, bool isBlasBuild) {
+                                   m_sceneSwap.queueCommands(cmd, isBlasBuild);
+                                 }};
+    m_sceneSwap.start(m_resources, found, [this, found, commands](SceneSlot& slot) {
+      const auto start = std::chrono::steady_clock::now();
+      const bool ok    = loadScene(found, slot, commands);
+      m_metrics.addSceneLoad(ok, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      IdleScheduler::wakeUp();  // The main loop may be waiting for input
+      return ok;
+    });
   }
   else if(nvutils::extensionMatches(filename, ".hdr"))
   {
     createHDR(filename);
     m_resources.settings.envSystem                 = shaderio::EnvSystem::eHdr;
-    m_pathTracer.m_pushConst.fireflyClampThreshold = m_resources.hdrIbl.getIntegral();
+    m_pathTracer.m_pushConst.fireflyClampThreshold = m_resources.hdrIbl->getIntegral();
+    resetFrame();
   }
+}
 
-  resetFrame();
+//--------------------------------------------------------------------------------------------------
+// Add an instance of a glTF file to the scene (SceneComposition), uploaded here the first time
+void GltfRenderer::addToScene(const std::filesystem::path& filename)
+{
+  const std::filesystem::path found = nvutils::findFile(filename, nvsamples::getResourcesDirs());
+  if(!found.has_filename())
+  {
+    LOGE("Cannot find file: %s\n", nvutils::utf8FromPath(filename).c_str());
+    return;
+  }
+
+  VkCommandBuffer cmd{};
+  nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
+  nvvk::StagingUploader uploader;
+  uploader.init(&m_resources.allocator, true);
+  const bool added = m_composition.add(cmd, m_resources, uploader, found);
+  nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
+  uploader.deinit();
+  if(added)
+  {
+    resetFrame();
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
 // Save the scene
 bool GltfRenderer::save(const std::filesystem::path& filename)
 {
-  if(m_resources.scene.valid() && !filename.empty())
+  if(m_resources.scene->valid() && !filename.empty())
   {
     // First, copy the camera
     nvvkgltf::RenderCamera camera;
@@ -497,10 +1000,10 @@ bool GltfRenderer::save(const std::filesystem::path& filename)
     camera.yfov  = glm::radians(m_resources.cameraManip->getFov());
     camera.znear = m_resources.cameraManip->getClipPlanes().x;
     camera.zfar  = m_resources.cameraManip->getClipPlanes().y;
-    m_resources.scene.setSceneCamera(camera);
+    m_resources.scene->setSceneCamera(camera);
 
     // Saving the scene
-    return m_resources.scene.save(filename);
+    return m_resources.scene->save(filename);
   }
   return false;
 }
@@ -510,7 +1013,8 @@ bool GltfRenderer::save(const std::filesystem::path& filename)
 void GltfRenderer::tonemap(VkCommandBuffer cmd)
 {
   NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
-  auto timerSection = m_profilerGpuTimer.cmdFrameSection(cmd, __FUNCTION__);
+  auto timerSection = m_profilerGpuTimer.cmdFrameSection(cmd, "Tonemap");
+  auto traceSection = g_traceExport.cmdSection(cmd, "Tonemap");
 
   m_resources.tonemapper.runCompute(cmd, m_resources.gBuffers.getSize(), m_resources.tonemapperData,
                                     m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered),
@@ -525,9 +1029,9 @@ void GltfRenderer::silhouette(VkCommandBuffer cmd)
   if(m_resources.selectedObject > -1)
   {
     NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
-    auto timerSection = m_profilerGpuTimer.cmdFrameSection(cmd, __FUNCTION__);
+    auto timerSection = m_profilerGpuTimer.cmdFrameSection(cmd, "Silhouette");
+    auto traceSection = g_traceExport.cmdSection(cmd, "Silhouette");
 
-    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
     std::vector<VkDescriptorImageInfo> imageInfos = {
         m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgSelection),
         m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgTonemapped),
@@ -538,10 +1042,12 @@ void GltfRenderer::silhouette(VkCommandBuffer cmd)
 
 
 //--------------------------------------------------------------------------------------------------
-// Load the scene
+// Load the scene, replacing the current one: its command buffers are processed by the render loop
+// before rendering again
 void GltfRenderer::createScene(const std::filesystem::path& sceneFilename)
 {
   nvutils::ScopedTimer st(__FUNCTION__);
+  TRACE_SCOPE("GltfRenderer::createScene");
   m_uiSceneGraph.setModel(nullptr);
 
   if(sceneFilename.empty())
@@ -549,15 +1055,50 @@ void GltfRenderer::createScene(const std::filesystem::path& sceneFilename)
     return;
   }
 
+  // Duration of the load, for the metrics
+  const auto loadStart   = std::chrono::steady_clock::now();
+  auto       loadSeconds = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count(); };
+
   std::filesystem::path filename = nvutils::findFile(sceneFilename, nvsamples::getResourcesDirs());
   if(!filename.has_filename())
   {
     LOGE("Cannot find file: %s\n", nvutils::utf8FromPath(sceneFilename).c_str());
+    m_metrics.addSceneLoad(false, loadSeconds());
     return;
   }
 
+  waitSequenceStep();  // Reads the animations of the scene being replaced
+  if(!loadScene(filename, SceneSwap::getCurrentSlot(m_resources), renderLoopCommands()))
+  {
+    m_metrics.addSceneLoad(false, loadSeconds());
+    return;
+  }
+
+  activateScene(filename);
+  m_metrics.addSceneLoad(true, loadSeconds());
+}
+
+//--------------------------------------------------------------------------------------------------
+// Commands of the current scene: queued for the render loop (processQueuedCommandBuffers)
+GltfRenderer::SceneCommands GltfRenderer::renderLoopCommands()
+{
+  return {.staging = &m_resources.staging,
+          .cmdPool = m_transientCmdPool,
+          .queue   = [this](VkCommandBuffer cmd, bool isBlasBuild) {
+            std::lock_guard<std::mutex> lock(m_cmdBufferQueueMutex);
+            m_cmdBufferQueue.push({cmd, isBlasBuild});
+          }};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Load the glTF or OBJ file in the slot and create its Vulkan scene. Only touches the slot and
+// the commands: runs on the thread of the scene swap.
+bool GltfRenderer::loadScene(const std::filesystem::path& filename, SceneSlot& slot, const SceneCommands& commands)
+{
+  TRACE_SCOPE("GltfRenderer::loadScene");
+
   // Convert OBJ to glTF
-  if(nvutils::extensionMatches(sceneFilename, ".obj"))
+  if(nvutils::extensionMatches(filename, ".obj"))
   {
     tinyobj::ObjReaderConfig readerConfig;
     readerConfig.mtl_search_path = std::filesystem::path(filename).parent_path().string();
@@ -572,53 +1113,91 @@ void GltfRenderer::createScene(const std::filesystem::path& sceneFilename)
       TinyConverter   converter;
       tinygltf::Model model;
       converter.convert(model, reader);
-      m_resources.scene.takeModel(std::move(model));
+      slot.scene.takeModel(std::move(model));
     }
     else
     {
       LOGE("Error loading OBJ: %s\n", error.c_str());
       LOGW("Warning: %s\n", warn.c_str());
-      return;
+      return false;
     }
   }
   else
   {
     LOGI("Loading scene: %s\n", nvutils::utf8FromPath(filename).c_str());
-    if(!m_resources.scene.load(filename))  // Loading the scene
+    if(!slot.scene.load(filename))  // Loading the scene
     {
       LOGE("Error loading scene: %s\n", nvutils::utf8FromPath(filename).c_str());
-      return;
+      return false;
     }
   }
 
   // Scene is loaded, we can create the Vulkan scene
-  createVulkanScene();
+  createVulkanScene(slot, commands);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The scene of the current slot is new: the UI, the camera and the textures follow it
+void GltfRenderer::activateScene(const std::filesystem::path& filename)
+{
+  // The assets were added to the previous scene
+  m_composition.clear(m_resources);
+
+  // Build mapping for faster node lookups
+  updateNodeToRenderNodeMap();
 
   // UI needs to be updated
-  m_uiSceneGraph.setModel(&m_resources.scene.getModel());
-  m_uiSceneGraph.setBbox(m_resources.scene.getSceneBounds());
-  m_resources.settings.infinitePlaneDistance = m_resources.scene.getSceneBounds().min().y;  // Set the infinite plane distance to the bottom of the scene
+  m_uiSceneGraph.setModel(&m_resources.scene->getModel());
+  m_uiSceneGraph.setBbox(m_resources.scene->getSceneBounds());
+  m_resources.settings.infinitePlaneDistance = m_resources.scene->getSceneBounds().min().y;  // Set the infinite plane distance to the bottom of the scene
 
   // Set camera from scene
-  nvvkgltf::addSceneCamerasToWidget(m_resources.cameraManip, filename, m_resources.scene.getRenderCameras(),
-                                    m_resources.scene.getSceneBounds());
+  nvvkgltf::addSceneCamerasToWidget(m_resources.cameraManip, filename, m_resources.scene->getRenderCameras(),
+                                    m_resources.scene->getSceneBounds());
 
   // Default sky parameters
   m_resources.skyParams = {};
 
   // Need to update (push) all textures
+  m_resources.memoryReport.setSceneTextures(SceneSwap::getCurrentSlot(m_resources).allocator, m_resources.sceneVk->textures());
   updateTextures();
 }
 
+//--------------------------------------------------------------------------------------------------
+// Scene loaded in the background: once all its command buffers were submitted, it replaces the
+// current scene at the beginning of the frame
+void GltfRenderer::updateSceneSwap()
+{
+  if(m_sceneSwap.isLoading())
+  {
+    m_idle.markActive();
+  }
+  SceneSlot* slot = m_sceneSwap.update(m_resources);
+  if(slot == nullptr)
+  {
+    return;
+  }
+
+  waitSequenceStep();
+  m_sceneSwap.swap(m_resources, *slot);
+  m_resources.selectedObject = -1;
+  m_uiSceneGraph.selectNode(-1);
+  m_rasterizer.freeRecordCommandBuffer();
+  m_ddgirasterizer.freeRecordCommandBuffer();
+  activateScene(m_sceneSwap.getFilename());
+  resetFrame();
+}
+
 //--------------------------------------------------------------------------------------------------
 // This function creates the Vulkan scene from the glTF model
 // It builds the bottom-level and top-level acceleration structure
 // The function is called when the scene is loaded
-void GltfRenderer::createVulkanScene()
+void GltfRenderer::createVulkanScene(SceneSlot& slot, const SceneCommands& commands)
 {
   VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR
                                                | VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
-  if(m_resources.scene.hasAnimation())
+  if(slot.scene.hasAnimation())
   {
     flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;  // Allow update
   }
@@ -627,18 +1206,21 @@ void GltfRenderer::createVulkanScene()
     // Create and queue command buffer for scene data upload (vertices, indices, materials, etc.)
     // This work happens asynchronously via the command buffer queue
     VkCommandBuffer cmd{};
-    nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
+    nvvk::beginSingleTimeCommands(cmd, m_device, commands.cmdPool);
 
-    m_resources.sceneVk.create(cmd, m_resources.staging, m_resources.scene, false);  // Creating the scene in Vulkan buffers
-    m_resources.staging.cmdUploadAppended(cmd);
     {
-      std::lock_guard<std::mutex> lock(m_cmdBufferQueueMutex);
-      m_cmdBufferQueue.push({cmd, false});  // Not a BLAS build command
+      MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eGeometry);
+      slot.sceneVk.create(cmd, *commands.staging, slot.scene, false);  // Creating the scene in Vulkan buffers
     }
+    commands.staging->cmdUploadAppended(cmd);
+    commands.queue(cmd, false);  // Not a BLAS build command
   }
 
+  // Acceleration structures, with their build scratch
+  MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eAccelerationStructures);
+
   // Create the bottom-level acceleration structure descriptors (no building yet)
-  m_resources.sceneRtx.createBottomLevelAccelerationStructure(m_resources.scene, m_resources.sceneVk, flags);
+  slot.sceneRtx.createBottomLevelAccelerationStructure(slot.scene, slot.sceneVk, flags);
 
   // Build the bottom-level acceleration structure
   // Memory-conscious approach: build within a fixed memory budget using multiple command buffers if needed
@@ -650,32 +1232,22 @@ void GltfRenderer::createVulkanScene()
     do
     {
       VkCommandBuffer cmd{};
-      nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
+      nvvk::beginSingleTimeCommands(cmd, m_device, commands.cmdPool);
       // This won't compact the BLAS, but will create the acceleration structure
-      finished = m_resources.sceneRtx.cmdBuildBottomLevelAccelerationStructure(cmd, 512'000'000);
-      {
-        std::lock_guard<std::mutex> lock(m_cmdBufferQueueMutex);
-        m_cmdBufferQueue.push({cmd, true});  // Mark as BLAS build command for immediate compaction
-      }
-
+      finished = slot.sceneRtx.cmdBuildBottomLevelAccelerationStructure(cmd, 512'000'000);
+      commands.queue(cmd, true);  // Mark as BLAS build command for immediate compaction
     } while(!finished);
 
     // Queue TLAS building for after all BLAS work completes
     // TLAS is the top-level structure referencing all bottom-level acceleration structures
     {
       VkCommandBuffer cmd{};
-      nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
-      m_resources.sceneRtx.cmdCreateBuildTopLevelAccelerationStructure(cmd, m_resources.staging, m_resources.scene);
-      m_resources.staging.cmdUploadAppended(cmd);
-      {
-        std::lock_guard<std::mutex> lock(m_cmdBufferQueueMutex);
-        m_cmdBufferQueue.push({cmd, false});  // Not a BLAS build command
-      }
+      nvvk::beginSingleTimeCommands(cmd, m_device, commands.cmdPool);
+      slot.sceneRtx.cmdCreateBuildTopLevelAccelerationStructure(cmd, *commands.staging, slot.scene);
+      commands.staging->cmdUploadAppended(cmd);
+      commands.queue(cmd, false);  // Not a BLAS build command
     }
   }
-
-  // Build mapping for faster node lookups
-  updateNodeToRenderNodeMap();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -709,8 +1281,10 @@ void GltfRenderer::clearGbuffer(VkCommandBuffer cmd)
 void GltfRenderer::createResourceBuffers()
 {
   // Create the buffer of the current camera transformation, changing at each frame
+  // (copied to the frame info of each view in multi-view)
   NVVK_CHECK(m_resources.allocator.createBuffer(m_resources.bFrameInfo, sizeof(shaderio::SceneFrameInfo),
-                                                VK_BUFFER_USAGE_2_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT,
+                                                VK_BUFFER_USAGE_2_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT
+                                                    | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT,
                                                 VMA_MEMORY_USAGE_CPU_TO_GPU));
   NVVK_DBG_NAME(m_resources.bFrameInfo.buffer);
   // Create the buffer of sky parameters, updated at each frame
@@ -751,7 +1325,11 @@ void GltfRenderer::createDescriptorSets()
       m_device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, &m_resources.descriptorSetLayout[0]));
   NVVK_DBG_NAME(m_resources.descriptorSetLayout[0]);
 
-  std::vector<VkDescriptorPoolSize> poolSize  = m_resources.descriptorBinding[0].calculatePoolSizes();
+  // One set per scene slot
+  std::vector<VkDescriptorPoolSize> poolSize = m_resources.descriptorBinding[0].calculatePoolSizes();
+  for(VkDescriptorPoolSize& size : poolSize)
+    size.descriptorCount *= uint32_t(m_resources.sceneSlots.size());
+  poolSize.push_back({VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3 * 2});  // The two G-buffer sets of the DDGI rasterizer
   VkDescriptorPoolCreateInfo        dpoolInfo = {
              .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
              .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT |  // allows descriptor sets to be updated after they have been bound to a command buffer
@@ -769,8 +1347,12 @@ void GltfRenderer::createDescriptorSets()
       .descriptorSetCount = 1,
       .pSetLayouts        = &m_resources.descriptorSetLayout[0],
   };
-  NVVK_CHECK(vkAllocateDescriptorSets(m_device, &allocInfo, &m_resources.descriptorSet));
-  NVVK_DBG_NAME(m_resources.descriptorSet);
+  for(SceneSlot& slot : m_resources.sceneSlots)
+  {
+    NVVK_CHECK(vkAllocateDescriptorSets(m_device, &allocInfo, &slot.descriptorSet));
+    NVVK_DBG_NAME(slot.descriptorSet);
+  }
+  m_resources.descriptorSet = SceneSwap::getCurrentSlot(m_resources).descriptorSet;
 
 
   // 1: Descriptor PUSH: top level acceleration structure and the output image
@@ -800,14 +1382,18 @@ void GltfRenderer::createDescriptorSets()
       m_device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, &m_resources.gbufferDescSetlayout));
   NVVK_DBG_NAME(m_resources.gbufferDescSetlayout);
 
+  // Two sets, written alternately when the transient images are reallocated (see DDGIRasterizer)
+  const std::array<VkDescriptorSetLayout, 2> gbufferLayouts{m_resources.gbufferDescSetlayout, m_resources.gbufferDescSetlayout};
   allocInfo = VkDescriptorSetAllocateInfo{
     .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
     .descriptorPool = m_resources.descriptorPool,
-    .descriptorSetCount = 1,
-    .pSetLayouts = &m_resources.gbufferDescSetlayout,
+    .descriptorSetCount = uint32_t(gbufferLayouts.size()),
+    .pSetLayouts = gbufferLayouts.data(),
   };
-  NVVK_CHECK(vkAllocateDescriptorSets(m_device, &allocInfo, &m_resources.gbufferDescSet));
-  NVVK_DBG_NAME(m_resources.gbufferDescSet);
+  NVVK_CHECK(vkAllocateDescriptorSets(m_device, &allocInfo, m_resources.gbufferDescSets.data()));
+  NVVK_DBG_NAME(m_resources.gbufferDescSets[0]);
+  NVVK_DBG_NAME(m_resources.gbufferDescSets[1]);
+  m_resources.gbufferDescSet = m_resources.gbufferDescSets[0];
 
   
 
@@ -818,6 +1404,7 @@ void GltfRenderer::createDescriptorSets()
 void GltfRenderer::compileShaders()
 {
   nvutils::ScopedTimer st(__FUNCTION__);
+  TRACE_SCOPE("GltfRenderer::compileShaders");
   if(m_resources.settings.renderSystem == RenderingMode::ePathtracer)
   {
     m_pathTracer.compileShader(m_resources);
@@ -831,143 +1418,46 @@ void GltfRenderer::compileShaders()
   }
 }
 
-// imageview:
-VkImageView createImageViewForGbuffer(const VkImage& image, const VkDevice& device) {
-    VkImageViewCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    createInfo.image = image;
-    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    createInfo.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    createInfo.components.r = VK_COMPONENT_SWIZZLE_R;
-    createInfo.components.g = VK_COMPONENT_SWIZZLE_G;
-    createInfo.components.b = VK_COMPONENT_SWIZZLE_B;
-    createInfo.components.a = VK_COMPONENT_SWIZZLE_A;
-    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    createInfo.subresourceRange.baseMipLevel = 0;
-    createInfo.subresourceRange.levelCount = 1;
-    createInfo.subresourceRange.baseArrayLayer = 0;
-    createInfo.subresourceRange.layerCount = 1;
-    VkImageView imageView;
-    if(vkCreateImageView(device, &createInfo, nullptr, &imageView) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create image views");
-    }
-    return imageView;
-        
-}
-
-VkSampler createSamplerforGbuffer(VkDevice device) {
-    VkSamplerCreateInfo samplerInfo = {};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_NEAREST;
-    samplerInfo.minFilter = VK_FILTER_NEAREST;;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = 16;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
-    VkSampler textureSampler;
-    if(vkCreateSampler(device, &samplerInfo, nullptr, &
-        textureSampler) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create a sampler");
-    }
-    return textureSampler;
-
-}
-
 
 //--------------------------------------------------------------------------------------------------
 // Update the textures: this is called when the scene is loaded
 // Textures are updated in the descriptor set (0)
 void GltfRenderer::updateTextures()
 {
-    {
-        // Now do the textures
-        nvvk::WriteSetContainer write{};
-        VkWriteDescriptorSet allTextures = m_resources.descriptorBinding[0].getWriteSet(shaderio::BindingPoints::eTextures);
-        allTextures.dstSet = m_resources.descriptorSet;
-        allTextures.descriptorCount = m_resources.sceneVk.nbTextures();
-        if (allTextures.descriptorCount == 0)
-            return;
-        write.append(allTextures, m_resources.sceneVk.textures().data());
-        vkUpdateDescriptorSets(m_device, write.size(), write.data(), 0, nullptr);
-    }
-
-    {
-        // תҪдdescriptorSet
-        std::vector<VkWriteDescriptorSet> writes{};
-        m_resources.gres.imageViews.clear();
-        m_resources.gres.sampler = createSamplerforGbuffer(m_device);
-        
-        std::array<VkDescriptorImageInfo, 3> imageinfos;
-        for (uint32_t i = 0; i < 3; i++) {
-            VkImageView& imageView = m_resources.gres.imageViews.emplace_back();
-            imageView = createImageViewForGbuffer(m_resources.gBuffersDefer.getColorImage(i), m_device);
-            imageinfos[i] = {
-                .sampler = m_resources.gres.sampler,
-                .imageView = imageView,
-                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            };
-            VkWriteDescriptorSet write{};
-            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write.pNext = nullptr;
-            write.dstSet = m_resources.gbufferDescSet;
-            write.dstBinding = i;
-            write.dstArrayElement = 0;
-            write.descriptorCount = 1;
-            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            write.pImageInfo = &imageinfos[i];
-            write.pBufferInfo = nullptr;
-            write.pTexelBufferView = nullptr;
-
-            writes.push_back(write);
-        }
-        
-        vkUpdateDescriptorSets(m_device, writes.size(), writes.data(), 0, nullptr);
-    }
+  // Now do the textures
+  nvvk::WriteSetContainer write{};
+  VkWriteDescriptorSet    allTextures = m_resources.descriptorBinding[0].getWriteSet(shaderio::BindingPoints::eTextures);
+  allTextures.dstSet                  = m_resources.descriptorSet;
+  allTextures.descriptorCount         = m_resources.sceneVk->nbTextures();
+  if(allTextures.descriptorCount == 0)
+    return;
+  write.append(allTextures, m_resources.sceneVk->textures().data());
+  vkUpdateDescriptorSets(m_device, write.size(), write.data(), 0, nullptr);
 }
-/*
-VkWriteDescriptorSet allTextures{};
-        allTextures.descriptorCount
-        allTextures.dstSet = m_resources.gbufferDescSet;
-        allTextures.descriptorCount = 1;
-        allTextures.dstBinding = 0;
-        VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        VkSampler sampler = m_resources.gBuffersDefer.getDescriptorImageInfo(0).sampler;
-
-        write.append(allTextures, m_resources.gBuffersDefer.getColorImageView(0), imageLayout, sampler);
-        allTextures.dstBinding = 1;
-        write.append(allTextures, m_resources.gBuffersDefer.getColorImageView(1), imageLayout, sampler);
-        allTextures.dstBinding = 2;
-        write.append(allTextures, m_resources.gBuffersDefer.getColorImageView(2), imageLayout, sampler);
-*/
 
 //--------------------------------------------------------------------------------------------------
 // Update the HDR images : add the 2D images to allTextures and the cube images to allTexturesCube
 //
 void GltfRenderer::updateHdrImages()
 {
-  const std::vector<nvvk::Image>& hdrPreconvolutedTextures = m_resources.hdrDome.getTextures();
+  const std::vector<nvvk::Image>& hdrPreconvolutedTextures = m_resources.hdrDome->getTextures();
   nvvk::WriteSetContainer         write{};
-  VkWriteDescriptorSet hdrTextures = m_resources.descriptorBinding[0].getWriteSet(shaderio::BindingPoints::eTexturesHdr,
-                                                                                  m_resources.descriptorSet, HDR_IMAGE_INDEX, 1U);
-  // Adding the HDR image (RGBA32F)
-  write.append(hdrTextures, m_resources.hdrIbl.getHdrImage());
-  // Add pre-integrated LUT BRDF
-  hdrTextures.dstArrayElement = HDR_LUT_INDEX;
-  write.append(hdrTextures, hdrPreconvolutedTextures[2]);
-
-  // Adding cube images: diffuse, glossy
-  VkWriteDescriptorSet hdrTexturesCube =
-      m_resources.descriptorBinding[0].getWriteSet(shaderio::BindingPoints::eTexturesCube, m_resources.descriptorSet, 0, 2U);
-  write.append(hdrTexturesCube, m_resources.hdrDome.getTextures().data());
+  // The environment is in the set of each scene slot
+  for(const SceneSlot& slot : m_resources.sceneSlots)
+  {
+    VkWriteDescriptorSet hdrTextures = m_resources.descriptorBinding[0].getWriteSet(shaderio::BindingPoints::eTexturesHdr,
+                                                                                    slot.descriptorSet, HDR_IMAGE_INDEX, 1U);
+    // Adding the HDR image (RGBA32F)
+    write.append(hdrTextures, m_resources.hdrIbl->getHdrImage());
+    // Add pre-integrated LUT BRDF
+    hdrTextures.dstArrayElement = HDR_LUT_INDEX;
+    write.append(hdrTextures, hdrPreconvolutedTextures[2]);
+
+    // Adding cube images: diffuse, glossy
+    VkWriteDescriptorSet hdrTexturesCube =
+        m_resources.descriptorBinding[0].getWriteSet(shaderio::BindingPoints::eTexturesCube, slot.descriptorSet, 0, 2U);
+    write.append(hdrTexturesCube, m_resources.hdrDome->getTextures().data());
+  }
 
   vkUpdateDescriptorSets(m_device, write.size(), write.data(), 0, nullptr);
 }
@@ -1011,8 +1501,28 @@ bool GltfRenderer::updateFrameCounter()
 //--------------------------------------------------------------------------------------------------
 // Create or load the HDR environment map
 // If the filename is empty, a default environment map (empty) is created, which allow the descriptor set to be updated
+// The previous environment goes to the deletion queue, the frames in flight may still sample it.
+// The new one is loaded meanwhile; only the descriptor update waits for these frames, since the
+// sets of the slots are bound by the pending command buffers.
 void GltfRenderer::createHDR(const std::filesystem::path& hdrFilename)
 {
+  MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eEnvironment);
+  uint64_t            retiredValue = 0;
+  if(m_resources.hdrIbl)
+  {
+    std::shared_ptr<nvvk::HdrIbl>          prevIbl(std::move(m_resources.hdrIbl));
+    std::shared_ptr<nvshaders::HdrEnvDome> prevDome(std::move(m_resources.hdrDome));
+    retiredValue = m_resources.deletionQueue.retire([prevIbl, prevDome]() {
+      prevDome->deinit();
+      prevIbl->deinit();
+    });
+  }
+
+  m_resources.hdrIbl = std::make_unique<nvvk::HdrIbl>();
+  m_resources.hdrIbl->init(&m_resources.allocator, &m_resources.samplerPool);
+  m_resources.hdrDome = std::make_unique<nvshaders::HdrEnvDome>();
+  m_resources.hdrDome->init(&m_resources.allocator, &m_resources.samplerPool, m_app->getQueue(0));
+
   VkCommandBuffer cmd{};
   nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
   nvvk::StagingUploader uploader;
@@ -1022,28 +1532,30 @@ void GltfRenderer::createHDR(const std::filesystem::path& hdrFilename)
   std::filesystem::path filename;
   if(!hdrFilename.empty())
     filename = nvutils::findFile(hdrFilename, nvsamples::getResourcesDirs());
-  m_resources.hdrIbl.destroyEnvironment();
-  m_resources.hdrIbl.loadEnvironment(cmd, uploader, filename, true);
+  m_resources.hdrIbl->loadEnvironment(cmd, uploader, filename, true);
 
   uploader.cmdUploadAppended(cmd);
 
   // Generate mipmaps for the HDR image
-  VkExtent2D hdrSize = m_resources.hdrIbl.getHdrImageSize();
+  VkExtent2D hdrSize = m_resources.hdrIbl->getHdrImageSize();
   if(hdrSize.width > 1 && hdrSize.height > 1)
   {
-    nvvk::cmdGenerateMipmaps(cmd, m_resources.hdrIbl.getHdrImage().image, hdrSize, nvvk::mipLevels(hdrSize));
+    nvvk::cmdGenerateMipmaps(cmd, m_resources.hdrIbl->getHdrImage().image, hdrSize, nvvk::mipLevels(hdrSize));
   }
 
   nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
   uploader.deinit();
 
   // Create the diffuse and glossy cube maps for the HDR image (raster)
-  m_resources.hdrDome.create(m_resources.hdrIbl.getDescriptorSet(), m_resources.hdrIbl.getDescriptorSetLayout(),
+  m_resources.hdrDome->create(m_resources.hdrIbl->getDescriptorSet(), m_resources.hdrIbl->getDescriptorSetLayout(),
                              std::span(hdr_prefilter_diffuse_slang), std::span(hdr_prefilter_glossy_slang),
                              std::span(hdr_integrate_brdf_slang), std::span(hdr_dome_slang));
 
+  // The submitted frames are done with the sets and the previous environment, destroyed here
+  if(retiredValue > 0)
+    m_resources.deletionQueue.wait(retiredValue);
   updateHdrImages();
-  m_resources.hdrDome.setOutImage(m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
+  m_resources.hdrDome->setOutImage(m_resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1066,6 +1578,14 @@ void GltfRenderer::destroyResources()
     }
   }
 
+  waitSequenceStep();
+
+  // Before anything is destroyed, to report what the scene uses
+  m_resources.memoryReport.deinit();
+  m_sceneSwap.deinit(m_resources);
+  m_composition.deinit(m_resources);
+  m_resources.deletionQueue.deinit();
+
   m_resources.allocator.destroyBuffer(m_resources.bFrameInfo);
   m_resources.allocator.destroyBuffer(m_resources.bSkyParams);
 
@@ -1074,17 +1594,28 @@ void GltfRenderer::destroyResources()
   vkDestroyDescriptorPool(m_device, m_resources.descriptorPool, nullptr);
   vkDestroyCommandPool(m_device, m_transientCmdPool, nullptr);
 
+  g_traceExport.deinit();
   m_profilerGpuTimer.deinit();
   g_profilerManager.destroyTimeline(m_profilerTimeline);
   m_silhouette.deinit(m_resources);
+  m_heatmap.deinit(m_resources);
+  m_metrics.deinit();
+  m_imageOutput.deinit(m_resources);
 
   m_resources.tonemapper.deinit();
   m_resources.gBuffers.deinit();
-  m_resources.gBuffersDefer.deinit();
-  m_resources.sceneVk.deinit();
-  m_resources.sceneRtx.deinit();
-  m_resources.hdrIbl.deinit();
-  m_resources.hdrDome.deinit();
+  m_resources.frameGraph.deinit();
+  for(SceneSlot& slot : m_resources.sceneSlots)
+  {
+    slot.sceneVk.deinit();
+    slot.sceneRtx.deinit();
+    slot.allocator.deinit();
+  }
+  if(m_resources.hdrIbl)
+  {
+    m_resources.hdrIbl->deinit();
+    m_resources.hdrDome->deinit();
+  }
   m_resources.samplerPool.deinit();
   m_resources.staging.deinit();
   m_rayPicker.deinit();
@@ -1096,11 +1627,11 @@ void GltfRenderer::destroyResources()
 // Update the animation
 bool GltfRenderer::updateAnimation(VkCommandBuffer cmd)
 {
-  if(m_resources.scene.hasAnimation() && m_animControl.doAnimation())
+  if(m_resources.scene->hasAnimation() && m_animControl.doAnimation())
   {
     NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
     float                    deltaTime = m_animControl.deltaTime();
-    nvvkgltf::AnimationInfo& animInfo  = m_resources.scene.getAnimationInfo(m_animControl.currentAnimation);
+    nvvkgltf::AnimationInfo& animInfo  = m_resources.scene->getAnimationInfo(m_animControl.currentAnimation);
     if(m_animControl.isReset())
     {
       animInfo.reset();
@@ -1110,8 +1641,8 @@ bool GltfRenderer::updateAnimation(VkCommandBuffer cmd)
       animInfo.incrementTime(deltaTime);
     }
 
-    m_resources.scene.updateAnimation(m_animControl.currentAnimation);
-    m_resources.scene.updateRenderNodes();
+    m_resources.scene->updateAnimation(m_animControl.currentAnimation);
+    m_resources.scene->updateRenderNodes();
 
     m_animControl.clearStates();
 
@@ -1120,6 +1651,253 @@ bool GltfRenderer::updateAnimation(VkCommandBuffer cmd)
   return false;
 }
 
+//--------------------------------------------------------------------------------------------------
+// Animation sequence: the time advances by a fixed 1/fps step, only once the current step has
+// accumulated `sequenceSamples` iterations and was written (see updateFrameCapture).
+// The result does not depend on the frame rate, and each frame gets the same number of samples.
+// Returns true when the animation moved to a new step.
+bool GltfRenderer::updateSequence()
+{
+  const Settings&          settings = m_resources.settings;
+  nvvkgltf::AnimationInfo& animInfo = m_resources.scene->getAnimationInfo(m_animControl.currentAnimation);
+
+  // Start of the sequence
+  if(m_sequence.step < 0)
+  {
+    const float duration  = animInfo.end - animInfo.start;
+    m_sequence.numSteps   = settings.sequenceFrames > 0 ? settings.sequenceFrames :
+                                                          int(std::floor(duration * settings.sequenceFps + 1e-3f)) + 1;
+    m_sequence.step       = 0;
+    m_sequence.converged  = false;
+    m_sequence.finished   = false;
+    m_animControl.play    = false;
+    LOGI("Animation sequence: %d frames at %.2f fps, %d iterations each\n", m_sequence.numSteps, settings.sequenceFps,
+         settings.sequenceSamples);
+    evaluateSequenceStep(0);
+    return true;
+  }
+
+  if(!m_sequence.converged)
+    return false;
+
+  // The converged step has been submitted for writing, move to the next one
+  if(m_sequence.step + 1 >= m_sequence.numSteps)
+  {
+    if(!m_sequence.finished)
+    {
+      m_sequence.finished = true;
+      LOGI("Animation sequence: done\n");
+      m_app->close();
+    }
+    return false;
+  }
+
+  m_sequence.step++;
+  m_sequence.converged = false;
+  waitSequenceStep();  // Normally done long ago, the step took many iterations
+  if(m_sequence.nextReady)
+  {
+    applySequenceStep(m_sequence.step);
+  }
+  else
+  {
+    evaluateSequenceStep(m_sequence.step);
+  }
+  m_sequence.nextReady = false;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Evaluate the animation on the CPU at the time of a sequence step.
+// The time is computed from the step index, not accumulated, to avoid drifting.
+void GltfRenderer::evaluateSequenceStep(int step)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  nvvkgltf::AnimationInfo& animInfo = m_resources.scene->getAnimationInfo(m_animControl.currentAnimation);
+  animInfo.currentTime = std::min(animInfo.start + float(step) / m_resources.settings.sequenceFps, animInfo.end);
+  m_resources.scene->updateAnimation(m_animControl.currentAnimation);
+  m_resources.scene->updateRenderNodes();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sample the animation of a later step on a thread. The scene (nodes, render nodes, time) stays
+// that of the step being rendered: the thread only reads the animations, accessors and buffers
+// of the model, which do not change while it is running (see waitSequenceStep).
+void GltfRenderer::prepareSequenceStep(int step)
+{
+  waitSequenceStep();
+  m_sequence.nextReady = false;
+  m_sequence.nextPoses.assign(m_resources.scene->getModel().nodes.size(), {});
+
+  const nvvkgltf::AnimationInfo& animInfo = m_resources.scene->getAnimationInfo(m_animControl.currentAnimation);
+  const float time      = std::min(animInfo.start + float(step) / m_resources.settings.sequenceFps, animInfo.end);
+  const int   animation = m_animControl.currentAnimation;
+  m_sequence.worker     = std::thread([this, animation, time]() {
+    TRACE_SCOPE("GltfRenderer::prepareSequenceStep");
+    // On failure the step is evaluated by the scene at the boundary
+    m_sequence.nextReady = sampleAnimation(m_resources.scene->getModel(), animation, time, m_sequence.nextPoses);
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+// Join the thread sampling the next step. Called before the model it reads can change.
+void GltfRenderer::waitSequenceStep()
+{
+  if(m_sequence.worker.joinable())
+    m_sequence.worker.join();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sample the channels of a glTF animation at `time`, writing only the animated members of `poses`.
+// Same interpolation as the scene: STEP, LINEAR (slerp for rotations) and CUBICSPLINE.
+// Returns false for data it does not read (sparse or non-normalized integer accessors).
+bool GltfRenderer::sampleAnimation(const tinygltf::Model& model, int animation, float time, std::vector<Sequence::NodePose>& poses)
+{
+  if(animation < 0 || animation >= int(model.animations.size()))
+    return false;
+
+  // Accessor as floats; integer components are normalized, as allowed for rotations and weights
+  auto readAccessor = [&model](int index, std::vector<float>& values) {
+    const tinygltf::Accessor& accessor = model.accessors[index];
+    if(accessor.sparse.isSparse || accessor.bufferView < 0)
+      return false;
+    const tinygltf::BufferView& view       = model.bufferViews[accessor.bufferView];
+    const uint8_t*              data       = model.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset;
+    const int                   components = tinygltf::GetNumComponentsInType(accessor.type);
+    const int                   size       = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+    const size_t                stride     = view.byteStride > 0 ? view.byteStride : size_t(components * size);
+    if(accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT && !accessor.normalized)
+      return false;
+    values.resize(accessor.count * components);
+    for(size_t i = 0; i < accessor.count; i++)
+    {
+      const uint8_t* element = data + i * stride;
+      for(int c = 0; c < components; c++)
+      {
+        float& value = values[i * components + c];
+        switch(accessor.componentType)
+        {
+          case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            memcpy(&value, element + c * size, sizeof(float));
+            break;
+          case TINYGLTF_COMPONENT_TYPE_BYTE:
+            value = std::max(float(reinterpret_cast<const int8_t*>(element)[c]) / 127.0f, -1.0f);
+            break;
+          case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            value = float(element[c]) / 255.0f;
+            break;
+          case TINYGLTF_COMPONENT_TYPE_SHORT:
+            value = std::max(float(reinterpret_cast<const int16_t*>(element)[c]) / 32767.0f, -1.0f);
+            break;
+          case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+            value = float(reinterpret_cast<const uint16_t*>(element)[c]) / 65535.0f;
+            break;
+          default:
+            return false;
+        }
+      }
+    }
+    return true;
+  };
+
+  std::vector<float> inputs, outputs;
+  for(const tinygltf::AnimationChannel& channel : model.animations[animation].channels)
+  {
+    if(channel.target_node < 0 || channel.target_node >= int(poses.size()))
+      continue;
+    const tinygltf::AnimationSampler& sampler = model.animations[animation].samplers[channel.sampler];
+    if(!readAccessor(sampler.input, inputs) || !readAccessor(sampler.output, outputs) || inputs.empty())
+      return false;
+
+    // Keyframe interval and position in it, the time is clamped to the keyframes
+    const float  t     = std::clamp(time, inputs.front(), inputs.back());
+    const size_t next  = std::min(size_t(std::upper_bound(inputs.begin(), inputs.end(), t) - inputs.begin()), inputs.size() - 1);
+    const size_t prev  = next > 0 ? next - 1 : 0;
+    const float  delta = inputs[next] - inputs[prev];
+    const float  u     = delta > 0.0f ? (t - inputs[prev]) / delta : 0.0f;
+
+    const bool   isCubic    = sampler.interpolation == "CUBICSPLINE";
+    const size_t numValues  = outputs.size() / (inputs.size() * (isCubic ? 3 : 1));  // Components per keyframe
+    const bool   isRotation = channel.target_path == "rotation";
+    auto         value      = [&](size_t key, size_t c) { return outputs[(isCubic ? key * 3 + 1 : key) * numValues + c]; };
+
+    std::vector<double> result(numValues);
+    if(sampler.interpolation == "STEP" || prev == next)
+    {
+      for(size_t c = 0; c < numValues; c++)
+        result[c] = value(u >= 1.0f ? next : prev, c);
+    }
+    else if(isCubic)
+    {
+      // Hermite spline, the tangents are scaled by the interval
+      const float u2 = u * u, u3 = u2 * u;
+      for(size_t c = 0; c < numValues; c++)
+      {
+        const float outTangent = outputs[(prev * 3 + 2) * numValues + c] * delta;
+        const float inTangent  = outputs[(next * 3) * numValues + c] * delta;
+        result[c] = (2 * u3 - 3 * u2 + 1) * value(prev, c) + (u3 - 2 * u2 + u) * outTangent
+                    + (-2 * u3 + 3 * u2) * value(next, c) + (u3 - u2) * inTangent;
+      }
+    }
+    else if(isRotation)
+    {
+      // glTF stores x, y, z, w
+      auto quat = [&](size_t key) {
+        glm::quat q;
+        q.x = value(key, 0), q.y = value(key, 1), q.z = value(key, 2), q.w = value(key, 3);
+        return q;
+      };
+      const glm::quat q = glm::slerp(quat(prev), quat(next), u);
+      result            = {q.x, q.y, q.z, q.w};
+    }
+    else
+    {
+      for(size_t c = 0; c < numValues; c++)
+        result[c] = glm::mix(value(prev, c), value(next, c), u);
+    }
+
+    if(isRotation && result.size() == 4)
+    {
+      const glm::dvec4 q = glm::normalize(glm::dvec4(result[0], result[1], result[2], result[3]));
+      result             = {q.x, q.y, q.z, q.w};
+    }
+
+    Sequence::NodePose& pose = poses[channel.target_node];
+    if(channel.target_path == "translation")
+      pose.translation = std::move(result);
+    else if(isRotation)
+      pose.rotation = std::move(result);
+    else if(channel.target_path == "scale")
+      pose.scale = std::move(result);
+    else if(channel.target_path == "weights")
+      pose.weights = std::move(result);
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The step boundary: the animated members sampled by prepareSequenceStep replace those of the nodes
+void GltfRenderer::applySequenceStep(int step)
+{
+  std::vector<tinygltf::Node>& nodes    = m_resources.scene->getModel().nodes;
+  nvvkgltf::AnimationInfo&     animInfo = m_resources.scene->getAnimationInfo(m_animControl.currentAnimation);
+  for(size_t i = 0; i < std::min(nodes.size(), m_sequence.nextPoses.size()); i++)
+  {
+    Sequence::NodePose& pose = m_sequence.nextPoses[i];
+    if(!pose.translation.empty())
+      nodes[i].translation = std::move(pose.translation);
+    if(!pose.rotation.empty())
+      nodes[i].rotation = std::move(pose.rotation);
+    if(!pose.scale.empty())
+      nodes[i].scale = std::move(pose.scale);
+    if(!pose.weights.empty())
+      nodes[i].weights = std::move(pose.weights);
+  }
+  m_sequence.nextPoses.clear();
+  animInfo.currentTime = std::min(animInfo.start + float(step) / m_resources.settings.sequenceFps, animInfo.end);
+  m_resources.scene->updateRenderNodes();
+}
+
 //--------------------------------------------------------------------------------------------------
 // Update the scene based on changes from UI or animation
 // This is a critical synchronization point for changes to scene data, ensuring that:
@@ -1130,43 +1908,49 @@ bool GltfRenderer::updateAnimation(VkCommandBuffer cmd)
 // Returns true if any changes were made that require re-rendering
 bool GltfRenderer::updateSceneChanges(VkCommandBuffer cmd, bool didAnimate)
 {
+  // Scene buffers and their staging, the acceleration structures have their own scope
+  MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eGeometry);
+
   bool changed = m_uiSceneGraph.hasAnyChanges();
   if(m_uiSceneGraph.hasMaterialChanged())
   {
-    m_resources.sceneVk.updateMaterialBuffer(cmd, m_resources.staging, m_resources.scene);
+    m_resources.sceneVk->updateMaterialBuffer(cmd, m_resources.staging, *m_resources.scene);
   }
   if(m_uiSceneGraph.hasLightChanged())
   {
-    m_resources.sceneVk.updateRenderLightsBuffer(cmd, m_resources.staging, m_resources.scene);
+    m_resources.sceneVk->updateRenderLightsBuffer(cmd, m_resources.staging, *m_resources.scene);
   }
   if(m_resources.dirtyFlags.test(DirtyFlags::eVulkanScene))
   {
-    m_resources.scene.updateRenderNodes();
-    m_resources.sceneVk.updateRenderNodesBuffer(cmd, m_resources.staging, m_resources.scene);
-    m_resources.sceneVk.updateRenderPrimitivesBuffer(cmd, m_resources.staging, m_resources.scene);
-    m_resources.sceneVk.updateRenderLightsBuffer(cmd, m_resources.staging, m_resources.scene);
+    m_resources.scene->updateRenderNodes();
+    m_resources.sceneVk->updateRenderNodesBuffer(cmd, m_resources.staging, *m_resources.scene);
+    m_resources.sceneVk->updateRenderPrimitivesBuffer(cmd, m_resources.staging, *m_resources.scene);
+    m_resources.sceneVk->updateRenderLightsBuffer(cmd, m_resources.staging, *m_resources.scene);
     m_resources.dirtyFlags.reset(DirtyFlags::eVulkanScene);
     changed = true;
   }
   if(m_uiSceneGraph.hasTransformChanged() || didAnimate)
   {
-    m_resources.scene.updateRenderNodes();
-    m_resources.sceneVk.updateRenderNodesBuffer(cmd, m_resources.staging, m_resources.scene);
-    m_resources.sceneVk.updateRenderPrimitivesBuffer(cmd, m_resources.staging, m_resources.scene);
-    m_resources.sceneVk.updateRenderLightsBuffer(cmd, m_resources.staging, m_resources.scene);
+    m_resources.scene->updateRenderNodes();
+    m_resources.sceneVk->updateRenderNodesBuffer(cmd, m_resources.staging, *m_resources.scene);
+    m_resources.sceneVk->updateRenderPrimitivesBuffer(cmd, m_resources.staging, *m_resources.scene);
+    m_resources.sceneVk->updateRenderLightsBuffer(cmd, m_resources.staging, *m_resources.scene);
     // Make sure the staging buffers are uploaded before the acceleration structures are updated
     m_resources.staging.cmdUploadAppended(cmd);
-    m_resources.sceneRtx.updateBottomLevelAS(cmd, m_resources.scene);
-    m_resources.sceneRtx.updateTopLevelAS(cmd, m_resources.staging, m_resources.scene);
+    MemoryReport::Scope asScope(m_resources.memoryReport, MemoryCategory::eAccelerationStructures);
+    m_resources.sceneRtx->updateBottomLevelAS(cmd, *m_resources.scene);
+    m_resources.sceneRtx->updateTopLevelAS(cmd, m_resources.staging, *m_resources.scene);
   }
   if(m_uiSceneGraph.hasMaterialFlagChanges() || m_uiSceneGraph.hasVisibilityChanged())
   {
-    m_resources.scene.updateRenderNodes();
-    m_resources.sceneRtx.updateTopLevelAS(cmd, m_resources.staging, m_resources.scene);
+    m_resources.scene->updateRenderNodes();
+    MemoryReport::Scope asScope(m_resources.memoryReport, MemoryCategory::eAccelerationStructures);
+    m_resources.sceneRtx->updateTopLevelAS(cmd, m_resources.staging, *m_resources.scene);
   }
   if(changed || didAnimate)
   {
     m_resources.staging.cmdUploadAppended(cmd);
+    m_composition.markBaseChanged();
     resetFrame();
   }
   m_uiSceneGraph.resetChanges();
@@ -1183,7 +1967,7 @@ bool GltfRenderer::updateSceneChanges(VkCommandBuffer cmd, bool didAnimate)
 void GltfRenderer::updateNodeToRenderNodeMap()
 {
   m_nodeToRenderNodeMap.clear();
-  auto& renderNodes = m_resources.scene.getRenderNodes();
+  auto& renderNodes = m_resources.scene->getRenderNodes();
   for(size_t i = 0; i < renderNodes.size(); i++)
   {
     m_nodeToRenderNodeMap[renderNodes[i].refNodeID] = static_cast<int>(i);
@@ -1206,10 +1990,12 @@ bool GltfRenderer::processQueuedCommandBuffers()
   if(!m_cmdBufferQueue.empty())
   {
     SCOPED_TIMER("Processing queued command buffer\n");
+    const auto start = std::chrono::steady_clock::now();
 
     // Get the command buffer information from the queue
     CommandBufferInfo cmdInfo = m_cmdBufferQueue.front();
     m_cmdBufferQueue.pop();
+    TRACE_SCOPE(cmdInfo.isBlasBuild ? "BLAS build" : "Queued command buffer");
 
     // Execute the command buffer
     nvvk::endSingleTimeCommands(cmdInfo.cmdBuffer, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
@@ -1220,13 +2006,161 @@ bool GltfRenderer::processQueuedCommandBuffers()
       // Create a command buffer for compaction
       VkCommandBuffer cmd{};
       nvvk::beginSingleTimeCommands(cmd, m_device, m_transientCmdPool);
-      m_resources.sceneRtx.cmdCompactBlas(cmd);
+      MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eAccelerationStructures);
+      m_resources.sceneRtx->cmdCompactBlas(cmd);
       // Submit the compaction command buffer immediately
       nvvk::endSingleTimeCommands(cmd, m_device, m_transientCmdPool, m_app->getQueue(0).queue);
     }
     if(m_cmdBufferQueue.empty())
+    {
+      // The staging of the scene upload was counted with the geometry
+      MemoryReport::Scope memScope(m_resources.memoryReport, MemoryCategory::eGeometry);
       m_resources.staging.releaseStaging(true);
+    }
+    m_benchmark.addSceneBuildTime(cmdInfo.isBlasBuild,
+                                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     return true;  // Command buffer was processed
   }
   return false;  // No command buffer was processed
 }
+
+//--------------------------------------------------------------------------------------------------
+// Metrics: progress, queued command buffers and memory of the heaps, at the beginning of the frame
+void GltfRenderer::updateMetrics()
+{
+  if(!m_metrics.isEnabled())
+  {
+    return;
+  }
+
+  Metrics::FrameState state{.frameCount = m_resources.frameCount, .maxFrames = m_resources.settings.maxFrames};
+  {
+    std::lock_guard<std::mutex> lock(m_cmdBufferQueueMutex);
+    state.queuedCommandBuffers = uint32_t(m_cmdBufferQueue.size());
+  }
+  state.idle = m_idle.isIdle();
+
+  const VkPhysicalDeviceMemoryProperties* memProps{};
+  vmaGetMemoryProperties(m_resources.allocator, &memProps);
+  VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+  vmaGetHeapBudgets(m_resources.allocator, budgets);
+  for(uint32_t i = 0; i < memProps->memoryHeapCount; i++)
+  {
+    state.memory.push_back({.deviceLocal     = (memProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+                            .usage           = budgets[i].usage,
+                            .budget          = budgets[i].budget,
+                            .blockBytes      = budgets[i].statistics.blockBytes,
+                            .allocationBytes = budgets[i].statistics.allocationBytes});
+  }
+  m_metrics.frameBegin(state);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Benchmark: executes the step of the current phase (see benchmark.hpp), called at the
+// beginning of each frame. Loading a scene is synchronous, its command buffers are then
+// processed one per frame, like an interactive load, and timed by processQueuedCommandBuffers.
+void GltfRenderer::updateBenchmark()
+{
+  using Phase = Benchmark::Phase;
+
+  // Device-local memory in use, from the VMA budgets
+  uint64_t gpuMemory = 0;
+  {
+    const VkPhysicalDeviceMemoryProperties* memProps{};
+    vmaGetMemoryProperties(m_resources.allocator, &memProps);
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+    vmaGetHeapBudgets(m_resources.allocator, budgets);
+    for(uint32_t i = 0; i < memProps->memoryHeapCount; i++)
+    {
+      if(memProps->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        gpuMemory += budgets[i].usage;
+    }
+    m_benchmark.addMemorySample(gpuMemory);
+  }
+
+  if(m_benchmark.getPhase() == Phase::eLoadScene)
+  {
+    const Benchmark::SceneEntry& entry = m_benchmark.getScene();
+
+    // Replaces the current scene, synchronously: a dropped file is loaded in the background instead
+    vkQueueWaitIdle(m_app->getQueue(0).queue);
+    m_cmdBufferQueue           = {};
+    m_resources.selectedObject = -1;
+    m_resources.scene->destroy();
+    m_rasterizer.freeRecordCommandBuffer();
+    m_ddgirasterizer.freeRecordCommandBuffer();
+
+    const auto start = std::chrono::steady_clock::now();
+    createScene(entry.filename);
+    const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if(!entry.hdrFilename.empty())
+    {
+      createHDR(entry.hdrFilename);
+      m_resources.settings.envSystem = shaderio::EnvSystem::eHdr;
+    }
+    else
+    {
+      m_resources.settings.envSystem = shaderio::EnvSystem::eSky;
+    }
+    m_benchmark.endSceneLoad(loadMs, m_resources.scene->valid());
+    return;
+  }
+
+  if(m_benchmark.getPhase() == Phase::eBuildScene)
+  {
+    std::lock_guard<std::mutex> lock(m_cmdBufferQueueMutex);
+    if(!m_cmdBufferQueue.empty())
+      return;
+    m_benchmark.endSceneBuild();
+  }
+
+  if(m_benchmark.getPhase() == Phase::eStartRun)
+  {
+    const Benchmark::RendererEntry& renderer = m_benchmark.getRenderer();
+    vkQueueWaitIdle(m_app->getQueue(0).queue);
+    m_resources.settings.renderSystem = static_cast<RenderingMode>(renderer.renderSystem);
+    m_pathTracer.m_renderTechnique    = static_cast<PathTracer::RenderTechnique>(renderer.ptTechnique);
+    resetFrame();
+    m_benchmark.startRun();
+  }
+
+  if(m_benchmark.getPhase() == Phase::eWarmup || m_benchmark.getPhase() == Phase::eMeasure)
+  {
+    // GPU times of the last frame the profiler has read back
+    Benchmark::FrameSample sample;
+    sample.gpuMemory = gpuMemory;
+    for(const std::string& name : m_benchmark.getSections())
+    {
+      nvutils::ProfilerTimeline::TimerInfo info{};
+      if(m_profilerTimeline->getFrameTimerInfo(name, info))
+        sample.gpuMs.push_back({name, info.gpu.last / 1000.0});  // Microseconds
+    }
+    if(m_resources.settings.renderSystem == RenderingMode::ePathtracer && m_pathTracer.getCounters().hasCounters())
+      sample.counters = m_pathTracer.getCounters().getNamedCounters();
+    m_benchmark.nextFrame(sample);
+
+    // Camera of the frame, unless the run just ended
+    Benchmark::CameraKey camera;
+    const bool           running = m_benchmark.getPhase() == Phase::eWarmup || m_benchmark.getPhase() == Phase::eMeasure;
+    if(running && m_benchmark.getCamera(camera))
+    {
+      m_resources.cameraManip->setLookat(camera.eye, camera.center, camera.up, true);
+      if(camera.fov > 0.0f)
+        m_resources.cameraManip->setFov(camera.fov);
+    }
+  }
+
+  if(m_benchmark.getPhase() == Phase::eDone)
+  {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_app->getPhysicalDevice(), &properties);
+    const VkExtent2D            size = m_resources.gBuffers.getSize();
+    const std::filesystem::path report =
+        m_resources.settings.benchmarkReport.empty() ?
+            nvutils::getExecutablePath().replace_filename(nvutils::getExecutablePath().stem().string() + "_benchmark.json") :
+            nvutils::pathFromUtf8(m_resources.settings.benchmarkReport);
+    m_benchmark.writeReport(report, properties.deviceName, {size.width, size.height});
+    m_benchmark = {};  // Idle
+    m_app->close();
+  }
+}
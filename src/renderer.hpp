@@ -19,11 +19,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <queue>
 #include <mutex>
+#include <thread>
 
 #include <vulkan/vulkan_core.h>
 #include <glm/glm.hpp>
@@ -49,13 +52,19 @@ using namespace glm;
 #include "shaders/shaderio.h"  // Shared between host and device
 }  // namespace shaderio
 
+#include "benchmark.hpp"
 #include "renderer_pathtracer.hpp"
 #include "renderer_rasterizer.hpp"
 #include "render_ddgiRaster.hpp"
+#include "heatmap.hpp"
+#include "idle_scheduler.hpp"
+#include "image_output.hpp"
+#include "metrics.hpp"
 #include "resources.hpp"
+#include "scene_composition.hpp"
+#include "scene_swap.hpp"
 #include "silhouette.hpp"
 #include "ui_animation_control.hpp"
-#include "ui_busy_window.hpp"
 #include "ui_scene_graph.hpp"
 #include "ui_renderer.hpp"
 
@@ -72,6 +81,8 @@ public:
   {
     m_resources.cameraManip = cameraManip;
   }
+  Metrics& getMetrics() { return m_metrics; }
+  int      getExitCode() const { return m_exitCode; }  // Of the process, non-zero if a headless check failed
 
   friend struct GltfRendererUI;
 
@@ -86,15 +97,41 @@ private:
   void onUIRender() override;
 
   bool save(const std::filesystem::path& filename);
+  void addToScene(const std::filesystem::path& filename);
+  void saveExr(const std::filesystem::path& filename);
+  void saveImage(const std::filesystem::path& filename);
+  void validateSvgf();
+  void updateFrameCapture(bool rendered);
+  bool createCaptureDir();
   bool updateAnimation(VkCommandBuffer cmd);
+  bool updateSequence();
+  void evaluateSequenceStep(int step);
+  void prepareSequenceStep(int step);
+  void waitSequenceStep();
+  void applySequenceStep(int step);
   bool updateFrameCounter();
   bool processQueuedCommandBuffers();
+  void updateBenchmark();
+  void updateMetrics();
 
   void clearGbuffer(VkCommandBuffer cmd);
   void compileShaders();
   void createDescriptorSets();
   void createResourceBuffers();
-  void createVulkanScene();
+
+  // Where the command buffers creating a scene are recorded and queued: the queue of the render
+  // loop for the current scene, the scene swap for a scene loaded in the background
+  struct SceneCommands
+  {
+    nvvk::StagingUploader*                                     staging{};
+    VkCommandPool                                              cmdPool{};
+    std::function<void(VkCommandBuffer cmd, bool isBlasBuild)> queue;
+  };
+  SceneCommands renderLoopCommands();
+  bool          loadScene(const std::filesystem::path& filename, SceneSlot& slot, const SceneCommands& commands);
+  void createVulkanScene(SceneSlot& slot, const SceneCommands& commands);
+  void activateScene(const std::filesystem::path& filename);
+  void updateSceneSwap();
   void destroyResources();
   void resetFrame();
   void silhouette(VkCommandBuffer cmd);
@@ -104,6 +141,7 @@ private:
   void updateHdrImages();
 
   bool updateSceneChanges(VkCommandBuffer cmd, bool didAnimate);
+  bool isPostProcessValid() const;
   //void updateGBuffer(VkCommandBuffer cmd, VkExtent2D extent);
   //--------------------------------------------------------------------------------------------------
   //
@@ -120,9 +158,12 @@ private:
   DDGIRasterizer m_ddgirasterizer;
 
   UiSceneGraph     m_uiSceneGraph;  // Model UI
-  BusyWindow       m_busy;
+  SceneSwap        m_sceneSwap;     // Scene loaded in the background (onFileDrop)
+  SceneComposition m_composition;   // Assets added to the scene (path tracer)
   AnimationControl m_animControl;  // Animation control (UI)
   Silhouette       m_silhouette;   // Silhouette renderer
+  ImageOutput      m_imageOutput;  // Readback of the HDR image and AOVs to EXR
+  Heatmap          m_heatmap;      // Cost heatmaps of the debug methods
 
   std::unordered_map<int, int> m_nodeToRenderNodeMap;  // Maps node IDs to render node indices
 
@@ -137,5 +178,54 @@ private:
 
   glm::mat4 m_prevMVP{1.f};  // Previous MVP matrix for motion vectors
 
+  // Frame capture (image sequences)
+  int                   m_exitCode{0};            // Set by the headless checks, e.g. --svgfValidate
+  bool                  m_capturePending{false};  // The last rendered frame must be captured once submitted
+  int                   m_captureCounter{0};      // Number of rendered frames since capture started
+  int                   m_captureIndex{0};        // Index of the next captured image
+  std::string           m_captureDirChecked;      // Value of captureDir last created, or which failed
+  std::filesystem::path m_captureDir;             // Created output directory, empty if it failed
+
+  // Deterministic animation sequence: fixed time steps, each rendered to a number of iterations
+  struct Sequence
+  {
+    // Animated members of a node
+    struct NodePose
+    {
+      std::vector<double> translation;
+      std::vector<double> rotation;
+      std::vector<double> scale;
+      std::vector<double> weights;
+    };
+
+    int  step{-1};           // Step being rendered (-1: not started)
+    int  numSteps{0};        // Total number of steps
+    bool converged{false};   // The current step reached the number of iterations
+    bool finished{false};    // All steps were written
+
+    // The animation of the next step is sampled on this thread while the current step accumulates.
+    // It only reads the animations of the model; its result is applied at the step boundary.
+    std::thread           worker;
+    std::atomic<bool>     nextReady{false};  // nextPoses holds the next step
+    std::vector<NodePose> nextPoses;         // Animated members of the nodes of the next step, empty if not animated
+  } m_sequence;
+  static bool sampleAnimation(const tinygltf::Model& model, int animation, float time, std::vector<Sequence::NodePose>& poses);
+
+  Benchmark m_benchmark;  // Scripted performance measurements (--benchmark)
+  Metrics   m_metrics;    // Prometheus metrics of long-running workers (--metricsPort, --metricsFile)
+
+  // Inputs of the post-processing of the tonemapped image: it is only recorded again when they
+  // change, or when the image was rendered
+  struct PostProcess
+  {
+    bool                     valid{false};
+    shaderio::TonemapperData tonemapper{};
+    int                      selectedObject{-1};
+    glm::vec3                silhouetteColor{0.0f};
+    shaderio::DebugMethod    debugMethod{shaderio::DebugMethod::eNone};
+  } m_postProcess;
+  bool          m_gbufferCleared{false};  // The G-Buffer of the empty scene was cleared
+  IdleScheduler m_idle;                   // Waits for input when the image is final (--idle)
+
   VkCommandPool m_transientCmdPool{};  // Command pool for transient command buffers
 };
\ No newline at end of file
@@ -27,7 +27,9 @@
 #include <nvvk/specialization.hpp>
 #include <nvutils/parameter_registry.hpp>
 
+#include "heatmap.hpp"
 #include "renderer_pathtracer.hpp"
+#include "trace_export.hpp"
 #include "utils.hpp"
 
 // Pre-compiled shaders
@@ -62,8 +64,15 @@ void PathTracer::onAttach(Resources& resources, nvvk::ProfilerGpuTimer* profiler
   m_rtPipelineProperties.pNext = &m_reorderProperties;
   vkGetPhysicalDeviceProperties2(resources.allocator.getPhysicalDevice(), &prop2);
 
+  m_svgf.init(resources);
+  m_guiding.init(resources);
+  m_radianceCache.init(resources);
+  m_counters.init(resources);
+  m_multiView.init();  // The file was given on the command line, parsed before
+
   // #DLSS - Create the DLSS denoiser
 #if defined(USE_DLSS)
+  MemoryReport::Scope memScope(resources.memoryReport, MemoryCategory::eDlss);
   m_dlss->init(resources);
 #endif
 }
@@ -78,8 +87,16 @@ void PathTracer::registerParameters(nvutils::ParameterRegistry* paramReg)
   paramReg->add({"ptFireflyClamp", "PathTracer: Firefly clamp threshold"}, &m_pushConst.fireflyClampThreshold);
   paramReg->add({"ptAperture", "PathTracer: Camera aperture"}, &m_pushConst.aperture);
   paramReg->add({"ptFocalDistance", "PathTracer: Focal distance"}, &m_pushConst.focalDistance);
+  paramReg->add({"ptTextureLod", "PathTracer: Texture mip selection [Finest:0, RayCones:1]"}, &m_pushConst.textureLod);
+  paramReg->add({"ptSampler", "PathTracer: Random numbers [WhiteNoise:0, Sobol:1, BlueNoise:2]"}, &m_pushConst.samplerMode);
   paramReg->add({"ptAutoFocus", "PathTracer: Enable auto focus"}, &m_autoFocus);
   paramReg->add({"ptTechnique", "PathTracer: Rendering technique [Compute:0, RayTracing:1]"}, (int*)&m_renderTechnique);
+  m_svgf.registerParameters(paramReg);
+  m_guiding.registerParameters(paramReg);
+  m_radianceCache.registerParameters(paramReg);
+  m_counters.registerParameters(paramReg);
+  m_dynamicRes.registerParameters(paramReg);
+  m_multiView.registerParameters(paramReg);
 #if defined(USE_DLSS)
   m_dlss->registerParameters(paramReg);
 #endif
@@ -90,6 +107,14 @@ void PathTracer::registerParameters(nvutils::ParameterRegistry* paramReg)
 void PathTracer::onDetach(Resources& resources)
 {
   resources.allocator.destroyBuffer(m_sbtBuffer);
+  if(m_aovGBuffers.getSize().width > 0)
+    m_aovGBuffers.deinit();
+  m_svgf.deinit(resources);
+  m_guiding.deinit(resources);
+  m_radianceCache.deinit(resources);
+  m_counters.deinit(resources);
+  m_dynamicRes.deinit();
+  m_multiView.deinit(resources);
 
 #if USE_DLSS
   m_dlss->deinit();
@@ -105,13 +130,69 @@ void PathTracer::onDetach(Resources& resources)
 void PathTracer::onResize(VkCommandBuffer cmd, const VkExtent2D& size, Resources& resources)
 {
   updateDlssResources(cmd, resources);
+  if(m_aovGBuffers.getSize().width > 0)
+    updateAovBuffers(cmd, resources);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create or resize the AOV buffers, written when the AOVs are requested without DLSS
+void PathTracer::updateAovBuffers(VkCommandBuffer cmd, Resources& resources)
+{
+  const VkExtent2D size = resources.gBuffers.getSize();
+  if(m_aovGBuffers.getSize().width == 0)
+  {
+    m_aovGBuffers.init({.allocator    = &resources.allocator,
+                        .colorFormats = {
+                            VK_FORMAT_R16G16B16A16_SFLOAT,  // Albedo           : eDlssAlbedo (accumulated, 8 bits would stall)
+                            VK_FORMAT_R16G16B16A16_SFLOAT,  // Specular albedo  : eDlssSpecAlbedo
+                            VK_FORMAT_R16G16B16A16_SFLOAT,  // Normal/Roughness : eDlssNormalRoughness
+                            VK_FORMAT_R16G16_SFLOAT,        // Motion vectors   : eDlssMotion
+                            VK_FORMAT_R32_SFLOAT,           // ViewZ            : eDlssDepth (first frame, not accumulated)
+                            VK_FORMAT_R32_UINT,             // Render node + 1  : eObjectId (first frame, not accumulated)
+                        },
+                        .imageSampler = resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered).sampler});
+  }
+  if(m_aovGBuffers.getSize().width != size.width || m_aovGBuffers.getSize().height != size.height)
+  {
+    m_aovGBuffers.update(cmd, size);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Return the image of a guide buffer, if it is written by the path tracer
+bool PathTracer::getGuideImage(shaderio::OutputImage name, VkImage& image, VkFormat& format, VkExtent2D& size) const
+{
+  if(name < shaderio::OutputImage::eDlssAlbedo)
+    return false;
+#if defined(USE_DLSS)
+  if(m_dlss->isEnabled())
+  {
+    if(name == shaderio::OutputImage::eObjectId)  // Not part of the DLSS guides
+      return false;
+    image  = m_dlss->getGBuffers().getColorImage(name);
+    format = m_dlss->getGBuffers().getColorFormat(name);
+    size   = m_dlss->getGBuffers().getSize();
+    return true;
+  }
+#endif
+  if(m_pushConst.writeAovs == 0 || m_aovGBuffers.getSize().width == 0)
+    return false;
+  const uint32_t index = name - shaderio::OutputImage::eDlssAlbedo;
+  image                = m_aovGBuffers.getColorImage(index);
+  format               = m_aovGBuffers.getColorFormat(index);
+  size                 = m_aovGBuffers.getSize();
+  return true;
 }
 
 void PathTracer::updateDlssResources(VkCommandBuffer cmd, Resources& resources)
 {
 #if defined(USE_DLSS)
+  // The DLSS resources are created when DLSS is enabled
+  if(!m_dlss->isEnabled())
+    return;
   NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
-  VkExtent2D size = resources.gBuffers.getSize();
+  MemoryReport::Scope memScope(resources.memoryReport, MemoryCategory::eDlss);
+  VkExtent2D          size = resources.gBuffers.getSize();
   m_dlss->updateSize(cmd, size);
   m_dlss->setResources();
   m_dlss->setResource(DlssRayReconstruction::ResourceType::eColorOut, resources.gBuffers.getColorImage(Resources::eImgRendered),
@@ -144,6 +225,11 @@ bool PathTracer::onUIRender(Resources& resources)
     changed |= PE::SliderInt("Samples", &m_pushConst.numSamples, 1, 10, "%d", 0, "Number of samples per pixel");
     changed |= PE::SliderFloat("FireFly Clamp", &m_pushConst.fireflyClampThreshold, 0.0f, 10.0f, "%.2f", 0,
                                "Clamp threshold for fireflies");
+    changed |= PE::Combo("Texture LOD", &m_pushConst.textureLod, "Finest\0Ray Cones\0\0", -1,
+                         "Mip level of the textures: always the finest, or from the footprint of the ray cones");
+    changed |= PE::Combo("Sampler", &m_pushConst.samplerMode, "White Noise\0Sobol\0Blue Noise\0\0", -1,
+                         "Random numbers of the paths: independent, Owen-scrambled Sobol, or Sobol with the error "
+                         "distributed as blue noise (low sample counts)");
 
 
     changed |= PE::SliderFloat("Aperture", &m_pushConst.aperture, 0.0f, apertureMax, "%5.9f",
@@ -154,13 +240,14 @@ bool PathTracer::onUIRender(Resources& resources)
                              ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_NoRoundToFormat, "Distance to focal point");
     m_pushConst.focalDistance = std::max(0.000000001f, m_pushConst.focalDistance);
     ImGui::EndDisabled();
+    changed |= PE::Checkbox("Write AOVs", &resources.settings.saveAovs, "Albedo, normal, depth, ... added to saved EXR images");
     PE::end();
 
     // Infinite plane
     changed |= ImGui::Checkbox("Infinite Plane", (bool*)&resources.settings.useInfinitePlane);
     if(resources.settings.useInfinitePlane)
     {
-      const float extentY = resources.scene.valid() ? resources.scene.getSceneBounds().extents().y : 10.0f;
+      const float extentY = resources.scene->valid() ? resources.scene->getSceneBounds().extents().y : 10.0f;
       PE::begin();
       if(PE::treeNode("Infinite Plane Settings"))
       {
@@ -174,6 +261,12 @@ bool PathTracer::onUIRender(Resources& resources)
       PE::end();
     }
   }
+  changed |= m_guiding.onUi(resources);
+  changed |= m_radianceCache.onUi(resources);
+  m_dynamicRes.onUi();
+  changed |= m_multiView.onUi();
+  changed |= m_svgf.onUi(resources);
+  changed |= m_counters.onUi(resources);
 #if defined(USE_DLSS)
   m_dlss->onUi(resources);
 #else
@@ -189,8 +282,9 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
 {
   NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
   auto timerSection = m_profiler->cmdFrameSection(cmd, "Pathtrace");
+  auto traceSection = g_traceExport.cmdSection(cmd, "Pathtrace");
 
-  m_sceneRadius = resources.scene.getSceneBounds().radius();
+  m_sceneRadius = resources.scene->getSceneBounds().radius();
 
   // Update the push constant: the camera information, sky parameters and the scene to render
   if(m_autoFocus)
@@ -198,6 +292,22 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
     m_pushConst.focalDistance = glm::length(resources.cameraManip->getEye() - resources.cameraManip->getCenter());
   }
 
+  // Dynamic resolution while moving, when no other pass needs the full resolution. Can restart
+  // the accumulation (frameCount) when the motion stopped.
+  bool dlssEnabled = false;
+#if defined(USE_DLSS)
+  dlssEnabled = m_dlss->isEnabled();
+#endif
+  // Multi-view: all the views in one dispatch, without the passes made for a single view (DLSS,
+  // SVGF, AOVs and dynamic resolution)
+  const bool multiView = m_multiView.isActive() && !dlssEnabled;
+
+  bool fullResolution = m_svgf.isEnabled() || resources.settings.saveAovs
+                        || Heatmap::isHeatmap(resources.settings.debugMethod) || dlssEnabled;
+  m_dynamicRes.update(cmd, resources, !fullResolution && !multiView);
+  const VkExtent2D renderSize = multiView ? m_multiView.getSize() : m_dynamicRes.getRenderSize(resources);
+  const uint32_t   numViews   = multiView ? m_multiView.getNumViews() : 1;
+
   // Current frame count, can be overridden by DLSS
   int frameCount = resources.frameCount;
 
@@ -208,21 +318,65 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
   if(m_dlss && m_dlss->isEnabled())
   {
     frameCount = ++haltonIndex;  // Override frame count with Halton index
-    // If the initialization is successful, update the DLSS resources
-    if(m_dlss->ensureInitialized(resources))
+    // If the initialization is successful, or DLSS was disabled, update the DLSS resources
+    if(m_dlss->ensureInitialized(resources) || m_dlss->isReleased())
       updateDlssResources(cmd, resources);
   }
+  else if(m_dlss)
+  {
+    // The DLSS feature and its G-Buffers are not kept while DLSS is disabled
+    MemoryReport::Scope memScope(resources.memoryReport, MemoryCategory::eDlss);
+    m_dlss->releaseResources();
+  }
   m_pushConst.jitter = shaderio::dlssJitter(frameCount);
 #endif
+  // Without DLSS, the built-in denoiser accumulates itself: the noise must change every frame
+  m_pushConst.denoise = (m_svgf.isEnabled() && m_pushConst.useDlss == 0 && !multiView) ? 1 : 0;
+  if(m_pushConst.denoise == 1)
+  {
+    frameCount = m_svgf.nextFrameIndex();
+    m_svgf.updateSize(cmd, resources);
+  }
+  // Without DLSS, the guides are written to the AOV buffers when requested (ex. saved in the EXR) or denoising
+  m_pushConst.writeAovs =
+      ((resources.settings.saveAovs || m_pushConst.denoise == 1) && m_pushConst.useDlss == 0 && !multiView) ? 1 : 0;
+  if(m_pushConst.writeAovs == 1)
+  {
+    updateAovBuffers(cmd, resources);
+  }
+  m_guiding.update(cmd, resources);
+  m_pushConst.guiding = (shaderio::PathGuidingField*)m_guiding.getFieldAddress();
+  m_radianceCache.update(cmd, resources);
+  m_pushConst.radianceCache = (shaderio::RadianceCacheGrid*)m_radianceCache.getGridAddress();
+
+  // Performance counters and multi-view: the shaders are specialized with or without them. The
+  // previous shaders are retired, the frames in flight may still use them.
+  if(m_counters.isEnabled() != m_countersInShaders || multiView != m_multiViewInShaders)
+  {
+    m_multiViewInShaders = multiView;
+    createShaders(resources);
+  }
+  if(multiView)
+  {
+    m_multiView.update(cmd, resources);
+  }
+  m_counters.begin(cmd, resources);
+  m_pushConst.counters = (shaderio::PathCounters*)m_counters.getAddress();
+
   static int lastRenderedObject = -1;
   m_pushConst.renderSelection   = resources.selectedObject != lastRenderedObject || resources.frameCount == 0;
   lastRenderedObject            = resources.selectedObject;
   m_pushConst.frameCount        = frameCount;
-  m_pushConst.frameInfo         = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
+  m_pushConst.frameInfo         = (shaderio::SceneFrameInfo*)(multiView ? m_multiView.getFrameInfoAddress() : resources.bFrameInfo.address);
   m_pushConst.skyParams         = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
-  m_pushConst.gltfScene         = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
+  m_pushConst.gltfScene         = (shaderio::GltfScene*)(resources.composedSceneDesc ? resources.composedSceneDesc :
+                                                                                       resources.sceneVk->sceneDesc().address);
   m_pushConst.mouseCoord        = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+  m_pushConst.renderSize        = m_dynamicRes.isActive() ? glm::ivec2(renderSize.width, renderSize.height) : glm::ivec2(0);
+  const int maxDepth            = m_pushConst.maxDepth;
+  m_pushConst.maxDepth          = m_dynamicRes.getMaxDepth(maxDepth);  // Shorter paths while moving
   vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_ALL, 0, sizeof(shaderio::PathtracePushConstant), &m_pushConst);
+  m_pushConst.maxDepth = maxDepth;
 
   // Make sure buffer is ready to be used
   nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
@@ -237,15 +391,14 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &resources.descriptorSet, 0, nullptr);
 
     // Set the Descriptor for HDR (Set: 2)
-    VkDescriptorSet hdrDescSet = resources.hdrIbl.getDescriptorSet();
+    VkDescriptorSet hdrDescSet = resources.hdrIbl->getDescriptorSet();
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 2, 1, &hdrDescSet, 0, nullptr);
 
     pushDescriptorSet(cmd, resources, VK_PIPELINE_BIND_POINT_COMPUTE);
 
     // Dispatch the compute shader
-    const VkExtent2D& size      = resources.gBuffers.getSize();
-    VkExtent2D        numGroups = nvvk::getGroupCounts(size, WORKGROUP_SIZE);
-    vkCmdDispatch(cmd, numGroups.width, numGroups.height, 1);
+    VkExtent2D numGroups = nvvk::getGroupCounts(renderSize, WORKGROUP_SIZE);
+    vkCmdDispatch(cmd, numGroups.width, numGroups.height, numViews);
   }
   else  // RayTracing
   {
@@ -262,20 +415,44 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_pipelineLayout, 0, 1, &resources.descriptorSet, 0, nullptr);
 
     // Set the Descriptor for HDR (Set: 2)
-    VkDescriptorSet hdrDescSet = resources.hdrIbl.getDescriptorSet();
+    VkDescriptorSet hdrDescSet = resources.hdrIbl->getDescriptorSet();
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_pipelineLayout, 2, 1, &hdrDescSet, 0, nullptr);
 
     pushDescriptorSet(cmd, resources, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR);
 
     // Trace rays
-    const VkExtent2D& size = resources.gBuffers.getSize();
     vkCmdTraceRaysKHR(cmd, &m_sbtRegions.raygen, &m_sbtRegions.miss, &m_sbtRegions.hit, &m_sbtRegions.callable,
-                      size.width, size.height, 1);
+                      renderSize.width, renderSize.height, numViews);
   }
 
   // Making sure the rendered image is ready to be used by tonemapper
   nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
 
+  m_counters.end(cmd, resources);
+
+  // Radiance cache: blend the samples of this frame
+  m_radianceCache.resolve(cmd);
+
+  // Reduced frame: upscale to the rendered image
+  if(m_dynamicRes.isActive())
+  {
+    m_dynamicRes.upscale(cmd, resources);
+  }
+
+  // Multi-view: show one of the views
+  if(multiView)
+  {
+    m_multiView.display(cmd, resources);
+  }
+
+  // Built-in denoiser: from the noisy frame to the rendered image
+  if(m_pushConst.denoise == 1)
+  {
+    auto denoiseSection = m_profiler->cmdFrameSection(cmd, "SVGF");
+    auto traceSection   = g_traceExport.cmdSection(cmd, "SVGF");
+    m_svgf.denoise(cmd, resources, m_aovGBuffers);
+  }
+
 #if defined(USE_DLSS)
   if(m_dlss->isEnabled())
   {
@@ -309,11 +486,25 @@ void PathTracer::onRender(VkCommandBuffer cmd, Resources& resources)
 void PathTracer::pushDescriptorSet(VkCommandBuffer cmd, Resources& resources, VkPipelineBindPoint bindPoint) const
 {
   nvvk::WriteSetContainer write{};
-  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eTlas), resources.sceneRtx.tlas());
+  write.append(resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eTlas),
+               resources.composedTlas ? resources.composedTlas : resources.sceneRtx->tlas());
 
-  // Normal rendering, two output images
-  std::vector<VkDescriptorImageInfo> outputImages = {resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered),
+  // Normal rendering, two output images; the denoiser writes the rendered image from the noisy one
+  std::vector<VkDescriptorImageInfo> outputImages = {m_pushConst.denoise == 1 ?
+                                                         m_svgf.getNoisyImageInfo() :
+                                                         resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered),
                                                      resources.gBuffers.getDescriptorImageInfo(Resources::eImgSelection)};
+  if(m_dynamicRes.isActive())
+  {
+    // Reduced frame, upscaled after
+    outputImages = {m_dynamicRes.getTargets().getDescriptorImageInfo(DynamicResolution::eTargetColor),
+                    m_dynamicRes.getTargets().getDescriptorImageInfo(DynamicResolution::eTargetSelection)};
+  }
+  if(m_multiViewInShaders)
+  {
+    // One layer per view, seen as image arrays by the shaders
+    outputImages = m_multiView.getOutputImages();
+  }
 #if USE_DLSS
   if(m_dlss->isEnabled())
   {
@@ -329,6 +520,14 @@ void PathTracer::pushDescriptorSet(VkCommandBuffer cmd, Resources& resources, Vk
     outputImages[eDlssDepth]           = m_dlss->getGBuffers().getDescriptorImageInfo(eDlssDepth);
   }
 #endif
+  if(m_pushConst.writeAovs == 1)
+  {
+    // AOVs without DLSS, the guides are at the rendering resolution
+    for(uint32_t i = shaderio::eDlssAlbedo; i <= shaderio::eObjectId; i++)
+    {
+      outputImages.push_back(m_aovGBuffers.getDescriptorImageInfo(i - shaderio::eDlssAlbedo));
+    }
+  }
 
   VkWriteDescriptorSet allTextures = resources.descriptorBinding[1].getWriteSet(shaderio::BindingPoints::eOutImages);
   allTextures.descriptorCount      = uint32_t(outputImages.size());
@@ -342,7 +541,7 @@ void PathTracer::createPipeline(Resources& resources)
 {
   SCOPED_TIMER(__FUNCTION__);
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{resources.descriptorSetLayout[0], resources.descriptorSetLayout[1],
-                                                          resources.hdrIbl.getDescriptorSetLayout()};
+                                                          resources.hdrIbl->getDescriptorSetLayout()};
 
   // Creating the pipeline layout
   VkPushConstantRange        pushConstant{VK_SHADER_STAGE_ALL, 0, sizeof(shaderio::PathtracePushConstant)};
@@ -361,6 +560,7 @@ void PathTracer::createPipeline(Resources& resources)
 void PathTracer::createRtxPipeline(Resources& resources)
 {
   SCOPED_TIMER(__FUNCTION__);
+  TRACE_SCOPE("PathTracer::createRtxPipeline");
   // Creating all shaders
   enum ShaderStages
   {
@@ -448,7 +648,12 @@ void PathTracer::createRtxPipeline(Resources& resources)
   nvvk::Specialization specialization;
   specialization.add(0, supportSER);
   //specialization.add(0, 0);
-  stages[eRaygen].pSpecializationInfo = specialization.getSpecializationInfo();
+  // Performance counters, in all stages (any-hit shaders count their invocations)
+  specialization.add(1, m_countersInShaders ? 1 : 0);
+  specialization.add(2, m_multiViewInShaders ? 1 : 0);
+  specialization.add(3, resources.hasShaderClock ? 1 : 0);
+  for(auto& stage : stages)
+    stage.pSpecializationInfo = specialization.getSpecializationInfo();
 
 
   // Assemble the shader stages and recursion depth info into the ray tracing pipeline
@@ -461,13 +666,14 @@ void PathTracer::createRtxPipeline(Resources& resources)
       .maxPipelineRayRecursionDepth = 2,  // Ray depth
       .layout                       = m_pipelineLayout,
   };
-  vkDestroyPipeline(m_device, m_pipeline, nullptr);
+  resources.deletionQueue.retire(m_pipeline);
   NVVK_CHECK(vkCreateRayTracingPipelinesKHR(m_device, {}, {}, 1, &rtPipelineCreateInfo, nullptr, &m_pipeline));
   NVVK_DBG_NAME(m_pipeline);
 
   // Create the Shading Binding Table
   {
-    resources.allocator.destroyBuffer(m_sbtBuffer);
+    MemoryReport::Scope memScope(resources.memoryReport, MemoryCategory::eRenderers);
+    resources.deletionQueue.retire(m_sbtBuffer);
 
     // Shader Binding Table (SBT) setup
     nvvk::SBTGenerator sbtGenerator;
@@ -498,40 +704,61 @@ void PathTracer::createRtxPipeline(Resources& resources)
 void PathTracer::compileShader(Resources& resources, bool fromFile)
 {
   SCOPED_TIMER(__FUNCTION__);
+  TRACE_SCOPE("PathTracer::compileShader");
+
+  m_spirv.assign(gltf_pathtrace_slang, gltf_pathtrace_slang + gltf_pathtrace_slang_sizeInBytes / sizeof(uint32_t));
+  if(fromFile)
+  {
+    SCOPED_TIMER("Slang compile from file");
+    if(resources.slangCompiler.compileFile("gltf_pathtrace.slang"))
+    {
+      const uint32_t* spirv = resources.slangCompiler.getSpirv();
+      m_spirv.assign(spirv, spirv + resources.slangCompiler.getSpirvSize() / sizeof(uint32_t));
+    }
+    else
+    {
+      LOGE("Error compiling gltf_pathtrace.slang\n");
+    }
+  }
+
+  createShaders(resources);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the compute shader and the module of the ray tracing pipeline from the SPIR-V,
+// specialized for the performance counters and the multi-view
+void PathTracer::createShaders(Resources& resources)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  TRACE_SCOPE("PathTracer::createShaders");
+
+  m_countersInShaders = m_counters.isEnabled();
+  nvvk::Specialization specialization;
+  specialization.add(1, m_countersInShaders ? 1 : 0);
+  specialization.add(2, m_multiViewInShaders ? 1 : 0);  // Set by onRender
+  specialization.add(3, resources.hasShaderClock ? 1 : 0);
 
   VkPushConstantRange pushConstant{VK_SHADER_STAGE_ALL, 0, sizeof(shaderio::PathtracePushConstant)};
 
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{resources.descriptorSetLayout[0], resources.descriptorSetLayout[1],
-                                                          resources.hdrIbl.getDescriptorSetLayout()};
+                                                          resources.hdrIbl->getDescriptorSetLayout()};
 
   VkShaderCreateInfoEXT shaderInfo{
       .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
       .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
       .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
-      .codeSize               = gltf_pathtrace_slang_sizeInBytes,
-      .pCode                  = gltf_pathtrace_slang,
+      .codeSize               = m_spirv.size() * sizeof(uint32_t),
+      .pCode                  = m_spirv.data(),
       .pName                  = "computeMain",
       .setLayoutCount         = uint32_t(descriptorSetLayouts.size()),
       .pSetLayouts            = descriptorSetLayouts.data(),
       .pushConstantRangeCount = 1,
       .pPushConstantRanges    = &pushConstant,
+      .pSpecializationInfo    = specialization.getSpecializationInfo(),
   };
-  if(fromFile)
-  {
-    SCOPED_TIMER("Slang compile from file");
-    if(resources.slangCompiler.compileFile("gltf_pathtrace.slang"))
-    {
-      shaderInfo.codeSize = resources.slangCompiler.getSpirvSize();
-      shaderInfo.pCode    = resources.slangCompiler.getSpirv();
-    }
-    else
-    {
-      LOGE("Error compiling gltf_pathtrace.slang\n");
-    }
-  }
   {
     SCOPED_TIMER("Create Shader");
-    vkDestroyShaderEXT(m_device, m_shader, nullptr);
+    resources.deletionQueue.retire(m_shader);
     NVVK_CHECK(vkCreateShadersEXT(m_device, 1U, &shaderInfo, nullptr, &m_shader));
     NVVK_DBG_NAME(m_shader);
   }
@@ -541,8 +768,8 @@ void PathTracer::compileShader(Resources& resources, bool fromFile)
     SCOPED_TIMER("Create Shader Module");
     VkShaderModuleCreateInfo moduleInfo{
         .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = gltf_pathtrace_slang_sizeInBytes,
-        .pCode    = gltf_pathtrace_slang,
+        .codeSize = m_spirv.size() * sizeof(uint32_t),
+        .pCode    = m_spirv.data(),
     };
 
     vkDestroyShaderModule(m_device, m_shaderModule, nullptr);
@@ -550,9 +777,8 @@ void PathTracer::compileShader(Resources& resources, bool fromFile)
     NVVK_DBG_NAME(m_shaderModule);
   }
 
-  // Destroy pipeline since shader was recompiled
-  vkDestroyPipeline(m_device, m_pipeline, nullptr);
-  m_pipeline = VK_NULL_HANDLE;
+  // Destroy pipeline since shader was recompiled or specialized differently
+  resources.deletionQueue.retire(m_pipeline);
 }
 
 void PathTracer::onUIMenu()
@@ -29,6 +29,12 @@ using namespace glm;
 
 #include <nvvk/sbt_generator.hpp>
 #include "renderer_base.hpp"
+#include "dynamic_resolution.hpp"
+#include "multi_view.hpp"
+#include "path_counters.hpp"
+#include "path_guiding.hpp"
+#include "radiance_cache.hpp"
+#include "svgf_denoiser.hpp"
 
 // #DLSS
 #if defined(USE_DLSS)
@@ -60,10 +66,32 @@ public:
   void createPipeline(Resources& resources) override;
   void createRtxPipeline(Resources& resources);
   void compileShader(Resources& resources, bool fromFile = true) override;
+  void createShaders(Resources& resources);
 
   // Register command line parameters
   void registerParameters(nvutils::ParameterRegistry* paramReg);
 
+  // Return the image holding an AOV guide (albedo, normal, depth, ...) from the DLSS buffers,
+  // or from the AOV buffers when DLSS is off. Return false if the guide is not being written.
+  bool getGuideImage(shaderio::OutputImage name, VkImage& image, VkFormat& format, VkExtent2D& size) const;
+
+  void updateAovBuffers(VkCommandBuffer cmd, Resources& resources);
+
+  // The built-in denoiser, used when DLSS is off
+  bool                isDenoising() const { return m_pushConst.denoise == 1; }
+  int                 getSamplesPerFrame() const { return m_pushConst.numSamples; }
+  const SvgfDenoiser& getSvgf() const { return m_svgf; }
+
+  // Performance counters of the shaders, of a recent frame
+  const PathTracerCounters& getCounters() const { return m_counters; }
+
+  // GPU time of a recent frame, for the dynamic resolution
+  void setGpuTime(float ms) { m_dynamicRes.setGpuTime(ms); }
+
+  // Views rendered together, valid when the last frame rendered them
+  const MultiView& getMultiView() const { return m_multiView; }
+  bool             isMultiView() const { return m_multiViewInShaders; }
+
   VkDevice                        m_device{};  // Vulkan device
   VkPipelineLayout                m_pipelineLayout{};
   VkPipeline                      m_pipeline{};   // Ray tracing pipeline
@@ -72,6 +100,7 @@ public:
   float                           m_sceneRadius{1.0f};
   bool                            m_autoFocus{true};  // Enable auto-focus
   VkShaderModule                  m_shaderModule{};   // Shader module for RTX
+  std::vector<uint32_t>           m_spirv;            // Code of the shaders, specialized when created
 
   // Shader Binding Table (SBT)
   nvvk::Buffer                m_sbtBuffer{};   // Buffer for the Shader Binding Table
@@ -84,6 +113,29 @@ public:
 
   RenderTechnique m_renderTechnique{RenderTechnique::Compute};
 
+  // AOV guides written when DLSS is off, in the order of OutputImage, starting at eDlssAlbedo
+  nvvk::GBuffer m_aovGBuffers{};
+
+  // Vendor-neutral denoiser, takes the AOV guides
+  SvgfDenoiser m_svgf;
+
+  // Learned distribution of the incident radiance, to sample the bounces
+  PathGuiding m_guiding;
+
+  // World-space cache of the radiance leaving the surfaces, to terminate the paths early
+  RadianceCache m_radianceCache;
+
+  // Lower resolution while the camera or the scene change
+  DynamicResolution m_dynamicRes;
+
+  // Rays, any-hit invocations, terminations and lobes counted by the shaders
+  PathTracerCounters m_counters;
+  bool               m_countersInShaders{false};  // The shaders were created with the counters
+
+  // Cameras of --multiView, traced in the same dispatch
+  MultiView m_multiView;
+  bool      m_multiViewInShaders{false};  // The shaders were created for the view arrays
+
   // #DLSS - Implementation of the DLSS denoiser
 #if defined(USE_DLSS)
   std::unique_ptr<DlssDenoiser> m_dlss;
@@ -28,6 +28,8 @@
     - Environment mapping with HDR and procedural sky options
     - Support for transparent and double-sided materials
     - Wireframe rendering mode for debugging
+    - Temporal anti-aliasing and upscaling (TAA/TAAU), with per-pixel motion vectors
+    - Clustered light culling: fragments only shade the lights of their cluster
     - Dynamic state management for flexible pipeline configuration
     - Efficient vertex and index buffer handling
     - Support for material variants and animations
@@ -47,6 +49,7 @@
 #include <nvvk/helpers.hpp>
 
 #include "renderer_rasterizer.hpp"
+#include "trace_export.hpp"
 
 // Pre-compiled shaders
 #include "_autogen/gltf_raster.slang.h"
@@ -64,6 +67,8 @@ void Rasterizer::onAttach(Resources& resources, nvvk::ProfilerGpuTimer* profiler
   m_device      = resources.allocator.getDevice();
   m_commandPool = resources.commandPool;
   m_skyPhysical.init(&resources.allocator, std::span(sky_physical_slang));
+  m_taa.init(resources);
+  m_lightClusters.init(resources);
   compileShader(resources, false);  // Compile the shader
 }
 
@@ -87,6 +92,8 @@ void Rasterizer::onDetach(Resources& resources)
   vkDestroyShaderEXT(m_device, m_wireframeShader, nullptr);
 
   m_skyPhysical.deinit();
+  m_taa.deinit(resources);
+  m_lightClusters.deinit(resources);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -111,8 +118,10 @@ bool Rasterizer::onUIRender(Resources& resources)
     PE::Checkbox("Use Recorded Cmd", &m_useRecordedCmd, "Use recorded command buffers for better performance");
     PE::end();
   }
+  changed |= m_taa.onUIRender(resources);
+  changed |= m_lightClusters.onUIRender(resources);
 
-  return false;
+  return changed;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -122,10 +131,30 @@ bool Rasterizer::onUIRender(Resources& resources)
 // 2. Scene geometry rendering with proper material handling
 // 3. Wireframe overlay when enabled
 // 4. Proper state management for different material types
+// 5. With TAA, the scene is rendered jittered in the TAA targets, then resolved in the G-Buffer
 void Rasterizer::onRender(VkCommandBuffer cmd, Resources& resources)
 {
   NVVK_DBG_SCOPE(cmd);  // <-- Helps to debug in NSight
+  auto timerSection = m_profiler->cmdFrameSection(cmd, "Raster");
+  auto traceSection = g_traceExport.cmdSection(cmd, "Raster");
 
+  // The recorded scene depends on the TAA targets and on the address of the previous matrices
+  bool recordChanged = m_taa.update(cmd, resources);
+  recordChanged |= m_taa.updateTransforms(cmd, resources);
+  if(recordChanged)
+  {
+    freeRecordCommandBuffer();
+  }
+
+  // Render targets: the G-Buffer, or the TAA targets at the render resolution
+  const bool           useTaa      = m_taa.isActive();
+  const nvvk::GBuffer& targets     = useTaa ? m_taa.getTargets() : resources.gBuffers;
+  const uint32_t       colorIndex  = useTaa ? uint32_t(TemporalAA::eTargetColor) : uint32_t(Resources::eImgRendered);
+  const uint32_t       selectIndex = useTaa ? uint32_t(TemporalAA::eTargetSelection) : uint32_t(Resources::eImgSelection);
+  const VkExtent2D     renderSize  = targets.getSize();
+
+  // Light lists of the clusters, for the camera of this frame
+  m_lightClusters.update(cmd, resources, renderSize);
 
   // Rendering the environment
   if(!resources.settings.useSolidBackground)
@@ -136,46 +165,51 @@ void Rasterizer::onRender(VkCommandBuffer cmd, Resources& resources)
     // Rendering dome or sky in the background, it is covering the entire screen
     if(resources.settings.envSystem == shaderio::EnvSystem::eSky)
     {
-      m_skyPhysical.runCompute(cmd, resources.gBuffers.getSize(), viewMatrix, projMatrix, resources.skyParams,
-                               resources.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
+      m_skyPhysical.runCompute(cmd, renderSize, viewMatrix, projMatrix, resources.skyParams, targets.getDescriptorImageInfo(colorIndex));
     }
     else if(resources.settings.envSystem == shaderio::EnvSystem::eHdr)
     {
-      resources.hdrDome.draw(cmd, viewMatrix, projMatrix, resources.gBuffers.getSize(), glm::vec4(resources.settings.hdrEnvIntensity),
+      resources.hdrDome->draw(cmd, viewMatrix, projMatrix, renderSize, glm::vec4(resources.settings.hdrEnvIntensity),
                              resources.settings.hdrEnvRotation, resources.settings.hdrBlur);
+      if(useTaa)
+        m_taa.copyEnvironment(cmd, resources);
     }
   }
 
 
-  // Two attachments, one for color and one for selection
-  std::array<VkRenderingAttachmentInfo, 2> attachments = {{DEFAULT_VkRenderingAttachmentInfo, DEFAULT_VkRenderingAttachmentInfo}};
+  // Three attachments: color, selection and motion vectors (only written with TAA)
+  std::array<VkRenderingAttachmentInfo, 3> attachments = {
+      {DEFAULT_VkRenderingAttachmentInfo, DEFAULT_VkRenderingAttachmentInfo, DEFAULT_VkRenderingAttachmentInfo}};
   // 0 - Color attachment
-  attachments[0].imageView  = resources.gBuffers.getColorImageView(Resources::eImgRendered);
+  attachments[0].imageView  = targets.getColorImageView(colorIndex);
   attachments[0].clearValue = {{{resources.settings.solidBackgroundColor.x, resources.settings.solidBackgroundColor.y,
                                  resources.settings.solidBackgroundColor.z, 0.f}}};
   attachments[0].loadOp = resources.settings.useSolidBackground ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
   // 1 - Selection attachment
-  attachments[1].imageView = resources.gBuffers.getColorImageView(Resources::eImgSelection);
+  attachments[1].imageView = targets.getColorImageView(selectIndex);
+  // 2 - Motion vectors, the background has no motion (camera motion is not reprojected on the sky)
+  attachments[2].imageView = useTaa ? targets.getColorImageView(TemporalAA::eTargetMotion) : VK_NULL_HANDLE;
   // X - Depth
   VkRenderingAttachmentInfo depthAttachment = DEFAULT_VkRenderingAttachmentInfo;
-  depthAttachment.imageView                 = resources.gBuffers.getDepthImageView();
+  depthAttachment.imageView                 = targets.getDepthImageView();
   depthAttachment.clearValue                = {.depthStencil = DEFAULT_VkClearDepthStencilValue};
 
-  nvvk::cmdImageMemoryBarrier(cmd, {resources.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL,
-                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+  nvvk::cmdImageMemoryBarrier(cmd, {targets.getColorImage(colorIndex), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
 
   // Setting up the push constant
-  m_pushConst.frameInfo  = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
-  m_pushConst.skyParams  = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
-  m_pushConst.gltfScene  = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
-  m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+  m_pushConst.frameInfo         = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
+  m_pushConst.skyParams         = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
+  m_pushConst.gltfScene         = (shaderio::GltfScene*)resources.sceneVk->sceneDesc().address;
+  m_pushConst.mouseCoord        = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+  m_pushConst.prevObjectToWorld = (glm::mat4*)m_taa.getPrevTransformsAddress();
+  m_pushConst.lightClusters     = (shaderio::LightClusterGrid*)m_lightClusters.getGridAddress();
   vkCmdPushConstants(cmd, m_graphicPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
 
 
   // Create the rendering info
   VkRenderingInfo renderingInfo      = DEFAULT_VkRenderingInfo;
   renderingInfo.flags                = m_useRecordedCmd ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0,
-  renderingInfo.renderArea           = DEFAULT_VkRect2D(resources.gBuffers.getSize());
+  renderingInfo.renderArea           = DEFAULT_VkRect2D(renderSize);
   renderingInfo.colorAttachmentCount = uint32_t(attachments.size());
   renderingInfo.pColorAttachments    = attachments.data();
   renderingInfo.pDepthAttachment     = &depthAttachment;
@@ -202,8 +236,13 @@ void Rasterizer::onRender(VkCommandBuffer cmd, Resources& resources)
 
   vkCmdEndRendering(cmd);
 
-  nvvk::cmdImageMemoryBarrier(cmd, {resources.gBuffers.getColorImage(Resources::eImgRendered),
-                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL});
+  nvvk::cmdImageMemoryBarrier(cmd, {targets.getColorImage(colorIndex), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL});
+
+  // Accumulate the jittered frame and upscale it to the G-Buffer
+  if(useTaa)
+  {
+    m_taa.resolve(cmd, resources, true);
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -216,8 +255,8 @@ void Rasterizer::renderNodes(VkCommandBuffer cmd, Resources& resources, const st
 {
   NVVK_DBG_SCOPE(cmd);
 
-  nvvkgltf::Scene&   scene   = resources.scene;
-  nvvkgltf::SceneVk& sceneVk = resources.sceneVk;
+  nvvkgltf::Scene&   scene   = *resources.scene;
+  nvvkgltf::SceneVk& sceneVk = *resources.sceneVk;
 
   const VkDeviceSize                            offsets{0};
   const std::vector<nvvkgltf::RenderNode>&      renderNodes = scene.getRenderNodes();
@@ -265,7 +304,7 @@ void Rasterizer::pushDescriptorSet(VkCommandBuffer cmd, Resources& resources)
 {
   //// Use a compute shader that outputs to the render target for now
   //nvvk::WriteSetContainer write{};
-  //write.append(resources.descriptorBinding[1].getWriteSet(0), resources.sceneRtx.tlas());
+  //write.append(resources.descriptorBinding[1].getWriteSet(0), resources.sceneRtx->tlas());
   //write.append(resources.descriptorBinding[1].getWriteSet(1),
   //             resources.gBuffers.getColorImageView(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL);
   //vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 1, write.size(), write.data());
@@ -316,6 +355,11 @@ void Rasterizer::createPipeline(Resources& resources)
   m_dynamicPipeline.colorWriteMasks.push_back(
       {VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT});
   m_dynamicPipeline.colorBlendEquations.push_back(VkColorBlendEquationEXT{});
+
+  // Attachment #2 - Motion vectors (TAA)
+  m_dynamicPipeline.colorBlendEnables.push_back(false);
+  m_dynamicPipeline.colorWriteMasks.push_back({VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT});
+  m_dynamicPipeline.colorBlendEquations.push_back(VkColorBlendEquationEXT{});
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -324,6 +368,7 @@ void Rasterizer::createPipeline(Resources& resources)
 void Rasterizer::compileShader(Resources& resources, bool fromFile)
 {
   SCOPED_TIMER(__FUNCTION__);
+  TRACE_SCOPE("Rasterizer::compileShader");
 
   // Push constant is used to pass data to the shader at each frame
   const VkPushConstantRange pushConstantRange{
@@ -389,8 +434,11 @@ void Rasterizer::recordRasterScene(Resources& resources)
 
   createRecordCommandBuffer();
 
+  // Must match the attachments of onRender; the motion vectors are only bound with TAA
   std::vector<VkFormat> colorFormat = {resources.gBuffers.getColorFormat(Resources::eImgRendered),
-                                       resources.gBuffers.getColorFormat(Resources::eImgSelection)};
+                                       resources.gBuffers.getColorFormat(Resources::eImgSelection),
+                                       m_taa.isActive() ? m_taa.getTargets().getColorFormat(TemporalAA::eTargetMotion) :
+                                                          VK_FORMAT_UNDEFINED};
 
   VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{
       .sType                   = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
@@ -424,15 +472,17 @@ void Rasterizer::renderRasterScene(VkCommandBuffer cmd, Resources& resources)
 {
 
   // Setting up the push constant
-  m_pushConst.frameInfo  = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
-  m_pushConst.skyParams  = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
-  m_pushConst.gltfScene  = (shaderio::GltfScene*)resources.sceneVk.sceneDesc().address;
-  m_pushConst.mouseCoord = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+  m_pushConst.frameInfo         = (shaderio::SceneFrameInfo*)resources.bFrameInfo.address;
+  m_pushConst.skyParams         = (shaderio::SkyPhysicalParameters*)resources.bSkyParams.address;
+  m_pushConst.gltfScene         = (shaderio::GltfScene*)resources.sceneVk->sceneDesc().address;
+  m_pushConst.mouseCoord        = nvapp::ElementDbgPrintf::getMouseCoord();  // Use for debugging: printf in shader
+  m_pushConst.prevObjectToWorld = (glm::mat4*)m_taa.getPrevTransformsAddress();
+  m_pushConst.lightClusters     = (shaderio::LightClusterGrid*)m_lightClusters.getGridAddress();
   vkCmdPushConstants(cmd, m_graphicPipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS, 0, sizeof(shaderio::RasterPushConstant), &m_pushConst);
 
   // All dynamic states are set here
   m_dynamicPipeline.cmdApplyAllStates(cmd);
-  m_dynamicPipeline.cmdSetViewportAndScissor(cmd, resources.gBuffers.getSize());
+  m_dynamicPipeline.cmdSetViewportAndScissor(cmd, m_taa.getRenderSize(resources));
   m_dynamicPipeline.cmdBindShaders(cmd, {.vertex = m_vertexShader, .fragment = m_fragmentShader});
   vkCmdSetDepthTestEnable(cmd, VK_TRUE);
 
@@ -459,18 +509,18 @@ void Rasterizer::renderRasterScene(VkCommandBuffer cmd, Resources& resources)
   // Back-face culling with depth bias
   vkCmdSetCullMode(cmd, VK_CULL_MODE_BACK_BIT);
   vkCmdSetDepthBias(cmd, -1.0f, 0.0f, 1.0f);  // Apply depth bias for solid objects
-  renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterSolid));
+  renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterSolid));
 
   // Double sided without depth bias
   vkCmdSetCullMode(cmd, VK_CULL_MODE_NONE);
   vkCmdSetDepthBias(cmd, 0.0f, 0.0f, 0.0f);  // Disable depth bias for double-sided objects
-  renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterSolidDoubleSided));
+  renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterSolidDoubleSided));
 
   // Blendable objects without depth bias
   VkBool32 blendEnable  = VK_TRUE;
   VkBool32 blendDisable = VK_FALSE;
   vkCmdSetColorBlendEnableEXT(cmd, 0, 1, &blendEnable);
-  renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterBlend));
+  renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterBlend));
 
   if(m_enableWireframe)
   {
@@ -478,7 +528,7 @@ void Rasterizer::renderRasterScene(VkCommandBuffer cmd, Resources& resources)
     vkCmdSetColorBlendEnableEXT(cmd, 0, 1, &blendDisable);
     vkCmdSetDepthBias(cmd, 0.0f, 0.0f, 0.0f);  // Disable depth bias for wireframe
     vkCmdSetPolygonModeEXT(cmd, VK_POLYGON_MODE_LINE);
-    renderNodes(cmd, resources, resources.scene.getShadedNodes(nvvkgltf::Scene::eRasterAll));
+    renderNodes(cmd, resources, resources.scene->getShadedNodes(nvvkgltf::Scene::eRasterAll));
   }
 }
 
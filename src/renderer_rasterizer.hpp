@@ -31,6 +31,8 @@ using namespace glm;
 
 #include "resources.hpp"
 #include "renderer_base.hpp"
+#include "temporal_aa.hpp"
+#include "light_clusters.hpp"
 
 class Rasterizer : public BaseRenderer
 {
@@ -49,6 +51,11 @@ public:
   void createPipeline(Resources& resources) override;
   void freeRecordCommandBuffer();
 
+  // Clip space jitter of the next frame (TAA)
+  glm::vec2 getJitter(const Resources& resources) const { return m_taa.getJitter(resources); }
+  // Resolution of the rendering, lower than the G-Buffer with TAA upscaling
+  VkExtent2D getRenderSize(const Resources& resources) const { return m_taa.getRenderSize(resources); }
+
   // Register command line parameters
   void registerParameters(nvutils::ParameterRegistry* paramReg);
 
@@ -75,6 +82,8 @@ private:
   VkShaderEXT m_wireframeShader{};  // Wireframe shader
 
   nvshaders::SkyPhysical m_skyPhysical;  // Sky physical
+  TemporalAA             m_taa;          // Temporal anti-aliasing and upscaling
+  LightClusters          m_lightClusters;  // Clustered light culling
 
   // UI
   bool m_enableWireframe = false;
@@ -26,7 +26,10 @@
  */
 
 #pragma once
+#include <array>
 #include <bitset>
+#include <memory>
+#include <string>
 
 #include <glm/glm.hpp>
 #include <glm/ext/scalar_constants.hpp>
@@ -49,6 +52,9 @@ using namespace glm;
 #include <nvvkgltf/scene.hpp>
 #include <nvvkgltf/scene_rtx.hpp>
 #include <nvvkgltf/scene_vk.hpp>
+
+#include "deletion_queue.hpp"
+#include "frame_graph.hpp"
 //#include <nvvkglsl/glsl.hpp>
 enum class RenderingMode
 {
@@ -87,9 +93,42 @@ struct Settings
   glm::vec3             infinitePlaneBaseColor = glm::vec3(0.5, 0.5, 0.5);  // Default gray color
   float                 infinitePlaneMetallic  = 0.0;                       // Default non-metallic
   float                 infinitePlaneRoughness = 0.5;                       // Default medium roughness
+  std::string           outputImage;                     // Headless: filename of the final image (default: <executable>.jpg)
+  bool                  saveExr                = false;  // Headless: save the linear HDR image as EXR
+  bool                  saveAovs               = false;  // Write the AOVs (albedo, normal, depth, ...) in the EXR
+  int                   captureEvery           = 0;      // Frame capture: save every Nth rendered frame (0: off)
+  int                   captureStart           = 0;      // Frame capture: only once frameCount reaches this value
+  bool                  captureExr             = false;  // Frame capture: save the linear image as EXR instead of PNG
+  std::string           captureDir;                      // Frame capture: output directory (default: executable directory)
+  float                 sequenceFps            = 0.0f;   // Animation sequence: fixed time step of 1/fps (0: off)
+  int                   sequenceSamples        = 64;     // Animation sequence: iterations accumulated per frame
+  int                   sequenceFrames         = 0;      // Animation sequence: number of frames (0: whole animation)
+  bool                  taaEnable              = true;   // Rasterizer: temporal anti-aliasing
+  float                 taaRenderScale         = 1.0f;   // Rasterizer: render resolution relative to the output (TAA upscaling)
+  float                 taaFeedback            = 0.9f;   // Rasterizer: maximum weight of the TAA history
+  bool                  clusterEnable          = true;   // Rasterizer: clustered light culling
+  glm::ivec2            clusterTiles           = {16, 9};  // Rasterizer: number of cluster tiles on screen
+  int                   clusterSlices          = 24;     // Rasterizer: number of cluster depth slices
+  int                   clusterMaxLights       = 64;     // Rasterizer: capacity of the light list of a cluster
+  float                 clusterLightCutoff     = 0.0f;   // Rasterizer: irradiance giving a range to lights without one (0: off)
+  std::string           benchmarkFile;                   // Benchmark: script of scenes, renderers and camera paths
+  std::string           benchmarkReport;                 // Benchmark: JSON report (default: next to the executable)
 };
 
 
+// A scene with its Vulkan buffers, its acceleration structures and the descriptor set of its
+// textures. There are two: a scene loaded in the background is created in the slot not rendered
+// (see SceneSwap). Each has its allocator, for the memory of the loading thread to be measured
+// apart from the render loop (MemoryReport).
+struct SceneSlot
+{
+  nvvk::ResourceAllocator allocator;        // Of sceneVk and sceneRtx
+  nvvkgltf::Scene         scene;            // GLTF Scene
+  nvvkgltf::SceneVk       sceneVk;          // GLTF Scene buffers
+  nvvkgltf::SceneRtx      sceneRtx;         // GLTF Scene BLAS/TLAS
+  VkDescriptorSet         descriptorSet{};  // Set 0: the textures of the scene and of the environment
+};
+
 struct Resources
 {
   enum
@@ -107,6 +146,7 @@ struct Resources
   };
 
   VkInstance              instance{};
+  bool                    hasShaderClock{false};  // VK_KHR_shader_clock with the device clock (shader time heatmap)
   nvvk::ResourceAllocator allocator{};  // Vulkan Memory Allocator
   nvvk::StagingUploader   staging;
 
@@ -115,16 +155,24 @@ struct Resources
   nvslang::SlangCompiler slangCompiler{};  // Slang compiler
   // nvvkglsl::GlslCompiler       glslCompiler{};   // gksl compiler
 
-  // Scene
-  nvvkgltf::Scene    scene;     // GLTF Scene
-  nvvkgltf::SceneVk  sceneVk;   // GLTF Scene buffers
-  nvvkgltf::SceneRtx sceneRtx;  // GLTF Scene BLAS/TLAS
+  // Scene: the members of the slot being rendered
+  std::array<SceneSlot, 2> sceneSlots;
+  nvvkgltf::Scene*         scene    = &sceneSlots[0].scene;     // GLTF Scene
+  nvvkgltf::SceneVk*       sceneVk  = &sceneSlots[0].sceneVk;   // GLTF Scene buffers
+  nvvkgltf::SceneRtx*      sceneRtx = &sceneSlots[0].sceneRtx;  // GLTF Scene BLAS/TLAS
+
+  // Assets added to the scene (SceneComposition): when set, the path tracer renders them with the scene
+  VkAccelerationStructureKHR composedTlas{};
+  VkDeviceAddress            composedSceneDesc{};  // shaderio::GltfScene
+
+  MemoryReport  memoryReport;   // GPU memory per subsystem
+  DeletionQueue deletionQueue;  // Objects destroyed once the frames using them are done
+  FrameGraph    frameGraph;     // Passes of the frame, barriers and transient images
 
   // Resources
-  nvvk::HdrIbl                                hdrIbl;  // HDR environment map
-  nvshaders::HdrEnvDome                       hdrDome;
+  std::unique_ptr<nvvk::HdrIbl>               hdrIbl;  // HDR environment map, replaced by GltfRenderer::createHDR
+  std::unique_ptr<nvshaders::HdrEnvDome>      hdrDome;
   nvvk::GBuffer                               gBuffers;          // G-Buffers: color + depth
-  nvvk::GBuffer                               gBuffersDefer;
   nvvk::Buffer                                bFrameInfo;        // Scene/Frame information
   nvvk::Buffer                                bSkyParams;        // Sky parameters
   shaderio::SkyPhysicalParameters             skyParams{};       // Sky parameters
@@ -135,19 +183,13 @@ struct Resources
   // Pipeline
   std::array<nvvk::DescriptorBindings, 2> descriptorBinding{};    // Descriptor bindings: 0: textures, 1: tlas
   std::array<VkDescriptorSetLayout, 2>    descriptorSetLayout{};  // Descriptor set layout
-  VkDescriptorSet                         descriptorSet{};        // Descriptor set for the textures
+  VkDescriptorSet                         descriptorSet{};        // Descriptor set for the textures, of the current slot
   VkDescriptorPool                        descriptorPool{};
 
   // for gbuffer
-  struct{
-      std::vector<nvvk::Image>  gBufferColor{};
-      nvvk::Image               gBufferDepth{};
-      std::vector<VkImageView>  imageViews{};
-      VkSampler                 sampler;
-      VkExtent2D                size{}; 
-  }gres;
   VkDescriptorSetLayout gbufferDescSetlayout{};
-  VkDescriptorSet gbufferDescSet{};
+  VkDescriptorSet gbufferDescSet{};  // Set of the current transient images, one of gbufferDescSets
+  std::array<VkDescriptorSet, 2> gbufferDescSets{};  // Written alternately, the frames in flight keep theirs
   nvvk::DescriptorBindings descirptorBindingGbuffer{};
   // for gbuffer
   
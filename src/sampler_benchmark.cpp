@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Sampler benchmark
+
+    Each pixel of a tile estimates three integrals over [0,1)^n with the sampler of the path tracer:
+    - smooth 2D       : Gaussian over the sub-pixel position (camera block, xy)
+    - discontinuous 2D: quarter disk over the light sample (light block of the first bounce, yz),
+                        like the edge of an area light or of a shadow
+    - smooth 8D       : product of sines over the lens, the light and the BSDF blocks, like a path
+    The mean squared error against the analytic value is averaged over the pixels. The filtered MSE
+    is measured after a 3x3 box blur of the error image: blue noise keeps most of its error in
+    high frequencies, which the blur (or the eye) removes.
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+#include <string>
+
+#include <fmt/format.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <nvutils/logger.hpp>
+
+#include "sampler_benchmark.hpp"
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/sampler.h"
+}  // namespace shaderio
+
+namespace sampler {
+
+namespace {
+
+constexpr int kNumIntegrands = 3;
+
+const double kReference[kNumIntegrands] = {
+    0.5577462853510335,                // (sqrt(pi)/2 erf(1))^2
+    glm::pi<double>() * 0.8 * 0.8 / 4.0,  // Quarter disk of radius 0.8
+    1.0,                               // Product of (1 + 0.5 sin(2 pi u))
+};
+
+const char* kModeNames[] = {"White noise", "Sobol", "Blue noise"};
+
+void evaluate(const shaderio::PathSampler& s, double values[kNumIntegrands])
+{
+  using namespace shaderio;
+  const glm::vec4 camera = samplerGet4D(s, SAMPLER_DIM_CAMERA);
+  const glm::vec4 light  = samplerGet4D(s, SAMPLER_DIM_LIGHT(0));
+  const glm::vec4 bsdf   = samplerGet4D(s, SAMPLER_DIM_BSDF(0));
+
+  values[0] = std::exp(-(double(camera.x) * camera.x + double(camera.y) * camera.y));
+  values[1] = (double(light.y) * light.y + double(light.z) * light.z < 0.8 * 0.8) ? 1.0 : 0.0;
+
+  const float dims[8] = {camera.z, camera.w, light.y, light.z, light.w, bsdf.x, bsdf.y, bsdf.z};
+  values[2]           = 1.0;
+  for(float u : dims)
+    values[2] *= 1.0 + 0.5 * std::sin(2.0 * glm::pi<double>() * u);
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+std::vector<BenchmarkRow> runBenchmark(const BenchmarkSettings& settings)
+{
+  const int                 size      = settings.tileSize;
+  const size_t              numPixels = size_t(size) * size;
+  std::vector<BenchmarkRow> rows;
+
+  for(int mode = SAMPLER_WHITE_NOISE; mode <= SAMPLER_BLUE_NOISE; mode++)
+  {
+    // Running sums of the pixels, estimates are taken at each power of two
+    std::vector<double> sums(numPixels * kNumIntegrands, 0.0);
+    int                 spp = 0;
+    for(int nextSpp = 1; nextSpp <= settings.maxSpp; nextSpp *= 2)
+    {
+      for(size_t p = 0; p < numPixels; p++)
+      {
+        const glm::uvec2 pixel(uint32_t(p % size), uint32_t(p / size));
+        for(int i = spp; i < nextSpp; i++)
+        {
+          double values[kNumIntegrands];
+          evaluate(shaderio::samplerInit(mode, pixel, uint32_t(i)), values);
+          for(int k = 0; k < kNumIntegrands; k++)
+            sums[p * kNumIntegrands + k] += values[k];
+        }
+      }
+      spp = nextSpp;
+
+      BenchmarkRow row;
+      row.mode = mode;
+      row.spp  = spp;
+      std::vector<double> error(numPixels);
+      for(int k = 0; k < kNumIntegrands; k++)
+      {
+        for(size_t p = 0; p < numPixels; p++)
+        {
+          error[p] = sums[p * kNumIntegrands + k] / spp - kReference[k];
+          row.mse[k] += error[p] * error[p];
+        }
+        row.mse[k] /= double(numPixels);
+
+        // Error after a 3x3 box filter, on the inner pixels
+        for(int y = 1; y < size - 1; y++)
+        {
+          for(int x = 1; x < size - 1; x++)
+          {
+            double blurred = 0.0;
+            for(int dy = -1; dy <= 1; dy++)
+              for(int dx = -1; dx <= 1; dx++)
+                blurred += error[size_t(y + dy) * size + (x + dx)];
+            blurred /= 9.0;
+            row.filteredMse[k] += blurred * blurred;
+          }
+        }
+        row.filteredMse[k] /= double(size - 2) * double(size - 2);
+      }
+      rows.push_back(row);
+    }
+  }
+  return rows;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+void logBenchmark(const std::vector<BenchmarkRow>& rows)
+{
+  const char* integrandNames[kNumIntegrands] = {"smooth 2D", "discontinuous 2D", "smooth 8D"};
+  for(int k = 0; k < kNumIntegrands; k++)
+  {
+    LOGI("Sampler benchmark - %s: MSE (filtered MSE)\n", integrandNames[k]);
+    LOGI("  %5s %24s %24s %24s\n", "spp", kModeNames[0], kModeNames[1], kModeNames[2]);
+    for(size_t r = 0; r < rows.size(); r++)
+    {
+      if(rows[r].mode != SAMPLER_WHITE_NOISE)
+        continue;
+      std::string line = fmt::format("  {:5d}", rows[r].spp);
+      for(const BenchmarkRow& other : rows)
+      {
+        if(other.spp == rows[r].spp)
+          line += fmt::format(" {:11.3e} ({:10.3e})", other.mse[k], other.filteredMse[k]);
+      }
+      LOGI("%s\n", line.c_str());
+    }
+
+    // Convergence rate: least-squares slope of log(MSE) against log(spp), -1 for white noise
+    std::string line = "  slope";
+    for(int mode = SAMPLER_WHITE_NOISE; mode <= SAMPLER_BLUE_NOISE; mode++)
+    {
+      double sx = 0, sy = 0, sxx = 0, sxy = 0, n = 0;
+      for(const BenchmarkRow& row : rows)
+      {
+        if(row.mode != mode || row.mse[k] <= 0.0)
+          continue;
+        const double x = std::log2(double(row.spp));
+        const double y = std::log2(row.mse[k]);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+        n += 1;
+      }
+      const double slope = (n > 1) ? (n * sxy - sx * sy) / (n * sxx - sx * sx) : 0.0;
+      line += fmt::format(" {:24.2f}", slope);
+    }
+    LOGI("%s\n", line.c_str());
+  }
+}
+
+}  // namespace sampler
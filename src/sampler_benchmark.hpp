@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <vector>
+
+// CPU benchmark of the samplers of the path tracer (shaders/sampler.h): Monte Carlo estimates of
+// integrals with a known value, using the same dimension blocks as the path tracer, and the mean
+// squared error over a tile of pixels for increasing sample counts.
+namespace sampler {
+
+struct BenchmarkRow
+{
+  int    mode = 0;            // SAMPLER_WHITE_NOISE, SAMPLER_SOBOL, SAMPLER_BLUE_NOISE
+  int    spp  = 0;            // Samples per pixel
+  double mse[3]{};            // Per integrand: smooth 2D, discontinuous 2D, smooth 8D
+  double filteredMse[3]{};    // Same, on the error image blurred over 3x3 pixels (low frequencies of the noise)
+};
+
+struct BenchmarkSettings
+{
+  int tileSize = 32;   // Pixels of a side of the tile
+  int maxSpp   = 256;  // Powers of two up to this count
+};
+
+std::vector<BenchmarkRow> runBenchmark(const BenchmarkSettings& settings = {});
+
+// Print the table of errors and the convergence rate (slope of log(MSE) / log(spp)) of each sampler
+void logBenchmark(const std::vector<BenchmarkRow>& rows);
+
+}  // namespace sampler
@@ -0,0 +1,700 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Scene Composition
+
+    - Assets are glTF files added to the loaded scene (File > Add to Scene).
+      The positions, normals, texture coordinates and indices of their
+      primitives are appended to four shared buffers; the asset table keeps
+      the range of each primitive and its BLAS. An asset added again only
+      gets a new instance: nothing is uploaded or built.
+    - The shared buffers double their capacity when full: the content is
+      copied on the GPU and the previous buffer retired, the render
+      primitives are then written again with the new addresses.
+    - One TLAS holds the render nodes of the loaded scene, in their order,
+      then the nodes of the instances, each transformed by its instance.
+      Adding, moving or removing an instance rebuilds this TLAS and writes
+      the render nodes of the instances, the geometry and the BLAS stay.
+    - The scene description of the path tracer has the materials, render
+      nodes and render primitives of the loaded scene at the head of its
+      arrays (copied on the GPU, scene_composition.comp.slang), followed by
+      the ones of the assets. InstanceIndex() and InstanceID() therefore
+      index both the same way, and the textures and lights are the ones of
+      the loaded scene.
+    - Limitations: only the path tracer renders the assets (the rasterizers
+      and the picking use the loaded scene). The materials of the assets
+      keep their factors, not their textures. The BLAS of the loaded scene
+      are built again for the composed TLAS, SceneRtx does not share them,
+      and a scene with skins or morph targets is not composed.
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "cpu_scene.hpp"
+#include "scene_composition.hpp"
+
+// Pre-compiled shader
+#include "_autogen/scene_composition.comp.slang.h"
+
+namespace {
+
+// Material of an asset: the factors of the glTF material, without textures
+shaderio::GltfShadeMaterial toShadeMaterial(const tinygltf::Material* gltfMaterial)
+{
+  shaderio::GltfShadeMaterial material = shaderio::defaultGltfMaterial();
+  std::memset(&material.pbrBaseColorTexture, 0, sizeof(material) - offsetof(shaderio::GltfShadeMaterial, pbrBaseColorTexture));
+  if(gltfMaterial == nullptr)
+    return material;
+
+  const tinygltf::PbrMetallicRoughness& pbr = gltfMaterial->pbrMetallicRoughness;
+  material.pbrBaseColorFactor =
+      glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2], pbr.baseColorFactor[3]);
+  material.pbrMetallicFactor  = float(pbr.metallicFactor);
+  material.pbrRoughnessFactor = float(pbr.roughnessFactor);
+  material.emissiveFactor =
+      glm::vec3(gltfMaterial->emissiveFactor[0], gltfMaterial->emissiveFactor[1], gltfMaterial->emissiveFactor[2]);
+  auto strength = gltfMaterial->extensions.find("KHR_materials_emissive_strength");
+  if(strength != gltfMaterial->extensions.end() && strength->second.Has("emissiveStrength"))
+    material.emissiveFactor *= float(strength->second.Get("emissiveStrength").GetNumberAsDouble());
+  material.alphaMode   = gltfMaterial->alphaMode == "MASK"  ? shaderio::eAlphaModeMask :
+                         gltfMaterial->alphaMode == "BLEND" ? shaderio::eAlphaModeBlend :
+                                                              shaderio::eAlphaModeOpaque;
+  material.alphaCutoff = float(gltfMaterial->alphaCutoff);
+  material.doubleSided = gltfMaterial->doubleSided ? 1 : 0;
+  material.unlit       = gltfMaterial->extensions.count("KHR_materials_unlit") > 0 ? 1 : 0;
+  return material;
+}
+
+VkAccelerationStructureGeometryKHR triangleGeometry(VkDeviceAddress vertices, uint32_t numVertices, VkDeviceAddress indices)
+{
+  return {
+      .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+      .geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR,
+      .geometry     = {.triangles = {.sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR,
+                                     .vertexFormat = VK_FORMAT_R32G32B32_SFLOAT,
+                                     .vertexData   = {.deviceAddress = vertices},
+                                     .vertexStride = sizeof(glm::vec3),
+                                     .maxVertex    = std::max(numVertices, 1U) - 1,
+                                     .indexType    = VK_INDEX_TYPE_UINT32,
+                                     .indexData    = {.deviceAddress = indices}}},
+      .flags        = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR,
+  };
+}
+
+// Instance of a render node: InstanceID() is its render primitive
+VkAccelerationStructureInstanceKHR makeInstance(const glm::mat4& objectToWorld, uint32_t renderPrimID, VkDeviceAddress blas, bool visible, bool opaque, bool doubleSided)
+{
+  VkAccelerationStructureInstanceKHR instance{};
+  const glm::mat4                    rows = glm::transpose(objectToWorld);  // 3 rows of 4 floats
+  std::memcpy(&instance.transform, &rows, sizeof(VkTransformMatrixKHR));
+  instance.instanceCustomIndex                    = renderPrimID;
+  instance.mask                                   = visible ? 0xFF : 0x00;
+  instance.instanceShaderBindingTableRecordOffset = 0;
+  instance.flags = (doubleSided ? VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR : 0)
+                   | (opaque ? VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR : 0);
+  instance.accelerationStructureReference = blas;
+  return instance;
+}
+
+}  // namespace
+
+glm::mat4 SceneComposition::Instance::getTransform() const
+{
+  return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(glm::quat(glm::radians(rotation)))
+         * glm::scale(glm::mat4(1.0f), scale);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the copy shader and the scene description. The shared buffers are created by the first asset.
+void SceneComposition::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  VkDevice device = res.allocator.getDevice();
+
+  VkPushConstantRange pushConstant = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::CompositionPushConstant)};
+
+  VkPipelineLayoutCreateInfo plCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreatePipelineLayout(device, &plCreateInfo, nullptr, &m_pipelineLayout));
+  NVVK_DBG_NAME(m_pipelineLayout);
+
+  VkShaderCreateInfoEXT shaderCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+      .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
+      .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+      .codeSize               = scene_composition_comp_slang_sizeInBytes,
+      .pCode                  = scene_composition_comp_slang,
+      .pName                  = "main",
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_shader));
+  NVVK_DBG_NAME(m_shader);
+
+  NVVK_CHECK(res.allocator.createBuffer(m_bSceneDesc, sizeof(shaderio::GltfScene),
+                                        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(m_bSceneDesc.buffer);
+
+  VkPhysicalDeviceAccelerationStructurePropertiesKHR asProperties{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR};
+  VkPhysicalDeviceProperties2 properties{.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &asProperties};
+  vkGetPhysicalDeviceProperties2(res.allocator.getPhysicalDevice(), &properties);
+  m_scratchAlignment = asProperties.minAccelerationStructureScratchOffsetAlignment;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Before the deletion queue, which destroys what is retired
+void SceneComposition::deinit(Resources& res)
+{
+  clear(res);
+  VkDevice device = res.allocator.getDevice();
+  res.allocator.destroyBuffer(m_bSceneDesc);
+  vkDestroyShaderEXT(device, m_shader, nullptr);
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  m_shader         = {};
+  m_pipelineLayout = {};
+}
+
+//--------------------------------------------------------------------------------------------------
+// The instances, with the transform of each
+bool SceneComposition::onUIRender(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  if(m_assets.empty())
+  {
+    ImGui::TextWrapped("File > Add to Scene places a glTF file in the scene, rendered by the path tracer");
+    return false;
+  }
+
+  bool changed = false;
+  int  removed = -1;
+  if(PE::begin())
+  {
+    PE::Text("Assets", fmt::format("{} ({} primitives, {} triangles)", m_assets.size(), m_primitives.size(),
+                                   m_indices.size / sizeof(glm::uvec3)));
+    for(size_t i = 0; i < m_instances.size(); i++)
+    {
+      Instance& instance = m_instances[i];
+      ImGui::PushID(int(i));
+      PE::Text("Instance", nvutils::utf8FromPath(m_assets[instance.asset].filename.filename()));
+      changed |= PE::DragFloat3("Translation", glm::value_ptr(instance.translation), 0.01f);
+      changed |= PE::DragFloat3("Rotation", glm::value_ptr(instance.rotation), 0.1f);
+      changed |= PE::DragFloat3("Scale", glm::value_ptr(instance.scale), 0.01f);
+      if(PE::entry("", [&] { return ImGui::SmallButton("Remove"); }, "Remove the instance, its asset stays uploaded"))
+        removed = int(i);
+      ImGui::PopID();
+    }
+    PE::end();
+  }
+
+  if(removed >= 0)
+  {
+    m_instances.erase(m_instances.begin() + removed);
+    changed = true;
+  }
+  if(changed && m_instances.empty())
+  {
+    // Back to the loaded scene
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+    res.deletionQueue.retire(m_tlas);
+    res.composedTlas      = {};
+    res.composedSceneDesc = 0;
+  }
+  m_dirty |= changed && !m_instances.empty();
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Add an instance of the file, loading it unless it already is in the asset table
+bool SceneComposition::add(VkCommandBuffer cmd, Resources& res, nvvk::StagingUploader& staging, const std::filesystem::path& filename)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  if(!res.scene->valid())
+  {
+    LOGW("Load a scene before adding assets to it\n");
+    return false;
+  }
+  if(m_baseBlas.empty() && !buildBaseBlas(cmd, res))
+    return false;
+
+  auto it    = std::find_if(m_assets.begin(), m_assets.end(), [&](const Asset& asset) { return asset.filename == filename; });
+  int  asset = it != m_assets.end() ? int(it - m_assets.begin()) : loadAsset(cmd, res, staging, filename);
+  if(asset < 0)
+    return false;
+
+  m_instances.push_back({.asset = uint32_t(asset)});
+  m_dirty = true;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Retire everything: the loaded scene is replaced
+void SceneComposition::clear(Resources& res)
+{
+  {
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+    for(Primitive& primitive : m_primitives)
+      res.deletionQueue.retire(primitive.blas);
+    for(nvvk::AccelerationStructure& blas : m_baseBlas)
+      res.deletionQueue.retire(blas);
+    res.deletionQueue.retire(m_tlas);
+  }
+  {
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eGeometry);
+    for(SharedBuffer* shared : {&m_positions, &m_normals, &m_texCoords, &m_indices, &m_materialTable, &m_primitiveTable, &m_nodeTable})
+    {
+      res.deletionQueue.retire(shared->buffer);
+      shared->size = 0;
+    }
+  }
+  m_assets.clear();
+  m_instances.clear();
+  m_primitives.clear();
+  m_materials.clear();
+  m_baseBlas.clear();
+  m_numBaseNodes        = 0;
+  m_numBasePrimitives   = 0;
+  m_dirty               = false;
+  res.composedTlas      = {};
+  res.composedSceneDesc = 0;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the render nodes of the instances, copy the loaded scene and rebuild the TLAS
+bool SceneComposition::update(VkCommandBuffer cmd, Resources& res)
+{
+  if(!m_dirty)
+    return false;
+  m_dirty = false;
+
+  // The indices of the composed scene follow the render nodes and primitives of the loaded scene,
+  // e.g. another scene of the file was selected
+  if(res.scene->getRenderNodes().size() != m_numBaseNodes || res.scene->getRenderPrimitives().size() != m_numBasePrimitives)
+  {
+    LOGW("The loaded scene changed, the assets added to it are removed\n");
+    clear(res);
+    return true;
+  }
+
+  NVVK_DBG_SCOPE(cmd);
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eGeometry);
+
+  // Render nodes of the instances, after the ones of the loaded scene
+  const uint32_t                        numBaseMaterials = getNumBaseMaterials(res);
+  std::vector<shaderio::GltfRenderNode> nodes;
+  for(const Instance& instance : m_instances)
+  {
+    const Asset&    asset     = m_assets[instance.asset];
+    const glm::mat4 transform = instance.getTransform();
+    for(const Node& node : asset.nodes)
+    {
+      const glm::mat4 objectToWorld = transform * node.worldMatrix;
+      nodes.push_back({.objectToWorld = objectToWorld,
+                       .worldToObject = glm::inverse(objectToWorld),
+                       .materialID    = int(numBaseMaterials + asset.firstMaterial) + node.material,
+                       .renderPrimID  = int(m_numBasePrimitives + asset.firstPrimitive) + node.primitive});
+    }
+  }
+  const VkDeviceSize nodesOffset = VkDeviceSize(m_numBaseNodes) * sizeof(shaderio::GltfRenderNode);
+  const VkDeviceSize nodesSize   = nodesOffset + nodes.size() * sizeof(shaderio::GltfRenderNode);
+  reserve(cmd, res, m_nodeTable, nodesSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT);
+  m_nodeTable.size = nodesSize;
+  NVVK_CHECK(res.staging.appendBuffer(m_nodeTable.buffer, nodesOffset, nodes.size() * sizeof(shaderio::GltfRenderNode), nodes.data()));
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  res.staging.cmdUploadAppended(cmd);
+
+  // The textures and the lights are set by the copy
+  const shaderio::GltfScene sceneDesc{
+      .materials        = (shaderio::GltfShadeMaterial*)m_materialTable.buffer.address,
+      .renderNodes      = (shaderio::GltfRenderNode*)m_nodeTable.buffer.address,
+      .renderPrimitives = (shaderio::GltfRenderPrimitive*)m_primitiveTable.buffer.address,
+  };
+  vkCmdUpdateBuffer(cmd, m_bSceneDesc.buffer, 0, sizeof(sceneDesc), &sceneDesc);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+  // Loaded scene at the head of the tables, one thread per element
+  const shaderio::CompositionPushConstant pushConstant{
+      .baseScene           = (shaderio::GltfScene*)res.sceneVk->sceneDesc().address,
+      .composedScene       = (shaderio::GltfScene*)m_bSceneDesc.address,
+      .numMaterials        = int(numBaseMaterials),
+      .numRenderNodes      = int(m_numBaseNodes),
+      .numRenderPrimitives = int(m_numBasePrimitives),
+  };
+  const uint32_t        numElements = std::max({numBaseMaterials, m_numBaseNodes, m_numBasePrimitives});
+  VkShaderStageFlagBits stage       = VK_SHADER_STAGE_COMPUTE_BIT;
+  vkCmdBindShadersEXT(cmd, 1, &stage, &m_shader);
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstant), &pushConstant);
+  vkCmdDispatch(cmd, (numElements + COMPOSITION_WORKGROUP_SIZE - 1) / COMPOSITION_WORKGROUP_SIZE, 1, 1);
+
+  buildTlas(cmd, res);
+
+  // Read by the path tracer, with ray tracing pipelines or ray queries
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                         VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+  res.composedTlas      = m_tlas.accel;
+  res.composedSceneDesc = m_bSceneDesc.address;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Load the file in the asset table: its primitives are appended to the shared buffers and get
+// their BLAS. Returns the index of the asset, -1 if it has no triangles.
+int SceneComposition::loadAsset(VkCommandBuffer cmd, Resources& res, nvvk::StagingUploader& staging, const std::filesystem::path& filename)
+{
+  nvvkgltf::Scene scene;
+  LOGI("Loading asset: %s\n", nvutils::utf8FromPath(filename).c_str());
+  if(!scene.load(filename))
+  {
+    LOGE("Error loading asset: %s\n", nvutils::utf8FromPath(filename).c_str());
+    return -1;
+  }
+  const tinygltf::Model& model = scene.getModel();
+
+  Asset asset{.filename = filename, .firstPrimitive = uint32_t(m_primitives.size()), .firstMaterial = uint32_t(m_materials.size())};
+  for(const tinygltf::Material& gltfMaterial : model.materials)
+    m_materials.push_back(toShadeMaterial(&gltfMaterial));
+  if(model.materials.empty())
+    m_materials.push_back(toShadeMaterial(nullptr));
+  asset.numMaterials = uint32_t(m_materials.size()) - asset.firstMaterial;
+
+  // Vertices and triangles of the primitives, each indexing its own vertices
+  const uint32_t          firstVertex   = uint32_t(m_positions.size / sizeof(glm::vec3));
+  const uint32_t          firstTriangle = uint32_t(m_indices.size / sizeof(glm::uvec3));
+  std::vector<glm::vec3>  positions;
+  std::vector<glm::vec3>  normals;
+  std::vector<glm::vec2>  texCoords;
+  std::vector<glm::uvec3> triangles;
+  std::vector<int>        primitiveMap(scene.getRenderPrimitives().size(), -1);  // Render primitive -> primitive of the asset
+  for(size_t i = 0; i < primitiveMap.size(); i++)
+  {
+    const tinygltf::Primitive& primitive = *scene.getRenderPrimitive(i).pPrimitive;
+    if(primitive.mode != TINYGLTF_MODE_TRIANGLES && primitive.mode != -1)
+      continue;  // Points, lines and strips are not rendered
+    auto attribute = [&](const char* name) {
+      auto found = primitive.attributes.find(name);
+      return found == primitive.attributes.end() ? -1 : found->second;
+    };
+
+    const std::vector<glm::vec3> primPositions = cpu::readAccessor<3>(model, attribute("POSITION"), glm::vec3(0.0f));
+    if(primPositions.empty())
+      continue;
+    std::vector<glm::vec3> primNormals   = cpu::readAccessor<3>(model, attribute("NORMAL"), glm::vec3(0.0f));
+    std::vector<glm::vec2> primTexCoords = cpu::readAccessor<2>(model, attribute("TEXCOORD_0"), glm::vec2(0.0f));
+    std::vector<uint32_t>  indices       = cpu::readIndices(model, primitive.indices);
+    if(primitive.indices < 0)
+    {
+      indices.resize(primPositions.size());
+      std::iota(indices.begin(), indices.end(), 0u);
+    }
+
+    Primitive prim{.firstVertex   = firstVertex + uint32_t(positions.size()),
+                   .numVertices   = uint32_t(primPositions.size()),
+                   .firstTriangle = firstTriangle + uint32_t(triangles.size()),
+                   .hasNormals    = primNormals.size() == primPositions.size(),
+                   .hasTexCoords  = primTexCoords.size() == primPositions.size()};
+    for(size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+      if(indices[t] < prim.numVertices && indices[t + 1] < prim.numVertices && indices[t + 2] < prim.numVertices)
+        triangles.emplace_back(indices[t], indices[t + 1], indices[t + 2]);
+    }
+    prim.numTriangles = firstTriangle + uint32_t(triangles.size()) - prim.firstTriangle;
+    if(prim.numTriangles == 0)
+      continue;
+
+    // All vertices have the three attributes, the missing ones are not referenced (null in the render primitive)
+    primNormals.resize(primPositions.size(), glm::vec3(0.0f));
+    primTexCoords.resize(primPositions.size(), glm::vec2(0.0f));
+    positions.insert(positions.end(), primPositions.begin(), primPositions.end());
+    normals.insert(normals.end(), primNormals.begin(), primNormals.end());
+    texCoords.insert(texCoords.end(), primTexCoords.begin(), primTexCoords.end());
+    primitiveMap[i] = int(m_primitives.size() - asset.firstPrimitive);
+    m_primitives.push_back(prim);
+  }
+  asset.numPrimitives = uint32_t(m_primitives.size()) - asset.firstPrimitive;
+
+  for(const nvvkgltf::RenderNode& renderNode : scene.getRenderNodes())
+  {
+    const int primitive = primitiveMap[renderNode.renderPrimID];
+    if(primitive < 0 || !renderNode.visible)
+      continue;
+    asset.nodes.push_back({.worldMatrix = renderNode.worldMatrix,
+                           .primitive   = primitive,
+                           .material    = std::clamp(renderNode.materialID, 0, int(asset.numMaterials) - 1)});
+  }
+  if(asset.nodes.empty())
+  {
+    LOGW("No triangles to render in %s\n", nvutils::utf8FromPath(filename).c_str());
+    m_primitives.resize(asset.firstPrimitive);
+    m_materials.resize(asset.firstMaterial);
+    return -1;
+  }
+
+  // Append to the shared buffers; when one of them moves, all the render primitives are written again
+  {
+    MemoryReport::Scope       memScope(res.memoryReport, MemoryCategory::eGeometry);
+    const VkBufferUsageFlags2 vertexUsage =
+        VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR;
+    auto append = [&](SharedBuffer& shared, const void* data, VkDeviceSize size) {
+      const bool moved = reserve(cmd, res, shared, shared.size + size, vertexUsage);
+      NVVK_CHECK(staging.appendBuffer(shared.buffer, shared.size, size, data));
+      shared.size += size;
+      return moved;
+    };
+    bool moved = append(m_positions, positions.data(), positions.size() * sizeof(glm::vec3));
+    moved |= append(m_normals, normals.data(), normals.size() * sizeof(glm::vec3));
+    moved |= append(m_texCoords, texCoords.data(), texCoords.size() * sizeof(glm::vec2));
+    moved |= append(m_indices, triangles.data(), triangles.size() * sizeof(glm::uvec3));
+    writeDescription(cmd, res, staging, moved ? 0 : asset.firstPrimitive, asset.firstMaterial);
+
+    // After the copies of the buffers which moved
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+    staging.cmdUploadAppended(cmd);
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+  }
+
+  {
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+    for(uint32_t i = asset.firstPrimitive; i < asset.firstPrimitive + asset.numPrimitives; i++)
+    {
+      Primitive&                               prim = m_primitives[i];
+      const VkAccelerationStructureGeometryKHR geometry =
+          triangleGeometry(m_positions.buffer.address + prim.firstVertex * sizeof(glm::vec3), prim.numVertices,
+                           m_indices.buffer.address + prim.firstTriangle * sizeof(glm::uvec3));
+      buildAccel(cmd, res, geometry, prim.numTriangles, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, prim.blas);
+    }
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                           VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+  }
+
+  LOGI("Asset %s: %u primitives, %zu triangles\n", nvutils::utf8FromPath(filename.filename()).c_str(), asset.numPrimitives,
+       triangles.size());
+  m_assets.push_back(std::move(asset));
+  return int(m_assets.size()) - 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+// BLAS of the render primitives of the loaded scene, for the composed TLAS
+bool SceneComposition::buildBaseBlas(VkCommandBuffer cmd, Resources& res)
+{
+  // SceneRtx updates the BLAS of skinned and morphed primitives each frame, these would not follow
+  const tinygltf::Model& model    = res.scene->getModel();
+  bool                   deformed = !model.skins.empty();
+  for(const tinygltf::Mesh& mesh : model.meshes)
+    for(const tinygltf::Primitive& primitive : mesh.primitives)
+      deformed |= !primitive.targets.empty();
+  if(deformed)
+  {
+    LOGW("Assets cannot be added to a scene with skins or morph targets\n");
+    return false;
+  }
+
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+  m_numBaseNodes      = uint32_t(res.scene->getRenderNodes().size());
+  m_numBasePrimitives = uint32_t(res.scene->getRenderPrimitives().size());
+  m_baseBlas.resize(m_numBasePrimitives);
+  for(uint32_t i = 0; i < m_numBasePrimitives; i++)
+  {
+    const nvvkgltf::RenderPrimitive&         renderPrimitive = res.scene->getRenderPrimitive(i);
+    const tinygltf::Accessor&                positions = model.accessors[renderPrimitive.pPrimitive->attributes.at("POSITION")];
+    const VkAccelerationStructureGeometryKHR geometry  = triangleGeometry(res.sceneVk->vertexBuffers()[i].position.address,
+                                                                          uint32_t(positions.count), res.sceneVk->indices()[i].address);
+    buildAccel(cmd, res, geometry, uint32_t(renderPrimitive.indexCount / 3), VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR,
+               m_baseBlas[i]);
+  }
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+                         VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Upload the materials and render primitives of the assets from the given ones, after the ones of
+// the loaded scene
+void SceneComposition::writeDescription(VkCommandBuffer cmd, Resources& res, nvvk::StagingUploader& staging, uint32_t firstPrimitive, uint32_t firstMaterial)
+{
+  const uint32_t     numBaseMaterials = getNumBaseMaterials(res);
+  const VkDeviceSize materialsSize    = VkDeviceSize(numBaseMaterials + m_materials.size()) * sizeof(shaderio::GltfShadeMaterial);
+  const VkDeviceSize primitivesSize = VkDeviceSize(m_numBasePrimitives + m_primitives.size()) * sizeof(shaderio::GltfRenderPrimitive);
+  reserve(cmd, res, m_materialTable, materialsSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT);
+  reserve(cmd, res, m_primitiveTable, primitivesSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT);
+  m_materialTable.size  = materialsSize;
+  m_primitiveTable.size = primitivesSize;
+
+  NVVK_CHECK(staging.appendBuffer(m_materialTable.buffer, (numBaseMaterials + firstMaterial) * sizeof(shaderio::GltfShadeMaterial),
+                                  (m_materials.size() - firstMaterial) * sizeof(shaderio::GltfShadeMaterial),
+                                  m_materials.data() + firstMaterial));
+
+  std::vector<shaderio::GltfRenderPrimitive> primitives;
+  for(uint32_t i = firstPrimitive; i < m_primitives.size(); i++)
+  {
+    const Primitive&              prim = m_primitives[i];
+    shaderio::GltfRenderPrimitive renderPrimitive{};
+    renderPrimitive.indices = (shaderio::uint3*)(m_indices.buffer.address + prim.firstTriangle * sizeof(glm::uvec3));
+    renderPrimitive.vertexBuffer.positions = (shaderio::float3*)(m_positions.buffer.address + prim.firstVertex * sizeof(glm::vec3));
+    if(prim.hasNormals)
+      renderPrimitive.vertexBuffer.normals = (shaderio::float3*)(m_normals.buffer.address + prim.firstVertex * sizeof(glm::vec3));
+    if(prim.hasTexCoords)
+      renderPrimitive.vertexBuffer.texCoords0 = (shaderio::float2*)(m_texCoords.buffer.address + prim.firstVertex * sizeof(glm::vec2));
+    primitives.push_back(renderPrimitive);
+  }
+  NVVK_CHECK(staging.appendBuffer(m_primitiveTable.buffer, (m_numBasePrimitives + firstPrimitive) * sizeof(shaderio::GltfRenderPrimitive),
+                                  primitives.size() * sizeof(shaderio::GltfRenderPrimitive), primitives.data()));
+  m_dirty = true;  // The scene description points to the tables
+}
+
+//--------------------------------------------------------------------------------------------------
+// TLAS of the render nodes of the loaded scene, in their order for InstanceIndex() to be the render
+// node, followed by the nodes of the instances
+void SceneComposition::buildTlas(VkCommandBuffer cmd, Resources& res)
+{
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+
+  const tinygltf::Model&                          model = res.scene->getModel();
+  std::vector<VkAccelerationStructureInstanceKHR> instances;
+  for(const nvvkgltf::RenderNode& renderNode : res.scene->getRenderNodes())
+  {
+    bool opaque      = true;
+    bool doubleSided = false;
+    if(renderNode.materialID >= 0 && renderNode.materialID < int(model.materials.size()))
+    {
+      const tinygltf::Material& material = model.materials[renderNode.materialID];
+      opaque      = material.alphaMode.empty() || material.alphaMode == "OPAQUE";
+      doubleSided = material.doubleSided;
+    }
+    instances.push_back(makeInstance(renderNode.worldMatrix, uint32_t(renderNode.renderPrimID),
+                                     m_baseBlas[renderNode.renderPrimID].address, renderNode.visible, opaque, doubleSided));
+  }
+  for(const Instance& instance : m_instances)
+  {
+    const Asset&    asset     = m_assets[instance.asset];
+    const glm::mat4 transform = instance.getTransform();
+    for(const Node& node : asset.nodes)
+    {
+      const shaderio::GltfShadeMaterial& material = m_materials[asset.firstMaterial + node.material];
+      const uint32_t                     prim     = asset.firstPrimitive + uint32_t(node.primitive);
+      instances.push_back(makeInstance(transform * node.worldMatrix, m_numBasePrimitives + prim, m_primitives[prim].blas.address,
+                                       true, material.alphaMode == shaderio::eAlphaModeOpaque, material.doubleSided != 0));
+    }
+  }
+
+  // Read by the build from host memory
+  nvvk::Buffer instanceBuffer;
+  NVVK_CHECK(res.allocator.createBuffer(instanceBuffer, instances.size() * sizeof(VkAccelerationStructureInstanceKHR),
+                                        VK_BUFFER_USAGE_2_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                                        VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+                                        VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+  NVVK_DBG_NAME(instanceBuffer.buffer);
+  std::memcpy(instanceBuffer.mapping, instances.data(), instances.size() * sizeof(VkAccelerationStructureInstanceKHR));
+
+  const VkAccelerationStructureGeometryKHR geometry{
+      .sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR,
+      .geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR,
+      .geometry     = {.instances = {.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR,
+                                     .data  = {.deviceAddress = instanceBuffer.address}}},
+  };
+  res.deletionQueue.retire(m_tlas);  // The frames in flight trace the previous one
+  buildAccel(cmd, res, geometry, uint32_t(instances.size()), VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR, m_tlas);
+  res.deletionQueue.retire(instanceBuffer);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the acceleration structure and record its build; the scratch buffer is retired
+void SceneComposition::buildAccel(VkCommandBuffer cmd, Resources& res, const VkAccelerationStructureGeometryKHR& geometry,
+                                  uint32_t primitiveCount, VkAccelerationStructureTypeKHR type, nvvk::AccelerationStructure& accel)
+{
+  VkAccelerationStructureBuildGeometryInfoKHR buildInfo{
+      .sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR,
+      .type          = type,
+      .flags         = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR,
+      .mode          = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+      .geometryCount = 1,
+      .pGeometries   = &geometry,
+  };
+  VkAccelerationStructureBuildSizesInfoKHR sizes{.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
+  vkGetAccelerationStructureBuildSizesKHR(res.allocator.getDevice(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                          &buildInfo, &primitiveCount, &sizes);
+
+  const VkAccelerationStructureCreateInfoKHR createInfo{
+      .sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR,
+      .size  = sizes.accelerationStructureSize,
+      .type  = type,
+  };
+  NVVK_CHECK(res.allocator.createAcceleration(accel, createInfo));
+  NVVK_DBG_NAME(accel.accel);
+
+  nvvk::Buffer scratch;
+  NVVK_CHECK(res.allocator.createBuffer(scratch, sizes.buildScratchSize, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                        VMA_MEMORY_USAGE_AUTO, {}, m_scratchAlignment));
+  NVVK_DBG_NAME(scratch.buffer);
+
+  buildInfo.dstAccelerationStructure  = accel.accel;
+  buildInfo.scratchData.deviceAddress = scratch.address;
+  const VkAccelerationStructureBuildRangeInfoKHR  range{.primitiveCount = primitiveCount};
+  const VkAccelerationStructureBuildRangeInfoKHR* ranges = &range;
+  vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfo, &ranges);
+  res.deletionQueue.retire(scratch);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Grow the buffer to hold `size` bytes: a buffer of twice the capacity replaces it, with a copy of
+// its content, and it is retired. Returns true if the buffer moved.
+bool SceneComposition::reserve(VkCommandBuffer cmd, Resources& res, SharedBuffer& shared, VkDeviceSize size, VkBufferUsageFlags2 usage)
+{
+  if(size <= shared.buffer.bufferSize)
+    return false;
+
+  nvvk::Buffer buffer;
+  NVVK_CHECK(res.allocator.createBuffer(buffer, std::max(size, 2 * shared.buffer.bufferSize),
+                                        usage | VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+  NVVK_DBG_NAME(buffer.buffer);
+  if(shared.size > 0)
+  {
+    const VkBufferCopy region{.size = shared.size};
+    vkCmdCopyBuffer(cmd, shared.buffer.buffer, buffer.buffer, 1, &region);
+  }
+  res.deletionQueue.retire(shared.buffer);
+  shared.buffer = buffer;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Materials at the head of the table: SceneVk has a default one when the glTF has none
+uint32_t SceneComposition::getNumBaseMaterials(Resources& res) const
+{
+  return std::max(1U, uint32_t(res.scene->getModel().materials.size()));
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <nvvk/staging.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include "resources.hpp"
+
+
+// Assets added to the loaded scene, rendered by the path tracer.
+// The geometry of all assets is in shared vertex and index buffers: the asset table gives the range
+// of each primitive, which is uploaded and gets its BLAS once, however many instances refer to it.
+// Adding, moving or removing an instance only rebuilds the TLAS, over the render nodes of the loaded
+// scene followed by the nodes of the instances placed by their transform. The scene description of
+// the path tracer starts with the one of the loaded scene, so both are indexed the same way.
+class SceneComposition
+{
+public:
+  SceneComposition() = default;
+  ~SceneComposition() { assert(!m_shader && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUIRender(Resources& res);
+
+  // Add an instance of a glTF file. The first time, the file is loaded and uploaded with `cmd`.
+  bool add(VkCommandBuffer cmd, Resources& res, nvvk::StagingUploader& staging, const std::filesystem::path& filename);
+  // Remove the instances and the assets, when the loaded scene is replaced
+  void clear(Resources& res);
+  // The render nodes, materials or lights of the loaded scene changed
+  void markBaseChanged() { m_dirty |= isActive(); }
+
+  // Rebuild the TLAS and copy the description of the loaded scene when they changed.
+  // Returns true if the composed scene changed.
+  bool update(VkCommandBuffer cmd, Resources& res);
+
+  bool isActive() const { return !m_instances.empty(); }
+
+private:
+  // Range of a primitive in the shared buffers
+  struct Primitive
+  {
+    uint32_t                    firstVertex{0};
+    uint32_t                    numVertices{0};
+    uint32_t                    firstTriangle{0};
+    uint32_t                    numTriangles{0};
+    bool                        hasNormals{false};
+    bool                        hasTexCoords{false};
+    nvvk::AccelerationStructure blas;
+  };
+
+  // Render node of an asset, its primitive and material relative to the ones of the asset
+  struct Node
+  {
+    glm::mat4 worldMatrix{1.0f};
+    int       primitive{0};
+    int       material{0};
+  };
+
+  // Entry of the asset table: a glTF file, uploaded once
+  struct Asset
+  {
+    std::filesystem::path filename;
+    uint32_t              firstPrimitive{0};  // In m_primitives
+    uint32_t              numPrimitives{0};
+    uint32_t              firstMaterial{0};  // In m_materials
+    uint32_t              numMaterials{0};
+    std::vector<Node>     nodes;
+  };
+
+  struct Instance
+  {
+    uint32_t  asset{0};
+    glm::vec3 translation{0.0f};
+    glm::vec3 rotation{0.0f};  // Euler angles in degrees
+    glm::vec3 scale{1.0f};
+
+    glm::mat4 getTransform() const;
+  };
+
+  // Device buffer growing by doubling its capacity
+  struct SharedBuffer
+  {
+    nvvk::Buffer buffer;
+    VkDeviceSize size{0};  // In use, the capacity is buffer.bufferSize
+  };
+
+  int  loadAsset(VkCommandBuffer cmd, Resources& res, nvvk::StagingUploader& staging, const std::filesystem::path& filename);
+  bool buildBaseBlas(VkCommandBuffer cmd, Resources& res);
+  void writeDescription(VkCommandBuffer cmd, Resources& res, nvvk::StagingUploader& staging, uint32_t firstPrimitive, uint32_t firstMaterial);
+  void buildTlas(VkCommandBuffer cmd, Resources& res);
+  void buildAccel(VkCommandBuffer cmd, Resources& res, const VkAccelerationStructureGeometryKHR& geometry, uint32_t primitiveCount,
+                  VkAccelerationStructureTypeKHR type, nvvk::AccelerationStructure& accel);
+  bool reserve(VkCommandBuffer cmd, Resources& res, SharedBuffer& shared, VkDeviceSize size, VkBufferUsageFlags2 usage);
+  uint32_t getNumBaseMaterials(Resources& res) const;
+
+  std::vector<Asset>     m_assets;     // Asset table
+  std::vector<Instance>  m_instances;  // Placed assets
+  std::vector<Primitive> m_primitives;
+
+  std::vector<shaderio::GltfShadeMaterial> m_materials;  // Of the assets, uploaded after the ones of the loaded scene
+
+  // Geometry of the assets
+  SharedBuffer m_positions;  // vec3
+  SharedBuffer m_normals;    // vec3
+  SharedBuffer m_texCoords;  // vec2
+  SharedBuffer m_indices;    // uvec3
+
+  // Scene description of the path tracer, the loaded scene followed by the assets
+  SharedBuffer m_materialTable;   // GltfShadeMaterial
+  SharedBuffer m_primitiveTable;  // GltfRenderPrimitive
+  SharedBuffer m_nodeTable;       // GltfRenderNode
+  nvvk::Buffer m_bSceneDesc;      // GltfScene
+
+  // Loaded scene: one BLAS per render primitive, for the composed TLAS
+  std::vector<nvvk::AccelerationStructure> m_baseBlas;
+  uint32_t                                 m_numBaseNodes{0};
+  uint32_t                                 m_numBasePrimitives{0};
+
+  nvvk::AccelerationStructure m_tlas;
+  bool                        m_dirty{false};  // The TLAS, the render nodes and the copy of the loaded scene are updated
+
+  VkDeviceSize     m_scratchAlignment{128};
+  VkShaderEXT      m_shader{};
+  VkPipelineLayout m_pipelineLayout{};
+};
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Scene Swap
+
+    - Only the current slot is rendered. The free slot is empty, holds the
+      scene being loaded, or the previous scene until it is retired
+    - The thread only touches the free slot, the command pool and the
+      staging of the swap. Its command buffers are submitted once it is
+      done, so the pool is never used by two threads
+    - Like the queued command buffers of the render loop, each submission
+      waits for its command buffer: the BLAS are compacted right after
+      their build, and a frame submits at most one of them
+    - The swap is done before anything is recorded in the frame: only the
+      frames already submitted use the previous scene, it is retired to
+      the deletion queue of Resources. Loading again in its slot waits for
+      it to be destroyed
+    - Each slot has its descriptor set for the textures: the set of the new
+      scene is written while the one of the previous scene is still in use
+    - Each slot also has its allocator, used by the staging while loading
+      in it. The thread binds it (MemoryReport::ThreadAllocator): its
+      scopes only measure the new scene, and the scopes of the render loop
+      running meanwhile do not see it
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/commands.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "scene_swap.hpp"
+#include "trace_export.hpp"
+
+void SceneSwap::init(Resources& res, const nvvk::QueueInfo& queue)
+{
+  m_device  = res.allocator.getDevice();
+  m_queue   = queue;
+  m_cmdPool = nvvk::createTransientCommandPool(m_device, queue.familyIndex);
+  NVVK_DBG_NAME(m_cmdPool);
+  m_staging.init(&res.allocator, true);
+}
+
+void SceneSwap::deinit(Resources& res)
+{
+  if(m_thread.joinable())
+    m_thread.join();
+
+  // Scene never swapped in
+  while(!m_queued.empty())
+  {
+    vkFreeCommandBuffers(m_device, m_cmdPool, 1, &m_queued.front().cmd);
+    m_queued.pop();
+  }
+  if(m_state != State::eIdle)
+    destroySlot(res, getFreeSlot(res));
+  m_state = State::eIdle;
+  waitRetired(res);
+
+  m_staging.deinit();
+  vkDestroyCommandPool(m_device, m_cmdPool, nullptr);
+  m_cmdPool = VK_NULL_HANDLE;
+}
+
+SceneSlot& SceneSwap::getCurrentSlot(Resources& res)
+{
+  return res.scene == &res.sceneSlots[0].scene ? res.sceneSlots[0] : res.sceneSlots[1];
+}
+
+SceneSlot& SceneSwap::getFreeSlot(Resources& res)
+{
+  return res.scene == &res.sceneSlots[0].scene ? res.sceneSlots[1] : res.sceneSlots[0];
+}
+
+//--------------------------------------------------------------------------------------------------
+// Load the scene on a thread, in the free slot
+bool SceneSwap::start(Resources& res, const std::filesystem::path& filename, LoadFunc load)
+{
+  if(m_state != State::eIdle)
+  {
+    LOGW("Still loading %s, %s is ignored\n", nvutils::utf8FromPath(m_filename).c_str(), nvutils::utf8FromPath(filename).c_str());
+    return false;
+  }
+  if(m_thread.joinable())
+    m_thread.join();
+
+  // The free slot may still hold the previous scene, used by the last frames
+  waitRetired(res);
+
+  m_filename      = filename;
+  m_state         = State::eLoading;
+  SceneSlot& slot = getFreeSlot(res);
+
+  // Staging in the allocator of the slot, measured with the scene
+  m_staging.deinit();
+  m_staging.init(&slot.allocator, true);
+
+  m_thread = std::thread([this, &res, &slot, load = std::move(load)]() {
+    TRACE_SCOPE("SceneSwap::load");
+    MemoryReport::ThreadAllocator threadAllocator(res.memoryReport, slot.allocator);
+    m_state = load(slot) ? State::eBuilding : State::eFailed;
+  });
+  return true;
+}
+
+void SceneSwap::queueCommands(VkCommandBuffer cmd, bool isBlasBuild)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_queued.push({cmd, isBlasBuild});
+}
+
+//--------------------------------------------------------------------------------------------------
+// Build the new scene, one command buffer per frame
+SceneSlot* SceneSwap::update(Resources& res)
+{
+  if(m_state == State::eFailed)
+  {
+    m_thread.join();
+    while(!m_queued.empty())
+    {
+      vkFreeCommandBuffers(m_device, m_cmdPool, 1, &m_queued.front().cmd);
+      m_queued.pop();
+    }
+    destroySlot(res, getFreeSlot(res));
+    {
+      MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eGeometry);
+      m_staging.releaseStaging(true);
+    }
+    m_state = State::eIdle;
+    return nullptr;
+  }
+  if(m_state != State::eBuilding)
+    return nullptr;
+
+  // All command buffers are recorded
+  if(m_thread.joinable())
+    m_thread.join();
+
+  if(!m_queued.empty())
+  {
+    const QueuedCommands queued = m_queued.front();
+    m_queued.pop();
+    TRACE_SCOPE(queued.isBlasBuild ? "Swap BLAS build" : "Swap command buffer");
+    nvvk::endSingleTimeCommands(queued.cmd, m_device, m_cmdPool, m_queue.queue);
+
+    if(queued.isBlasBuild)
+    {
+      VkCommandBuffer cmd{};
+      nvvk::beginSingleTimeCommands(cmd, m_device, m_cmdPool);
+      MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+      getFreeSlot(res).sceneRtx.cmdCompactBlas(cmd);
+      nvvk::endSingleTimeCommands(cmd, m_device, m_cmdPool, m_queue.queue);
+    }
+    return nullptr;
+  }
+
+  // The scene is complete
+  {
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eGeometry);
+    m_staging.releaseStaging(true);
+  }
+  m_state = State::eIdle;
+  return &getFreeSlot(res);
+}
+
+//--------------------------------------------------------------------------------------------------
+// The slot becomes the scene rendered, the previous one is destroyed once the frames using it are done
+void SceneSwap::swap(Resources& res, SceneSlot& slot)
+{
+  SceneSlot& previous = getCurrentSlot(res);
+  res.scene           = &slot.scene;
+  res.sceneVk         = &slot.sceneVk;
+  res.sceneRtx        = &slot.sceneRtx;
+  res.descriptorSet   = slot.descriptorSet;
+
+  m_retired      = true;
+  m_retiredValue = res.deletionQueue.retire([this, &res, &previous]() {
+    destroySlot(res, previous);
+    m_retired = false;
+  });
+}
+
+void SceneSwap::waitRetired(Resources& res)
+{
+  if(m_retired)
+    res.deletionQueue.wait(m_retiredValue);
+}
+
+void SceneSwap::destroySlot(Resources& res, SceneSlot& slot)
+{
+  slot.scene.destroy();
+  {
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eGeometry);
+    slot.sceneVk.destroy();
+  }
+  {
+    MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eAccelerationStructures);
+    slot.sceneRtx.destroy();
+  }
+}
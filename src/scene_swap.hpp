@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+#include <vulkan/vulkan_core.h>
+#include <nvvk/resource_allocator.hpp>
+#include <nvvk/staging.hpp>
+
+#include "resources.hpp"
+
+
+// Loads a scene in the background while the current one is still rendered. The new scene is
+// created in the slot of Resources not rendered: parsed and created on a thread, which records its
+// upload and acceleration structure builds with a command pool and a staging uploader of its own.
+// The render loop then submits these command buffers one per frame, between the frames of the
+// current scene. Once all are done, the slots are swapped at the beginning of a frame, and the
+// previous scene goes to the deletion queue, destroyed once the last frame using it is done.
+class SceneSwap
+{
+public:
+  // Creates the scene in the slot, returns false if it cannot be loaded. Runs on the thread.
+  using LoadFunc = std::function<bool(SceneSlot& slot)>;
+
+  void init(Resources& res, const nvvk::QueueInfo& queue);
+  void deinit(Resources& res);  // Waits for the thread, destroys the scene being loaded and the retired one
+
+  // Starts loading in the free slot, returns false if a scene is already being loaded
+  bool start(Resources& res, const std::filesystem::path& filename, LoadFunc load);
+  bool isLoading() const { return m_state != State::eIdle; }
+  const std::filesystem::path& getFilename() const { return m_filename; }
+
+  // For the load function: the command buffers creating the scene are allocated from this pool,
+  // with the uploads of this staging, then queued
+  VkCommandPool          getCommandPool() const { return m_cmdPool; }
+  nvvk::StagingUploader& getStaging() { return m_staging; }
+  void                   queueCommands(VkCommandBuffer cmd, bool isBlasBuild);
+
+  // Once per frame, before recording: submits the next queued command buffer of the new scene.
+  // Returns the slot of the new scene when it is complete: it must be swapped in.
+  SceneSlot* update(Resources& res);
+
+  // Makes the slot the scene rendered, the previous one is retired
+  void swap(Resources& res, SceneSlot& slot);
+
+  static SceneSlot& getCurrentSlot(Resources& res);
+  static SceneSlot& getFreeSlot(Resources& res);
+
+private:
+  enum class State
+  {
+    eIdle,
+    eLoading,   // The thread creates the scene
+    eBuilding,  // Its command buffers are submitted, one per frame
+    eFailed,    // The thread could not load the scene
+  };
+
+  struct QueuedCommands
+  {
+    VkCommandBuffer cmd{};
+    bool            isBlasBuild{false};  // Followed by the compaction of the BLAS
+  };
+
+  void destroySlot(Resources& res, SceneSlot& slot);
+  void waitRetired(Resources& res);  // Until the previous scene is destroyed
+
+  VkDevice              m_device{};
+  nvvk::QueueInfo       m_queue{};
+  VkCommandPool         m_cmdPool{};
+  nvvk::StagingUploader m_staging;
+
+  std::atomic<State>         m_state{State::eIdle};
+  std::filesystem::path      m_filename;
+  std::thread                m_thread;
+  std::queue<QueuedCommands> m_queued;
+  std::mutex                 m_mutex;
+
+  bool     m_retired{false};  // The free slot holds the previous scene, in the deletion queue
+  uint64_t m_retiredValue{0};
+};
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Spatiotemporal Variance-Guided Filtering (SVGF)
+
+    - Temporal: the illumination (color / albedo) and its luminance moments are accumulated
+      with the reprojected history; history samples of another surface are rejected (disocclusion)
+    - Variance: from the temporal moments, or estimated on the neighbours for new pixels
+    - Spatial: a-trous wavelet iterations (5x5 taps, 1, 2, 4, .. pixels apart), weighted by
+      the normal, depth and luminance differences; the last one multiplies back the albedo
+    The same algorithm is implemented on the CPU in svgf_reference.cpp, for regression tests.
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include <nvgui/property_editor.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/compute_pipeline.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "svgf_denoiser.hpp"
+
+// Pre-compiled shader
+#include "_autogen/svgf.comp.slang.h"
+
+//--------------------------------------------------------------------------------------------------
+// Create the shaders of the three passes and their layout. The images are created on first use.
+void SvgfDenoiser::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  VkDevice device = res.allocator.getDevice();
+
+  VkPushConstantRange pushConstant = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::SvgfPushConstant)};
+
+  using namespace shaderio;
+  const VkDescriptorType sampled = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  const VkDescriptorType storage = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  m_bindings.addBinding(SvgfBindings::eSvgfColor, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfAlbedo, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfNormalRoughness, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfMotion, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfDepth, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfPrevIllumination, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfPrevMoments, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfPrevNormalDepth, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfIllumination, storage, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfMoments, storage, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfNormalDepth, storage, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfFilterIn, sampled, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(SvgfBindings::eSvgfFilterOut, storage, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  NVVK_CHECK(m_bindings.createDescriptorSetLayout(device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR, &m_descriptorSetLayout));
+  NVVK_DBG_NAME(m_descriptorSetLayout);
+
+  VkPipelineLayoutCreateInfo plCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_descriptorSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreatePipelineLayout(device, &plCreateInfo, nullptr, &m_pipelineLayout));
+  NVVK_DBG_NAME(m_pipelineLayout);
+
+  // One shader object per entry point of the module
+  VkShaderCreateInfoEXT shaderCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+      .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
+      .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+      .codeSize               = svgf_comp_slang_sizeInBytes,
+      .pCode                  = svgf_comp_slang,
+      .pName                  = "temporalMain",
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_descriptorSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_temporalShader));
+  NVVK_DBG_NAME(m_temporalShader);
+  shaderCreateInfo.pName = "varianceMain";
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_varianceShader));
+  NVVK_DBG_NAME(m_varianceShader);
+  shaderCreateInfo.pName = "atrousMain";
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_atrousShader));
+  NVVK_DBG_NAME(m_atrousShader);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the images and the shaders
+void SvgfDenoiser::deinit(Resources& res)
+{
+  VkDevice device = res.allocator.getDevice();
+  if(m_images)
+    m_images->deinit();
+  m_images.reset();
+  vkDestroyShaderEXT(device, m_temporalShader, nullptr);
+  vkDestroyShaderEXT(device, m_varianceShader, nullptr);
+  vkDestroyShaderEXT(device, m_atrousShader, nullptr);
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+  m_bindings.clear();
+  m_temporalShader      = {};
+  m_varianceShader      = {};
+  m_atrousShader        = {};
+  m_pipelineLayout      = {};
+  m_descriptorSetLayout = {};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters
+void SvgfDenoiser::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"svgf", "SVGF Denoiser: Enable the built-in denoiser of the path tracer"}, &m_settings.enable, true);
+  paramReg->add({"svgfIterations", "SVGF Denoiser: Number of a-trous iterations [1..6]"}, &m_settings.iterations);
+  paramReg->add({"svgfMaxHistory", "SVGF Denoiser: Maximum number of accumulated frames"}, &m_settings.maxHistory);
+  paramReg->add({"svgfValidate", "SVGF Denoiser: Headless, compare the last frame with the CPU reference"},
+                &m_settings.validate, true);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Settings of the denoiser, returns true if the image must be rendered again
+bool SvgfDenoiser::onUi(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  bool changed = false;
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("SVGF Denoiser", &m_settings.enable, "Built-in spatiotemporal denoiser, for previews at 1-4 spp");
+    ImGui::BeginDisabled(!m_settings.enable);
+    changed |= PE::SliderInt("Filter Iterations", &m_settings.iterations, 1, 6, "%d", 0,
+                             "Number of a-trous iterations, the radius of the filter doubles at each");
+    changed |= PE::SliderInt("Max History", &m_settings.maxHistory, 1, 128, "%d", 0, "Maximum number of accumulated frames");
+    changed |= PE::SliderFloat("Temporal Alpha", &m_settings.alphaColor, 0.01f, 1.0f, "%.2f", 0,
+                               "Minimum weight of the current frame: lower is smoother, higher has less ghosting");
+    changed |= PE::SliderFloat("Color Sigma", &m_settings.phiColor, 0.1f, 16.0f, "%.1f", 0,
+                               "Tolerance to luminance differences, in standard deviations");
+    changed |= PE::SliderFloat("Normal Power", &m_settings.phiNormal, 1.0f, 256.0f, "%.0f", 0,
+                               "Sharpness of the normal edge-stopping function");
+    changed |= PE::SliderFloat("Depth Sigma", &m_settings.phiDepth, 0.1f, 8.0f, "%.1f", 0, "Tolerance to depth differences");
+    ImGui::EndDisabled();
+    PE::end();
+  }
+  if(changed)
+    m_reset = true;
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create or resize the images
+void SvgfDenoiser::updateSize(VkCommandBuffer cmd, Resources& res)
+{
+  const VkExtent2D size = res.gBuffers.getSize();
+  if(m_images && m_images->getSize().width == size.width && m_images->getSize().height == size.height)
+    return;
+
+  // The frames in flight may still use the previous images, freed later from the same category
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  res.deletionQueue.retire(m_images);
+  m_images = std::make_unique<nvvk::GBuffer>();
+  m_images->init({.allocator    = &res.allocator,
+                  .colorFormats = {
+                      VK_FORMAT_R32G32B32A32_SFLOAT,  // eNoisy
+                      VK_FORMAT_R32G32B32A32_SFLOAT,  // eIllumination0
+                      VK_FORMAT_R32G32B32A32_SFLOAT,  // eIllumination1
+                      VK_FORMAT_R32G32_SFLOAT,        // eMoments0
+                      VK_FORMAT_R32G32_SFLOAT,        // eMoments1
+                      VK_FORMAT_R16G16B16A16_SFLOAT,  // eNormalDepth0
+                      VK_FORMAT_R16G16B16A16_SFLOAT,  // eNormalDepth1
+                      VK_FORMAT_R32G32B32A32_SFLOAT,  // eFilter0
+                      VK_FORMAT_R32G32B32A32_SFLOAT,  // eFilter1
+                  },
+                  .imageSampler = res.gBuffers.getDescriptorImageInfo(Resources::eImgRendered).sampler});
+  m_images->update(cmd, size);
+  m_reset = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// After denoise(), m_historyIndex points to the history the frame has read
+bool SvgfDenoiser::getLastHistory(Image image, VkImage& vkImage, VkFormat& format) const
+{
+  if(!m_images || m_lastReset)
+    return false;
+  vkImage = m_images->getColorImage(image + m_historyIndex);
+  format  = m_images->getColorFormat(image + m_historyIndex);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Bind the shader and dispatch it over the image
+void SvgfDenoiser::dispatch(VkCommandBuffer cmd, VkShaderEXT shader, const VkExtent2D& size)
+{
+  const VkShaderStageFlagBits stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  vkCmdBindShadersEXT(cmd, 1, &stage, &shader);
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(shaderio::SvgfPushConstant), &m_pushConstant);
+  const VkExtent2D groupCounts = nvvk::getGroupCounts(size, SVGF_WORKGROUP_SIZE);
+  vkCmdDispatch(cmd, groupCounts.width, groupCounts.height, 1);
+
+  // The next pass reads the result
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Temporal accumulation, variance estimation and a-trous iterations
+void SvgfDenoiser::denoise(VkCommandBuffer cmd, Resources& res, const nvvk::GBuffer& guides)
+{
+  NVVK_DBG_SCOPE(cmd);
+  using namespace shaderio;
+
+  const VkExtent2D size = m_images->getSize();
+
+  // The path tracer restarted without a camera motion: something else changed in the scene
+  // (material, light, ..), the history cannot be reprojected.
+  const glm::mat4 viewProj = res.cameraManip->getPerspectiveMatrix() * res.cameraManip->getViewMatrix();
+  if(res.frameCount == 0 && viewProj == m_lastViewProj)
+    m_reset = true;
+  m_lastViewProj = viewProj;
+
+  m_pushConstant.size         = {int(size.width), int(size.height)};
+  m_pushConstant.reset        = m_reset ? 1 : 0;
+  m_pushConstant.alphaColor   = m_settings.alphaColor;
+  m_pushConstant.alphaMoments = m_settings.alphaMoments;
+  m_pushConstant.maxHistory   = float(std::max(1, m_settings.maxHistory));
+  m_pushConstant.phiColor     = m_settings.phiColor;
+  m_pushConstant.phiNormal    = m_settings.phiNormal;
+  m_pushConstant.phiDepth     = m_settings.phiDepth;
+
+  // The frame and the guides were written by the path tracer
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+  const uint32_t curr = m_historyIndex;
+  const uint32_t prev = 1 - m_historyIndex;
+  auto guide = [&](OutputImage name) { return guides.getDescriptorImageInfo(name - eDlssAlbedo); };
+
+  auto pushDescriptors = [&](const VkDescriptorImageInfo& filterIn, const VkDescriptorImageInfo& filterOut) {
+    nvvk::WriteSetContainer write;
+    write.append(m_bindings.getWriteSet(eSvgfColor), m_images->getDescriptorImageInfo(eNoisy));
+    write.append(m_bindings.getWriteSet(eSvgfAlbedo), guide(eDlssAlbedo));
+    write.append(m_bindings.getWriteSet(eSvgfNormalRoughness), guide(eDlssNormalRoughness));
+    write.append(m_bindings.getWriteSet(eSvgfMotion), guide(eDlssMotion));
+    write.append(m_bindings.getWriteSet(eSvgfDepth), guide(eDlssDepth));
+    write.append(m_bindings.getWriteSet(eSvgfPrevIllumination), m_images->getDescriptorImageInfo(eIllumination0 + prev));
+    write.append(m_bindings.getWriteSet(eSvgfPrevMoments), m_images->getDescriptorImageInfo(eMoments0 + prev));
+    write.append(m_bindings.getWriteSet(eSvgfPrevNormalDepth), m_images->getDescriptorImageInfo(eNormalDepth0 + prev));
+    write.append(m_bindings.getWriteSet(eSvgfIllumination), m_images->getDescriptorImageInfo(eIllumination0 + curr));
+    write.append(m_bindings.getWriteSet(eSvgfMoments), m_images->getDescriptorImageInfo(eMoments0 + curr));
+    write.append(m_bindings.getWriteSet(eSvgfNormalDepth), m_images->getDescriptorImageInfo(eNormalDepth0 + curr));
+    write.append(m_bindings.getWriteSet(eSvgfFilterIn), filterIn);
+    write.append(m_bindings.getWriteSet(eSvgfFilterOut), filterOut);
+    vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, write.size(), write.data());
+  };
+
+  const VkDescriptorImageInfo filters[2] = {m_images->getDescriptorImageInfo(eFilter0), m_images->getDescriptorImageInfo(eFilter1)};
+
+  // Temporal accumulation, then the variance in the first filter image
+  pushDescriptors(filters[1], filters[0]);
+  dispatch(cmd, m_temporalShader, size);
+  dispatch(cmd, m_varianceShader, size);
+
+  // A-trous iterations, the last one writes the rendered image
+  const int iterations = std::clamp(m_settings.iterations, 1, 6);
+  for(int i = 0; i < iterations; i++)
+  {
+    const bool last           = (i == iterations - 1);
+    m_pushConstant.stepSize   = 1 << i;
+    m_pushConstant.finalPass  = last ? 1 : 0;
+    pushDescriptors(filters[i % 2], last ? res.gBuffers.getDescriptorImageInfo(Resources::eImgRendered) : filters[(i + 1) % 2]);
+    dispatch(cmd, m_atrousShader, size);
+  }
+  m_pushConstant.stepSize  = 1;
+  m_pushConstant.finalPass = 0;
+
+  m_historyIndex = prev;
+  m_lastReset    = m_reset;
+  m_reset        = false;
+}
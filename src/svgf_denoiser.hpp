@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <memory>
+
+#include <glm/glm.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include <nvutils/parameter_registry.hpp>
+
+#include "resources.hpp"
+
+
+// Vendor-neutral spatiotemporal denoiser of the path tracer (SVGF: temporal accumulation with
+// reprojection, then an edge-aware a-trous filter), running in compute.
+// The path tracer writes its noisy frame in the image of this class and the first-hit guides
+// (albedo, normal, motion, depth) in its AOV buffers; the denoised image is written in the
+// rendered image (Resources::eImgRendered).
+class SvgfDenoiser
+{
+public:
+  struct Settings
+  {
+    bool  enable       = false;
+    int   iterations   = 4;       // Number of a-trous iterations, the filter radius doubles at each
+    float alphaColor   = 0.2f;    // Minimum weight of the current frame, color
+    float alphaMoments = 0.2f;    // Minimum weight of the current frame, moments
+    int   maxHistory   = 32;      // Maximum number of accumulated frames
+    float phiColor     = 4.0f;    // Edge-stopping: luminance
+    float phiNormal    = 128.0f;  // Edge-stopping: normal
+    float phiDepth     = 1.0f;    // Edge-stopping: depth
+    bool  validate     = false;   // Headless: compare the last frame with the CPU reference
+  };
+
+  // Images owned by the denoiser
+  enum Image
+  {
+    eNoisy,            // RGBA32F: frame of the path tracer
+    eIllumination0,    // RGBA32F: history, illumination and history length (ping-pong)
+    eIllumination1,    //
+    eMoments0,         // RG32F  : history, luminance moments (ping-pong)
+    eMoments1,         //
+    eNormalDepth0,     // RGBA16F: normal and depth of the frame (ping-pong)
+    eNormalDepth1,     //
+    eFilter0,          // RGBA32F: illumination and variance, a-trous iterations (ping-pong)
+    eFilter1,          //
+  };
+
+  SvgfDenoiser() = default;
+  ~SvgfDenoiser() { assert(!m_temporalShader && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUi(Resources& res);
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  bool            isEnabled() const { return m_settings.enable; }
+  const Settings& getSettings() const { return m_settings; }
+
+  // Create or resize the images to the size of the rendering
+  void updateSize(VkCommandBuffer cmd, Resources& res);
+
+  // Image where the path tracer writes its noisy frame
+  VkDescriptorImageInfo getNoisyImageInfo() const { return m_images->getDescriptorImageInfo(eNoisy); }
+  VkImage               getNoisyImage() const { return m_images->getColorImage(eNoisy); }
+  VkFormat              getNoisyFormat() const { return m_images->getColorFormat(eNoisy); }
+
+  // For the validation: the history read by the last denoised frame (eIllumination0, eMoments0 or
+  // eNormalDepth0), left untouched until the next frame. False if that frame had no history.
+  bool getLastHistory(Image image, VkImage& vkImage, VkFormat& format) const;
+
+  // Frame index of the path tracer: never restarts, the noise must differ between frames
+  int nextFrameIndex() { return ++m_frameIndex; }
+
+  // Denoise the frame. `guides` are the AOV buffers of the path tracer, in the order of
+  // shaderio::OutputImage starting at eDlssAlbedo.
+  void denoise(VkCommandBuffer cmd, Resources& res, const nvvk::GBuffer& guides);
+
+  void reset() { m_reset = true; }  // Discard the history
+
+private:
+  void dispatch(VkCommandBuffer cmd, VkShaderEXT shader, const VkExtent2D& size);
+
+  Settings                       m_settings{};
+  std::unique_ptr<nvvk::GBuffer> m_images;           // See Image, replaced when resized
+  uint32_t                       m_historyIndex{0};  // History written by the next frame (0 or 1)
+  int                            m_frameIndex{0};
+  bool                           m_reset{true};
+  bool                           m_lastReset{true};  // The last frame discarded the history
+  glm::mat4                  m_lastViewProj{0.0f};
+  shaderio::SvgfPushConstant m_pushConstant{};
+
+  nvvk::DescriptorBindings m_bindings;
+  VkShaderEXT              m_temporalShader{};
+  VkShaderEXT              m_varianceShader{};
+  VkShaderEXT              m_atrousShader{};
+  VkPipelineLayout         m_pipelineLayout{};       // Pipeline layout
+  VkDescriptorSetLayout    m_descriptorSetLayout{};  // Descriptor set layout
+};
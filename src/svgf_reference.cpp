@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    SVGF CPU reference
+
+    Same steps as svgf.comp.slang for one frame:
+    - temporal : illumination = color / albedo, blended with the bilinear reprojection of the
+                 history taps on the same surface (history length 1 without history)
+    - variance : from the temporal moments, or spatial estimate boosted for short histories
+    - a-trous  : `iterations` edge-aware passes, the last one multiplies back the albedo
+    The weights come from shaders/svgf_util.h, shared with the shader. The normal and depth are
+    rounded to half floats, like the RGBA16F image of the GPU version.
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "svgf_reference.hpp"
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/svgf_util.h"
+}  // namespace shaderio
+
+namespace svgf {
+
+namespace {
+
+struct Image
+{
+  int                    width  = 0;
+  int                    height = 0;
+  std::vector<glm::vec4> pixels;
+
+  Image(int w, int h)
+      : width(w)
+      , height(h)
+      , pixels(size_t(w) * h, glm::vec4(0.0f))
+  {
+  }
+  bool       inside(glm::ivec2 p) const { return p.x >= 0 && p.y >= 0 && p.x < width && p.y < height; }
+  glm::vec4& operator[](glm::ivec2 p) { return pixels[size_t(p.y) * width + p.x]; }
+  glm::vec4  operator[](glm::ivec2 p) const { return pixels[size_t(p.y) * width + p.x]; }
+  glm::vec4  clamped(glm::ivec2 p) const { return (*this)[glm::clamp(p, glm::ivec2(0), glm::ivec2(width - 1, height - 1))]; }
+};
+
+float toHalf(float v)
+{
+  return glm::unpackHalf1x16(glm::packHalf1x16(v));
+}
+
+glm::vec4 load4(const std::vector<float>& data, size_t index)
+{
+  return {data[index * 4 + 0], data[index * 4 + 1], data[index * 4 + 2], data[index * 4 + 3]};
+}
+
+glm::vec2 load2(const std::vector<float>& data, size_t index)
+{
+  return {data[index * 2 + 0], data[index * 2 + 1]};
+}
+
+// Same as isConsistent() of the shader
+bool isConsistent(const glm::vec3& normal, float depth, const glm::vec4& prevNormalDepth)
+{
+  return prevNormalDepth.w >= 0.0f && std::abs(depth - prevNormalDepth.w) < 0.1f * depth
+         && glm::dot(normal, glm::vec3(prevNormalDepth)) > 0.9f;
+}
+
+// Same as depthGradient() of the shader
+float depthGradient(const Image& normalDepth, glm::ivec2 p, float depth)
+{
+  glm::vec2 grad(1e10f);
+  for(int i = -1; i <= 1; i += 2)
+  {
+    const float zx = normalDepth.clamped(p + glm::ivec2(i, 0)).w;
+    const float zy = normalDepth.clamped(p + glm::ivec2(0, i)).w;
+    if(zx >= 0.0f)
+      grad.x = std::min(grad.x, std::abs(zx - depth));
+    if(zy >= 0.0f)
+      grad.y = std::min(grad.y, std::abs(zy - depth));
+  }
+  grad.x = grad.x >= 1e10f ? 0.0f : grad.x;
+  grad.y = grad.y >= 1e10f ? 0.0f : grad.y;
+  return std::max(grad.x, grad.y);
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+//
+std::vector<float> denoiseReference(const ReferenceInput& input)
+{
+  using namespace shaderio;
+  const int w = int(input.width);
+  const int h = int(input.height);
+
+  const bool hasHistory = !input.prevIllumination.empty();
+
+  Image normalDepth(w, h);
+  Image illumination(w, h);  // xyz: illumination, w: history length
+  Image moments(w, h);       // xy: luminance moments
+  Image albedo(w, h);
+  Image color(w, h);
+
+  // Temporal pass
+  for(int y = 0; y < h; y++)
+  {
+    for(int x = 0; x < w; x++)
+    {
+      const glm::ivec2 p(x, y);
+      const size_t     i = size_t(y) * w + x;
+      color[p]           = load4(input.color, i);
+      albedo[p]          = load4(input.albedo, i);
+      if(!svgfIsSurface(albedo[p]))
+      {
+        normalDepth[p]  = glm::vec4(0, 0, 0, -1);
+        illumination[p] = glm::vec4(glm::vec3(color[p]), 0);
+        continue;
+      }
+      const glm::vec3 n     = glm::vec3(load4(input.normalRoughness, i));
+      const float     depth = input.depth[i];
+      normalDepth[p]        = glm::vec4(toHalf(n.x), toHalf(n.y), toHalf(n.z), toHalf(depth));
+      const glm::vec3 l     = glm::vec3(color[p]) / svgfAlbedo(albedo[p]);
+      const float     lum   = svgfLuminance(l);
+
+      // Bilinear fetch of the history, keeping only the taps of the same surface
+      float     historyLength = 0.0f;
+      glm::vec3 prevIllum(0.0f);
+      glm::vec2 prevMoments(0.0f);
+      if(hasHistory)
+      {
+        const glm::vec2  prevPos = glm::vec2(p) + load2(input.motion, i);
+        const glm::ivec2 p0      = glm::ivec2(glm::floor(prevPos));
+        const glm::vec2  f       = prevPos - glm::vec2(p0);
+        float            sumW    = 0.0f;
+        for(int tap = 0; tap < 4; tap++)
+        {
+          const glm::ivec2 q  = p0 + glm::ivec2(tap & 1, tap >> 1);
+          const float      wq = ((tap & 1) != 0 ? f.x : 1.0f - f.x) * ((tap >> 1) != 0 ? f.y : 1.0f - f.y);
+          if(!normalDepth.inside(q))
+            continue;
+          const size_t iq = size_t(q.y) * w + q.x;
+          if(!isConsistent(n, depth, load4(input.prevNormalDepth, iq)))
+            continue;
+          const glm::vec4 prev = load4(input.prevIllumination, iq);
+          prevIllum += glm::vec3(prev) * wq;
+          prevMoments += load2(input.prevMoments, iq) * wq;
+          historyLength += prev.w * wq;
+          sumW += wq;
+        }
+        if(sumW > 0.01f)
+        {
+          prevIllum /= sumW;
+          prevMoments /= sumW;
+          historyLength = std::floor(historyLength / sumW + 0.5f);
+        }
+        else
+        {
+          historyLength = 0.0f;  // Disocclusion
+        }
+      }
+
+      historyLength       = std::min(historyLength + 1.0f, input.maxHistory);
+      const float alpha   = svgfTemporalAlpha(historyLength, input.alphaColor);
+      const float alphaM  = svgfTemporalAlpha(historyLength, input.alphaMoments);
+      illumination[p]     = glm::vec4(glm::mix(prevIllum, l, alpha), historyLength);
+      const glm::vec2 mom = glm::mix(prevMoments, glm::vec2(lum, lum * lum), alphaM);
+      moments[p]          = glm::vec4(mom, 0, 0);
+    }
+  }
+
+  // Variance, from the temporal moments or estimated on the neighbours for short histories
+  Image filter(w, h);
+  for(int y = 0; y < h; y++)
+  {
+    for(int x = 0; x < w; x++)
+    {
+      const glm::ivec2 p(x, y);
+      const glm::vec4  nd    = normalDepth[p];
+      const glm::vec4  illum = illumination[p];
+      if(nd.w < 0.0f)
+      {
+        filter[p] = glm::vec4(glm::vec3(illum), 0);
+        continue;
+      }
+      const float historyLength = illum.w;
+      if(historyLength >= SVGF_MIN_HISTORY_FOR_VARIANCE)
+      {
+        const glm::vec4 m = moments[p];
+        filter[p]         = glm::vec4(glm::vec3(illum), std::max(0.0f, m.y - m.x * m.x));
+        continue;
+      }
+      const float centerLum = svgfLuminance(glm::vec3(illum));
+      const float grad      = depthGradient(normalDepth, p, nd.w);
+      glm::vec3   sumIllum(0.0f);
+      glm::vec2   sumMoment(0.0f);
+      float       sumW = 0.0f;
+      for(int dy = -2; dy <= 2; dy++)
+      {
+        for(int dx = -2; dx <= 2; dx++)
+        {
+          const glm::ivec2 q = p + glm::ivec2(dx, dy);
+          if(!normalDepth.inside(q) || normalDepth[q].w < 0.0f)
+            continue;
+          const glm::vec3 s  = glm::vec3(illumination[q]);
+          const float     wq = svgfEdgeWeight(glm::vec3(nd), glm::vec3(normalDepth[q]), nd.w, normalDepth[q].w, grad,
+                                              glm::length(glm::vec2(dx, dy)), centerLum, svgfLuminance(s), 1.0f,
+                                              input.phiNormal, input.phiDepth, 10.0f);
+          sumIllum += s * wq;
+          sumMoment += glm::vec2(moments[q]) * wq;
+          sumW += wq;
+        }
+      }
+      sumW = std::max(sumW, 1e-6f);
+      sumIllum /= sumW;
+      sumMoment /= sumW;
+      const float variance = std::max(0.0f, sumMoment.y - sumMoment.x * sumMoment.x) * (SVGF_MIN_HISTORY_FOR_VARIANCE / historyLength);
+      filter[p]            = glm::vec4(sumIllum, variance);
+    }
+  }
+
+  // A-trous iterations
+  const int iterations = std::clamp(input.iterations, 1, 6);
+  for(int iter = 0; iter < iterations; iter++)
+  {
+    const int stepSize = 1 << iter;
+    Image     next(w, h);
+    for(int y = 0; y < h; y++)
+    {
+      for(int x = 0; x < w; x++)
+      {
+        const glm::ivec2 p(x, y);
+        const glm::vec4  center = filter[p];
+        const glm::vec4  nd     = normalDepth[p];
+        if(nd.w < 0.0f)
+        {
+          next[p] = center;
+          continue;
+        }
+        float variance = 0.0f;
+        for(int dy = -1; dy <= 1; dy++)
+          for(int dx = -1; dx <= 1; dx++)
+            variance += filter.clamped(p + glm::ivec2(dx, dy)).w * svgfGaussianWeight(dx, dy);
+        const float stdDev    = std::sqrt(std::max(variance, 0.0f));
+        const float centerLum = svgfLuminance(glm::vec3(center));
+        const float grad      = depthGradient(normalDepth, p, nd.w);
+
+        const float wCenter  = svgfKernelWeight(0) * svgfKernelWeight(0);
+        glm::vec3   sumIllum = glm::vec3(center) * wCenter;
+        float       sumVar   = center.w * wCenter * wCenter;
+        float       sumW     = wCenter;
+        for(int dy = -2; dy <= 2; dy++)
+        {
+          for(int dx = -2; dx <= 2; dx++)
+          {
+            const glm::ivec2 q = p + glm::ivec2(dx, dy) * stepSize;
+            if((dx == 0 && dy == 0) || !normalDepth.inside(q) || normalDepth[q].w < 0.0f)
+              continue;
+            const glm::vec4 s  = filter[q];
+            const float     wq = svgfKernelWeight(dx) * svgfKernelWeight(dy)
+                             * svgfEdgeWeight(glm::vec3(nd), glm::vec3(normalDepth[q]), nd.w, normalDepth[q].w, grad,
+                                              glm::length(glm::vec2(dx, dy)) * float(stepSize), centerLum,
+                                              svgfLuminance(glm::vec3(s)), stdDev, input.phiNormal, input.phiDepth, input.phiColor);
+            sumIllum += glm::vec3(s) * wq;
+            sumVar += s.w * wq * wq;
+            sumW += wq;
+          }
+        }
+        next[p] = glm::vec4(sumIllum / sumW, sumVar / (sumW * sumW));
+      }
+    }
+    filter = std::move(next);
+  }
+
+  // Put back the albedo and the alpha
+  std::vector<float> result(size_t(w) * h * 4);
+  for(int y = 0; y < h; y++)
+  {
+    for(int x = 0; x < w; x++)
+    {
+      const glm::ivec2 p(x, y);
+      const glm::vec3  c = glm::vec3(filter[p]) * svgfAlbedo(albedo[p]);
+      const size_t     i = (size_t(y) * w + x) * 4;
+      result[i + 0]      = c.x;
+      result[i + 1]      = c.y;
+      result[i + 2]      = c.z;
+      result[i + 3]      = color[p].w;
+    }
+  }
+  return result;
+}
+
+//--------------------------------------------------------------------------------------------------
+//
+float relativeRmse(const std::vector<float>& image, const std::vector<float>& reference)
+{
+  const size_t numPixels = std::min(image.size(), reference.size()) / 4;
+  if(numPixels == 0)
+    return 0.0f;
+
+  double sumSq  = 0.0;
+  double sumLum = 0.0;
+  for(size_t i = 0; i < numPixels; i++)
+  {
+    for(int c = 0; c < 3; c++)
+    {
+      const double d = double(image[i * 4 + c]) - double(reference[i * 4 + c]);
+      sumSq += d * d;
+    }
+    sumLum += 0.2126 * reference[i * 4 + 0] + 0.7152 * reference[i * 4 + 1] + 0.0722 * reference[i * 4 + 2];
+  }
+  const double rmse    = std::sqrt(sumSq / double(numPixels * 3));
+  const double meanLum = sumLum / double(numPixels);
+  return float(rmse / std::max(meanLum, 1e-6));
+}
+
+}  // namespace svgf
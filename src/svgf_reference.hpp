@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// CPU reference implementation of the SVGF denoiser (svgf.comp.slang), used to validate the
+// GPU result. One frame is denoised: the history of the previous frame (as read back from the
+// GPU) is reprojected and accumulated, the variance comes from the temporal moments or is
+// estimated spatially for short histories, then the a-trous iterations are applied.
+namespace svgf {
+
+struct ReferenceInput
+{
+  uint32_t           width  = 0;
+  uint32_t           height = 0;
+  std::vector<float> color;            // RGBA, noisy frame of the path tracer
+  std::vector<float> albedo;           // RGBA, guide eDlssAlbedo
+  std::vector<float> normalRoughness;  // RGBA, guide eDlssNormalRoughness
+  std::vector<float> depth;            // R, guide eDlssDepth
+  std::vector<float> motion;           // RG, guide eDlssMotion, in pixels
+  // History of the previous frame, empty when it was discarded (reset)
+  std::vector<float> prevIllumination;  // RGBA, illumination and history length
+  std::vector<float> prevMoments;       // RG, luminance moments
+  std::vector<float> prevNormalDepth;   // RGBA, normal and depth
+  int                iterations   = 4;
+  float              alphaColor   = 0.2f;
+  float              alphaMoments = 0.2f;
+  float              maxHistory   = 32.0f;
+  float              phiColor     = 4.0f;
+  float              phiNormal    = 128.0f;
+  float              phiDepth     = 1.0f;
+};
+
+// Denoised RGBA image
+std::vector<float> denoiseReference(const ReferenceInput& input);
+
+// Root mean square error of the RGB channels, relative to the mean luminance of the reference
+float relativeRmse(const std::vector<float>& image, const std::vector<float>& reference);
+
+}  // namespace svgf
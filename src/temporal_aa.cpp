@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Temporal Anti-Aliasing and Upscaling
+
+    - The projection is offset by a Halton (2,3) sub-pixel jitter, passed in SceneFrameInfo
+    - The rasterizers write per-pixel motion vectors, computed from the current and previous
+      camera and node matrices (the previous node matrices are kept in a buffer here)
+    - The image can be rendered at 50% to 100% of the output resolution; the resolve pass
+      reconstructs the output resolution from the jittered samples
+    - The history is reprojected and clipped to the neighbourhood of the current frame
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+#include <nvgui/property_editor.hpp>
+#include <nvutils/timers.hpp>
+#include <nvvk/barriers.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/compute_pipeline.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "temporal_aa.hpp"
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/dlss_util.h"  // halton()
+}  // namespace shaderio
+
+// Pre-compiled shader
+#include "_autogen/taa.comp.slang.h"
+
+//--------------------------------------------------------------------------------------------------
+// Create the resolve shader and its layout. The targets are created on first use.
+void TemporalAA::init(Resources& res)
+{
+  SCOPED_TIMER(__FUNCTION__);
+  VkDevice device = res.allocator.getDevice();
+
+  VkPushConstantRange pushConstant = {.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT, .offset = 0, .size = sizeof(shaderio::TaaPushConstant)};
+
+  m_bindings.addBinding(shaderio::TaaBindings::eTaaColor, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(shaderio::TaaBindings::eTaaMotion, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(shaderio::TaaBindings::eTaaHistory, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(shaderio::TaaBindings::eTaaHistoryOut, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  m_bindings.addBinding(shaderio::TaaBindings::eTaaOutput, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+  NVVK_CHECK(m_bindings.createDescriptorSetLayout(device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR, &m_descriptorSetLayout));
+  NVVK_DBG_NAME(m_descriptorSetLayout);
+
+  VkPipelineLayoutCreateInfo plCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_descriptorSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreatePipelineLayout(device, &plCreateInfo, nullptr, &m_pipelineLayout));
+  NVVK_DBG_NAME(m_pipelineLayout);
+
+  VkShaderCreateInfoEXT shaderCreateInfo{
+      .sType                  = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+      .stage                  = VK_SHADER_STAGE_COMPUTE_BIT,
+      .codeType               = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+      .codeSize               = taa_comp_slang_sizeInBytes,
+      .pCode                  = taa_comp_slang,
+      .pName                  = "main",
+      .setLayoutCount         = 1,
+      .pSetLayouts            = &m_descriptorSetLayout,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges    = &pushConstant,
+  };
+  NVVK_CHECK(vkCreateShadersEXT(device, 1, &shaderCreateInfo, nullptr, &m_shader));
+  NVVK_DBG_NAME(m_shader);
+
+  // The Catmull-Rom fetch of the history reads outside of the image on the borders
+  VkSamplerCreateInfo samplerInfo{
+      .sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter    = VK_FILTER_LINEAR,
+      .minFilter    = VK_FILTER_LINEAR,
+      .mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .maxLod       = VK_LOD_CLAMP_NONE,
+  };
+  NVVK_CHECK(res.samplerPool.acquireSampler(m_historySampler, samplerInfo));
+  NVVK_DBG_NAME(m_historySampler);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Destroy the targets, the history and the shader
+void TemporalAA::deinit(Resources& res)
+{
+  VkDevice device = res.allocator.getDevice();
+  if(m_targets)
+    m_targets->deinit();
+  if(m_history)
+    m_history->deinit();
+  m_targets.reset();
+  m_history.reset();
+  res.allocator.destroyBuffer(m_bPrevTransforms);
+  res.samplerPool.releaseSampler(m_historySampler);
+  vkDestroyShaderEXT(device, m_shader, nullptr);
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+  m_bindings.clear();
+  m_lastTransforms.clear();
+  m_uploadedTransforms.clear();
+  m_historySampler      = {};
+  m_shader              = {};
+  m_pipelineLayout      = {};
+  m_descriptorSetLayout = {};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Settings shared by the rasterizers
+bool TemporalAA::onUIRender(Resources& res)
+{
+  namespace PE = nvgui::PropertyEditor;
+  Settings& settings = res.settings;
+  bool      changed  = false;
+  if(PE::begin())
+  {
+    changed |= PE::Checkbox("Temporal AA", &settings.taaEnable, "Jitter the frames and accumulate them over time");
+    ImGui::BeginDisabled(!settings.taaEnable);
+    changed |= PE::SliderFloat("Render Scale", &settings.taaRenderScale, 0.5f, 1.0f, "%.2f", 0,
+                               "Fraction of the output resolution to render, then upscaled by TAA");
+    changed |= PE::SliderFloat("History Feedback", &settings.taaFeedback, 0.5f, 0.98f, "%.2f", 0,
+                               "Maximum weight of the history: higher is smoother, lower has less ghosting");
+    if(m_active)
+    {
+      const VkExtent2D size = m_targets->getSize();
+      PE::Text("Render Size", fmt::format("{} x {}", size.width, size.height));
+    }
+    ImGui::EndDisabled();
+    PE::end();
+  }
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Size of the rendered image: a fraction of the output with TAA
+VkExtent2D TemporalAA::getRenderSize(const Resources& res) const
+{
+  const VkExtent2D size = res.gBuffers.getSize();
+  if(!res.settings.taaEnable)
+    return size;
+  const float scale = std::clamp(res.settings.taaRenderScale, 0.5f, 1.0f);
+  return {std::max(1U, uint32_t(std::lround(size.width * scale))), std::max(1U, uint32_t(std::lround(size.height * scale)))};
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create or resize the targets and the history
+bool TemporalAA::update(VkCommandBuffer cmd, Resources& res)
+{
+  bool changed = res.settings.taaEnable != m_active;
+  m_active     = res.settings.taaEnable;
+  if(!m_active)
+    return changed;
+
+  // Resized: the frames in flight may still use the previous images, they go to the deletion queue
+  MemoryReport::Scope memScope(res.memoryReport, MemoryCategory::eRenderers);
+  const VkExtent2D    renderSize = getRenderSize(res);
+  const VkExtent2D outputSize = res.gBuffers.getSize();
+  if(!m_targets || m_targets->getSize().width != renderSize.width || m_targets->getSize().height != renderSize.height)
+  {
+    res.deletionQueue.retire(m_targets);
+    m_targets = std::make_unique<nvvk::GBuffer>();
+    m_targets->init({.allocator    = &res.allocator,
+                     .colorFormats = {
+                         res.gBuffers.getColorFormat(Resources::eImgRendered),   // Color     : eTargetColor
+                         res.gBuffers.getColorFormat(Resources::eImgSelection),  // Selection : eTargetSelection
+                         VK_FORMAT_R16G16_SFLOAT,                                // Motion    : eTargetMotion
+                     },
+                     .depthFormat  = res.gBuffers.getDepthFormat(),
+                     .imageSampler = res.gBuffers.getDescriptorImageInfo(Resources::eImgRendered).sampler});
+    m_targets->update(cmd, renderSize);
+    changed = true;
+  }
+  if(!m_history || m_history->getSize().width != outputSize.width || m_history->getSize().height != outputSize.height)
+  {
+    res.deletionQueue.retire(m_history);
+    m_history = std::make_unique<nvvk::GBuffer>();
+    m_history->init({.allocator    = &res.allocator,
+                     .colorFormats = {VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT},
+                     .imageSampler = m_historySampler});
+    m_history->update(cmd, outputSize);
+    changed = true;
+  }
+
+  if(changed)
+    m_reset = true;
+  return changed;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Keep the node matrices of the previous frame on the GPU. The buffer is only written when the
+// matrices differ from what was uploaded, so static scenes cost a comparison per frame.
+bool TemporalAA::updateTransforms(VkCommandBuffer cmd, Resources& res)
+{
+  const std::vector<nvvkgltf::RenderNode>& renderNodes = res.scene->getRenderNodes();
+
+  std::vector<glm::mat4> current(renderNodes.size());
+  for(size_t i = 0; i < renderNodes.size(); i++)
+    current[i] = renderNodes[i].worldMatrix;
+
+  bool reallocated = false;
+  const VkDeviceSize bufferSize = std::max<VkDeviceSize>(1, current.size()) * sizeof(glm::mat4);
+  if(m_bPrevTransforms.bufferSize < bufferSize)
+  {
+    res.allocator.destroyBuffer(m_bPrevTransforms);
+    NVVK_CHECK(res.allocator.createBuffer(m_bPrevTransforms, bufferSize,
+                                          VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT));
+    NVVK_DBG_NAME(m_bPrevTransforms.buffer);
+    m_uploadedTransforms.clear();
+    reallocated = true;
+  }
+
+  // New scene: no motion on the first frame
+  if(m_lastTransforms.size() != current.size())
+    m_lastTransforms = current;
+
+  if(m_uploadedTransforms != m_lastTransforms && !m_lastTransforms.empty())
+  {
+    // vkCmdUpdateBuffer is limited to 64 KB per call
+    const size_t   totalSize = m_lastTransforms.size() * sizeof(glm::mat4);
+    const uint8_t* data      = reinterpret_cast<const uint8_t*>(m_lastTransforms.data());
+    for(size_t offset = 0; offset < totalSize; offset += 65536)
+    {
+      vkCmdUpdateBuffer(cmd, m_bPrevTransforms.buffer, offset, std::min<size_t>(65536, totalSize - offset), data + offset);
+    }
+    nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT);
+    m_uploadedTransforms = m_lastTransforms;
+  }
+  m_lastTransforms = std::move(current);
+
+  return reallocated;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Halton (2,3) jitter, in [-0.5, 0.5] render pixels. The sequence is longer when upscaling, so
+// that each output pixel receives a few samples (8 phases per output pixel).
+// Computed from the settings, since the frame info is written before the targets are updated.
+glm::vec2 TemporalAA::getPixelJitter(const Resources& res) const
+{
+  if(!res.settings.taaEnable)
+    return glm::vec2(0.0f);
+  const VkExtent2D renderSize = getRenderSize(res);
+  const VkExtent2D outputSize = res.gBuffers.getSize();
+  const float      ratio      = float(outputSize.width) / float(std::max(1U, renderSize.width));
+  const uint32_t   numPhases  = uint32_t(std::ceil(8.0f * ratio * ratio));
+  return shaderio::halton(int(m_frameIndex % numPhases) + 1) - glm::vec2(0.5f);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Jitter of the projection: a translation of the clip space position by `2 * jitter / size`
+glm::vec2 TemporalAA::getJitter(const Resources& res) const
+{
+  const VkExtent2D renderSize = getRenderSize(res);
+  return 2.0f * getPixelJitter(res) / glm::vec2(renderSize.width, renderSize.height);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Resolve the jittered frame into the rendered image, and update the history
+void TemporalAA::resolve(VkCommandBuffer cmd, Resources& res, bool copySelection)
+{
+  NVVK_DBG_SCOPE(cmd);
+
+  const VkExtent2D renderSize = m_targets->getSize();
+  const VkExtent2D outputSize = m_history->getSize();
+
+  // The targets were written by the rasterizer
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+  nvvk::WriteSetContainer writeContainer;
+  writeContainer.append(m_bindings.getWriteSet(shaderio::TaaBindings::eTaaColor), m_targets->getDescriptorImageInfo(eTargetColor));
+  writeContainer.append(m_bindings.getWriteSet(shaderio::TaaBindings::eTaaMotion), m_targets->getDescriptorImageInfo(eTargetMotion));
+  writeContainer.append(m_bindings.getWriteSet(shaderio::TaaBindings::eTaaHistory), m_history->getDescriptorImageInfo(m_historyIndex));
+  writeContainer.append(m_bindings.getWriteSet(shaderio::TaaBindings::eTaaHistoryOut),
+                        m_history->getDescriptorImageInfo(1 - m_historyIndex));
+  writeContainer.append(m_bindings.getWriteSet(shaderio::TaaBindings::eTaaOutput), res.gBuffers.getDescriptorImageInfo(Resources::eImgRendered));
+  vkCmdPushDescriptorSetKHR(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0,
+                            static_cast<uint32_t>(writeContainer.size()), writeContainer.data());
+
+  const VkShaderStageFlagBits stages[1] = {VK_SHADER_STAGE_COMPUTE_BIT};
+  vkCmdBindShadersEXT(cmd, 1, stages, &m_shader);
+
+  m_pushConstant.renderSize = glm::ivec2(renderSize.width, renderSize.height);
+  m_pushConstant.outputSize = glm::ivec2(outputSize.width, outputSize.height);
+  m_pushConstant.jitter     = getPixelJitter(res);
+  m_pushConstant.feedback   = std::clamp(res.settings.taaFeedback, 0.0f, 0.99f);
+  m_pushConstant.reset      = m_reset ? 1 : 0;
+  vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(shaderio::TaaPushConstant), &m_pushConstant);
+
+  VkExtent2D groupCounts = nvvk::getGroupCounts(outputSize, TAA_WORKGROUP_SIZE);
+  vkCmdDispatch(cmd, groupCounts.width, groupCounts.height, 1);
+
+  // The selection is only needed for the silhouette, nearest is enough
+  if(copySelection)
+  {
+    VkImageBlit blitRegion{
+        .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+        .srcOffsets     = {{0, 0, 0}, {int(renderSize.width), int(renderSize.height), 1}},
+        .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+        .dstOffsets     = {{0, 0, 0}, {int(outputSize.width), int(outputSize.height), 1}},
+    };
+    vkCmdBlitImage(cmd, m_targets->getColorImage(eTargetSelection), VK_IMAGE_LAYOUT_GENERAL,
+                   res.gBuffers.getColorImage(Resources::eImgSelection), VK_IMAGE_LAYOUT_GENERAL, 1, &blitRegion, VK_FILTER_NEAREST);
+  }
+
+  // The rendered image and the selection are read by the post-processing
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+  m_historyIndex = 1 - m_historyIndex;
+  m_frameIndex++;
+  m_reset = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// The rendered image is only written by the resolve, later in the frame: it holds the dome meanwhile
+void TemporalAA::copyEnvironment(VkCommandBuffer cmd, Resources& res)
+{
+  const VkExtent2D renderSize = m_targets->getSize();
+
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+  const VkImageCopy region{
+      .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+      .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .layerCount = 1},
+      .extent         = {renderSize.width, renderSize.height, 1},
+  };
+  vkCmdCopyImage(cmd, res.gBuffers.getColorImage(Resources::eImgRendered), VK_IMAGE_LAYOUT_GENERAL,
+                 m_targets->getColorImage(eTargetColor), VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+  nvvk::cmdMemoryBarrier(cmd, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace shaderio {
+using namespace glm;
+#include "shaders/shaderio.h"  // Shared between host and device
+}  // namespace shaderio
+
+#include "resources.hpp"
+
+
+// Temporal anti-aliasing and upscaling (TAA/TAAU) for the rasterizers.
+// When enabled, the rasterizer renders into the targets of this class, at a fraction of the output
+// resolution, with a Halton sub-pixel jitter and per-pixel motion vectors. The resolve pass
+// reconstructs the output resolution from the jittered frames accumulated in a history and writes
+// the result in the rendered image (Resources::eImgRendered).
+class TemporalAA
+{
+public:
+  // Images of the render targets
+  enum Target
+  {
+    eTargetColor,      // RGBA32F, same as the rendered image
+    eTargetSelection,  // R8, same as the selection image
+    eTargetMotion,     // RG16F, UV offset to the previous frame
+  };
+
+  TemporalAA() = default;
+  ~TemporalAA() { assert(!m_shader && "deinit must be called"); }
+
+  void init(Resources& res);
+  void deinit(Resources& res);
+  bool onUIRender(Resources& res);
+
+  // Create or resize the targets and the history for the current settings and output size.
+  // Returns true when the targets changed, or TAA was toggled: recorded draws must be recorded again.
+  bool update(VkCommandBuffer cmd, Resources& res);
+
+  // Upload the node matrices of the previous frame, for the motion vectors. Must be called at each
+  // rendered frame, even without TAA. Returns true when the buffer was reallocated (new address).
+  bool updateTransforms(VkCommandBuffer cmd, Resources& res);
+
+  // Accumulate the jittered frame and write the result in the rendered image.
+  // With `copySelection`, the selection target is also copied to the selection image.
+  void resolve(VkCommandBuffer cmd, Resources& res, bool copySelection);
+
+  // The HDR dome always draws in the rendered image, its descriptor set cannot change while
+  // recording: copy its render-size corner to the color target, before drawing the scene.
+  void copyEnvironment(VkCommandBuffer cmd, Resources& res);
+
+  bool                 isActive() const { return m_active; }
+  glm::vec2            getJitter(const Resources& res) const;  // Jitter of the frame to render, in clip space
+  const nvvk::GBuffer& getTargets() const { return *m_targets; }
+  VkExtent2D           getRenderSize(const Resources& res) const;
+  VkDeviceAddress      getPrevTransformsAddress() const { return m_bPrevTransforms.address; }
+  void                 reset() { m_reset = true; }  // Discard the history
+
+private:
+  glm::vec2 getPixelJitter(const Resources& res) const;  // Jitter of the frame to render, in render pixels
+
+  std::unique_ptr<nvvk::GBuffer> m_targets;  // Render resolution: color, selection, motion and depth
+  std::unique_ptr<nvvk::GBuffer> m_history;  // Output resolution: two history images, used in turn
+  nvvk::Buffer           m_bPrevTransforms;     // Node matrices of the previous frame
+  std::vector<glm::mat4> m_lastTransforms;      // Node matrices of the last rendered frame
+  std::vector<glm::mat4> m_uploadedTransforms;  // Content of m_bPrevTransforms
+  VkSampler              m_historySampler{};    // Linear, clamp to edge
+  uint32_t               m_frameIndex{0};       // Index in the jitter sequence
+  uint32_t               m_historyIndex{0};     // History image read by the next resolve
+  bool                   m_active{false};       // TAA was enabled at the last update
+  bool                   m_reset{true};         // The history is not valid
+
+  shaderio::TaaPushConstant m_pushConstant{};
+  nvvk::DescriptorBindings  m_bindings;
+  VkShaderEXT               m_shader{};
+  VkPipelineLayout          m_pipelineLayout{};       // Pipeline layout
+  VkDescriptorSetLayout     m_descriptorSetLayout{};  // Descriptor set layout
+};
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+//////////////////////////////////////////////////////////////////////////
+/*
+    Trace Export
+
+    - The profiler window averages the sections of the last frames; a trace
+      keeps every CPU scope and GPU section of the run, which shows where a
+      headless batch job spends its time, and what the GPU does during a load
+    - The file is in the Chrome trace event format: one "complete" event per
+      scope, in microseconds. The CPU threads and the GPU queue are two
+      processes of the trace
+    - The GPU sections write timestamps in the frame command buffer, in one
+      slot of queries per frame. A slot is read back when it is reused, a few
+      frames later, so the recording never waits for the GPU
+    - With VK_EXT_calibrated_timestamps, the device clock is sampled at the
+      beginning of each frame, between two reads of the CPU clock, and the
+      GPU timestamps are moved to the CPU clock from there. Without it, the
+      first GPU section of a frame is aligned on the start of its recording,
+      which only keeps the durations exact
+    - The file is written at the end of the frame range, or at exit
+*/
+//////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <volk.h>
+#include <nvutils/file_operations.hpp>
+#include <nvutils/logger.hpp>
+#include <nvvk/check_error.hpp>
+#include <nvvk/debug_util.hpp>
+
+#include "trace_export.hpp"
+
+TraceExport g_traceExport;
+
+namespace {
+
+int64_t toNs(TraceExport::Clock::time_point time)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+std::string jsonEscape(const std::string& s)
+{
+  std::string result;
+  for(char c : s)
+  {
+    if(c == '"' || c == '\\')
+      result += '\\';
+    if(c == '\n')
+      continue;  // Some timer names end with a new line
+    result += c;
+  }
+  return result;
+}
+
+}  // namespace
+
+//--------------------------------------------------------------------------------------------------
+// Register command line parameters. Called from the main thread, which becomes the first thread
+void TraceExport::registerParameters(nvutils::ParameterRegistry* paramReg)
+{
+  paramReg->add({"trace", "Trace: write the CPU scopes and GPU sections to this Chrome trace / Perfetto .json file"},
+                &m_filename);
+  paramReg->add({"traceStart", "Trace: first frame to record (0: also record the loading)"}, &m_startFrame);
+  paramReg->add({"traceFrames", "Trace: number of frames to record (0: until the end of the run)"}, &m_numFrames);
+  threadIndex(std::this_thread::get_id());
+}
+
+//--------------------------------------------------------------------------------------------------
+// Create the timestamp queries, and check if the device clock can be sampled from the host
+void TraceExport::init(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+  if(!isEnabled())
+    return;
+
+  m_device = device;
+
+  VkPhysicalDeviceProperties properties{};
+  vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  m_timestampPeriod = double(properties.limits.timestampPeriod);
+
+  const VkQueryPoolCreateInfo poolInfo{
+      .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = kNumFrameSlots * 2 * kMaxSectionsPerFrame,
+  };
+  NVVK_CHECK(vkCreateQueryPool(m_device, &poolInfo, nullptr, &m_queryPool));
+  NVVK_DBG_NAME(m_queryPool);
+
+  // The extension is requested when available (see main.cpp), it must also expose the device clock
+  uint32_t numExtensions = 0;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &numExtensions, nullptr);
+  std::vector<VkExtensionProperties> extensions(numExtensions);
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &numExtensions, extensions.data());
+  const bool hasExtension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& e) {
+    return strcmp(e.extensionName, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME) == 0;
+  });
+  if(hasExtension && vkGetPhysicalDeviceCalibrateableTimeDomainsEXT && vkGetCalibratedTimestampsEXT)
+  {
+    uint32_t numDomains = 0;
+    vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physicalDevice, &numDomains, nullptr);
+    std::vector<VkTimeDomainEXT> domains(numDomains);
+    vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physicalDevice, &numDomains, domains.data());
+    m_calibrated = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+  }
+  if(!m_calibrated)
+  {
+    LOGW("Trace: VK_EXT_calibrated_timestamps is not available, the GPU sections are aligned on the CPU frames\n");
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the trace if the run ended before the end of the frame range, then destroy the queries
+void TraceExport::deinit()
+{
+  if(m_queryPool)
+  {
+    if(!m_written)
+    {
+      stop();
+    }
+    vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+  }
+  m_queryPool = VK_NULL_HANDLE;
+  m_recording = false;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Called at the top of GltfRenderer::onRender, before any section of the frame
+void TraceExport::frameBegin(VkCommandBuffer cmd)
+{
+  if(!m_queryPool || m_written)
+    return;
+
+  const int64_t frame = ++m_frame;
+  m_currentSlot       = uint32_t(frame % kNumFrameSlots);
+  FrameSlot& slot     = m_slots[m_currentSlot];
+  collect(slot, m_currentSlot);
+
+  // End of the range: the sections of this frame are not recorded
+  if(m_numFrames > 0 && frame >= int64_t(m_startFrame) + m_numFrames)
+  {
+    stop();
+    return;
+  }
+  m_recording = (frame >= m_startFrame);
+  if(!m_recording)
+    return;
+
+  slot.frame = frame;
+  calibrate(slot);
+  vkCmdResetQueryPool(cmd, m_queryPool, firstQuery(m_currentSlot), 2 * kMaxSectionsPerFrame);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Sample the device clock between two reads of the CPU clock; without the extension, keep the
+// CPU time of the frame and align its first GPU section on it (see collect())
+void TraceExport::calibrate(FrameSlot& slot)
+{
+  slot.deviceTicks = 0;
+  if(!m_calibrated)
+  {
+    slot.hostNs = toNs(Clock::now());
+    return;
+  }
+
+  const VkCalibratedTimestampInfoEXT info{
+      .sType      = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+      .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT,
+  };
+  uint64_t       ticks     = 0;
+  uint64_t       deviation = 0;
+  const auto     before    = Clock::now();
+  const VkResult result    = vkGetCalibratedTimestampsEXT(m_device, 1, &info, &ticks, &deviation);
+  const auto     after     = Clock::now();
+  slot.hostNs = toNs(before) + (toNs(after) - toNs(before)) / 2;
+  if(result == VK_SUCCESS)
+  {
+    slot.deviceTicks = ticks;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Read the timestamps of a recorded frame and add its sections to the trace
+void TraceExport::collect(FrameSlot& slot, uint32_t slotIndex)
+{
+  if(slot.frame < 0 || slot.names.empty())
+  {
+    slot.frame = -1;
+    slot.names.clear();
+    return;
+  }
+
+  // The frame was submitted a few frames ago, the wait is for safety
+  std::vector<uint64_t> timestamps(slot.names.size() * 2);
+  const VkResult result =
+      vkGetQueryPoolResults(m_device, m_queryPool, firstQuery(slotIndex), uint32_t(timestamps.size()),
+                            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+  if(result == VK_SUCCESS)
+  {
+    uint64_t originTicks = slot.deviceTicks;
+    if(originTicks == 0)
+    {
+      originTicks = timestamps[0];
+      for(size_t i = 0; i < slot.names.size(); i++)
+        originTicks = std::min(originTicks, timestamps[2 * i]);
+    }
+    for(size_t i = 0; i < slot.names.size(); i++)
+    {
+      const int64_t begin = int64_t(timestamps[2 * i] - originTicks);
+      const int64_t end   = int64_t(timestamps[2 * i + 1] - originTicks);
+      addEvent({.name       = std::move(slot.names[i]),
+                .startNs    = slot.hostNs + int64_t(double(begin) * m_timestampPeriod),
+                .durationNs = int64_t(double(end - begin) * m_timestampPeriod),
+                .tid        = 0,
+                .frame      = slot.frame});
+    }
+  }
+  slot.frame = -1;
+  slot.names.clear();
+}
+
+//--------------------------------------------------------------------------------------------------
+// End the recording: wait for the frames in flight, collect their sections and write the file
+void TraceExport::stop()
+{
+  m_recording = false;
+  vkDeviceWaitIdle(m_device);
+  for(uint32_t i = 0; i < kNumFrameSlots; i++)
+  {
+    // Oldest frames first
+    const uint32_t slotIndex = (m_currentSlot + 1 + i) % kNumFrameSlots;
+    collect(m_slots[slotIndex], slotIndex);
+  }
+  write();
+  m_written = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Start a GPU section, inactive when not recording or when the frame has too many sections
+TraceExport::GpuSection TraceExport::cmdSection(VkCommandBuffer cmd, const char* name)
+{
+  GpuSection section;
+  FrameSlot& slot = m_slots[m_currentSlot];
+  if(!m_recording || !m_queryPool || slot.frame != m_frame || slot.names.size() >= kMaxSectionsPerFrame)
+    return section;
+
+  section.m_trace = this;
+  section.m_cmd   = cmd;
+  section.m_query = firstQuery(m_currentSlot) + 2 * uint32_t(slot.names.size());
+  slot.names.emplace_back(name);
+  vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_queryPool, section.m_query);
+  return section;
+}
+
+TraceExport::GpuSection::GpuSection(GpuSection&& other) noexcept
+    : m_trace(other.m_trace)
+    , m_cmd(other.m_cmd)
+    , m_query(other.m_query)
+{
+  other.m_trace = nullptr;
+}
+
+TraceExport::GpuSection::~GpuSection()
+{
+  if(m_trace)
+  {
+    vkCmdWriteTimestamp2(m_cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, m_trace->m_queryPool, m_query + 1);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// CPU scopes
+TraceExport::CpuScope::CpuScope(const char* name)
+    : m_name(name)
+    , m_start(Clock::now())
+    , m_active(g_traceExport.isRecording())
+{
+}
+
+TraceExport::CpuScope::~CpuScope()
+{
+  if(m_active)
+  {
+    const int64_t start = toNs(m_start);
+    g_traceExport.addEvent({.name       = m_name,
+                            .startNs    = start,
+                            .durationNs = toNs(Clock::now()) - start,
+                            .tid        = g_traceExport.threadIndex(std::this_thread::get_id())});
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+// Index of a CPU thread in the trace, from 1
+int TraceExport::threadIndex(std::thread::id id)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_threads.find(id);
+  if(it == m_threads.end())
+    it = m_threads.emplace(id, int(m_threads.size()) + 1).first;
+  return it->second;
+}
+
+void TraceExport::addEvent(Event&& event)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_events.emplace_back(std::move(event));
+}
+
+//--------------------------------------------------------------------------------------------------
+// Write the events in the Chrome trace event format, in microseconds from the first event
+bool TraceExport::write() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  int64_t origin = m_events.empty() ? 0 : m_events[0].startNs;
+  for(const Event& event : m_events)
+    origin = std::min(origin, event.startNs);
+
+  const int cpuPid = 1;
+  const int gpuPid = 2;
+  std::string json = "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n";
+  json += fmt::format("    {{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": {}, \"args\": {{\"name\": \"CPU\"}}}},\n", cpuPid);
+  json += fmt::format("    {{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": {}, \"args\": {{\"name\": \"GPU\"}}}},\n", gpuPid);
+  json += fmt::format("    {{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": {}, \"tid\": 0, \"args\": {{\"name\": \"Queue 0\"}}}}", gpuPid);
+  for(const auto& [id, tid] : m_threads)
+  {
+    json += fmt::format(",\n    {{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": {}, \"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+                        cpuPid, tid, tid == 1 ? "Main" : fmt::format("Thread {}", tid));
+  }
+  for(const Event& event : m_events)
+  {
+    const bool gpu = event.tid == 0;
+    json += fmt::format(",\n    {{\"name\": \"{}\", \"cat\": \"{}\", \"ph\": \"X\", \"ts\": {:.3f}, \"dur\": {:.3f}, \"pid\": {}, \"tid\": {}",
+                        jsonEscape(event.name), gpu ? "gpu" : "cpu", double(event.startNs - origin) * 1e-3,
+                        double(event.durationNs) * 1e-3, gpu ? gpuPid : cpuPid, event.tid);
+    json += gpu ? fmt::format(", \"args\": {{\"frame\": {}}}}}", event.frame) : "}";
+  }
+  json += "\n  ]\n}\n";
+
+  std::ofstream file(nvutils::pathFromUtf8(m_filename));
+  if(!file || !(file << json))
+  {
+    LOGE("Trace: cannot write %s\n", m_filename.c_str());
+    return false;
+  }
+  LOGI("Trace: %zu events written to %s\n", m_events.size(), m_filename.c_str());
+  return true;
+}
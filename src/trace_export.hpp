@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2024-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2024-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <nvutils/parameter_registry.hpp>
+
+
+// Export of the CPU scopes and the GPU sections of a run to a Chrome trace JSON file, which
+// opens in chrome://tracing and in Perfetto (ui.perfetto.dev). The GPU timestamps are moved to
+// the CPU clock, so loading stalls line up with the GPU work of the frames.
+// The export is enabled with --trace <file.json>, for a range of frames or for the whole run;
+// TRACE_SCOPE marks the CPU scopes, cmdSection() the GPU sections of the frame command buffer.
+class TraceExport
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void registerParameters(nvutils::ParameterRegistry* paramReg);
+
+  void init(VkDevice device, VkPhysicalDevice physicalDevice);
+  void deinit();  // Writes the file, when the recording did not end before
+
+  bool isEnabled() const { return !m_filename.empty(); }
+  // Before the first frame, the loading is recorded when the range starts at frame 0
+  bool isRecording() const { return m_recording || (m_frame < 0 && isEnabled() && m_startFrame <= 0); }
+
+  // Beginning of a frame: collects the GPU timestamps of an older frame, starts or ends the
+  // recording, and resets the queries of this frame in `cmd`
+  void frameBegin(VkCommandBuffer cmd);
+
+  // Scope on the calling thread, added when the recording is on at its start
+  class CpuScope
+  {
+  public:
+    explicit CpuScope(const char* name);
+    ~CpuScope();
+
+  private:
+    const char*       m_name;
+    Clock::time_point m_start;
+    bool              m_active;
+  };
+
+  // Timestamps around the commands recorded during the lifetime of the section
+  class GpuSection
+  {
+  public:
+    GpuSection() = default;
+    GpuSection(GpuSection&& other) noexcept;
+    GpuSection(const GpuSection&)            = delete;
+    GpuSection& operator=(const GpuSection&) = delete;
+    GpuSection& operator=(GpuSection&&)      = delete;
+    ~GpuSection();
+
+  private:
+    friend class TraceExport;
+    TraceExport*    m_trace{};
+    VkCommandBuffer m_cmd{};
+    uint32_t        m_query{};
+  };
+  [[nodiscard]] GpuSection cmdSection(VkCommandBuffer cmd, const char* name);
+
+private:
+  static constexpr uint32_t kNumFrameSlots       = 4;  // More than the frames in flight
+  static constexpr uint32_t kMaxSectionsPerFrame = 64;
+
+  struct Event
+  {
+    std::string name;
+    int64_t     startNs{};  // On the Clock
+    int64_t     durationNs{};
+    int         tid{};      // CPU thread, or 0 for the GPU queue
+    int64_t     frame{-1};  // GPU sections only
+  };
+
+  // GPU sections of a frame, in the queries [slot * 2 * kMaxSectionsPerFrame, ...)
+  struct FrameSlot
+  {
+    int64_t                  frame{-1};
+    std::vector<std::string> names;
+    int64_t                  hostNs{};       // Clock time of `deviceTicks`
+    uint64_t                 deviceTicks{};  // 0: not calibrated, aligned on the first section
+  };
+
+  void     addEvent(Event&& event);
+  int      threadIndex(std::thread::id id);
+  void     calibrate(FrameSlot& slot);
+  void     collect(FrameSlot& slot, uint32_t slotIndex);
+  void     stop();
+  bool     write() const;
+  uint32_t firstQuery(uint32_t slotIndex) const { return slotIndex * 2 * kMaxSectionsPerFrame; }
+
+  // Settings
+  std::string m_filename;       // --trace, empty: disabled
+  int         m_startFrame{0};  // --traceStart
+  int         m_numFrames{0};   // --traceFrames, 0: until the end of the run
+
+  std::atomic<bool>    m_recording{false};
+  bool                 m_written{false};
+  std::atomic<int64_t> m_frame{-1};  // Current frame, -1 before the first one
+
+  // GPU
+  VkDevice                              m_device{};
+  VkQueryPool                           m_queryPool{};
+  double                                m_timestampPeriod{1.0};  // Nanoseconds per tick
+  bool                                  m_calibrated{false};     // VK_EXT_calibrated_timestamps
+  std::array<FrameSlot, kNumFrameSlots> m_slots{};
+  uint32_t                              m_currentSlot{0};
+
+  // Recorded events, from any thread
+  mutable std::mutex                       m_mutex;
+  std::vector<Event>                       m_events;
+  std::unordered_map<std::thread::id, int> m_threads;  // Index of the threads in the trace, in order of appearance
+};
+
+extern TraceExport g_traceExport;
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// Adds the enclosing scope to the trace, e.g. TRACE_SCOPE(__FUNCTION__)
+#define TRACE_SCOPE(name) TraceExport::CpuScope TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -28,6 +28,7 @@
 #include "nvgui/file_dialog.hpp"
 #include "nvgui/tonemapper.hpp"
 #include "nvutils/bounding_box.hpp"
+#include "nvutils/file_operations.hpp"
 #include "renderer.hpp"
 #include "ui_collapsing_header_manager.h"
 #include "ui_mouse_state.hpp"
@@ -39,7 +40,7 @@ void GltfRendererUI::mouseClickedInViewport(GltfRenderer& renderer)
 
   s_mouseClickState.update();
 
-  if(!renderer.m_resources.scene.valid())
+  if(!renderer.m_resources.scene->valid())
   {
     return;
   }
@@ -59,7 +60,7 @@ void GltfRendererUI::mouseClickedInViewport(GltfRenderer& renderer)
     renderer.m_rayPicker.run(cmd, {.modelViewInv = glm::inverse(renderer.m_resources.cameraManip->getViewMatrix()),
                                    .perspectiveInv = glm::inverse(renderer.m_resources.cameraManip->getPerspectiveMatrix()),
                                    .pickPos = {localMousePos.x, localMousePos.y},
-                                   .tlas    = renderer.m_resources.sceneRtx.tlas()});
+                                   .tlas    = renderer.m_resources.sceneRtx->tlas()});
     renderer.m_app->submitAndWaitTempCmdBuffer(cmd);
     nvvk::RayPicker::PickResult pickResult = renderer.m_rayPicker.getResult();
 
@@ -70,7 +71,7 @@ void GltfRendererUI::mouseClickedInViewport(GltfRenderer& renderer)
       int nodeID                          = -1;
       if(pickResult.instanceID > -1)
       {
-        const nvvkgltf::RenderNode& renderNode = renderer.m_resources.scene.getRenderNodes()[pickResult.instanceID];
+        const nvvkgltf::RenderNode& renderNode = renderer.m_resources.scene->getRenderNodes()[pickResult.instanceID];
         nodeID                                 = renderNode.refNodeID;
       }
       renderer.m_uiSceneGraph.selectNode(nodeID);
@@ -91,8 +92,8 @@ void GltfRendererUI::mouseClickedInViewport(GltfRenderer& renderer)
 
     {
       // Logging picking info.
-      const nvvkgltf::RenderNode& renderNode = renderer.m_resources.scene.getRenderNodes()[pickResult.instanceID];
-      const tinygltf::Node&       node       = renderer.m_resources.scene.getModel().nodes[renderNode.refNodeID];
+      const nvvkgltf::RenderNode& renderNode = renderer.m_resources.scene->getRenderNodes()[pickResult.instanceID];
+      const tinygltf::Node&       node       = renderer.m_resources.scene->getModel().nodes[renderNode.refNodeID];
       LOGI("Node Name: %s\n", node.name.c_str());
       LOGI(" - GLTF: NodeID: %d, MeshID: %d, TriangleId: %d\n", renderNode.refNodeID, node.mesh, pickResult.primitiveID);
       LOGI(" - Render: RenderNode: %d, RenderPrim: %d\n", pickResult.instanceID, pickResult.instanceCustomIndex);
@@ -106,12 +107,12 @@ void GltfRendererUI::mouseClickedInViewport(GltfRenderer& renderer)
 nvutils::Bbox GltfRendererUI::getRenderNodeBbox(GltfRenderer& renderer, int nodeID)
 {
   nvutils::Bbox worldBbox({-1, -1, -1}, {1, 1, 1});
-  if(nodeID < 0 || !renderer.m_resources.scene.valid())
+  if(nodeID < 0 || !renderer.m_resources.scene->valid())
     return worldBbox;
 
-  const nvvkgltf::RenderNode& renderNode = renderer.m_resources.scene.getRenderNodes()[nodeID];
-  const nvvkgltf::RenderPrimitive& renderPrimitive = renderer.m_resources.scene.getRenderPrimitive(renderNode.renderPrimID);
-  const tinygltf::Model&    model    = renderer.m_resources.scene.getModel();
+  const nvvkgltf::RenderNode& renderNode = renderer.m_resources.scene->getRenderNodes()[nodeID];
+  const nvvkgltf::RenderPrimitive& renderPrimitive = renderer.m_resources.scene->getRenderPrimitive(renderNode.renderPrimID);
+  const tinygltf::Model&    model    = renderer.m_resources.scene->getModel();
   const tinygltf::Accessor& accessor = model.accessors[renderPrimitive.pPrimitive->attributes.at("POSITION")];
 
   glm::vec3 minValues = {-1.f, -1.f, -1.f};
@@ -133,7 +134,7 @@ void GltfRendererUI::windowTitle(GltfRenderer& renderer)
   if(dirty_timer > 1.0F)  // Refresh every seconds
   {
     const VkExtent2D&     size     = renderer.m_app->getViewportSize();
-    std::filesystem::path filename = renderer.m_resources.scene.getFilename().filename();
+    std::filesystem::path filename = renderer.m_resources.scene->getFilename().filename();
     if(filename.empty())
     {
       filename = "No Scene";
@@ -200,7 +201,10 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
           changed                                    = true;  // Reset frame counter when switching renderers
         }
         changed |= PE::Combo("Debug Method", reinterpret_cast<int32_t*>(&renderer.m_resources.settings.debugMethod),
-                             "None\0BaseColor\0Metallic\0Roughness\0Normal\0Tangent\0Bitangent\0Emissive\0Opacity\0TexCoord0\0TexCoord1\0\0");
+                             "None\0BaseColor\0Metallic\0Roughness\0Normal\0Tangent\0Bitangent\0Emissive\0Opacity\0TexCoord0\0TexCoord1\0RadianceCache\0"
+                             "Heat: Shader Time\0Heat: Traversal\0Heat: Any-Hit\0Heat: Path Length\0Heat: Light Samples\0Heat: Overdraw\0\0");
+        Heatmap::checkSupport(renderer.m_resources);
+        changed |= renderer.m_heatmap.onUi(renderer.m_resources);
         PE::end();
         if(renderer.m_resources.settings.renderSystem == RenderingMode::ePathtracer)
         {
@@ -236,7 +240,7 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
             renderer.m_pathTracer.m_pushConst.fireflyClampThreshold =
                 (renderer.m_resources.settings.envSystem == shaderio::EnvSystem::eSky) ?
                     10.0f :
-                    renderer.m_resources.hdrIbl.getIntegral();
+                    renderer.m_resources.hdrIbl->getIntegral();
             changed |= true;
           }
           changed |= PE::Checkbox("Solid Color", &renderer.m_resources.settings.useSolidBackground);
@@ -281,19 +285,23 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
       }
 
       // Multiple scenes
-      if(renderer.m_resources.scene.getModel().scenes.size() > 1)
+      if(renderer.m_resources.scene->getModel().scenes.size() > 1)
       {
         if(headerManager.beginHeader("Multiple Scenes"))
         {
           ImGui::PushID("Scenes");
-          for(size_t i = 0; i < renderer.m_resources.scene.getModel().scenes.size(); i++)
+          for(size_t i = 0; i < renderer.m_resources.scene->getModel().scenes.size(); i++)
           {
-            if(ImGui::RadioButton(renderer.m_resources.scene.getModel().scenes[i].name.c_str(),
-                                  renderer.m_resources.scene.getCurrentScene() == i))
+            if(ImGui::RadioButton(renderer.m_resources.scene->getModel().scenes[i].name.c_str(),
+                                  renderer.m_resources.scene->getCurrentScene() == i))
             {
-              renderer.m_resources.scene.setCurrentScene(int(i));
+              renderer.m_resources.scene->setCurrentScene(int(i));
               vkDeviceWaitIdle(renderer.m_device);
-              renderer.createVulkanScene();
+              renderer.m_composition.clear(renderer.m_resources);
+              renderer.createVulkanScene(SceneSwap::getCurrentSlot(renderer.m_resources), renderer.renderLoopCommands());
+              renderer.updateNodeToRenderNodeMap();
+              renderer.m_resources.memoryReport.setSceneTextures(SceneSwap::getCurrentSlot(renderer.m_resources).allocator,
+                                                                 renderer.m_resources.sceneVk->textures());
               renderer.updateTextures();
               changed = true;
             }
@@ -303,17 +311,17 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
       }
 
       // Variant selection
-      if(renderer.m_resources.scene.getVariants().size() > 0)
+      if(renderer.m_resources.scene->getVariants().size() > 0)
       {
         if(headerManager.beginHeader("Variants"))
         {
           ImGui::PushID("Variants");
-          for(size_t i = 0; i < renderer.m_resources.scene.getVariants().size(); i++)
+          for(size_t i = 0; i < renderer.m_resources.scene->getVariants().size(); i++)
           {
-            if(ImGui::Selectable(renderer.m_resources.scene.getVariants()[i].c_str(),
-                                 renderer.m_resources.scene.getCurrentVariant() == i))
+            if(ImGui::Selectable(renderer.m_resources.scene->getVariants()[i].c_str(),
+                                 renderer.m_resources.scene->getCurrentVariant() == i))
             {
-              renderer.m_resources.scene.setCurrentVariant(int(i));
+              renderer.m_resources.scene->setCurrentVariant(int(i));
               renderer.m_resources.dirtyFlags.set(DirtyFlags::eVulkanScene);
               changed = true;
             }
@@ -323,33 +331,57 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
       }
 
       // Animation
-      if(renderer.m_resources.scene.hasAnimation())
+      if(renderer.m_resources.scene->hasAnimation())
       {
         if(headerManager.beginHeader("Animation"))
         {
-          renderer.m_animControl.onUI(&renderer.m_resources.scene);
+          renderer.m_animControl.onUI(renderer.m_resources.scene);
+          if(renderer.m_resources.settings.sequenceFps > 0.0f && renderer.m_sequence.step >= 0)
+          {
+            ImGui::Text("Sequence: frame %d / %d", renderer.m_sequence.step + 1, renderer.m_sequence.numSteps);
+          }
         }
       }
 
-      if(renderer.m_resources.scene.valid() && headerManager.beginHeader("Statistics"))
+      // Assets added to the scene
+      if(renderer.m_resources.scene->valid() && headerManager.beginHeader("Composition"))
+      {
+        changed |= renderer.m_composition.onUIRender(renderer.m_resources);
+      }
+
+      if(renderer.m_resources.scene->valid() && headerManager.beginHeader("Statistics"))
       {
         if(PE::begin("Stat_Val"))
         {
-          const tinygltf::Model& tiny = renderer.m_resources.scene.getModel();
+          const tinygltf::Model& tiny = renderer.m_resources.scene->getModel();
           PE::Text("Nodes", std::to_string(tiny.nodes.size()));
-          PE::Text("Render Nodes", std::to_string(renderer.m_resources.scene.getRenderNodes().size()));
-          PE::Text("Render Primitives", std::to_string(renderer.m_resources.scene.getNumRenderPrimitives()));
+          PE::Text("Render Nodes", std::to_string(renderer.m_resources.scene->getRenderNodes().size()));
+          PE::Text("Render Primitives", std::to_string(renderer.m_resources.scene->getNumRenderPrimitives()));
           PE::Text("Materials", std::to_string(tiny.materials.size()));
-          PE::Text("Triangles", std::to_string(renderer.m_resources.scene.getNumTriangles()));
+          PE::Text("Triangles", std::to_string(renderer.m_resources.scene->getNumTriangles()));
           PE::Text("Lights", std::to_string(tiny.lights.size()));
           PE::Text("Textures", std::to_string(tiny.textures.size()));
           PE::Text("Images", std::to_string(tiny.images.size()));
+          const FrameGraph::Stats& graphStats = renderer.m_resources.frameGraph.getStats();
+          PE::Text("Frame Graph Passes", fmt::format("{} ({} culled)", graphStats.passes, graphStats.culledPasses));
+          PE::Text("Frame Graph Barriers", std::to_string(graphStats.barriers));
+          PE::Text("Transient Images", fmt::format("{:.1f} MB ({:.1f} MB allocated)", graphStats.transientBytes / (1024.0 * 1024.0),
+                                                   graphStats.allocatedBytes / (1024.0 * 1024.0)));
+          PE::Text("Idle", fmt::format("{} ({:.0f}% of the time, {} waits)", renderer.m_idle.isIdle() ? "yes" : "no",
+                                       100.0 * renderer.m_idle.getIdleRatio(), renderer.m_idle.getWaits()));
           PE::end();
         }
       }
     }
     ImGui::End();  // End Settings
 
+    // Performance counters of the path tracer, next to the profiler
+    if(renderer.m_resources.settings.renderSystem == RenderingMode::ePathtracer)
+      renderer.m_pathTracer.getCounters().onUiWindow();
+
+    // GPU memory per subsystem and heap
+    renderer.m_resources.memoryReport.onUiWindow();
+
     if(changed)
       renderer.resetFrame();
   }
@@ -366,6 +398,10 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
     // Display the G-Buffer tonemapped image
     ImGui::Image(ImTextureID(renderer.m_resources.gBuffers.getDescriptorSet(Resources::eImgTonemapped)),
                  ImGui::GetContentRegionAvail());
+    const ImVec2 imageMin = ImGui::GetItemRectMin();
+
+    // Color scale of the cost heatmaps
+    renderer.m_heatmap.onUiLegend(renderer.m_resources, imageMin, ImGui::GetItemRectMax());
 
     // Adding Axis at the bottom left corner of the viewport
     if(renderer.m_resources.settings.showAxis)
@@ -373,16 +409,17 @@ void GltfRendererUI::renderUI(GltfRenderer& renderer)
       nvgui::Axis(renderer.m_resources.cameraManip->getViewMatrix(), 25.f);
     }
 
+    // Scene loaded in the background: the current one stays in the viewport until it is ready
+    if(renderer.m_sceneSwap.isLoading())
+    {
+      const std::string loading = "Loading " + nvutils::utf8FromPath(renderer.m_sceneSwap.getFilename().filename());
+      ImGui::SetCursorScreenPos(ImVec2(imageMin.x + 10.0f, imageMin.y + 10.0f));
+      ImGui::ProgressBar(-.20f * float(ImGui::GetTime()), ImVec2(300.0f, 0.0f), loading.c_str());
+    }
+
     ImGui::End();
     ImGui::PopStyleVar();
   }
-
-
-  // Show the busy window if the busy flag is set
-  if(renderer.m_busy.isBusy())
-  {
-    renderer.m_busy.show();
-  }
 }
 
 void GltfRendererUI::renderMenu(GltfRenderer& renderer)
@@ -390,8 +427,8 @@ void GltfRendererUI::renderMenu(GltfRenderer& renderer)
   bool v_sync = renderer.m_app->isVsync();
 
   auto getSaveImage = [&]() {
-    std::filesystem::path filename =
-        nvgui::windowSaveFileDialog(renderer.m_app->getWindowHandle(), "Save Image", "PNG(.png),JPG(.jpg)|*.png;*.jpg");
+    std::filesystem::path filename = nvgui::windowSaveFileDialog(renderer.m_app->getWindowHandle(), "Save Image",
+                                                                 "PNG(.png),JPG(.jpg),EXR(.exr)|*.png;*.jpg;*.exr");
     if(!filename.empty())
     {
       std::filesystem::path ext = std::filesystem::path(filename).extension();
@@ -410,18 +447,21 @@ void GltfRendererUI::renderMenu(GltfRenderer& renderer)
   bool fitObject      = ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiKey_F);
   bool toggleVsyc     = ImGui::IsKeyChordPressed(ImGuiMod_Ctrl | ImGuiMod_Shift | ImGuiKey_V);
   bool reloadShader   = ImGui::IsKeyPressed(ImGuiKey_F5);
+  bool addFile        = false;
 
   if(toggleVsyc)
   {
     v_sync = !v_sync;
   }
-  bool validScene = renderer.m_resources.scene.valid();
+  bool validScene = renderer.m_resources.scene->valid();
   if(ImGui::BeginMenu("File"))
   {
     clearScene = ImGui::MenuItem("Clear Scene", "Ctrl+N");
     loadFile |= ImGui::MenuItem("Load", "Ctrl+O");
     ImGui::BeginDisabled(!validScene);  // Disable menu item if no scene is loaded
     saveFile |= ImGui::MenuItem("Save As", "Ctrl+S");
+    addFile = ImGui::MenuItem("Add to Scene");
+    ImGui::SetItemTooltip("Place a glTF file in the scene, rendered by the path tracer");
     ImGui::EndDisabled();
     ImGui::Separator();
     saveImageFile |= ImGui::MenuItem("Save Image", "Ctrl+Shift+S");
@@ -460,13 +500,13 @@ void GltfRendererUI::renderMenu(GltfRenderer& renderer)
 
     if(ImGui::MenuItem("Recreate Tangents - Simple"))
     {
-      recomputeTangents(renderer.m_resources.scene.getModel(), true, false);
+      recomputeTangents(renderer.m_resources.scene->getModel(), true, false);
       renderer.m_resources.dirtyFlags.set(DirtyFlags::eVulkanScene);
     }
     ImGui::SetItemTooltip("This recreate tangents using UV gradient method");
     if(ImGui::MenuItem("Recreate Tangents - MikkTSpace"))
     {
-      recomputeTangents(renderer.m_resources.scene.getModel(), true, true);
+      recomputeTangents(renderer.m_resources.scene->getModel(), true, true);
       renderer.m_resources.dirtyFlags.set(DirtyFlags::eVulkanScene);
     }
     ImGui::SetItemTooltip("This recreate tangents using MikkTSpace");
@@ -478,9 +518,18 @@ void GltfRendererUI::renderMenu(GltfRenderer& renderer)
 
   if(clearScene)
   {
-    renderer.m_resources.scene.destroy();
-    renderer.m_resources.sceneVk.destroy();
-    renderer.m_resources.sceneRtx.destroy();
+    renderer.m_composition.clear(renderer.m_resources);
+    renderer.m_resources.scene->destroy();
+    {
+      MemoryReport::Scope memScope(renderer.m_resources.memoryReport, MemoryCategory::eGeometry);
+      renderer.m_resources.sceneVk->destroy();
+    }
+    renderer.m_resources.memoryReport.setSceneTextures(SceneSwap::getCurrentSlot(renderer.m_resources).allocator,
+                                                       renderer.m_resources.sceneVk->textures());
+    {
+      MemoryReport::Scope memScope(renderer.m_resources.memoryReport, MemoryCategory::eAccelerationStructures);
+      renderer.m_resources.sceneRtx->destroy();
+    }
     renderer.m_resources.dirtyFlags.set(DirtyFlags::eVulkanScene);
     renderer.m_resources.selectedObject = -1;
     renderer.m_uiSceneGraph.selectNode(-1);
@@ -501,6 +550,14 @@ void GltfRendererUI::renderMenu(GltfRenderer& renderer)
     renderer.onFileDrop(filename.c_str());
   }
 
+  if(addFile)
+  {
+    std::filesystem::path filename =
+        nvgui::windowOpenFileDialog(renderer.m_app->getWindowHandle(), "Add glTF", "glTF(.gltf, .glb)|*.gltf;*.glb");
+    if(!filename.empty())
+      renderer.addToScene(filename);
+  }
+
   if(saveFile && validScene)
   {
     std::filesystem::path filename =
@@ -523,14 +580,13 @@ void GltfRendererUI::renderMenu(GltfRenderer& renderer)
     std::filesystem::path filename = getSaveImage();
     if(!filename.empty())
     {
-      renderer.m_app->saveImageToFile(renderer.m_resources.gBuffers.getColorImage(Resources::eImgTonemapped),
-                                      renderer.m_resources.gBuffers.getSize(), filename);
+      renderer.saveImage(filename);  // Tonemapped image, or linear HDR image (and AOVs) for .exr
     }
   }
 
   if(validScene && (fitScene || (fitObject && renderer.m_resources.selectedObject > -1)))
   {
-    nvutils::Bbox bbox = fitScene ? renderer.m_resources.scene.getSceneBounds() :
+    nvutils::Bbox bbox = fitScene ? renderer.m_resources.scene->getSceneBounds() :
                                     GltfRendererUI::getRenderNodeBbox(renderer, renderer.m_resources.selectedObject);
     renderer.m_resources.cameraManip->fit(bbox.min(), bbox.max(), false, true, renderer.m_resources.cameraManip->getAspectRatio());
   }
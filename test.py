@@ -1,5 +1,7 @@
 import argparse
+import shutil
 import subprocess
+import sys
 import logging
 from pathlib import Path
 from enum import Enum
@@ -13,13 +15,36 @@ logger = logging.getLogger(__name__)
 # Predefined executables and their arguments
 EXECUTABLES_WITH_ARGS = [
     ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "env3.hdr", "--envSystem", "1", "--frames", "10"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--saveExr", "--saveAovs"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--maxFrames", "7", "--output", "shader_ball.png"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--ptCounters"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--trace", "shader_ball_trace.json"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--metricsFile", "shader_ball.prom", "--metricsInterval", "0"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--memReport", "shader_ball_memory.json"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--captureEvery", "2"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--renderSystem", "1", "--taaScale", "0.67"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--svgf", "--svgfValidate"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--renderSystem", "1", "--clusterTiles", "8", "4"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--ptTextureLod", "1"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--ptSampler", "1"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--ptSampler", "2"]),
+    ("vk_gltf_renderer", ["--samplerBenchmark"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--ptGuiding", "--ptGuidingTraining", "4"]),
+    ("vk_gltf_renderer", ["--headless", "shader_ball.gltf", "--frames", "10", "--ptMaxDepth", "10", "--ptRadianceCache"]),
+    ("vk_gltf_renderer", ["--cpuRender", "shader_ball.gltf", "--frames", "4", "--size", "320", "240"]),
+    ("vk_gltf_renderer", ["--headless", "--frames", "100000", "--benchmark", "benchmark.txt", "--size", "640", "360"]),
 
 ]
 
+# Golden-image regression of the bundled scenes (utils/golden_test.py), on the GPU only
+GOLDEN_TEST = Path(__file__).resolve().parent / "utils" / "golden_test.py"
+GPU_DEVICE_TYPES = ("PHYSICAL_DEVICE_TYPE_DISCRETE_GPU", "PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU", "PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU")
+
 class ReturnCode(Enum):
     SUCCESS = 0
     TEST_ERROR = 1
     ENVIRONMENT_ERROR = 2
+    SKIPPED = 3
 
 def run_command(commands):
     """Run a command and handle potential errors."""
@@ -77,6 +102,24 @@ def test_executable(test_dir, executable, args):
         logger.error(f"Error testing {executable}: {e}")
         return (executable, ReturnCode.TEST_ERROR.value, "N/A")
 
+def has_gpu():
+    """True when vulkaninfo lists a hardware device, not only a CPU driver like lavapipe."""
+    if shutil.which("vulkaninfo") is None:
+        logger.warning("vulkaninfo not found, cannot tell whether a GPU is present")
+        return False
+    result = subprocess.run(["vulkaninfo", "--summary"], text=True, capture_output=True)
+    return result.returncode == 0 and any(t in result.stdout for t in GPU_DEVICE_TYPES)
+
+def test_golden(test_dir):
+    """Golden images of the bundled scenes on the system driver, skipped without a GPU."""
+    name = "golden_test --local"
+    if not has_gpu():
+        logger.info("No GPU: the golden-image test is skipped")
+        return (name, ReturnCode.SKIPPED.value, "N/A")
+    commands = [sys.executable, str(GOLDEN_TEST), "--local", "--icd", "", "--exe", str(test_dir / "vk_gltf_renderer")]
+    return_code = run_command(commands)
+    return (name, ReturnCode.SUCCESS.value if return_code == 0 else ReturnCode.TEST_ERROR.value, "N/A")
+
 def test_all_executables():
     """Test all predefined executables."""
     # Install directory for executables
@@ -94,6 +137,11 @@ def test_all_executables():
         results.append(result)
         if result[1] != ReturnCode.SUCCESS.value:
             overall_status = ReturnCode.TEST_ERROR
+
+    result = test_golden(test_dir)
+    results.append(result)
+    if result[1] == ReturnCode.TEST_ERROR.value:
+        overall_status = ReturnCode.TEST_ERROR
     
     return results, overall_status
 
@@ -105,7 +153,7 @@ def print_report(results):
     logger.info("-" * 80)
     
     for executable, return_code, testing_time in results:
-        status = "SUCCESS" if return_code == ReturnCode.SUCCESS.value else "FAILED"
+        status = {ReturnCode.SUCCESS.value: "SUCCESS", ReturnCode.SKIPPED.value: "SKIPPED"}.get(return_code, "FAILED")
         logger.info("{:<35} | {:<12} | {:<8}".format(
             executable, status, testing_time
         ))
@@ -0,0 +1,96 @@
+import json
+import argparse
+import logging
+import sys
+
+# Compare a benchmark report (vk_gltf_renderer --benchmark) with a baseline report, and flag the
+# measurements that became slower (or bigger) than the baseline by more than the threshold.
+# Returns 1 when a regression is found, so it can be used in a CI job.
+
+logging.basicConfig(level=logging.INFO, format="%(message)s")
+
+
+def load_report(filename):
+    with open(filename, "r") as file:
+        return json.load(file)
+
+
+def collect_metrics(report, statistic):
+    """Flatten a report to {(scene, renderer, metric): value}."""
+    metrics = {}
+    for scene in report.get("scenes", []):
+        if not scene.get("loaded", False):
+            continue
+        name = scene["name"]
+        for key in ("loadMs", "uploadMs", "blasBuildMs", "peakGpuMemoryMB"):
+            metrics[(name, "-", key)] = scene[key]
+        for run in scene.get("runs", []):
+            renderer = run["renderer"]
+            metrics[(name, renderer, "cpuFrameMs")] = run["cpuFrameMs"][statistic]
+            metrics[(name, renderer, "peakGpuMemoryMB")] = run["peakGpuMemoryMB"]
+            for section, stats in run.get("gpuMs", {}).items():
+                metrics[(name, renderer, "gpu." + section)] = stats[statistic]
+    return metrics
+
+
+def compare(baseline, current, threshold, min_delta_ms, statistic):
+    base_metrics = collect_metrics(baseline, statistic)
+    curr_metrics = collect_metrics(current, statistic)
+
+    if baseline.get("device") != current.get("device"):
+        logging.warning(f"Different devices: '{baseline.get('device')}' vs '{current.get('device')}'")
+    if baseline.get("size") != current.get("size"):
+        logging.warning(f"Different sizes: {baseline.get('size')} vs {current.get('size')}")
+
+    regressions = []
+    logging.info("{:<30} {:<20} {:<22} {:>10} {:>10} {:>8}".format("Scene", "Renderer", "Metric", "Baseline", "Current", "Change"))
+    logging.info("-" * 105)
+    for key in sorted(curr_metrics.keys()):
+        scene, renderer, metric = key
+        value = curr_metrics[key]
+        if key not in base_metrics:
+            logging.info("{:<30} {:<20} {:<22} {:>10} {:>10.3f} {:>8}".format(scene[-30:], renderer, metric, "-", value, "new"))
+            continue
+        base = base_metrics[key]
+        change = (value - base) / base if base > 0 else 0.0
+        # Small absolute differences of timings are noise, whatever their relative change
+        is_time = metric.endswith("Ms") or metric.startswith("gpu.")
+        significant = (value - base) > min_delta_ms if is_time else True
+        flag = ""
+        if change > threshold and significant:
+            flag = "  <-- REGRESSION"
+            regressions.append(key)
+        elif change < -threshold and significant:
+            flag = "  (improved)"
+        logging.info(
+            "{:<30} {:<20} {:<22} {:>10.3f} {:>10.3f} {:>+7.1f}%{}".format(
+                scene[-30:], renderer, metric, base, value, change * 100.0, flag
+            )
+        )
+    for key in sorted(set(base_metrics.keys()) - set(curr_metrics.keys())):
+        logging.warning(f"Missing in the current report: {' / '.join(key)}")
+
+    logging.info("-" * 105)
+    if regressions:
+        logging.error(f"{len(regressions)} regression(s) above {threshold * 100.0:.1f}%")
+    else:
+        logging.info("No regression")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare a benchmark report with a baseline and flag the regressions.")
+    parser.add_argument("baseline", help="Baseline JSON report.")
+    parser.add_argument("current", help="JSON report to check.")
+    parser.add_argument("--threshold", type=float, default=0.05, help="Relative increase flagged as a regression (default: 0.05).")
+    parser.add_argument("--min-delta-ms", type=float, default=0.05, help="Ignore timing differences below this value (default: 0.05).")
+    parser.add_argument("--statistic", choices=["mean", "median", "p95", "min", "max"], default="median",
+                        help="Statistic of the frame timings to compare (default: median).")
+    args = parser.parse_args()
+
+    regressions = compare(load_report(args.baseline), load_report(args.current), args.threshold, args.min_delta_ms, args.statistic)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,386 @@
+import argparse
+import hashlib
+import json
+import logging
+import os
+import subprocess
+import sys
+import urllib.request
+from pathlib import Path
+
+import numpy as np
+from PIL import Image
+
+# Golden-image regression: render the scenes of golden/scenes.json in headless mode with a fixed
+# number of samples per pixel, and compare them with the stored references using the LDR-FLIP
+# perceptual metric (Andersson et al. 2020). The path tracer is deterministic for a given frame
+# index, so the same driver gives the same image; the tolerance of each scene absorbs the
+# differences between drivers and compilers.
+# Without a GPU, the renderer runs on lavapipe, the software Vulkan driver of Mesa.
+# Returns 1 when a scene is above its tolerance, and writes the error map next to the rendered image.
+#
+# The references are generated on the CI device with --update: references/index.json records, for
+# each scene, the driver, size, samples and tolerance they were rendered with. A scene of the index
+# whose image is missing fails, and so does a scene added to scenes.json after the references were
+# generated, until its reference is added with `--update --scene <name>`.
+#
+# The models of the glTF Sample Assets are pinned: "assets" of scenes.json gives the commit they are
+# downloaded from, and each scene the SHA-256 of its file, checked after every download and before
+# using the cached copy. `--pin <commit>` downloads them at that commit and records the checksums.
+# `--local` only runs the scenes using the bundled resources, without any download (test.py).
+# Returns 2 when there are no references to compare with.
+
+logging.basicConfig(level=logging.INFO, format="%(message)s")
+
+SCRIPT_DIR = Path(__file__).resolve().parent
+GOLDEN_DIR = SCRIPT_DIR / "golden"
+EXTRA_FRAMES = 32  # Frames spent uploading the scene and building the acceleration structures
+
+
+#--------------------------------------------------------------------------------------------------
+# LDR-FLIP
+# Straight port of the reference implementation (https://github.com/NVlabs/flip), for sRGB images
+# in [0,1]. flip_evaluator is used instead when it is installed.
+
+def srgb_to_linear(img):
+    return np.where(img <= 0.04045, img / 12.92, np.power((img + 0.055) / 1.055, 2.4))
+
+
+RGB_TO_XYZ = np.array([[0.4124, 0.3576, 0.1805], [0.2126, 0.7152, 0.0722], [0.0193, 0.1192, 0.9505]])
+XYZ_TO_RGB = np.linalg.inv(RGB_TO_XYZ)
+WHITE_XYZ = RGB_TO_XYZ.sum(axis=1)  # D65, reference white of the conversions
+
+
+def linear_to_ycxcz(rgb):
+    xyz = (rgb @ RGB_TO_XYZ.T) / WHITE_XYZ
+    return np.stack([116.0 * xyz[..., 1] - 16.0, 500.0 * (xyz[..., 0] - xyz[..., 1]), 200.0 * (xyz[..., 1] - xyz[..., 2])], axis=-1)
+
+
+def ycxcz_to_linear(ycxcz):
+    y = (ycxcz[..., 0] + 16.0) / 116.0
+    x = y + ycxcz[..., 1] / 500.0
+    z = y - ycxcz[..., 2] / 200.0
+    xyz = np.stack([x, y, z], axis=-1) * WHITE_XYZ
+    return xyz @ XYZ_TO_RGB.T
+
+
+def linear_to_hunt_lab(rgb):
+    xyz = (rgb @ RGB_TO_XYZ.T) / WHITE_XYZ
+    delta = 6.0 / 29.0
+    f = np.where(xyz > delta**3, np.cbrt(xyz), xyz / (3.0 * delta * delta) + 4.0 / 29.0)
+    l = 116.0 * f[..., 1] - 16.0
+    a = 500.0 * (f[..., 0] - f[..., 1])
+    b = 200.0 * (f[..., 1] - f[..., 2])
+    # Hunt effect: the chroma is perceived lower in dark regions
+    return np.stack([l, 0.01 * l * a, 0.01 * l * b], axis=-1)
+
+
+def hyab(lab0, lab1):
+    d = lab0 - lab1
+    return np.abs(d[..., 0]) + np.sqrt(d[..., 1] ** 2 + d[..., 2] ** 2)
+
+
+def convolve_separable(img, kernel_x, kernel_y):
+    """2D convolution of a single channel image, with symmetric borders like the reference."""
+    rx, ry = len(kernel_x) // 2, len(kernel_y) // 2
+    padded = np.pad(img, ((ry, ry), (rx, rx)), mode="symmetric")
+    h, w = img.shape
+    rows = np.zeros((h + 2 * ry, w))
+    for i, k in enumerate(kernel_x):
+        rows += k * padded[:, i:i + w]
+    result = np.zeros((h, w))
+    for i, k in enumerate(kernel_y):
+        result += k * rows[i:i + h, :]
+    return result
+
+
+def csf_filter(ycxcz, ppd):
+    """Contrast sensitivity of the achromatic, red-green and blue-yellow channels.
+    Each filter is a sum of (separable) Gaussians."""
+    params = [[(1.0, 0.0047), (0.0, 1e-5)], [(1.0, 0.0053), (0.0, 1e-5)], [(34.1, 0.04), (13.5, 0.025)]]
+    radius = int(np.ceil(3.0 * np.sqrt(0.04 / (2.0 * np.pi**2)) * ppd))
+    x = np.arange(-radius, radius + 1) / ppd
+    result = np.zeros_like(ycxcz)
+    for c, gaussians in enumerate(params):
+        terms = [(a * np.sqrt(np.pi / b), np.exp(-np.pi**2 * x * x / b)) for a, b in gaussians]
+        total = sum(scale * g.sum() ** 2 for scale, g in terms)
+        for scale, g in terms:
+            if scale > 0.0:
+                result[..., c] += (scale / total) * convolve_separable(ycxcz[..., c], g, g)
+    return result
+
+
+def feature_kernels(ppd):
+    sigma = 0.5 * 0.082 * ppd
+    radius = int(np.ceil(3.0 * sigma))
+    x = np.arange(-radius, radius + 1, dtype=np.float64)
+    g = np.exp(-(x * x) / (2.0 * sigma * sigma))
+    kernels = []
+    for k in (-x * g, (x * x / (sigma * sigma) - 1.0) * g):  # Edges, points
+        k = k.copy()
+        k[k > 0] /= k[k > 0].sum()
+        k[k < 0] /= -k[k < 0].sum()
+        kernels.append(k)
+    return kernels, g / g.sum()
+
+
+def feature_magnitudes(luminance, ppd):
+    (edge, point), smooth = feature_kernels(ppd)
+    edges = np.hypot(convolve_separable(luminance, edge, smooth), convolve_separable(luminance, smooth, edge))
+    points = np.hypot(convolve_separable(luminance, point, smooth), convolve_separable(luminance, smooth, point))
+    return edges, points
+
+
+def flip_ldr(reference, test, ppd):
+    """Per-pixel FLIP error of two sRGB images (HxWx3, [0,1])."""
+    qc, qf, pc, pt = 0.7, 0.5, 0.4, 0.95
+
+    ref_ycxcz = linear_to_ycxcz(srgb_to_linear(reference))
+    test_ycxcz = linear_to_ycxcz(srgb_to_linear(test))
+
+    # Color pipeline
+    ref_lab = linear_to_hunt_lab(np.clip(ycxcz_to_linear(csf_filter(ref_ycxcz, ppd)), 0.0, 1.0))
+    test_lab = linear_to_hunt_lab(np.clip(ycxcz_to_linear(csf_filter(test_ycxcz, ppd)), 0.0, 1.0))
+    green_blue = linear_to_hunt_lab(np.array([[0.0, 1.0, 0.0], [0.0, 0.0, 1.0]]))
+    cmax = np.power(hyab(green_blue[0], green_blue[1]), qc)
+    delta_c = np.power(hyab(ref_lab, test_lab), qc)
+    delta_c = np.where(delta_c < pc * cmax, (pt / (pc * cmax)) * delta_c,
+                       pt + ((delta_c - pc * cmax) / (cmax - pc * cmax)) * (1.0 - pt))
+
+    # Feature pipeline, on the achromatic channel normalized to [0,1]
+    ref_edges, ref_points = feature_magnitudes((ref_ycxcz[..., 0] + 16.0) / 116.0, ppd)
+    test_edges, test_points = feature_magnitudes((test_ycxcz[..., 0] + 16.0) / 116.0, ppd)
+    delta_f = np.maximum(np.abs(ref_edges - test_edges), np.abs(ref_points - test_points))
+    delta_f = np.power(np.clip(delta_f / np.sqrt(2.0), 0.0, 1.0), qf)
+
+    return np.power(delta_c, 1.0 - delta_f)
+
+
+def compute_flip(reference, test, ppd):
+    try:
+        import flip_evaluator
+        error_map, _, _ = flip_evaluator.evaluate(reference.astype(np.float32), test.astype(np.float32), "LDR",
+                                                  parameters={"ppd": ppd})
+        return np.squeeze(np.asarray(error_map))
+    except ImportError:
+        return flip_ldr(reference, test, ppd)
+
+
+def error_to_heatmap(error):
+    """Magma color map, like the error maps of the FLIP tool."""
+    stops = np.array([[0.001, 0.000, 0.014], [0.231, 0.060, 0.439], [0.550, 0.161, 0.506],
+                      [0.868, 0.288, 0.409], [0.994, 0.624, 0.427], [0.987, 0.991, 0.750]])
+    t = np.clip(error, 0.0, 1.0) * (len(stops) - 1)
+    i = np.minimum(t.astype(int), len(stops) - 2)
+    f = (t - i)[..., None]
+    return stops[i] * (1.0 - f) + stops[i + 1] * f
+
+
+def load_image(filename):
+    return np.asarray(Image.open(filename).convert("RGB"), dtype=np.float64) / 255.0
+
+
+def save_image(filename, img):
+    Image.fromarray((np.clip(img, 0.0, 1.0) * 255.0 + 0.5).astype(np.uint8)).save(filename)
+
+
+#--------------------------------------------------------------------------------------------------
+# Rendering
+
+def find_lavapipe_icd():
+    for directory in ("/usr/share/vulkan/icd.d", "/usr/local/share/vulkan/icd.d", "/etc/vulkan/icd.d"):
+        for icd in sorted(Path(directory).glob("lvp_icd*.json")):
+            return icd
+    return None
+
+
+def sha256(filename):
+    digest = hashlib.sha256()
+    with open(filename, "rb") as f:
+        for block in iter(lambda: f.read(1 << 20), b""):
+            digest.update(block)
+    return digest.hexdigest()
+
+
+def asset_url(assets, entry, commit=None):
+    return assets["url"].format(commit=commit or assets["commit"]) + entry["asset"]
+
+
+def fetch_scene(entry, assets, cache_dir):
+    """Local resource names are resolved by the renderer. The assets are downloaded once at the pinned
+    commit, in a cache directory of that commit, and must match their checksum."""
+    if "asset" not in entry:
+        return entry["scene"]
+    if not assets["commit"] or not entry.get("sha256"):
+        logging.error(f"{entry['name']:<30} {entry['asset']} is not pinned: run with --pin <commit>")
+        return None
+    filename = cache_dir / assets["commit"] / entry["asset"].rsplit("/", 1)[-1]
+    if not filename.exists():
+        url = asset_url(assets, entry)
+        logging.info(f"Downloading {url}")
+        filename.parent.mkdir(parents=True, exist_ok=True)
+        urllib.request.urlretrieve(url, filename)
+    checksum = sha256(filename)
+    if checksum != entry["sha256"]:
+        logging.error(f"{entry['name']:<30} {filename} has SHA-256 {checksum}, expected {entry['sha256']}")
+        filename.unlink()
+        return None
+    return str(filename)
+
+
+def pin_assets(manifest_file, manifest, commit, cache_dir):
+    """Download the assets at the commit, and write the commit and their checksums to the manifest."""
+    assets = manifest["assets"]
+    for entry in manifest["scenes"]:
+        if "asset" not in entry:
+            continue
+        url = asset_url(assets, entry, commit)
+        filename = cache_dir / commit / entry["asset"].rsplit("/", 1)[-1]
+        filename.parent.mkdir(parents=True, exist_ok=True)
+        logging.info(f"Downloading {url}")
+        urllib.request.urlretrieve(url, filename)
+        entry["sha256"] = sha256(filename)
+        logging.info(f"{entry['name']:<30} {entry['sha256']}")
+    assets["commit"] = commit
+    manifest_file.write_text(json.dumps(manifest, indent=2) + "\n")
+    logging.info(f"Pinned the assets to {commit} in {manifest_file}")
+
+
+def render(executable, entry, scene, size, output, env):
+    spp = entry["spp"]
+    commands = [str(executable), "--headless", scene]
+    if "hdr" in entry:
+        commands.append(entry["hdr"])
+    commands += ["--frames", str(spp + EXTRA_FRAMES), "--maxFrames", str(spp - 1), "--ptSamples", "1",
+                 "--size", str(size[0]), str(size[1]), "--output", str(output)]
+    commands += entry.get("args", [])
+    logging.info(f"Running command: {' '.join(commands)}")
+    result = subprocess.run(commands, env=env, text=True, capture_output=True)
+    if result.returncode != 0 or not output.exists():
+        logging.error(f"Rendering failed ({result.returncode}):\n{result.stdout}\n{result.stderr}")
+        return False
+    return True
+
+
+def driver_name(icd):
+    """Name of the Vulkan driver the references were rendered with."""
+    return Path(icd).stem if icd else "system"
+
+
+def load_index(references):
+    index_file = references / "index.json"
+    return json.loads(index_file.read_text()) if index_file.exists() else None
+
+
+def save_index(references, index):
+    references.mkdir(parents=True, exist_ok=True)
+    (references / "index.json").write_text(json.dumps(index, indent=2) + "\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Render the golden scenes and compare them with the references.")
+    parser.add_argument("--exe", type=Path, default=Path("_install/vk_gltf_renderer"), help="Renderer executable (default: _install/vk_gltf_renderer).")
+    parser.add_argument("--manifest", type=Path, default=GOLDEN_DIR / "scenes.json", help="Scenes, samples per pixel and tolerances.")
+    parser.add_argument("--references", type=Path, default=GOLDEN_DIR / "references", help="Directory of the reference images.")
+    parser.add_argument("--output", type=Path, default=Path("_golden"), help="Directory of the rendered images and error maps (default: _golden).")
+    parser.add_argument("--icd", help="Vulkan ICD manifest to use (default: lavapipe when found, '' for the system driver).")
+    parser.add_argument("--scene", action="append", help="Only run the named scene (can be repeated).")
+    parser.add_argument("--update", action="store_true", help="Replace the references with the rendered images.")
+    parser.add_argument("--local", action="store_true", help="Only run the scenes of the bundled resources, nothing is downloaded.")
+    parser.add_argument("--pin", metavar="COMMIT", help="Download the assets at this glTF-Sample-Assets commit and record their SHA-256.")
+    args = parser.parse_args()
+
+    manifest = json.loads(args.manifest.read_text())
+    size = manifest.get("size", [320, 240])
+    ppd = manifest.get("pixelsPerDegree", 67.0)
+    assets = manifest.get("assets", {"url": "", "commit": ""})
+    cache_dir = args.output / "models"
+    if args.pin:
+        pin_assets(args.manifest, manifest, args.pin, cache_dir)
+        return 0
+    scenes = [s for s in manifest["scenes"] if (not args.scene or s["name"] in args.scene) and not (args.local and "asset" in s)]
+
+    env = dict(os.environ)
+    icd = args.icd if args.icd is not None else find_lavapipe_icd()
+    if icd:
+        logging.info(f"Vulkan driver: {icd}")
+        env["VK_DRIVER_FILES"] = str(icd)
+        env["VK_ICD_FILENAMES"] = str(icd)  # Loaders before 1.3.207
+    else:
+        logging.warning("Lavapipe not found, using the system Vulkan driver")
+
+    index = load_index(args.references)
+    if index is None and not args.update:
+        logging.error(f"No references in {args.references}: generate them on the CI device with --update")
+        return 2
+    if index is None:
+        index = {"size": size, "scenes": {}}
+    if index.get("size", size) != size and not args.update:
+        logging.error(f"The references are {index['size']}, the manifest renders {size}: run with --update")
+        return 1
+
+    args.output.mkdir(parents=True, exist_ok=True)
+    failures = []
+    logging.info("-" * 80)
+    for entry in scenes:
+        name = entry["name"]
+        rendered = (args.output / f"{name}.png").resolve()
+        rendered.unlink(missing_ok=True)
+        scene = fetch_scene(entry, assets, cache_dir)
+        if scene is None or not render(args.exe, entry, scene, size, rendered, env):
+            failures.append(name)
+            continue
+
+        reference_file = args.references / f"{name}.png"
+        if args.update:
+            args.references.mkdir(parents=True, exist_ok=True)
+            save_image(reference_file, load_image(rendered))
+            index["size"] = size
+            index["scenes"][name] = {"driver": driver_name(icd), "spp": entry["spp"], "tolerance": entry.get("tolerance", 0.05)}
+            save_index(args.references, index)
+            logging.info(f"{name:<30} reference updated")
+            continue
+        recorded = index["scenes"].get(name)
+        if recorded is None:
+            logging.error(f"{name:<30} added after the references were generated: run with --update --scene {name}")
+            failures.append(name)
+            continue
+        if not reference_file.exists():
+            logging.error(f"{name:<30} missing reference {reference_file}, recorded in the index")
+            failures.append(name)
+            continue
+        if recorded["driver"] != driver_name(icd):
+            logging.warning(f"{name:<30} reference rendered with {recorded['driver']}, running on {driver_name(icd)}")
+        if recorded["spp"] != entry["spp"]:
+            logging.error(f"{name:<30} rendered with {entry['spp']} spp, the reference with {recorded['spp']}: run with --update")
+            failures.append(name)
+            continue
+
+        reference = load_image(reference_file)
+        test = load_image(rendered)
+        if reference.shape != test.shape:
+            logging.error(f"{name:<30} size mismatch {test.shape[1]}x{test.shape[0]}, reference {reference.shape[1]}x{reference.shape[0]}")
+            failures.append(name)
+            continue
+
+        error = compute_flip(reference, test, ppd)
+        mean_error = float(error.mean())
+        tolerance = recorded["tolerance"]  # The tolerance the reference was generated with
+        if mean_error > tolerance:
+            diff_file = args.output / f"{name}_diff.png"
+            save_image(diff_file, error_to_heatmap(error))
+            logging.error(f"{name:<30} FLIP {mean_error:.4f} > {tolerance:.4f}  <-- FAILED, see {diff_file}")
+            failures.append(name)
+        else:
+            logging.info(f"{name:<30} FLIP {mean_error:.4f} <= {tolerance:.4f}")
+
+    logging.info("-" * 80)
+    if failures:
+        logging.error(f"{len(failures)} of {len(scenes)} scene(s) failed: {', '.join(failures)}")
+        return 1
+    logging.info(f"All {len(scenes)} scene(s) passed")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
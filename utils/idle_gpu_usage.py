@@ -0,0 +1,77 @@
+import argparse
+import logging
+import subprocess
+import sys
+import time
+import urllib.request
+
+from metrics_scrape import parse
+
+# Measures the GPU utilization of the interactive renderer while it is active and while it is idle
+# (--idle): nvidia-smi is sampled at each interval, and the gltf_renderer_idle gauge of the metrics
+# endpoint tells in which state the renderer was. Start the renderer with --metricsPort, load a
+# scene, let the path tracer converge and leave the window alone, e.g.:
+#   python idle_gpu_usage.py --port 9400 --duration 60 -- vk_gltf_renderer shader_ball.gltf --maxFrames 200 --metricsPort 9400
+# Without a command, an already running renderer is measured. Returns 1 when the idle utilization
+# is above --max-idle, or when no idle sample was taken.
+
+logging.basicConfig(level=logging.INFO, format="%(message)s")
+
+
+def gpu_utilization(gpu):
+    output = subprocess.check_output(
+        ["nvidia-smi", f"--id={gpu}", "--query-gpu=utilization.gpu", "--format=csv,noheader,nounits"], text=True
+    )
+    return float(output.strip().splitlines()[0])
+
+
+def is_idle(port):
+    with urllib.request.urlopen(f"http://127.0.0.1:{port}/metrics", timeout=5) as response:
+        samples, _ = parse(response.read().decode())
+    return samples.get("gltf_renderer_idle", {}).get("", 0) > 0
+
+
+def mean(values):
+    return sum(values) / len(values) if values else 0.0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="GPU utilization of the renderer, active and idle.")
+    parser.add_argument("--port", type=int, default=9400, help="Port of the metrics endpoint (default: 9400).")
+    parser.add_argument("--gpu", type=int, default=0, help="Index of the GPU for nvidia-smi (default: 0).")
+    parser.add_argument("--interval", type=float, default=0.5, help="Seconds between two samples (default: 0.5).")
+    parser.add_argument("--duration", type=float, default=30.0, help="Seconds of measurement (default: 30).")
+    parser.add_argument("--max-idle", type=float, default=5.0, help="Highest idle utilization, in percent (default: 5).")
+    parser.add_argument("command", nargs=argparse.REMAINDER, help="Renderer to start, after --.")
+    args = parser.parse_args()
+
+    command = args.command[1:] if args.command[:1] == ["--"] else args.command
+    process = subprocess.Popen(command) if command else None
+    active, idle = [], []
+    try:
+        end = time.monotonic() + args.duration
+        while time.monotonic() < end and (not process or process.poll() is None):
+            time.sleep(args.interval)
+            try:
+                state = is_idle(args.port)
+            except OSError:
+                continue  # Not listening yet
+            (idle if state else active).append(gpu_utilization(args.gpu))
+    finally:
+        if process and process.poll() is None:
+            process.terminate()
+            process.wait()
+
+    logging.info(f"active: {len(active)} samples, {mean(active):.1f}% GPU")
+    logging.info(f"idle:   {len(idle)} samples, {mean(idle):.1f}% GPU")
+    if not idle:
+        logging.error("No idle sample: the renderer never became idle")
+        return 1
+    if mean(idle) > args.max_idle:
+        logging.error(f"Idle utilization above {args.max_idle}%")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
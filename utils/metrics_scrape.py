@@ -0,0 +1,115 @@
+import argparse
+import logging
+import subprocess
+import sys
+import time
+import urllib.request
+from pathlib import Path
+
+# Stand-in for a Prometheus scraper: reads the metrics of the renderer (--metricsPort or
+# --metricsFile), checks that they parse and that the expected series are present, and prints
+# a summary of each scrape. With a command after `--`, the renderer is started first and the
+# script scrapes it until it exits, e.g.:
+#   python metrics_scrape.py --port 9400 -- vk_gltf_renderer --headless --frames 2000 --metricsPort 9400
+# Returns 1 when a scrape fails or a series is missing.
+
+logging.basicConfig(level=logging.INFO, format="%(message)s")
+
+REQUIRED = [
+    "gltf_renderer_uptime_seconds",
+    "gltf_renderer_frame_time_seconds",
+    "gltf_renderer_frames_per_second",
+    "gltf_renderer_samples_total",
+    "gltf_renderer_samples_per_second",
+    "gltf_renderer_frame_count",
+    "gltf_renderer_queued_command_buffers",
+    "gltf_renderer_memory_usage_bytes",
+    "gltf_renderer_scene_load_seconds",
+    "gltf_renderer_log_messages_total",
+]
+
+
+def parse(text):
+    """Parse the Prometheus text format into {name: {labels: value}} and {name: type}."""
+    samples, types = {}, {}
+    for line in text.splitlines():
+        line = line.strip()
+        if not line:
+            continue
+        if line.startswith("#"):
+            parts = line.split()
+            if len(parts) >= 4 and parts[1] == "TYPE":
+                types[parts[2]] = parts[3]
+            continue
+        series, value = line.rsplit(" ", 1)
+        name, labels = (series.split("{", 1) + [""])[:2]
+        samples.setdefault(name, {})[labels.rstrip("}")] = float(value)
+    return samples, types
+
+
+def scrape(args):
+    if args.file:
+        return Path(args.file).read_text()
+    with urllib.request.urlopen(f"http://127.0.0.1:{args.port}/metrics", timeout=5) as response:
+        return response.read().decode()
+
+
+def check(text):
+    samples, types = parse(text)
+    missing = [name for name in REQUIRED if name not in types]
+    if missing:
+        logging.error(f"Missing metrics: {', '.join(missing)}")
+        return False
+    frame = samples.get("gltf_renderer_frame_time_seconds", {})
+    p50 = 1000 * frame.get('quantile="0.5"', 0)
+    p99 = 1000 * frame.get('quantile="0.99"', 0)
+    errors = samples["gltf_renderer_log_messages_total"].get('level="error"', 0)
+    logging.info(
+        f"fps {samples['gltf_renderer_frames_per_second']['']:.1f}  p50 {p50:.2f} ms  p99 {p99:.2f} ms"
+        f"  samples/s {samples['gltf_renderer_samples_per_second']['']:.3g}"
+        f"  frame {samples['gltf_renderer_frame_count']['']:.0f}"
+        f"  queued {samples['gltf_renderer_queued_command_buffers']['']:.0f}  errors {errors:.0f}"
+    )
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scrape and check the metrics of the renderer.")
+    parser.add_argument("--port", type=int, default=9400, help="Port of the metrics endpoint (default: 9400).")
+    parser.add_argument("--file", help="Read this metrics file instead of the endpoint.")
+    parser.add_argument("--interval", type=float, default=1.0, help="Seconds between two scrapes (default: 1).")
+    parser.add_argument("--count", type=int, default=5, help="Number of scrapes without a command (default: 5).")
+    parser.add_argument("command", nargs=argparse.REMAINDER, help="Renderer to start, after --.")
+    args = parser.parse_args()
+
+    command = args.command[1:] if args.command[:1] == ["--"] else args.command
+    process = subprocess.Popen(command) if command else None
+    ok = True
+    scrapes = 0
+    attempts = 0
+    try:
+        while (process and process.poll() is None) or (not process and attempts < args.count):
+            attempts += 1
+            time.sleep(args.interval)
+            try:
+                text = scrape(args)
+            except OSError as e:
+                if process and scrapes == 0:
+                    continue  # Not listening yet
+                logging.error(f"Scrape failed: {e}")
+                ok = False
+                continue
+            ok &= check(text)
+            scrapes += 1
+    finally:
+        if process:
+            process.wait()
+            ok &= process.returncode == 0
+    if scrapes == 0:
+        logging.error("No successful scrape")
+        ok = False
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())